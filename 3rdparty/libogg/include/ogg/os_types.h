@@ -19,10 +19,29 @@
 
 /* make it easy on the folks that want to compile the libs with a
    different malloc than stdlib */
+#ifdef PLAYAU_CODEC_ALLOCATOR
+/* PlayAU: route codec memory through the engine allocator */
+#include <stddef.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern void *playau_codec_malloc(size_t len);
+extern void *playau_codec_calloc(size_t count,size_t len);
+extern void *playau_codec_realloc(void *ptr,size_t len);
+extern void  playau_codec_free(void *ptr);
+#ifdef __cplusplus
+}
+#endif
+#define _ogg_malloc  playau_codec_malloc
+#define _ogg_calloc  playau_codec_calloc
+#define _ogg_realloc playau_codec_realloc
+#define _ogg_free    playau_codec_free
+#else
 #define _ogg_malloc  malloc
 #define _ogg_calloc  calloc
 #define _ogg_realloc realloc
 #define _ogg_free    free
+#endif
 
 #if defined(_WIN32)
 
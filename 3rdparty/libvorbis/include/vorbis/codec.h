@@ -217,6 +217,32 @@ extern long     vorbis_packet_blocksize(vorbis_info *vi,ogg_packet *op);
 extern int      vorbis_synthesis_halfrate(vorbis_info *v,int flag);
 extern int      vorbis_synthesis_halfrate_p(vorbis_info *v);
 
+/* Vorbis PRIMITIVES: decoder pool hooks (PlayAU) *******************/
+
+/* Lets the host keep unpacked codec setups (codebooks, floor/residue
+   params) and warm synthesis states alive between streams of the same
+   asset.  A setup is identified by a hash of the setup header mixed
+   with rate, channels and blocksizes.  Pooled setups are immutable
+   and may be shared by concurrent streams.  All hooks may be called
+   from any decoding thread. */
+typedef struct vorbis_pool_callbacks {
+  void *ctx;
+  /* returns a pooled setup for the key with a new reference or NULL */
+  void *(*setup_acquire)(void *ctx,ogg_uint64_t key);
+  /* offers a freshly unpacked setup, nonzero if the pool took it */
+  int   (*setup_insert)(void *ctx,ogg_uint64_t key,vorbis_info *vi);
+  /* drops a reference of a pooled setup, nonzero if the pool kept it */
+  int   (*setup_release)(void *ctx,void *setup);
+  /* fills v with a parked state of the setup, nonzero on hit */
+  int   (*dsp_acquire)(void *ctx,void *setup,vorbis_dsp_state *v);
+  /* offers a synthesis state, nonzero if the pool parked it */
+  int   (*dsp_release)(void *ctx,void *setup,vorbis_dsp_state *v);
+} vorbis_pool_callbacks;
+
+extern void     vorbis_pool_set(const vorbis_pool_callbacks *cb);
+extern void     vorbis_setup_destroy(void *setup);
+extern void     vorbis_dsp_destroy(vorbis_dsp_state *v);
+
 /* Vorbis ERRORS and return codes ***********************************/
 
 #define OV_FALSE      -1
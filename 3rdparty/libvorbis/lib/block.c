@@ -288,7 +288,7 @@ static int _vds_shared_init(vorbis_dsp_state *v,vorbis_info *vi,int encp){
       ci->book_param[i]=NULL;
     }
   }
-  vorbis_dsp_clear(v);
+  vorbis_dsp_destroy(v);
   return -1;
 }
 
@@ -314,6 +314,22 @@ int vorbis_analysis_init(vorbis_dsp_state *v,vorbis_info *vi){
 }
 
 void vorbis_dsp_clear(vorbis_dsp_state *v){
+  if(v){
+    vorbis_info *vi=v->vi;
+    codec_setup_info *ci=(vi?vi->codec_setup:NULL);
+
+    /* warm synthesis states of pooled setups go back to the pool */
+    if(ci && ci->setup_key && v->backend_state && !v->analysisp &&
+       _vorbis_pool &&
+       _vorbis_pool->dsp_release(_vorbis_pool->ctx,ci,v)){
+      memset(v,0,sizeof(*v));
+      return;
+    }
+  }
+  vorbis_dsp_destroy(v);
+}
+
+void vorbis_dsp_destroy(vorbis_dsp_state *v){
   int i;
   if(v){
     vorbis_info *vi=v->vi;
@@ -707,8 +723,20 @@ int vorbis_synthesis_restart(vorbis_dsp_state *v){
 }
 
 int vorbis_synthesis_init(vorbis_dsp_state *v,vorbis_info *vi){
+  codec_setup_info *ci=vi->codec_setup;
+
+  /* reuse a parked state, lookups and pcm storage are already sized */
+  if(ci && ci->setup_key && _vorbis_pool &&
+     _vorbis_pool->dsp_acquire(_vorbis_pool->ctx,ci,v)){
+    v->vi=vi;
+    v->lW=v->W=v->nW=0;
+    v->glue_bits=v->time_bits=v->floor_bits=v->res_bits=0;
+    vorbis_synthesis_restart(v);
+    return 0;
+  }
+
   if(_vds_shared_init(v,vi,0)){
-    vorbis_dsp_clear(v);
+    vorbis_dsp_destroy(v);
     return 1;
   }
   vorbis_synthesis_restart(v);
@@ -724,7 +752,7 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
   codec_setup_info *ci=vi->codec_setup;
   private_state *b=v->backend_state;
   int hs=ci->halfrate_flag;
-  int i,j;
+  int j;
 
   if(!vb)return(OV_EINVAL);
   if(v->pcm_current>v->pcm_returned  && v->pcm_returned!=-1)return(OV_EINVAL);
@@ -775,15 +803,13 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
           const float *w=_vorbis_window_get(b->window[1]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j];
-          for(i=0;i<n1;i++)
-            pcm[i]=pcm[i]*w[n1-i-1] + p[i]*w[i];
+          _vorbis_window_lap(pcm,p,w,n1);
         }else{
           /* large/small */
           const float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter+n1/2-n0/2;
           float *p=vb->pcm[j];
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
+          _vorbis_window_lap(pcm,p,w,n0);
         }
       }else{
         if(v->W){
@@ -791,17 +817,14 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
           const float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j]+n1/2-n0/2;
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
-          for(;i<n1/2+n0/2;i++)
-            pcm[i]=p[i];
+          _vorbis_window_lap(pcm,p,w,n0);
+          memcpy(pcm+n0,p+n0,(n1/2-n0/2)*sizeof(*pcm));
         }else{
           /* small/small */
           const float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j];
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
+          _vorbis_window_lap(pcm,p,w,n0);
         }
       }
 
@@ -809,8 +832,7 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
       {
         float *pcm=v->pcm[j]+thisCenter;
         float *p=vb->pcm[j]+n;
-        for(i=0;i<n;i++)
-          pcm[i]=p[i];
+        memcpy(pcm,p,n*sizeof(*pcm));
       }
     }
 
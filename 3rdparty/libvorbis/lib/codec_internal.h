@@ -128,8 +128,12 @@ typedef struct codec_setup_info {
                                 highly redundant structure, but
                                 improves clarity of program flow. */
   int         halfrate_flag; /* painless downsample for decode */
+  ogg_uint64_t setup_key;    /* nonzero if owned by the decoder pool */
 } codec_setup_info;
 
+/* decoder pool hooks, NULL if not installed */
+extern const vorbis_pool_callbacks *_vorbis_pool;
+
 extern vorbis_look_psy_global *_vp_global_look(vorbis_info *vi);
 extern void _vp_global_free(vorbis_look_psy_global *look);
 
@@ -147,8 +147,14 @@ void vorbis_info_init(vorbis_info *vi){
   vi->codec_setup=_ogg_calloc(1,sizeof(codec_setup_info));
 }
 
-void vorbis_info_clear(vorbis_info *vi){
-  codec_setup_info     *ci=vi->codec_setup;
+const vorbis_pool_callbacks *_vorbis_pool=NULL;
+
+void vorbis_pool_set(const vorbis_pool_callbacks *cb){
+  _vorbis_pool=cb;
+}
+
+void vorbis_setup_destroy(void *setup){
+  codec_setup_info     *ci=setup;
   int i;
 
   if(ci){
@@ -190,6 +196,15 @@ void vorbis_info_clear(vorbis_info *vi){
 
     _ogg_free(ci);
   }
+}
+
+void vorbis_info_clear(vorbis_info *vi){
+  codec_setup_info     *ci=vi->codec_setup;
+
+  /* pooled setups go back to the pool */
+  if(!ci || !ci->setup_key || !_vorbis_pool ||
+     !_vorbis_pool->setup_release(_vorbis_pool->ctx,ci))
+    vorbis_setup_destroy(ci);
 
   memset(vi,0,sizeof(*vi));
 }
@@ -335,6 +350,72 @@ static int _vorbis_unpack_books(vorbis_info *vi,oggpack_buffer *opb){
   return(OV_EBADHEADER);
 }
 
+/* hash of the setup header mixed with the stream basics, never 0 */
+static ogg_uint64_t _vorbis_setup_key(vorbis_info *vi,ogg_packet *op){
+  codec_setup_info     *ci=vi->codec_setup;
+  ogg_uint64_t key=0xcbf29ce484222325ULL;
+  long i;
+
+  for(i=0;i<op->bytes;i++){
+    key^=op->packet[i];
+    key*=0x100000001b3ULL;
+  }
+  key^=(ogg_uint64_t)vi->channels;
+  key*=0x100000001b3ULL;
+  key^=(ogg_uint64_t)vi->rate;
+  key*=0x100000001b3ULL;
+  key^=(ogg_uint64_t)ci->blocksizes[0]<<32|(ogg_uint64_t)ci->blocksizes[1];
+  key*=0x100000001b3ULL;
+  return(key?key:1);
+}
+
+/* build the decode codebooks up front; a pooled setup is shared by
+   concurrent streams and must not be touched after insertion */
+static int _vorbis_finish_books(codec_setup_info *ci){
+  int i;
+  ci->fullbooks=_ogg_calloc(ci->books,sizeof(*ci->fullbooks));
+  if(!ci->fullbooks)return(OV_EFAULT);
+  for(i=0;i<ci->books;i++){
+    if(ci->book_param[i]==NULL)
+      return(OV_EBADHEADER);
+    if(vorbis_book_init_decode(ci->fullbooks+i,ci->book_param[i]))
+      return(OV_EBADHEADER);
+    /* decode codebooks are now standalone after init */
+    vorbis_staticbook_destroy(ci->book_param[i]);
+    ci->book_param[i]=NULL;
+  }
+  return(0);
+}
+
+/* setup header through the decoder pool: share a pooled setup on a
+   hit, otherwise unpack and offer the result to the pool */
+static int _vorbis_unpack_books_pooled(vorbis_info *vi,ogg_packet *op,
+                                       oggpack_buffer *opb){
+  ogg_uint64_t key=_vorbis_setup_key(vi,op);
+  codec_setup_info *ci=_vorbis_pool->setup_acquire(_vorbis_pool->ctx,key);
+  int ret;
+
+  if(ci){
+    /* the fresh setup holds the blocksizes only */
+    _ogg_free(vi->codec_setup);
+    vi->codec_setup=ci;
+    return(0);
+  }
+
+  ret=_vorbis_unpack_books(vi,opb);
+  if(ret)return(ret);
+  ci=vi->codec_setup;
+  ret=_vorbis_finish_books(ci);
+  if(ret){
+    vorbis_info_clear(vi);
+    return(ret);
+  }
+  ci->setup_key=key;
+  if(!_vorbis_pool->setup_insert(_vorbis_pool->ctx,key,vi))
+    ci->setup_key=0;
+  return(0);
+}
+
 /* Is this packet a vorbis ID header? */
 int vorbis_synthesis_idheader(ogg_packet *op){
   oggpack_buffer opb;
@@ -421,6 +502,8 @@ int vorbis_synthesis_headerin(vorbis_info *vi,vorbis_comment *vc,ogg_packet *op)
           return(OV_EBADHEADER);
         }
 
+        if(_vorbis_pool)
+          return(_vorbis_unpack_books_pooled(vi,op,&opb));
         return(_vorbis_unpack_books(vi,&opb));
 
       default:
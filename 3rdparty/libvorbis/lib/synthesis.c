@@ -170,6 +170,8 @@ int vorbis_synthesis_halfrate(vorbis_info *vi,int flag){
 
   /* right now, our MDCT can't handle < 64 sample windows. */
   if(ci->blocksizes[0]<=64 && flag)return -1;
+  /* pooled setups and their parked states are sized for full rate */
+  if(ci->setup_key && flag)return -1;
   ci->halfrate_flag=(flag?1:0);
   return 0;
 }
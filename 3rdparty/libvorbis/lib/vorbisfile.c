@@ -1403,8 +1403,11 @@ int ov_raw_seek(OggVorbis_File *vf,ogg_int64_t pos){
 
    Seek to the last [granule marked] page preceding the specified pos
    location, such that decoding past the returned point will quickly
-   arrive at the requested position. */
-int ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos){
+   arrive at the requested position.  A hint of known pages around the
+   position (see ov_pcm_seek_hint) narrows the bisection range. */
+static int _ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos,
+                             ogg_int64_t hint_begin,ogg_int64_t hint_begintime,
+                             ogg_int64_t hint_end,ogg_int64_t hint_endtime){
   int link=-1;
   ogg_int64_t result=0;
   ogg_int64_t total=ov_pcm_total(vf,-1);
@@ -1443,6 +1446,19 @@ int ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos){
 
     ogg_page og;
 
+    /* hinted pages must lie inside the link and around the target;
+       otherwise ignore the hint and bisect the whole link */
+    if(hint_begin>=begin && hint_begin<end &&
+       hint_begintime>=begintime && hint_begintime<target){
+      begin=hint_begin;
+      begintime=hint_begintime;
+      if(hint_end>begin && hint_end<=end &&
+         hint_endtime>=target && hint_endtime<=endtime){
+        end=hint_end;
+        endtime=hint_endtime;
+      }
+    }
+
     /* if we have only one page, there will be no bisection.  Grab the page here */
     if(begin==end){
       result=_seek_helper(vf,begin);
@@ -1672,12 +1688,15 @@ int ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos){
   return (int)result;
 }
 
-/* seek to a sample offset relative to the decompressed pcm stream
-   returns zero on success, nonzero on failure */
+int ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos){
+  return _ov_pcm_seek_page(vf,pos,-1,-1,-1,-1);
+}
 
-int ov_pcm_seek(OggVorbis_File *vf,ogg_int64_t pos){
+static int _ov_pcm_seek(OggVorbis_File *vf,ogg_int64_t pos,
+                        ogg_int64_t hint_begin,ogg_int64_t hint_begintime,
+                        ogg_int64_t hint_end,ogg_int64_t hint_endtime){
   int thisblock,lastblock=0;
-  int ret=ov_pcm_seek_page(vf,pos);
+  int ret=_ov_pcm_seek_page(vf,pos,hint_begin,hint_begintime,hint_end,hint_endtime);
   if(ret<0)return(ret);
   if((ret=_make_decode_ready(vf)))return ret;
 
@@ -1773,6 +1792,25 @@ int ov_pcm_seek(OggVorbis_File *vf,ogg_int64_t pos){
   return 0;
 }
 
+/* seek to a sample offset relative to the decompressed pcm stream
+   returns zero on success, nonzero on failure */
+
+int ov_pcm_seek(OggVorbis_File *vf,ogg_int64_t pos){
+  return _ov_pcm_seek(vf,pos,-1,-1,-1,-1);
+}
+
+/* ov_pcm_seek with a hint from an external seek table: begin is the raw
+   offset of a page with granulepos begintime before pos, end the raw
+   offset of a later page with granulepos endtime at or after pos (-1 if
+   unknown).  Bisection only searches between them; a hint that does not
+   fit the stream is ignored. */
+
+int ov_pcm_seek_hint(OggVorbis_File *vf,ogg_int64_t pos,
+                     ogg_int64_t begin,ogg_int64_t begintime,
+                     ogg_int64_t end,ogg_int64_t endtime){
+  return _ov_pcm_seek(vf,pos,begin,begintime,end,endtime);
+}
+
 /* seek to a playback time relative to the decompressed pcm stream
    returns zero on success, nonzero on failure */
 int ov_time_seek(OggVorbis_File *vf,double seconds){
@@ -21,6 +21,17 @@
 #include "misc.h"
 #include "window.h"
 
+/* windowing and lapping are plain float multiply/add over long runs;
+   use 4-wide vectors where the target provides them */
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  include <xmmintrin.h>
+#  define VORBIS_WINDOW_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#  include <arm_neon.h>
+#  define VORBIS_WINDOW_NEON
+#endif
+
 static const float vwin64[32] = {
   0.0009460463F, 0.0085006468F, 0.0235352254F, 0.0458950567F,
   0.0753351908F, 0.1115073077F, 0.1539457973F, 0.2020557475F,
@@ -2100,6 +2111,65 @@ const float *_vorbis_window_get(int n){
   return vwin[n];
 }
 
+/* d[i]*=w[i] */
+static void _window_mul(float *d,const float *w,long n){
+  long i=0;
+#if defined(VORBIS_WINDOW_SSE)
+  for(;i+4<=n;i+=4)
+    _mm_storeu_ps(d+i,_mm_mul_ps(_mm_loadu_ps(d+i),_mm_loadu_ps(w+i)));
+#elif defined(VORBIS_WINDOW_NEON)
+  for(;i+4<=n;i+=4)
+    vst1q_f32(d+i,vmulq_f32(vld1q_f32(d+i),vld1q_f32(w+i)));
+#endif
+  for(;i<n;i++)
+    d[i]*=w[i];
+}
+
+/* d[i]*=w[n-i-1] */
+static void _window_mul_rev(float *d,const float *w,long n){
+  long i=0;
+#if defined(VORBIS_WINDOW_SSE)
+  for(;i+4<=n;i+=4){
+    __m128 r=_mm_loadu_ps(w+n-i-4);
+    r=_mm_shuffle_ps(r,r,_MM_SHUFFLE(0,1,2,3));
+    _mm_storeu_ps(d+i,_mm_mul_ps(_mm_loadu_ps(d+i),r));
+  }
+#elif defined(VORBIS_WINDOW_NEON)
+  for(;i+4<=n;i+=4){
+    float32x4_t r=vrev64q_f32(vld1q_f32(w+n-i-4));
+    r=vcombine_f32(vget_high_f32(r),vget_low_f32(r));
+    vst1q_f32(d+i,vmulq_f32(vld1q_f32(d+i),r));
+  }
+#endif
+  for(;i<n;i++)
+    d[i]*=w[n-i-1];
+}
+
+/* overlap-add of the falling edge already in pcm and the rising edge
+   of the new block: pcm[i]=pcm[i]*w[n-i-1]+p[i]*w[i].  The product
+   and sum are kept separate (no fused multiply-add) so the result is
+   bit-identical to the scalar loop. */
+void _vorbis_window_lap(float *pcm,const float *p,const float *w,long n){
+  long i=0;
+#if defined(VORBIS_WINDOW_SSE)
+  for(;i+4<=n;i+=4){
+    __m128 r=_mm_loadu_ps(w+n-i-4);
+    r=_mm_shuffle_ps(r,r,_MM_SHUFFLE(0,1,2,3));
+    _mm_storeu_ps(pcm+i,_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pcm+i),r),
+                                   _mm_mul_ps(_mm_loadu_ps(p+i),_mm_loadu_ps(w+i))));
+  }
+#elif defined(VORBIS_WINDOW_NEON)
+  for(;i+4<=n;i+=4){
+    float32x4_t r=vrev64q_f32(vld1q_f32(w+n-i-4));
+    r=vcombine_f32(vget_high_f32(r),vget_low_f32(r));
+    vst1q_f32(pcm+i,vaddq_f32(vmulq_f32(vld1q_f32(pcm+i),r),
+                              vmulq_f32(vld1q_f32(p+i),vld1q_f32(w+i))));
+  }
+#endif
+  for(;i<n;i++)
+    pcm[i]=pcm[i]*w[n-i-1]+p[i]*w[i];
+}
+
 void _vorbis_apply_window(float *d,int *winno,long *blocksizes,
                           int lW,int W,int nW){
   lW=(W?lW:0);
@@ -2114,23 +2184,19 @@ void _vorbis_apply_window(float *d,int *winno,long *blocksizes,
     long rn=blocksizes[nW];
 
     long leftbegin=n/4-ln/4;
-    long leftend=leftbegin+ln/2;
 
     long rightbegin=n/2+n/4-rn/4;
     long rightend=rightbegin+rn/2;
 
-    int i,p;
+    int i;
 
     for(i=0;i<leftbegin;i++)
       d[i]=0.f;
 
-    for(p=0;i<leftend;i++,p++)
-      d[i]*=windowLW[p];
-
-    for(i=rightbegin,p=rn/2-1;i<rightend;i++,p--)
-      d[i]*=windowNW[p];
+    _window_mul(d+leftbegin,windowLW,ln/2);
+    _window_mul_rev(d+rightbegin,windowNW,rn/2);
 
-    for(;i<n;i++)
+    for(i=rightend;i<n;i++)
       d[i]=0.f;
   }
 }
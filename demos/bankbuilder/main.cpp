@@ -0,0 +1,589 @@
+﻿// sound bank builder: decode assets via playau codecs, re-encode by rule, write a bank
+#include "../../inc/playau.h"
+#include "../../src/private/p_au_engine_interface.h"
+#include "../../src/private/p_au_adpcm.h"
+#include "../../src/private/p_au_wave.h"
+#include "../../3rdparty/libvorbis/include/vorbis/vorbisenc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "playau.lib")
+#endif
+
+namespace PlayAU {
+    // create audio stream via registered codecs
+    bool CreateAudioStreamFromFileStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) noexcept;
+}
+
+namespace {
+    using namespace PlayAU;
+    // encode rule
+    enum Rule : int {
+        // pick by duration
+        Rule_Auto = 0,
+        // 16bit pcm
+        Rule_PCM,
+        // ima-adpcm
+        Rule_ADPCM,
+        // vorbis
+        Rule_Vorbis,
+        // store source file as is
+        Rule_Copy,
+        // COUNT
+        RULE_COUNT
+    };
+    // rule name
+    const char* const RULE_NAME[RULE_COUNT] = {
+        "auto", "pcm", "adpcm", "vorbis", "copy",
+    };
+    // options
+    struct Options {
+        // worker count, 0 for all cores
+        unsigned    jobs = 0;
+        // vorbis vbr quality [-0.1, 1]
+        float       quality = 0.4f;
+        // auto: pcm if not longer than this, in sec
+        double      tiny = 0.5;
+        // auto: adpcm if not longer than this, vorbis otherwise, in sec
+        double      music = 8.0;
+    };
+    // asset to build
+    struct Asset {
+        // entry name
+        std::string             name;
+        // source path
+        std::string             path;
+        // rule
+        Rule                    rule;
+        // built entry, offset filled when writing
+        BankEntry               entry;
+        // built data
+        std::vector<uint8_t>    data;
+        // seek table, ogg pages of the first link
+        std::vector<BankSeekPoint> seeks;
+        // error message, empty if ok
+        std::string             error;
+    };
+    // ima-adpcm block align per channel
+    enum : uint32_t { IMA_BLOCK_PER_CHANNEL = 512 };
+
+    /// <summary>
+    /// Loads the whole file.
+    /// </summary>
+    /// <param name="path">The path.</param>
+    /// <param name="data">The data.</param>
+    /// <returns></returns>
+    bool LoadFile(const char* path, std::vector<uint8_t>& data) {
+        const auto file = std::fopen(path, "rb");
+        if (!file) return false;
+        uint8_t buf[64 * 1024]; size_t len;
+        while ((len = std::fread(buf, 1, sizeof(buf), file)) > 0)
+            data.insert(data.end(), buf, buf + len);
+        std::fclose(file);
+        return true;
+    }
+    /// <summary>
+    /// Decodes source to interleaved float via playau codecs.
+    /// </summary>
+    /// <param name="src">The source.</param>
+    /// <param name="pcm">The PCM.</param>
+    /// <param name="fmt">The format.</param>
+    /// <returns></returns>
+    bool Decode(const std::vector<uint8_t>& src, std::vector<float>& pcm, WaveFormat& fmt) {
+        FileStreamHolder file;
+        AudioStreamHolder audio;
+        if (src.size() > 0xFFFFFFFFu) return false;
+        const auto len = static_cast<uint32_t>(src.size());
+        if (!PlayAU::CreateMemoryStream(file, src.data(), len)) return false;
+        if (!PlayAU::CreateAudioStreamFromFileStream(file, audio, Flag_None)) return false;
+        fmt = audio->format;
+        const uint32_t bytes = fmt.bits_per_sample / 8;
+        const bool fp = fmt.fmt_tag == Wave_IEEEFloat;
+        if (!fmt.channels || !bytes || bytes > 4 || (fp && bytes != 4)) return false;
+        if (fmt.fmt_tag != Wave_PCM && !fp) return false;
+        std::vector<uint8_t> buf(64 * 1024 / (bytes * fmt.channels) * (bytes * fmt.channels));
+        uint32_t read;
+        while ((read = audio->ReadNext(static_cast<uint32_t>(buf.size()), buf.data())) > 0) {
+            for (uint32_t i = 0; i + bytes <= read; i += bytes) {
+                const uint8_t* p = buf.data() + i;
+                float v;
+                if (fp) std::memcpy(&v, p, 4);
+                // 8位为无符号
+                else if (bytes == 1) v = (int32_t(p[0]) - 128) / 128.f;
+                else {
+                    uint32_t x = 0;
+                    for (uint32_t b = 0; b != bytes; ++b) x |= uint32_t(p[b]) << (b * 8 + (4 - bytes) * 8);
+                    v = static_cast<float>(static_cast<int32_t>(x) / 2147483648.0);
+                }
+                pcm.push_back(v);
+            }
+        }
+        return !pcm.empty();
+    }
+    /// <summary>
+    /// Converts float to int16 with clamp.
+    /// </summary>
+    /// <param name="pcm">The PCM.</param>
+    /// <param name="out">The out.</param>
+    void ToPCM16(const std::vector<float>& pcm, std::vector<int16_t>& out) {
+        out.resize(pcm.size());
+        for (size_t i = 0; i != pcm.size(); ++i) {
+            int32_t v = static_cast<int32_t>(std::lrint(pcm[i] * 32768.f));
+            if (v > 32767) v = 32767;
+            else if (v < -32768) v = -32768;
+            out[i] = static_cast<int16_t>(v);
+        }
+    }
+    /// <summary>
+    /// Measures integrated loudness via ITU-R BS.1770, returns 0.01 LUFS, 0 if silent.
+    /// </summary>
+    /// <param name="pcm">The PCM.</param>
+    /// <param name="channels">The channels.</param>
+    /// <param name="rate">The rate.</param>
+    /// <returns></returns>
+    int16_t Loudness(const std::vector<float>& pcm, uint32_t channels, uint32_t rate) {
+        const double pi = 3.14159265358979323846;
+        // K计权: 高架滤波 + 高通滤波
+        double K = std::tan(pi * 1681.974450955533 / rate);
+        const double Q1 = 0.7071752369554196;
+        const double Vh = std::pow(10., 3.999843853973347 / 20.);
+        const double Vb = std::pow(Vh, 0.4996667741545416);
+        double a0 = 1. + K / Q1 + K * K;
+        const double pb[3] = {
+            (Vh + Vb * K / Q1 + K * K) / a0, 2. * (K * K - Vh) / a0, (Vh - Vb * K / Q1 + K * K) / a0 };
+        const double pa[2] = { 2. * (K * K - 1.) / a0, (1. - K / Q1 + K * K) / a0 };
+        K = std::tan(pi * 38.13547087602444 / rate);
+        const double Q2 = 0.5003270373238773;
+        a0 = 1. + K / Q2 + K * K;
+        const double ha[2] = { 2. * (K * K - 1.) / a0, (1. - K / Q2 + K * K) / a0 };
+        // 5.1: LFE不计, 环绕声道加权
+        std::vector<double> weight(channels, 1.);
+        if (channels == 6) { weight[3] = 0.; weight[4] = weight[5] = 1.41; }
+        const size_t frames = pcm.size() / channels;
+        const size_t step = rate >= 10 ? rate / 10 : 1;
+        // 400ms块, 75%重叠, 以100ms为单位累计
+        std::vector<double> power((frames + step - 1) / step, 0.);
+        for (uint32_t c = 0; c != channels; ++c) {
+            if (weight[c] == 0.) continue;
+            double x1 = 0, x2 = 0, y1 = 0, y2 = 0, z1 = 0, z2 = 0;
+            for (size_t i = 0; i != frames; ++i) {
+                const double x = pcm[i * channels + c];
+                const double y = pb[0] * x + pb[1] * x1 + pb[2] * x2 - pa[0] * y1 - pa[1] * y2;
+                x2 = x1; x1 = x;
+                const double z = y - 2. * y1 + y2 - ha[0] * z1 - ha[1] * z2;
+                y2 = y1; y1 = y; z2 = z1; z1 = z;
+                power[i / step] += weight[c] * z * z;
+            }
+        }
+        std::vector<double> blocks;
+        // 末尾不足100ms的部分只在整体短于一个块时计入
+        const size_t full = frames / step;
+        if (full < 4) {
+            // 短于一个块: 整体作为一块
+            double sum = 0; for (double p : power) sum += p;
+            blocks.push_back(sum / frames);
+        }
+        else for (size_t i = 0; i + 4 <= full; ++i) {
+            blocks.push_back((power[i] + power[i + 1] + power[i + 2] + power[i + 3]) / (step * 4.));
+        }
+        const auto lufs = [](double z) { return -0.691 + 10. * std::log10(z); };
+        // 绝对门限-70, 相对门限-10
+        double sum = 0; size_t n = 0;
+        for (double z : blocks) if (z > 0 && lufs(z) > -70.) { sum += z; ++n; }
+        if (!n) return 0;
+        const double gate = lufs(sum / n) - 10.;
+        sum = 0; n = 0;
+        for (double z : blocks) if (z > 0 && lufs(z) > gate) { sum += z; ++n; }
+        const double value = std::round(lufs(sum / n) * 100.);
+        return static_cast<int16_t>(std::max(-32767., std::min(-1., value)));
+    }
+    /// <summary>
+    /// Encodes to 16bit pcm.
+    /// </summary>
+    /// <param name="asset">The asset.</param>
+    /// <param name="pcm">The PCM.</param>
+    void EncodePCM(Asset& asset, const std::vector<float>& pcm) {
+        std::vector<int16_t> s16;
+        ToPCM16(pcm, s16);
+        auto& e = asset.entry;
+        e.tag = WAVE_TAG_PCM;
+        e.bits_per_sample = 16;
+        e.block_align = static_cast<uint16_t>(e.channels * 2);
+        asset.data.resize(s16.size() * 2);
+        for (size_t i = 0; i != s16.size(); ++i) {
+            asset.data[i * 2 + 0] = static_cast<uint8_t>(s16[i]);
+            asset.data[i * 2 + 1] = static_cast<uint8_t>(uint16_t(s16[i]) >> 8);
+        }
+    }
+    /// <summary>
+    /// Encodes to ima-adpcm.
+    /// </summary>
+    /// <param name="asset">The asset.</param>
+    /// <param name="pcm">The PCM.</param>
+    void EncodeADPCM(Asset& asset, const std::vector<float>& pcm) {
+        std::vector<int16_t> s16;
+        ToPCM16(pcm, s16);
+        auto& e = asset.entry;
+        const uint32_t channels = e.channels;
+        const uint32_t block_align = IMA_BLOCK_PER_CHANNEL * channels;
+        const uint32_t samples = PlayAU::ImaAdpcmBlockSamples(block_align, channels);
+        const uint32_t frames = e.frames;
+        const uint32_t blocks = (frames + samples - 1) / samples;
+        e.tag = WAVE_TAG_IMAADPCM;
+        e.bits_per_sample = 4;
+        e.block_align = static_cast<uint16_t>(block_align);
+        // cbSize后为每块样本数
+        e.extra_size = 2;
+        e.extra[0] = static_cast<uint8_t>(samples);
+        e.extra[1] = static_cast<uint8_t>(samples >> 8);
+        asset.data.resize(size_t(blocks) * block_align);
+        int32_t index[ADPCM_MAX_CHANNELS] = { 0 };
+        for (uint32_t b = 0; b != blocks; ++b) {
+            const uint32_t first = b * samples;
+            const uint32_t count = std::min(samples, frames - first);
+            PlayAU::EncodeImaAdpcmBlock(
+                asset.data.data() + size_t(b) * block_align, block_align,
+                channels, s16.data() + size_t(first) * channels, count, index
+            );
+        }
+    }
+    /// <summary>
+    /// Encodes to ogg vorbis via vorbisenc.
+    /// </summary>
+    /// <param name="asset">The asset.</param>
+    /// <param name="pcm">The PCM.</param>
+    /// <param name="quality">The quality.</param>
+    /// <returns></returns>
+    bool EncodeVorbis(Asset& asset, const std::vector<float>& pcm, float quality) {
+        auto& e = asset.entry;
+        const int channels = e.channels;
+        vorbis_info vi; vorbis_comment vc;
+        vorbis_dsp_state vd; vorbis_block vb;
+        ogg_stream_state os; ogg_page og; ogg_packet op;
+        ::vorbis_info_init(&vi);
+        if (::vorbis_encode_init_vbr(&vi, channels, e.sample_rate, quality)) {
+            ::vorbis_info_clear(&vi);
+            return false;
+        }
+        ::vorbis_comment_init(&vc);
+        ::vorbis_analysis_init(&vd, &vi);
+        ::vorbis_block_init(&vd, &vb);
+        ::ogg_stream_init(&os, static_cast<int>(BankHash(asset.name.c_str()) & 0x7fffffff));
+        auto& out = asset.data;
+        const auto write_page = [&out](const ogg_page& page) {
+            out.insert(out.end(), page.header, page.header + page.header_len);
+            out.insert(out.end(), page.body, page.body + page.body_len);
+        };
+        ogg_packet header[3];
+        ::vorbis_analysis_headerout(&vd, &vc, header + 0, header + 1, header + 2);
+        for (auto& h : header) ::ogg_stream_packetin(&os, &h);
+        // 头信息单独成页
+        while (::ogg_stream_flush(&os, &og)) write_page(og);
+        const size_t frames = e.frames;
+        constexpr size_t CHUNK = 4096;
+        bool eos = false;
+        for (size_t pos = 0; !eos; ) {
+            const size_t count = std::min(CHUNK, frames - pos);
+            if (count) {
+                float** buf = ::vorbis_analysis_buffer(&vd, static_cast<int>(count));
+                for (size_t i = 0; i != count; ++i)
+                    for (int c = 0; c != channels; ++c)
+                        buf[c][i] = pcm[(pos + i) * channels + c];
+                pos += count;
+            }
+            ::vorbis_analysis_wrote(&vd, static_cast<int>(count));
+            while (::vorbis_analysis_blockout(&vd, &vb) == 1) {
+                ::vorbis_analysis(&vb, nullptr);
+                ::vorbis_bitrate_addblock(&vb);
+                while (::vorbis_bitrate_flushpacket(&vd, &op)) {
+                    ::ogg_stream_packetin(&os, &op);
+                    while (::ogg_stream_pageout(&os, &og)) {
+                        write_page(og);
+                        if (::ogg_page_eos(&og)) eos = true;
+                    }
+                }
+            }
+        }
+        ::ogg_stream_clear(&os);
+        ::vorbis_block_clear(&vb);
+        ::vorbis_dsp_clear(&vd);
+        ::vorbis_comment_clear(&vc);
+        ::vorbis_info_clear(&vi);
+        return true;
+    }
+    /// <summary>
+    /// Scans ogg pages for the seek table: granule position and page start,
+    /// chained streams get no table as granules restart in each link.
+    /// </summary>
+    /// <param name="asset">The asset.</param>
+    void ScanOggPages(Asset& asset) {
+        const auto& d = asset.data;
+        const auto u32 = [&d](size_t i) {
+            return uint32_t(d[i]) | uint32_t(d[i + 1]) << 8 | uint32_t(d[i + 2]) << 16 | uint32_t(d[i + 3]) << 24;
+        };
+        auto& seeks = asset.seeks;
+        seeks.clear();
+        uint32_t serial = 0;
+        for (size_t pos = 0; pos + 27 <= d.size(); ) {
+            // 页头: "OggS" 版本 类型 颗粒位置(8) 序列号(4) 页序号(4) 校验(4) 段数 段表
+            if (std::memcmp(d.data() + pos, "OggS", 4)) break;
+            const size_t segs = d[pos + 26];
+            if (pos + 27 + segs > d.size()) break;
+            size_t body = 0;
+            for (size_t i = 0; i != segs; ++i) body += d[pos + 27 + i];
+            const uint64_t granule = uint64_t(u32(pos + 6)) | uint64_t(u32(pos + 10)) << 32;
+            const uint32_t page_serial = u32(pos + 14);
+            if (!pos) serial = page_serial;
+            // 链接的流不生成定位表
+            else if (d[pos + 5] & 0x02) { seeks.clear(); return; }
+            // 头信息页颗粒位置为0, 未结束包的页为-1
+            if (page_serial == serial && granule && granule != ~uint64_t(0)) {
+                if (granule > 0xFFFFFFFFu) break;
+                if (!seeks.empty() && seeks.back().frame > granule) { seeks.clear(); return; }
+                seeks.push_back({ static_cast<uint32_t>(granule), static_cast<uint32_t>(pos) });
+            }
+            pos += 27 + segs + body;
+        }
+    }
+    /// <summary>
+    /// Builds the asset.
+    /// </summary>
+    /// <param name="asset">The asset.</param>
+    /// <param name="opt">The option.</param>
+    void Build(Asset& asset, const Options& opt) {
+        auto& e = asset.entry;
+        std::memset(&e, 0, sizeof(e));
+        e.hash = PlayAU::BankHash(asset.name.c_str());
+        std::vector<uint8_t> src;
+        if (!LoadFile(asset.path.c_str(), src)) { asset.error = "cannot open"; return; }
+        std::vector<float> pcm;
+        WaveFormat fmt;
+        if (!Decode(src, pcm, fmt)) { asset.error = "cannot decode"; return; }
+        e.sample_rate = fmt.samples_per_sec;
+        e.channels = fmt.channels;
+        e.frames = static_cast<uint32_t>(pcm.size() / fmt.channels);
+        e.loudness = Loudness(pcm, fmt.channels, fmt.samples_per_sec);
+        Rule rule = asset.rule;
+        if (rule == Rule_Auto) {
+            const double sec = double(e.frames) / e.sample_rate;
+            rule = sec <= opt.tiny ? Rule_PCM : (sec <= opt.music ? Rule_ADPCM : Rule_Vorbis);
+        }
+        // ADPCM声道数有限
+        if (rule == Rule_ADPCM && e.channels > ADPCM_MAX_CHANNELS) rule = Rule_PCM;
+        switch (rule)
+        {
+        case Rule_PCM:
+            EncodePCM(asset, pcm);
+            break;
+        case Rule_ADPCM:
+            EncodeADPCM(asset, pcm);
+            break;
+        case Rule_Vorbis:
+            if (!EncodeVorbis(asset, pcm, opt.quality)) asset.error = "vorbis encoder rejected format";
+            break;
+        default:
+            // 原样保存, 播放时探测解码器
+            asset.data = std::move(src);
+            break;
+        }
+        asset.rule = rule;
+        if (asset.data.size() > 0xFFFFFFFFu) asset.error = "entry too large";
+        // vorbis与原样保存的ogg文件带定位表
+        else if (asset.data.size() >= 4 && !std::memcmp(asset.data.data(), "OggS", 4)) ScanOggPages(asset);
+    }
+    /// <summary>
+    /// Reads the asset list: "rule name path" per line, '#' for comment.
+    /// </summary>
+    /// <param name="path">The path.</param>
+    /// <param name="assets">The assets.</param>
+    /// <returns></returns>
+    bool ReadList(const char* path, std::vector<Asset>& assets) {
+        std::vector<uint8_t> text;
+        if (!LoadFile(path, text)) return false;
+        std::string all(text.begin(), text.end());
+        size_t line_no = 0;
+        for (size_t pos = 0; pos < all.size(); ) {
+            size_t end = all.find('\n', pos);
+            if (end == std::string::npos) end = all.size();
+            std::string line = all.substr(pos, end - pos);
+            pos = end + 1; ++line_no;
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+                line.pop_back();
+            const size_t first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line[first] == '#') continue;
+            // 规则 名称 路径(余下部分)
+            char rule[16], name[256]; int used = 0;
+            if (std::sscanf(line.c_str() + first, "%15s %255s %n", rule, name, &used) < 2 || !used) {
+                std::printf("%s:%zu: expect \"rule name path\"\n", path, line_no);
+                return false;
+            }
+            Asset asset;
+            asset.rule = RULE_COUNT;
+            for (int i = 0; i != RULE_COUNT; ++i)
+                if (!std::strcmp(rule, RULE_NAME[i])) asset.rule = static_cast<Rule>(i);
+            if (asset.rule == RULE_COUNT) {
+                std::printf("%s:%zu: unknown rule '%s'\n", path, line_no, rule);
+                return false;
+            }
+            asset.name = name;
+            asset.path = line.substr(first + used);
+            assets.push_back(std::move(asset));
+        }
+        return true;
+    }
+    /// <summary>
+    /// Writes the bank, entries sorted by hash.
+    /// </summary>
+    /// <param name="path">The path.</param>
+    /// <param name="assets">The assets.</param>
+    /// <returns></returns>
+    bool WriteBank(const char* path, std::vector<Asset>& assets) {
+        std::vector<Asset*> sorted;
+        for (auto& a : assets) sorted.push_back(&a);
+        std::sort(sorted.begin(), sorted.end(), [](const Asset* a, const Asset* b) {
+            return a->entry.hash < b->entry.hash;
+        });
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            if (sorted[i - 1]->entry.hash != sorted[i]->entry.hash) continue;
+            std::printf(
+                "hash collision: '%s' and '%s', rename one\n",
+                sorted[i - 1]->name.c_str(), sorted[i]->name.c_str()
+            );
+            return false;
+        }
+        const auto align = [](uint64_t x) {
+            return (x + BANK_DATA_ALIGN - 1) / BANK_DATA_ALIGN * BANK_DATA_ALIGN;
+        };
+        uint64_t offset = BANK_INDEX_OFFSET + uint64_t(sorted.size()) * sizeof(BankEntry);
+        for (auto a : sorted) {
+            offset = align(offset);
+            if (offset + a->data.size() > 0xFFFFFFFFu) {
+                std::printf("bank exceeds 4GB at '%s'\n", a->name.c_str());
+                return false;
+            }
+            a->entry.offset = static_cast<uint32_t>(offset);
+            a->entry.length = static_cast<uint32_t>(a->data.size());
+            offset += a->data.size();
+        }
+        // 定位表在数据之后: 与索引平行的BankSeekIndex, 然后是各条目的定位点
+        std::vector<BankSeekIndex> seek_index;
+        const uint64_t data_end = offset;
+        const uint64_t seek_offset = align(data_end);
+        if (std::any_of(sorted.begin(), sorted.end(), [](const Asset* a) { return !a->seeks.empty(); })) {
+            offset = seek_offset + uint64_t(sorted.size()) * sizeof(BankSeekIndex);
+            for (auto a : sorted) {
+                const uint32_t count = static_cast<uint32_t>(a->seeks.size());
+                seek_index.push_back({ count ? static_cast<uint32_t>(offset) : 0, count });
+                offset += uint64_t(count) * sizeof(BankSeekPoint);
+            }
+            if (offset > 0xFFFFFFFFu) {
+                std::printf("bank exceeds 4GB in seek tables\n");
+                return false;
+            }
+        }
+        const auto file = std::fopen(path, "wb");
+        if (!file) return false;
+        uint8_t head[BANK_INDEX_OFFSET] = { 0 };
+        BankHeader header = {
+            BANK_MAGIC, BANK_VERSION, static_cast<uint32_t>(sorted.size()),
+            seek_index.empty() ? 0 : static_cast<uint32_t>(seek_offset)
+        };
+        std::memcpy(head, &header, sizeof(header));
+        bool ok = std::fwrite(head, sizeof(head), 1, file) == 1;
+        for (auto a : sorted)
+            ok = ok && std::fwrite(&a->entry, sizeof(BankEntry), 1, file) == 1;
+        uint64_t pos = BANK_INDEX_OFFSET + uint64_t(sorted.size()) * sizeof(BankEntry);
+        const uint8_t zero[BANK_DATA_ALIGN] = { 0 };
+        for (auto a : sorted) {
+            const auto pad = static_cast<size_t>(a->entry.offset - pos);
+            if (pad) ok = ok && std::fwrite(zero, pad, 1, file) == 1;
+            if (!a->data.empty())
+                ok = ok && std::fwrite(a->data.data(), a->data.size(), 1, file) == 1;
+            pos = a->entry.offset + a->data.size();
+        }
+        if (!seek_index.empty()) {
+            const auto pad = static_cast<size_t>(seek_offset - data_end);
+            if (pad) ok = ok && std::fwrite(zero, pad, 1, file) == 1;
+            ok = ok && std::fwrite(seek_index.data(), sizeof(BankSeekIndex), seek_index.size(), file) == seek_index.size();
+            for (auto a : sorted) {
+                if (a->seeks.empty()) continue;
+                ok = ok && std::fwrite(a->seeks.data(), sizeof(BankSeekPoint), a->seeks.size(), file) == a->seeks.size();
+            }
+        }
+        return (std::fclose(file) == 0) && ok;
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        const char* value = argv[arg + 1];
+        switch (argv[arg][1])
+        {
+        case 'j': opt.jobs = static_cast<unsigned>(std::atoi(value)); break;
+        case 'q': opt.quality = static_cast<float>(std::atof(value)); break;
+        case 't': opt.tiny = std::atof(value); break;
+        case 'm': opt.music = std::atof(value); break;
+        default: arg = argc; break;
+        }
+    }
+    if (argc - arg != 2) {
+        std::printf(
+            "usage: bankbuilder [-j jobs] [-q vorbis-quality] [-t tiny-sec] [-m music-sec] list out\n"
+            "list: one asset per line, \"rule name path\", rule: auto|pcm|adpcm|vorbis|copy\n"
+        );
+        return 1;
+    }
+    std::vector<Asset> assets;
+    if (!ReadList(argv[arg], assets)) return 1;
+    unsigned jobs = opt.jobs ? opt.jobs : std::thread::hardware_concurrency();
+    if (!jobs) jobs = 1;
+    if (jobs > assets.size()) jobs = static_cast<unsigned>(assets.size() ? assets.size() : 1);
+    const auto begin = std::chrono::steady_clock::now();
+    // 工作线程按序领取资源
+    std::atomic<size_t> next{ 0 };
+    const auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < assets.size()) Build(assets[i], opt);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < jobs; ++i) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+    size_t failed = 0, bytes = 0, points = 0, count[RULE_COUNT] = { 0 };
+    for (auto& a : assets) {
+        if (!a.error.empty()) {
+            std::printf("%s (%s): %s\n", a.name.c_str(), a.path.c_str(), a.error.c_str());
+            ++failed;
+            continue;
+        }
+        ++count[a.rule];
+        bytes += a.data.size();
+        points += a.seeks.size();
+    }
+    if (failed) return 1;
+    if (!WriteBank(argv[arg + 1], assets)) {
+        std::printf("cannot write %s\n", argv[arg + 1]);
+        return 1;
+    }
+    std::printf(
+        "%zu asset(s), %zu bytes, pcm %zu, adpcm %zu, vorbis %zu, copy %zu, %zu seek point(s), %u job(s), %.3f s\n",
+        assets.size(), bytes, count[Rule_PCM], count[Rule_ADPCM], count[Rule_Vorbis],
+        count[Rule_Copy], points, jobs, time.count()
+    );
+    return 0;
+}
@@ -7,7 +7,6 @@
 #include <Windows.h>
 
 #pragma comment(lib, "playau.lib")
-#pragma comment(lib, "libFLAC_static_win32d.lib")
 
 void window(HWND*) noexcept;
 
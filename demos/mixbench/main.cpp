@@ -0,0 +1,202 @@
+﻿// mix kernel check and benchmark: compare simd kernels with scalar reference, then time voices into group buses
+#include "../../inc/au_dsp.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "playau.lib")
+#endif
+
+namespace {
+    using namespace PlayAU;
+    // clock
+    using Clock = std::chrono::steady_clock;
+    // constant
+    enum : uint32_t {
+        // group bus count
+        GROUP_COUNT = 4,
+        // random check rounds per block size
+        CHECK_ROUNDS = 200,
+    };
+    // max error allowed between kernel and reference
+    const float CHECK_TOLERANCE = 1e-5f;
+    // options
+    struct Options {
+        // voice count
+        uint32_t    voices = 256;
+        // audio seconds per measure at 48k
+        double      seconds = 5.0;
+    };
+    // voice layout measured
+    enum Layout : uint32_t { Layout_Mono, Layout_Stereo, Layout_51, LAYOUT_COUNT };
+    // layout name
+    const char* const LAYOUT_NAME[LAYOUT_COUNT] = { "mono-pan", "stereo", "5.1-down" };
+    // input channels of layout
+    const uint32_t LAYOUT_CHANNELS[LAYOUT_COUNT] = { 1, 2, 6 };
+    // random
+    struct Random {
+        // state
+        uint32_t    seed = 2463534242u;
+        // next in [-1, 1)
+        float Next() noexcept {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            return float(int32_t(seed) >> 8) / float(1 << 23);
+        }
+    };
+    // aligned bus array
+    struct Buses {
+        // storage
+        std::unique_ptr<uint8_t[]>  storage;
+        // buses
+        MixBus*                     bus;
+        // ctor
+        explicit Buses(uint32_t count) : storage(new uint8_t[sizeof(MixBus) * count + MIX_BUS_ALIGN]) {
+            auto addr = reinterpret_cast<uintptr_t>(storage.get());
+            addr = (addr + MIX_BUS_ALIGN - 1) & ~uintptr_t(MIX_BUS_ALIGN - 1);
+            bus = reinterpret_cast<MixBus*>(addr);
+        }
+    };
+    // max difference of two buses
+    float BusDiff(const MixBus& a, const MixBus& b) noexcept {
+        float diff = 0.f;
+        for (uint32_t c = 0; c != a.channels; ++c)
+            for (uint32_t i = 0; i != a.frames; ++i)
+                diff = std::fmax(diff, std::fabs(a.data[c][i] - b.data[c][i]));
+        return diff;
+    }
+    // fill bus with random
+    void BusRandom(MixBus& bus, uint32_t channels, uint32_t frames, Random& rng) noexcept {
+        bus.Clear(channels, frames);
+        for (uint32_t c = 0; c != channels; ++c)
+            for (uint32_t i = 0; i != frames; ++i) bus.data[c][i] = rng.Next();
+    }
+    // check all kernels against reference, return max error
+    float Check() {
+        Buses buses(3);
+        MixBus& a = buses.bus[0];
+        MixBus& b = buses.bus[1];
+        MixBus& src = buses.bus[2];
+        Random rng;
+        float in[DSP_MAX_CHANNELS][MIX_BLOCK_FRAMES + 1];
+        float m0[DSP_MAX_CHANNELS * DSP_MAX_CHANNELS], m1[DSP_MAX_CHANNELS * DSP_MAX_CHANNELS];
+        float err = 0.f;
+        const uint32_t sizes[] = { 1, 7, 64, 100, 128, 200, 256 };
+        for (const auto frames : sizes) {
+            for (uint32_t round = 0; round != CHECK_ROUNDS; ++round) {
+                const uint32_t out_ch = 1 + round % DSP_MAX_CHANNELS;
+                const uint32_t in_ch = 1 + (round / DSP_MAX_CHANNELS) % DSP_MAX_CHANNELS;
+                // 输入故意错开对齐
+                const float* planes[DSP_MAX_CHANNELS];
+                for (uint32_t c = 0; c != in_ch; ++c) {
+                    for (uint32_t i = 0; i != frames + 1; ++i) in[c][i] = rng.Next();
+                    planes[c] = in[c] + (round & 1);
+                }
+                for (uint32_t k = 0; k != in_ch * out_ch; ++k) {
+                    // 部分系数为零, 覆盖稀疏路径
+                    m0[k] = (k % 3 == 2) ? 0.f : rng.Next();
+                    m1[k] = (k % 3 == 2) ? 0.f : rng.Next();
+                }
+                BusRandom(a, out_ch, frames, rng);
+                b = a;
+                MixMatrix(a, planes, in_ch, m0, m1);
+                MixMatrixScalar(b, planes, in_ch, m0, m1);
+                err = std::fmax(err, BusDiff(a, b));
+                const MixRamp l{ rng.Next(), rng.Next() }, r{ rng.Next(), rng.Next() };
+                MixPan(a, planes[0], l, r);
+                MixPanScalar(b, planes[0], l, r);
+                err = std::fmax(err, BusDiff(a, b));
+                BusRandom(src, in_ch, frames, rng);
+                const MixRamp g{ rng.Next(), rng.Next() };
+                MixBusInto(a, src, g);
+                MixBusIntoScalar(b, src, g);
+                err = std::fmax(err, BusDiff(a, b));
+                float x[MIX_BLOCK_FRAMES + 1], y[MIX_BLOCK_FRAMES + 1];
+                for (uint32_t i = 0; i != frames + 1; ++i) x[i] = y[i] = rng.Next();
+                MixGain(x + 1, frames, g);
+                MixGainScalar(y + 1, frames, g);
+                for (uint32_t i = 0; i != frames + 1; ++i) err = std::fmax(err, std::fabs(x[i] - y[i]));
+            }
+        }
+        return err;
+    }
+    // mix voices of layout in blocks into group buses then master, return ns per voice per frame
+    double Bench(const Options& opt, Layout layout, uint32_t block, bool scalar) {
+        const uint32_t in_ch = LAYOUT_CHANNELS[layout];
+        Buses buses(GROUP_COUNT + 1);
+        MixBus& master = buses.bus[GROUP_COUNT];
+        // 每个声部一块输入, 模拟重采样后的平面数据
+        std::vector<float> input(size_t(opt.voices) * in_ch * MIX_BLOCK_FRAMES);
+        Random rng;
+        for (auto& x : input) x = rng.Next() * 0.1f;
+        float m0[12], m1[12];
+        if (layout == Layout_51) { GetChannelMatrix(6, 2, m0); GetChannelMatrix(6, 2, m1); }
+        else { m0[0] = 0.9f; m0[1] = 0.f; m0[2] = 0.f; m0[3] = 0.9f; std::memcpy(m1, m0, sizeof(m0)); m1[0] = 1.f; }
+        const auto blocks = uint32_t(opt.seconds * 48000.0 / double(block));
+        float sink = 0.f;
+        const auto begin = Clock::now();
+        for (uint32_t n = 0; n != blocks; ++n) {
+            master.Clear(2, block);
+            for (uint32_t g = 0; g != GROUP_COUNT; ++g) buses.bus[g].Clear(2, block);
+            for (uint32_t v = 0; v != opt.voices; ++v) {
+                MixBus& bus = buses.bus[v % GROUP_COUNT];
+                const float* planes[DSP_MAX_CHANNELS];
+                for (uint32_t c = 0; c != in_ch; ++c)
+                    planes[c] = input.data() + (size_t(v) * in_ch + c) * MIX_BLOCK_FRAMES;
+                if (layout == Layout_Mono) {
+                    const MixRamp l{ 0.5f, 0.6f }, r{ 0.5f, 0.4f };
+                    if (scalar) MixPanScalar(bus, planes[0], l, r);
+                    else MixPan(bus, planes[0], l, r);
+                }
+                else if (scalar) MixMatrixScalar(bus, planes, in_ch, m0, m1);
+                else MixMatrix(bus, planes, in_ch, m0, m1);
+            }
+            for (uint32_t g = 0; g != GROUP_COUNT; ++g) {
+                const MixRamp gain{ 1.f, 1.f };
+                if (scalar) MixBusIntoScalar(master, buses.bus[g], gain);
+                else MixBusInto(master, buses.bus[g], gain);
+            }
+            sink += master.data[0][n % block];
+        }
+        const double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+        if (sink == 12345.f) std::printf(" ");
+        return sec * 1e9 / (double(blocks) * block * opt.voices);
+    }
+    // usage
+    void Usage() noexcept {
+        std::printf("usage: mixbench [-n voices] [-s seconds]\n");
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has = i + 1 < argc;
+        if (!std::strcmp(arg, "-n") && has) opt.voices = uint32_t(std::atoi(argv[++i]));
+        else if (!std::strcmp(arg, "-s") && has) opt.seconds = std::atof(argv[++i]);
+        else { Usage(); return 2; }
+    }
+    if (!opt.voices || opt.seconds <= 0.0) { Usage(); return 2; }
+    const float err = Check();
+    std::printf("check: max error %.3g %s\n", err, err <= CHECK_TOLERANCE ? "ok" : "FAILED");
+    if (err > CHECK_TOLERANCE) return 1;
+    std::printf("%u voices into %u group buses, stereo master\n", opt.voices, GROUP_COUNT);
+    std::printf("%-9s %6s %12s %12s %8s\n", "layout", "block", "simd ns/vf", "scalar ns/vf", "speedup");
+    const uint32_t blocks[] = { 64, 128, 256 };
+    for (uint32_t layout = 0; layout != LAYOUT_COUNT; ++layout) {
+        for (const auto block : blocks) {
+            const double simd = Bench(opt, Layout(layout), block, false);
+            const double scalar = Bench(opt, Layout(layout), block, true);
+            std::printf("%-9s %6u %12.3f %12.3f %7.2fx\n",
+                LAYOUT_NAME[layout], block, simd, scalar, scalar / simd);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,651 @@
+﻿// fixture generator: writes small deterministic fixtures for the decode regression
+// flac fixed/variable block with seektable, pcm wave, rf64, ms-adpcm, ima-adpcm
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    // byte buffer
+    using Bytes = std::vector<uint8_t>;
+    // constant
+    enum : uint32_t {
+        // flac block size of fixed block fixture
+        FLAC_FIXED_BLOCK = 1024,
+        // flac frames per seek point
+        FLAC_SEEK_EVERY = 4,
+        // ms-adpcm block align of fixture
+        MS_BLOCK_ALIGN = 512,
+        // ima-adpcm block align of fixture
+        IMA_BLOCK_ALIGN = 256,
+        // max channel count of fixtures
+        FIXTURE_MAX_CHANNELS = 2,
+    };
+    // flac block sizes of variable block fixture, cycled
+    const uint32_t FLAC_VARIABLE_BLOCKS[] = { 1152, 576, 4096, 192, 2000, 777, 4608, 256 };
+    // ms-adpcm coefficients
+    const int32_t MS_COEFS[7][2] = {
+        { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 },
+        { 240, 0 }, { 460, -208 }, { 392, -232 },
+    };
+    // ms-adpcm adaptation table
+    const int32_t MS_ADAPT[16] = {
+        230, 230, 230, 230, 307, 409, 512, 614,
+        768, 614, 512, 409, 307, 230, 230, 230,
+    };
+    // ima-adpcm step table
+    const int32_t IMA_STEP[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+        19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+        130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+        337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+        876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+        2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+        5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+    };
+    // ima-adpcm step index adjustment
+    const int32_t IMA_INDEX[16] = {
+        -1, -1, -1, -1, 2, 4, 6, 8,
+        -1, -1, -1, -1, 2, 4, 6, 8,
+    };
+    // flac lpc predictor of fixture
+    struct FlacLpc {
+        // order
+        uint32_t    order;
+        // quantized coefficient precision in bits
+        uint32_t    precision;
+        // shift
+        uint32_t    shift;
+        // coefficients, [0] for the last sample
+        int32_t     coefs[12];
+    };
+    // flac lpc predictors, cycled over frames
+    const FlacLpc FLAC_LPCS[] = {
+        { 3, 13, 9, { 1536, -1536, 512 } },
+        { 8, 13, 12, { 3686, 0, 0, 0, 0, 0, 0, 0 } },
+        { 12, 15, 11, { 3072, -1024, 512, -256, 128, -64, 32, -16, 8, -4, 2, -1 } },
+    };
+    // interleaved pcm in int32
+    struct Pcm {
+        // samples
+        std::vector<int32_t>    data;
+        // frame count
+        uint32_t                frames;
+        // channel count
+        uint32_t                channels;
+        // bits per sample
+        uint32_t                bits;
+        // sample rate
+        uint32_t                rate;
+    };
+    // deterministic lcg
+    struct Random {
+        // state
+        uint32_t    state;
+        // next value
+        uint32_t Next() noexcept { state = state * 1664525u + 1013904223u; return state >> 8; }
+    };
+    /// <summary>
+    /// Makes the test signal: triangle waves with noise, a silent gap and a clipped burst.
+    /// Integer only, same samples on all platforms.
+    /// </summary>
+    /// <param name="frames">The frames.</param>
+    /// <param name="channels">The channels.</param>
+    /// <param name="bits">The bits.</param>
+    /// <param name="rate">The rate.</param>
+    /// <returns></returns>
+    Pcm MakeSignal(uint32_t frames, uint32_t channels, uint32_t bits, uint32_t rate) {
+        Pcm pcm{ std::vector<int32_t>(size_t(frames) * channels), frames, channels, bits, rate };
+        Random rng{ 0xF1C7u + frames + channels * 7 + bits };
+        const int32_t max = (1 << (bits - 1)) - 1;
+        const uint32_t gap = frames / 3, gap_end = gap + frames / 10;
+        const uint32_t burst = frames * 3 / 4, burst_end = burst + frames / 20;
+        for (uint32_t c = 0; c != channels; ++c) {
+            uint32_t phase = 0;
+            const uint32_t step = 0x01000000u / (40 + 13 * c) * 3;
+            for (uint32_t i = 0; i != frames; ++i) {
+                phase += step + (i >> 4);
+                // 三角波
+                const int32_t tri = int32_t(phase >> 16 < 0x8000 ? phase >> 16 : 0xffff - (phase >> 16)) - 0x4000;
+                int32_t v = int32_t(int64_t(tri) * max / 0x8000);
+                const int32_t noise = int32_t(rng.Next() % 129) - 64;
+                v += bits > 16 ? noise * (1 << (bits - 16)) : noise / (1 << (16 - bits));
+                if (i >= gap && i < gap_end) v = 0;
+                if (i >= burst && i < burst_end) v = (i & 64) ? max : -max - 1;
+                if (v > max) v = max;
+                if (v < -max - 1) v = -max - 1;
+                pcm.data[size_t(i) * channels + c] = v;
+            }
+        }
+        return pcm;
+    }
+    // little endian writer
+    void Put16(Bytes& out, uint32_t x) { out.push_back(uint8_t(x)); out.push_back(uint8_t(x >> 8)); }
+    void Put32(Bytes& out, uint32_t x) { Put16(out, x & 0xffff); Put16(out, x >> 16); }
+    void Put64(Bytes& out, uint64_t x) { Put32(out, uint32_t(x)); Put32(out, uint32_t(x >> 32)); }
+    void PutTag(Bytes& out, const char* tag) { out.insert(out.end(), tag, tag + 4); }
+    // little endian pcm bytes
+    void PutPcm(Bytes& out, const Pcm& pcm) {
+        for (const int32_t v : pcm.data) {
+            if (pcm.bits == 8) { out.push_back(uint8_t(v + 128)); continue; }
+            for (uint32_t b = 0; b != pcm.bits; b += 8) out.push_back(uint8_t(v >> b));
+        }
+    }
+    // big endian bit writer
+    struct BitWriter {
+        // output
+        Bytes&      out;
+        // pending bits
+        uint64_t    acc = 0;
+        // pending bit count
+        uint32_t    count = 0;
+        // write n bits, n <= 32
+        void Write(uint32_t x, uint32_t n) {
+            if (!n) return;
+            acc = (acc << n) | (x & (0xffffffffu >> (32 - n)));
+            count += n;
+            while (count >= 8) { count -= 8; out.push_back(uint8_t(acc >> count)); }
+        }
+        // write signed n bits
+        void WriteSigned(int32_t x, uint32_t n) { Write(uint32_t(x), n); }
+        // write unary, q zeros then one
+        void WriteUnary(uint32_t q) { for (; q >= 32; q -= 32) Write(0, 32); Write(1, q + 1); }
+        // pad with zero bits to byte boundary
+        void Align() { if (count) Write(0, 8 - count); }
+    };
+    // flac crc-8, poly 0x07
+    uint8_t Crc8(const uint8_t* data, size_t len) noexcept {
+        uint32_t crc = 0;
+        for (size_t i = 0; i != len; ++i) {
+            crc ^= data[i];
+            for (int k = 0; k != 8; ++k) crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xff : (crc << 1) & 0xff;
+        }
+        return uint8_t(crc);
+    }
+    // flac crc-16, poly 0x8005
+    uint16_t Crc16(const uint8_t* data, size_t len) noexcept {
+        uint32_t crc = 0;
+        for (size_t i = 0; i != len; ++i) {
+            crc ^= uint32_t(data[i]) << 8;
+            for (int k = 0; k != 8; ++k) crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) & 0xffff : (crc << 1) & 0xffff;
+        }
+        return uint16_t(crc);
+    }
+    // rice coded length of residuals with parameter k
+    uint64_t RiceBits(const int32_t* res, uint32_t n, uint32_t k) noexcept {
+        uint64_t bits = 0;
+        for (uint32_t i = 0; i != n; ++i) {
+            const uint32_t u = res[i] < 0 ? uint32_t(-int64_t(res[i]) * 2 - 1) : uint32_t(res[i]) * 2;
+            bits += (u >> k) + 1 + k;
+        }
+        return bits;
+    }
+    /// <summary>
+    /// Writes the residual of subframe, partition order 2 when block allows.
+    /// </summary>
+    /// <param name="bw">The bit writer.</param>
+    /// <param name="res">The residual, blocksize - order values.</param>
+    /// <param name="blocksize">The blocksize.</param>
+    /// <param name="order">The predictor order.</param>
+    void WriteResidual(BitWriter& bw, const int32_t* res, uint32_t blocksize, uint32_t order) {
+        const uint32_t po = (blocksize % 4 == 0 && blocksize / 4 > order) ? 2 : 0;
+        const uint32_t parts = 1u << po;
+        uint32_t params[4], lens[4];
+        uint32_t method = 0;
+        const int32_t* p = res;
+        for (uint32_t i = 0; i != parts; ++i) {
+            lens[i] = (blocksize >> po) - (i ? 0 : order);
+            uint32_t best = 0;
+            for (uint32_t k = 1; k <= 30; ++k)
+                if (RiceBits(p, lens[i], k) < RiceBits(p, lens[i], best)) best = k;
+            params[i] = best;
+            if (best > 14) method = 1;
+            p += lens[i];
+        }
+        bw.Write(method, 2);
+        bw.Write(po, 4);
+        p = res;
+        for (uint32_t i = 0; i != parts; ++i) {
+            bw.Write(params[i], method ? 5 : 4);
+            for (uint32_t j = 0; j != lens[i]; ++j) {
+                const uint32_t u = p[j] < 0 ? uint32_t(-int64_t(p[j]) * 2 - 1) : uint32_t(p[j]) * 2;
+                bw.WriteUnary(u >> params[i]);
+                bw.Write(u, params[i]);
+            }
+            p += lens[i];
+        }
+    }
+    /// <summary>
+    /// Writes one subframe, type picked by frame index: verbatim, fixed 0-4 or lpc.
+    /// </summary>
+    /// <param name="bw">The bit writer.</param>
+    /// <param name="s">The samples.</param>
+    /// <param name="n">The count.</param>
+    /// <param name="bits">The bits of subframe.</param>
+    /// <param name="frame">The frame index.</param>
+    void WriteSubframe(BitWriter& bw, const int32_t* s, uint32_t n, uint32_t bits, uint32_t frame) {
+        bool constant = true;
+        for (uint32_t i = 1; i != n; ++i) constant = constant && s[i] == s[0];
+        bw.Write(0, 1);
+        // 常数
+        if (constant) {
+            bw.Write(0, 6); bw.Write(0, 1);
+            bw.WriteSigned(s[0], bits);
+            return;
+        }
+        const uint32_t kind = frame % 9;
+        // 原始数据
+        if (kind == 8 || n <= 12) {
+            bw.Write(1, 6); bw.Write(0, 1);
+            for (uint32_t i = 0; i != n; ++i) bw.WriteSigned(s[i], bits);
+            return;
+        }
+        std::vector<int32_t> res(n);
+        // 固定预测
+        if (kind < 5) {
+            const uint32_t order = kind;
+            bw.Write(8 | order, 6); bw.Write(0, 1);
+            for (uint32_t i = 0; i != order; ++i) bw.WriteSigned(s[i], bits);
+            for (uint32_t i = order; i != n; ++i) {
+                int64_t pred = 0;
+                switch (order)
+                {
+                case 1: pred = s[i - 1]; break;
+                case 2: pred = 2 * int64_t(s[i - 1]) - s[i - 2]; break;
+                case 3: pred = 3 * int64_t(s[i - 1]) - 3 * int64_t(s[i - 2]) + s[i - 3]; break;
+                case 4: pred = 4 * int64_t(s[i - 1]) - 6 * int64_t(s[i - 2]) + 4 * int64_t(s[i - 3]) - s[i - 4]; break;
+                }
+                res[i - order] = int32_t(s[i] - pred);
+            }
+            WriteResidual(bw, res.data(), n, order);
+            return;
+        }
+        // 线性预测
+        const auto& lpc = FLAC_LPCS[kind - 5 < 3 ? kind - 5 : 0];
+        bw.Write(0x20 | (lpc.order - 1), 6); bw.Write(0, 1);
+        for (uint32_t i = 0; i != lpc.order; ++i) bw.WriteSigned(s[i], bits);
+        bw.Write(lpc.precision - 1, 4);
+        bw.WriteSigned(int32_t(lpc.shift), 5);
+        for (uint32_t j = 0; j != lpc.order; ++j) bw.WriteSigned(lpc.coefs[j], lpc.precision);
+        for (uint32_t i = lpc.order; i != n; ++i) {
+            int64_t sum = 0;
+            for (uint32_t j = 0; j != lpc.order; ++j) sum += int64_t(lpc.coefs[j]) * s[i - 1 - j];
+            res[i - lpc.order] = int32_t(s[i] - (sum >> lpc.shift));
+        }
+        WriteResidual(bw, res.data(), n, lpc.order);
+    }
+    // flac block size code: 0 for explicit 8/16 bit
+    uint32_t FlacBlockCode(uint32_t n) noexcept {
+        if (n == 192) return 1;
+        for (uint32_t c = 2; c <= 5; ++c) if (n == 576u << (c - 2)) return c;
+        for (uint32_t c = 8; c <= 15; ++c) if (n == 256u << (c - 8)) return c;
+        return 0;
+    }
+    /// <summary>
+    /// Writes one flac frame, stereo decorrelation cycles over frames.
+    /// </summary>
+    /// <param name="out">The out.</param>
+    /// <param name="pcm">The PCM.</param>
+    /// <param name="first">The first sample.</param>
+    /// <param name="n">The block size.</param>
+    /// <param name="number">The frame or sample number.</param>
+    /// <param name="variable">if set to <c>true</c> [variable] block.</param>
+    /// <param name="frame">The frame index.</param>
+    void WriteFlacFrame(Bytes& out, const Pcm& pcm, uint32_t first, uint32_t n, uint64_t number, bool variable, uint32_t frame) {
+        const size_t begin = out.size();
+        const uint32_t ch = pcm.channels;
+        const uint32_t assignment = ch == 2 ? (frame % 4 ? 7 + frame % 4 : 1) : ch - 1;
+        uint32_t code = FlacBlockCode(n);
+        const uint32_t bs_code = code ? code : (n <= 256 ? 6 : 7);
+        const uint32_t ss_code = pcm.bits == 8 ? 1 : pcm.bits == 16 ? 4 : pcm.bits == 24 ? 6 : 0;
+        out.push_back(0xff);
+        out.push_back(variable ? 0xf9 : 0xf8);
+        out.push_back(uint8_t(bs_code << 4));
+        out.push_back(uint8_t(assignment << 4 | ss_code << 1));
+        // UTF-8 编码的帧号/样本号
+        if (number < 0x80) out.push_back(uint8_t(number));
+        else {
+            uint32_t extra = 1;
+            while (number >> (6 * extra + 6 - extra)) ++extra;
+            out.push_back(uint8_t((0xff00 >> (extra + 1)) | (number >> (6 * extra))));
+            for (uint32_t i = extra; i; --i) out.push_back(uint8_t(0x80 | ((number >> (6 * (i - 1))) & 0x3f)));
+        }
+        if (bs_code == 6) out.push_back(uint8_t(n - 1));
+        if (bs_code == 7) { out.push_back(uint8_t((n - 1) >> 8)); out.push_back(uint8_t(n - 1)); }
+        out.push_back(Crc8(out.data() + begin, out.size() - begin));
+        BitWriter bw{ out };
+        std::vector<int32_t> chan[FIXTURE_MAX_CHANNELS];
+        for (uint32_t c = 0; c != ch; ++c) {
+            chan[c].resize(n);
+            for (uint32_t i = 0; i != n; ++i) chan[c][i] = pcm.data[size_t(first + i) * ch + c];
+        }
+        uint32_t bits[FIXTURE_MAX_CHANNELS] = { pcm.bits, pcm.bits };
+        // 左/侧, 侧/右, 中/侧
+        if (assignment >= 8) {
+            std::vector<int32_t> side(n), mid(n);
+            for (uint32_t i = 0; i != n; ++i) {
+                side[i] = chan[0][i] - chan[1][i];
+                mid[i] = (chan[0][i] + chan[1][i]) >> 1;
+            }
+            if (assignment == 8) { chan[1] = side; bits[1] += 1; }
+            if (assignment == 9) { chan[0] = side; bits[0] += 1; }
+            if (assignment == 10) { chan[0] = mid; chan[1] = side; bits[1] += 1; }
+        }
+        for (uint32_t c = 0; c != ch; ++c) WriteSubframe(bw, chan[c].data(), n, bits[c], frame + c);
+        bw.Align();
+        const uint16_t crc = Crc16(out.data() + begin, out.size() - begin);
+        out.push_back(uint8_t(crc >> 8));
+        out.push_back(uint8_t(crc));
+    }
+    // flac metadata block header
+    void PutFlacBlock(Bytes& out, uint32_t type, bool last, uint32_t len) {
+        out.push_back(uint8_t(type | (last ? 0x80 : 0)));
+        out.push_back(uint8_t(len >> 16)); out.push_back(uint8_t(len >> 8)); out.push_back(uint8_t(len));
+    }
+    /// <summary>
+    /// Makes the flac file with a seektable, block sizes cycled when variable.
+    /// </summary>
+    /// <param name="pcm">The PCM.</param>
+    /// <param name="variable">if set to <c>true</c> [variable] block.</param>
+    /// <returns></returns>
+    Bytes MakeFlac(const Pcm& pcm, bool variable) {
+        // 帧
+        Bytes frames;
+        struct Point { uint64_t sample, offset; uint32_t n; };
+        std::vector<Point> points;
+        uint32_t min_bs = 0xffff, max_bs = 0;
+        uint32_t pos = 0, frame = 0;
+        const uint32_t cycle = sizeof(FLAC_VARIABLE_BLOCKS) / sizeof(FLAC_VARIABLE_BLOCKS[0]);
+        while (pos < pcm.frames) {
+            uint32_t n = variable ? FLAC_VARIABLE_BLOCKS[frame % cycle] : FLAC_FIXED_BLOCK;
+            if (n > max_bs) max_bs = n;
+            if (n < min_bs) min_bs = n;
+            if (n > pcm.frames - pos) n = pcm.frames - pos;
+            if (frame % FLAC_SEEK_EVERY == 0) points.push_back({ pos, frames.size(), n });
+            WriteFlacFrame(frames, pcm, pos, n, variable ? pos : frame, variable, frame);
+            pos += n;
+            ++frame;
+        }
+        if (!variable) min_bs = max_bs;
+        Bytes out;
+        PutTag(out, "fLaC");
+        // STREAMINFO
+        PutFlacBlock(out, 0, false, 34);
+        BitWriter bw{ out };
+        bw.Write(min_bs, 16); bw.Write(max_bs, 16);
+        bw.Write(0, 24); bw.Write(0, 24);
+        bw.Write(pcm.rate, 20); bw.Write(pcm.channels - 1, 3); bw.Write(pcm.bits - 1, 5);
+        bw.Write(0, 4); bw.Write(pcm.frames, 32);
+        for (int i = 0; i != 4; ++i) bw.Write(0, 32);
+        // SEEKTABLE, 末尾带一个占位点
+        PutFlacBlock(out, 3, false, uint32_t(points.size() + 1) * 18);
+        for (const auto& p : points) {
+            bw.Write(uint32_t(p.sample >> 32), 32); bw.Write(uint32_t(p.sample), 32);
+            bw.Write(uint32_t(p.offset >> 32), 32); bw.Write(uint32_t(p.offset), 32);
+            bw.Write(p.n, 16);
+        }
+        bw.Write(0xffffffffu, 32); bw.Write(0xffffffffu, 32);
+        bw.Write(0, 32); bw.Write(0, 32); bw.Write(0, 16);
+        // PADDING
+        PutFlacBlock(out, 1, true, 16);
+        out.resize(out.size() + 16, 0);
+        out.insert(out.end(), frames.begin(), frames.end());
+        return out;
+    }
+    // wave fmt chunk, extensible when channel mask is given
+    void PutFmt(Bytes& out, uint32_t tag, const Pcm& pcm, uint32_t block_align, uint32_t bits, uint32_t mask, const Bytes& extra) {
+        const uint32_t ext = mask ? 22 : uint32_t(extra.size());
+        PutTag(out, "fmt ");
+        Put32(out, 18 + ext);
+        Put16(out, mask ? 0xfffe : tag);
+        Put16(out, pcm.channels);
+        Put32(out, pcm.rate);
+        // ADPCM: 额外数据的前两字节为每块样本数
+        const uint32_t per_block = extra.size() >= 2 ? uint32_t(extra[0] | extra[1] << 8) : 1;
+        Put32(out, pcm.rate * block_align / per_block);
+        Put16(out, block_align);
+        Put16(out, bits);
+        Put16(out, ext);
+        if (mask) {
+            static const uint8_t SUBTYPE[14] = {
+                0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71,
+            };
+            Put16(out, bits);
+            Put32(out, mask);
+            Put16(out, tag);
+            out.insert(out.end(), SUBTYPE, SUBTYPE + sizeof(SUBTYPE));
+        }
+        else out.insert(out.end(), extra.begin(), extra.end());
+    }
+    // riff size field
+    void FixRiff(Bytes& out) {
+        const uint32_t len = uint32_t(out.size() - 8);
+        for (int i = 0; i != 4; ++i) out[4 + i] = uint8_t(len >> (8 * i));
+    }
+    // pcm wave, odd sized chunk before data
+    Bytes MakeWave(const Pcm& pcm) {
+        Bytes out;
+        PutTag(out, "RIFF"); Put32(out, 0); PutTag(out, "WAVE");
+        const uint32_t align = pcm.channels * pcm.bits / 8;
+        PutFmt(out, 1, pcm, align, pcm.bits, 0, Bytes{});
+        PutTag(out, "LIST"); Put32(out, 5);
+        PutTag(out, "INFO"); out.push_back('x'); out.push_back(0);
+        PutTag(out, "data"); Put32(out, pcm.frames * align);
+        PutPcm(out, pcm);
+        FixRiff(out);
+        return out;
+    }
+    // rf64 wave, sizes in ds64, extensible format
+    Bytes MakeRf64(const Pcm& pcm) {
+        Bytes out;
+        const uint32_t align = pcm.channels * pcm.bits / 8;
+        const uint64_t data = uint64_t(pcm.frames) * align;
+        PutTag(out, "RF64"); Put32(out, 0xffffffffu); PutTag(out, "WAVE");
+        PutTag(out, "ds64"); Put32(out, 28);
+        const size_t riff = out.size();
+        Put64(out, 0); Put64(out, data); Put64(out, pcm.frames); Put32(out, 0);
+        PutFmt(out, 1, pcm, align, pcm.bits, pcm.channels == 2 ? 3 : 4, Bytes{});
+        PutTag(out, "data"); Put32(out, 0xffffffffu);
+        PutPcm(out, pcm);
+        const uint64_t len = out.size() - 8;
+        for (int i = 0; i != 8; ++i) out[riff + i] = uint8_t(len >> (8 * i));
+        return out;
+    }
+    // clamp to int16
+    int32_t Clamp16(int32_t x) noexcept { return x < -32768 ? -32768 : (x > 32767 ? 32767 : x); }
+    /// <summary>
+    /// Encodes ms-adpcm samples [2, n) of a channel, returns squared error.
+    /// </summary>
+    /// <param name="s">The samples, stride is channel count.</param>
+    /// <param name="ch">The channel count.</param>
+    /// <param name="n">The count.</param>
+    /// <param name="pred">The predictor index.</param>
+    /// <param name="delta">The initial delta.</param>
+    /// <param name="codes">The output nibbles.</param>
+    /// <returns></returns>
+    uint64_t MsEncodeLane(const int32_t* s, uint32_t ch, uint32_t n, uint32_t pred, int32_t delta, uint8_t* codes) {
+        int32_t s1 = s[ch], s2 = s[0];
+        uint64_t err = 0;
+        for (uint32_t i = 2; i < n; ++i) {
+            const int32_t p = (s1 * MS_COEFS[pred][0] + s2 * MS_COEFS[pred][1]) >> 8;
+            const int32_t diff = s[i * ch] - p;
+            int32_t code = (diff + (diff < 0 ? -delta / 2 : delta / 2)) / delta;
+            if (code > 7) code = 7;
+            if (code < -8) code = -8;
+            const int32_t cur = Clamp16(p + code * delta);
+            codes[i] = uint8_t(code & 0xf);
+            delta = (MS_ADAPT[code & 0xf] * delta) >> 8;
+            if (delta < 16) delta = 16;
+            s2 = s1; s1 = cur;
+            err += uint64_t(int64_t(cur - s[i * ch]) * (cur - s[i * ch]));
+        }
+        return err;
+    }
+    /// <summary>
+    /// Makes the ms-adpcm wave, predictor chosen per block and channel, last block partial.
+    /// </summary>
+    /// <param name="pcm">The PCM, 16 bit.</param>
+    /// <returns></returns>
+    Bytes MakeMsAdpcm(const Pcm& pcm) {
+        const uint32_t ch = pcm.channels;
+        const uint32_t per_block = 2 + (MS_BLOCK_ALIGN - 7 * ch) * 2 / ch;
+        Bytes extra;
+        Put16(extra, per_block);
+        Put16(extra, 7);
+        for (const auto& c : MS_COEFS) { Put16(extra, uint32_t(c[0])); Put16(extra, uint32_t(c[1])); }
+        Bytes data;
+        std::vector<uint8_t> codes[FIXTURE_MAX_CHANNELS], tmp(per_block);
+        for (uint32_t first = 0; first < pcm.frames; first += per_block) {
+            uint32_t n = pcm.frames - first;
+            if (n > per_block) n = per_block;
+            if (n < 2) break;
+            const int32_t* const s = pcm.data.data() + size_t(first) * ch;
+            uint32_t preds[FIXTURE_MAX_CHANNELS];
+            int32_t deltas[FIXTURE_MAX_CHANNELS];
+            for (uint32_t c = 0; c != ch; ++c) {
+                codes[c].assign(per_block, 0);
+                int32_t delta = (n > 2 ? std::abs(s[2 * ch + c] - s[ch + c]) : 0) / 2;
+                if (delta < 16) delta = 16;
+                deltas[c] = delta;
+                uint64_t best = ~uint64_t(0);
+                for (uint32_t p = 0; p != 7; ++p) {
+                    const auto err = MsEncodeLane(s + c, ch, n, p, delta, tmp.data());
+                    if (err < best) { best = err; preds[c] = p; codes[c] = tmp; }
+                }
+            }
+            // 块头: 预测器索引, 初始步长, 样本1, 样本2
+            for (uint32_t c = 0; c != ch; ++c) data.push_back(uint8_t(preds[c]));
+            for (uint32_t c = 0; c != ch; ++c) Put16(data, uint32_t(deltas[c]));
+            for (uint32_t c = 0; c != ch; ++c) Put16(data, uint32_t(s[ch + c]));
+            for (uint32_t c = 0; c != ch; ++c) Put16(data, uint32_t(s[c]));
+            // 高位半字节在前, 声道交错
+            uint32_t nibble = 0, k = 0;
+            for (uint32_t i = 2; i < n; ++i) {
+                for (uint32_t c = 0; c != ch; ++c, ++k) {
+                    nibble = (nibble << 4) | codes[c][i];
+                    if (k & 1) { data.push_back(uint8_t(nibble)); nibble = 0; }
+                }
+            }
+            if (k & 1) data.push_back(uint8_t(nibble << 4));
+        }
+        Bytes out;
+        PutTag(out, "RIFF"); Put32(out, 0); PutTag(out, "WAVE");
+        PutFmt(out, 2, pcm, MS_BLOCK_ALIGN, 4, 0, extra);
+        PutTag(out, "fact"); Put32(out, 4); Put32(out, pcm.frames);
+        PutTag(out, "data"); Put32(out, uint32_t(data.size()));
+        out.insert(out.end(), data.begin(), data.end());
+        if (data.size() & 1) out.push_back(0);
+        FixRiff(out);
+        return out;
+    }
+    /// <summary>
+    /// Makes the ima-adpcm wave, step index carried over blocks, last block partial.
+    /// </summary>
+    /// <param name="pcm">The PCM, 16 bit.</param>
+    /// <returns></returns>
+    Bytes MakeImaAdpcm(const Pcm& pcm) {
+        const uint32_t ch = pcm.channels;
+        const uint32_t per_block = 1 + (IMA_BLOCK_ALIGN - 4 * ch) / (4 * ch) * 8;
+        Bytes extra;
+        Put16(extra, per_block);
+        Bytes data;
+        int32_t index[FIXTURE_MAX_CHANNELS] = {};
+        std::vector<uint8_t> codes[FIXTURE_MAX_CHANNELS];
+        for (uint32_t first = 0; first < pcm.frames; first += per_block) {
+            uint32_t n = pcm.frames - first;
+            if (n > per_block) n = per_block;
+            // 不完整的块补齐到8样本
+            const uint32_t groups = (n - 1 + 7) / 8;
+            const int32_t* const s = pcm.data.data() + size_t(first) * ch;
+            for (uint32_t c = 0; c != ch; ++c) {
+                // 块头: 初始预测值, 步长索引, 保留
+                Put16(data, uint32_t(s[c]));
+                data.push_back(uint8_t(index[c]));
+                data.push_back(0);
+                codes[c].assign(groups * 8 + 1, 0);
+                int32_t pred = s[c];
+                for (uint32_t i = 1; i <= groups * 8; ++i) {
+                    const int32_t target = s[size_t(i < n ? i : n - 1) * ch + c];
+                    const int32_t step = IMA_STEP[index[c]];
+                    int32_t diff = target - pred;
+                    uint32_t code = 0;
+                    if (diff < 0) { code = 8; diff = -diff; }
+                    if (diff >= step) { code |= 4; diff -= step; }
+                    if (diff >= step >> 1) { code |= 2; diff -= step >> 1; }
+                    if (diff >= step >> 2) code |= 1;
+                    // 与解码器相同的重建
+                    int32_t delta = step >> 3;
+                    if (code & 1) delta += step >> 2;
+                    if (code & 2) delta += step >> 1;
+                    if (code & 4) delta += step;
+                    pred = Clamp16(pred + ((code & 8) ? -delta : delta));
+                    index[c] += IMA_INDEX[code];
+                    if (index[c] < 0) index[c] = 0;
+                    if (index[c] > 88) index[c] = 88;
+                    codes[c][i] = uint8_t(code);
+                }
+            }
+            // 每声道4字节8样本, 低位半字节在前
+            for (uint32_t g = 0; g != groups; ++g)
+                for (uint32_t c = 0; c != ch; ++c)
+                    for (uint32_t b = 0; b != 4; ++b)
+                        data.push_back(uint8_t(codes[c][g * 8 + b * 2 + 1] | (codes[c][g * 8 + b * 2 + 2] << 4)));
+        }
+        Bytes out;
+        PutTag(out, "RIFF"); Put32(out, 0); PutTag(out, "WAVE");
+        PutFmt(out, 0x11, pcm, IMA_BLOCK_ALIGN, 4, 0, extra);
+        PutTag(out, "fact"); Put32(out, 4); Put32(out, pcm.frames);
+        PutTag(out, "data"); Put32(out, uint32_t(data.size()));
+        out.insert(out.end(), data.begin(), data.end());
+        if (data.size() & 1) out.push_back(0);
+        FixRiff(out);
+        return out;
+    }
+    // write whole file
+    bool Save(const std::string& path, const Bytes& data) {
+        const auto file = std::fopen(path.c_str(), "wb");
+        if (!file) { std::printf("cannot write %s\n", path.c_str()); return false; }
+        const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        std::fclose(file);
+        if (ok) std::printf("%8u bytes %s\n", unsigned(data.size()), path.c_str());
+        return ok;
+    }
+}
+
+
+/// <summary>
+/// Writes the generated fixtures into dir, reference pcm of lossless ones into refdir.
+/// </summary>
+/// <param name="dir">The dir.</param>
+/// <param name="refdir">The reference pcm directory, nullptr for none.</param>
+/// <returns></returns>
+bool MakeFixtures(const char* dir, const char* refdir) {
+    struct Fixture { const char* name; Bytes data; const Pcm* ref; };
+    const auto s16 = MakeSignal(17000, 2, 16, 44100);
+    const auto s24 = MakeSignal(23000, 2, 24, 48000);
+    const auto m16 = MakeSignal(9000, 1, 16, 22050);
+    const auto w16 = MakeSignal(8000, 2, 16, 22050);
+    const auto w24 = MakeSignal(6000, 2, 24, 48000);
+    const Fixture fixtures[] = {
+        { "fixed.flac", MakeFlac(s16, false), &s16 },
+        { "variable.flac", MakeFlac(s24, true), &s24 },
+        { "pcm16.wav", MakeWave(w16), &w16 },
+        { "pcm24.rf64.wav", MakeRf64(w24), &w24 },
+        { "msadpcm.wav", MakeMsAdpcm(s16), nullptr },
+        { "imaadpcm.wav", MakeImaAdpcm(m16), nullptr },
+    };
+    bool ok = true;
+    for (const auto& f : fixtures) {
+        ok = Save(std::string(dir) + "/" + f.name, f.data) && ok;
+        if (!refdir || !f.ref) continue;
+        Bytes pcm;
+        PutPcm(pcm, *f.ref);
+        ok = Save(std::string(refdir) + "/" + f.name + ".pcm", pcm) && ok;
+    }
+    return ok;
+}
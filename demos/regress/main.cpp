@@ -0,0 +1,438 @@
+﻿// decode regression: decode fixtures via XAUAudioStream with varied chunk/seek patterns, compare with goldens
+// run from repository root, exit code is 0 only if all passed
+#include "../../inc/playau.h"
+#include "../../src/private/p_au_engine_interface.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "playau.lib")
+#endif
+
+namespace PlayAU {
+    // create audio stream via registered codecs
+    bool CreateAudioStreamFromFileStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) noexcept;
+}
+
+// write generated fixtures into dir, reference pcm of lossless ones into refdir, see fixture.cpp
+bool MakeFixtures(const char* dir, const char* refdir);
+
+namespace {
+    using namespace PlayAU;
+    // read pattern
+    enum Pattern : int {
+        // BUCKET_LENGTH chunks from begin to end, the reference
+        Pattern_Linear = 0,
+        // pseudo random chunk length
+        Pattern_Chunked,
+        // read half, seek to begin, read all
+        Pattern_Rewind,
+        // pseudo random seek then short read
+        Pattern_Seek,
+        // COUNT
+        PATTERN_COUNT
+    };
+    // pattern name
+    const char* const PATTERN_NAME[PATTERN_COUNT] = {
+        "linear", "chunked", "rewind", "seek",
+    };
+    // constant
+    enum : uint32_t {
+        // max chunk length in chunked pattern
+        CHUNK_MAX = 64 * 1024,
+        // seek count in seek pattern
+        SEEK_COUNT = 24,
+        // read length after seek
+        SEEK_READ = 4096,
+        // blocks before end in tail seek of seek pattern
+        SEEK_TAIL = 64,
+    };
+    // options
+    struct Options {
+        // golden file
+        const char* golden = "demos/regress/regress.golden";
+        // generated fixture directory
+        const char* fixtures = "demos/regress/fixtures";
+        // reference pcm directory, nullptr for none
+        const char* refdir = nullptr;
+        // min snr of seek reads against linear decode, in dB
+        double      snr = 90.0;
+        // write goldens instead of checking
+        bool        update = false;
+        // write generated fixtures and exit
+        bool        make = false;
+    };
+    // golden record
+    struct Golden {
+        // file path
+        std::string path;
+        // pattern
+        int         pattern;
+        // pcm byte count
+        uint64_t    bytes;
+        // pcm hash
+        uint64_t    hash;
+    };
+    // decode result
+    struct Result {
+        // pcm read, seek pattern keeps reads only
+        std::vector<uint8_t>    pcm;
+        // hash of pcm
+        uint64_t                hash;
+        // min snr of seek reads against linear decode
+        double                  snr;
+    };
+    // fnv-1a 64
+    uint64_t Hash(const uint8_t* data, size_t len, uint64_t h = 0xcbf29ce484222325ull) noexcept {
+        for (size_t i = 0; i != len; ++i) { h ^= data[i]; h *= 0x100000001b3ull; }
+        return h;
+    }
+    // deterministic lcg, same sequence on all platforms
+    struct Random {
+        // state
+        uint32_t    state;
+        // next value
+        uint32_t Next() noexcept { state = state * 1664525u + 1013904223u; return state >> 8; }
+    };
+    // block align of stream
+    uint32_t BlockAlign(const XAUAudioStream& stream) noexcept {
+        const uint32_t align = stream.format.channels * (stream.format.bits_per_sample / 8);
+        return align ? align : 1;
+    }
+    /// <summary>
+    /// Reads the sample normalized to [-1, 1].
+    /// </summary>
+    /// <param name="fmt">The format.</param>
+    /// <param name="ptr">The PTR.</param>
+    /// <returns></returns>
+    double Sample(const WaveFormat& fmt, const uint8_t* ptr) noexcept {
+        switch (fmt.bits_per_sample)
+        {
+        case 8:
+            return (double(ptr[0]) - 128.0) / 128.0;
+        case 16:
+            return double(int16_t(ptr[0] | (ptr[1] << 8))) / 32768.0;
+        case 24:
+            return double(int32_t(uint32_t(ptr[0] << 8) | uint32_t(ptr[1] << 16) | uint32_t(ptr[2]) << 24) >> 8) / 8388608.0;
+        case 32:
+            if (fmt.fmt_tag == Wave_IEEEFloat) { float f; std::memcpy(&f, ptr, 4); return f; }
+            { int32_t v; std::memcpy(&v, ptr, 4); return double(v) / 2147483648.0; }
+        }
+        return 0.0;
+    }
+    /// <summary>
+    /// Signal to noise ratio of test against reference in dB, infinity if equal.
+    /// </summary>
+    /// <param name="fmt">The format.</param>
+    /// <param name="ref">The reference.</param>
+    /// <param name="test">The test.</param>
+    /// <param name="len">The length.</param>
+    /// <returns></returns>
+    double Snr(const WaveFormat& fmt, const uint8_t* ref, const uint8_t* test, size_t len) noexcept {
+        if (!std::memcmp(ref, test, len)) return INFINITY;
+        const uint32_t size = fmt.bits_per_sample / 8;
+        double signal = 0.0, noise = 0.0;
+        for (size_t i = 0; i + size <= len; i += size) {
+            const double a = Sample(fmt, ref + i);
+            const double b = Sample(fmt, test + i);
+            signal += a * a;
+            noise += (a - b) * (a - b);
+        }
+        // 静音段上的误差按满幅信号计算
+        if (signal < 1e-12) signal = double(len / size);
+        return 10.0 * std::log10(signal / noise);
+    }
+    /// <summary>
+    /// Opens the audio stream of the file.
+    /// </summary>
+    /// <param name="data">The data.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool Open(const std::vector<uint8_t>& data, AudioStreamHolder& out) noexcept {
+        FileStreamHolder file;
+        const auto len = static_cast<uint32_t>(data.size());
+        if (!PlayAU::CreateMemoryStream(file, data.data(), len)) return false;
+        return PlayAU::CreateAudioStreamFromFileStream(file, out, Flag_None);
+    }
+    /// <summary>
+    /// Reads until end of stream.
+    /// </summary>
+    /// <param name="stream">The stream.</param>
+    /// <param name="out">The out.</param>
+    /// <param name="rng">The RNG, nullptr for BUCKET_LENGTH chunks.</param>
+    /// <returns></returns>
+    void ReadAll(XAUAudioStream& stream, std::vector<uint8_t>& out, Random* rng) {
+        const uint32_t align = BlockAlign(stream);
+        std::vector<uint8_t> buf(CHUNK_MAX + align);
+        while (true) {
+            uint32_t len = BUCKET_LENGTH;
+            // 按块对齐的随机长度, 至少一块
+            if (rng) len = (rng->Next() % CHUNK_MAX) / align * align + align;
+            const auto read = stream.ReadNext(len, buf.data());
+            if (!read) break;
+            out.insert(out.end(), buf.data(), buf.data() + read);
+        }
+    }
+    /// <summary>
+    /// Decodes the file with pattern.
+    /// </summary>
+    /// <param name="data">The data.</param>
+    /// <param name="pattern">The pattern.</param>
+    /// <param name="linear">The linear decode, used by seek pattern.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool Decode(const std::vector<uint8_t>& data, int pattern, const std::vector<uint8_t>& linear, Result& out) {
+        AudioStreamHolder holder;
+        if (!Open(data, holder)) return false;
+        auto& stream = *holder;
+        Random rng{ 0x5EED0000u + uint32_t(pattern) };
+        out.pcm.clear();
+        out.snr = INFINITY;
+        switch (pattern)
+        {
+        case Pattern_Linear:
+            ReadAll(stream, out.pcm, nullptr);
+            break;
+        case Pattern_Chunked:
+            ReadAll(stream, out.pcm, &rng);
+            break;
+        case Pattern_Rewind:
+        {
+            std::vector<uint8_t> half(static_cast<size_t>(stream.length / 2 / BlockAlign(stream) * BlockAlign(stream)));
+            stream.ReadNext(static_cast<uint32_t>(half.size()), half.data());
+            if (!stream.Seek(0, XAUStream::Move_Begin)) return false;
+            ReadAll(stream, out.pcm, nullptr);
+            break;
+        }
+        case Pattern_Seek:
+        {
+            const uint32_t align = BlockAlign(stream);
+            uint8_t buf[SEEK_READ];
+            // 读取并与线性解码的同一位置比较
+            const auto check = [&]() {
+                const uint64_t pos = stream.offset;
+                const auto read = stream.ReadNext(SEEK_READ / align * align, buf);
+                out.pcm.insert(out.pcm.end(), buf, buf + read);
+                if (pos + uint64_t(read) > linear.size()) { out.snr = -INFINITY; return; }
+                const auto snr = Snr(stream.format, linear.data() + pos, buf, read);
+                if (snr < out.snr) out.snr = snr;
+            };
+            for (uint32_t i = 0; i != SEEK_COUNT; ++i) {
+                // 偶数次绝对定位, 奇数次相对当前位置
+                const uint64_t target = stream.length ? (rng.Next() % stream.length) / align * align : 0;
+                const bool ok = (i & 1)
+                    ? stream.Seek(int64_t(target) - int64_t(stream.offset), XAUStream::Move_Current)
+                    : stream.Seek(int64_t(target), XAUStream::Move_Begin)
+                    ;
+                if (!ok) return false;
+                check();
+            }
+            // 最后一帧内, 然后定位到末尾: 之后不应再读出数据
+            const uint64_t blocks = stream.length / align;
+            const uint32_t tail = blocks < SEEK_TAIL ? uint32_t(blocks) : SEEK_TAIL;
+            if (!stream.Seek(-int64_t(tail * align), XAUStream::Move_End)) return false;
+            check();
+            if (!stream.Seek(0, XAUStream::Move_End)) return false;
+            if (stream.offset != stream.length) return false;
+            if (stream.ReadNext(SEEK_READ / align * align, buf)) return false;
+            break;
+        }
+        }
+        out.hash = Hash(out.pcm.data(), out.pcm.size());
+        return true;
+    }
+    /// <summary>
+    /// Loads the whole file.
+    /// </summary>
+    /// <param name="path">The path.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool LoadFile(const char* path, std::vector<uint8_t>& out) {
+        const auto file = std::fopen(path, "rb");
+        if (!file) return false;
+        std::fseek(file, 0, SEEK_END);
+        const long len = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        out.resize(len > 0 ? size_t(len) : 0);
+        const bool ok = std::fread(out.data(), 1, out.size(), file) == out.size();
+        std::fclose(file);
+        return ok;
+    }
+    // reference pcm path
+    std::string RefPath(const Options& opt, const std::string& path) {
+        const auto slash = path.find_last_of("/\\");
+        const auto name = slash == std::string::npos ? path : path.substr(slash + 1);
+        return std::string(opt.refdir) + "/" + name + ".pcm";
+    }
+    /// <summary>
+    /// Loads the goldens.
+    /// </summary>
+    /// <param name="path">The path.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool LoadGoldens(const char* path, std::vector<Golden>& out) {
+        const auto file = std::fopen(path, "r");
+        if (!file) return false;
+        char line[1024];
+        while (std::fgets(line, sizeof(line), file)) {
+            char name[16], fixture[900];
+            unsigned long long hash, bytes;
+            if (line[0] == '#') continue;
+            if (std::sscanf(line, "%15s %llx %llu %899[^\r\n]", name, &hash, &bytes, fixture) != 4) continue;
+            Golden g{ fixture, -1, bytes, hash };
+            for (int i = 0; i != PATTERN_COUNT; ++i)
+                if (!std::strcmp(name, PATTERN_NAME[i])) g.pattern = i;
+            if (g.pattern >= 0) out.push_back(g);
+        }
+        std::fclose(file);
+        return true;
+    }
+    /// <summary>
+    /// Runs all patterns on the fixture.
+    /// </summary>
+    /// <param name="opt">The option.</param>
+    /// <param name="path">The path.</param>
+    /// <param name="goldens">The goldens.</param>
+    /// <param name="out">The out, new goldens.</param>
+    /// <returns>failure count</returns>
+    int RunFixture(const Options& opt, const std::string& path, const std::vector<Golden>& goldens, std::vector<Golden>& out) {
+        std::vector<uint8_t> data;
+        if (!LoadFile(path.c_str(), data)) {
+            std::printf("FAIL %-8s %s: cannot read file\n", "-", path.c_str());
+            return 1;
+        }
+        AudioStreamHolder probe;
+        if (!Open(data, probe)) {
+            std::printf("FAIL %-8s %s: no codec\n", "-", path.c_str());
+            return 1;
+        }
+        const auto fmt = probe->format;
+        probe.Reset();
+        int failed = 0;
+        Result linear;
+        for (int p = 0; p != PATTERN_COUNT; ++p) {
+            Result result;
+            auto& now = p == Pattern_Linear ? linear : result;
+            if (!Decode(data, p, linear.pcm, now)) {
+                std::printf("FAIL %-8s %s: decode failed\n", PATTERN_NAME[p], path.c_str());
+                ++failed;
+                continue;
+            }
+            out.push_back(Golden{ path, p, now.pcm.size(), now.hash });
+            const char* reason = nullptr;
+            // 分块与重置必须与线性解码逐字节一致
+            if ((p == Pattern_Chunked || p == Pattern_Rewind) && now.hash != linear.hash)
+                reason = "differs from linear";
+            else if (p == Pattern_Seek && now.snr < opt.snr)
+                reason = "seek snr too low";
+            // 与金标准比较
+            if (!opt.update && !reason) {
+                const Golden* golden = nullptr;
+                for (const auto& g : goldens)
+                    if (g.pattern == p && g.path == path) golden = &g;
+                if (!golden) reason = "no golden";
+                else if (golden->hash != now.hash || golden->bytes != now.pcm.size())
+                    reason = "golden mismatch";
+            }
+            std::printf("%s %-8s %016llx %10llu", reason ? "FAIL" : "PASS",
+                PATTERN_NAME[p], (unsigned long long)now.hash, (unsigned long long)now.pcm.size());
+            if (p == Pattern_Seek) std::printf(" snr %6.1f", now.snr);
+            std::printf(" %s", path.c_str());
+            if (reason) std::printf(": %s", reason);
+            std::printf("\n");
+            if (reason) ++failed;
+        }
+        // 参考PCM: 更新时写入, 检查时用于定位误差
+        if (opt.refdir && !linear.pcm.empty()) {
+            const auto ref = RefPath(opt, path);
+            std::vector<uint8_t> old;
+            if (opt.update) {
+                if (const auto file = std::fopen(ref.c_str(), "wb")) {
+                    std::fwrite(linear.pcm.data(), 1, linear.pcm.size(), file);
+                    std::fclose(file);
+                }
+            }
+            else if (LoadFile(ref.c_str(), old)) {
+                const size_t len = old.size() < linear.pcm.size() ? old.size() : linear.pcm.size();
+                const auto snr = Snr(fmt, old.data(), linear.pcm.data(), len);
+                size_t first = 0;
+                while (first != len && old[first] == linear.pcm[first]) ++first;
+                std::printf("     %-8s snr %6.1f first diff at %llu of %llu/%llu %s\n", "ref", snr,
+                    (unsigned long long)first, (unsigned long long)linear.pcm.size(),
+                    (unsigned long long)old.size(), path.c_str());
+            }
+        }
+        return failed;
+    }
+    // usage
+    void Usage() noexcept {
+        std::printf(
+            "usage: regress [-u] [-m] [-g golden] [-r refdir] [-s snr] [fixtures...]\n"
+            "  -u       write goldens (and reference pcm with -r) instead of checking\n"
+            "  -m       write generated fixtures into demos/regress/fixtures (and reference pcm with -r)\n"
+            "  -g FILE  golden file, default demos/regress/regress.golden\n"
+            "  -r DIR   reference pcm directory, reports snr and first differing byte\n"
+            "  -s DB    min snr of seek reads against linear decode, default 90\n"
+            "  fixtures default to those listed in golden file, paths relative to repository root\n"
+        );
+    }
+}
+
+
+/// <summary>
+/// Mains the specified argc.
+/// </summary>
+/// <param name="argc">The argc.</param>
+/// <param name="argv">The argv.</param>
+/// <returns></returns>
+int main(int argc, char* argv[]) {
+    Options opt;
+    std::vector<std::string> fixtures;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (!std::strcmp(arg, "-u")) opt.update = true;
+        else if (!std::strcmp(arg, "-m")) opt.make = true;
+        else if (!std::strcmp(arg, "-g") && i + 1 < argc) opt.golden = argv[++i];
+        else if (!std::strcmp(arg, "-r") && i + 1 < argc) opt.refdir = argv[++i];
+        else if (!std::strcmp(arg, "-s") && i + 1 < argc) opt.snr = std::atof(argv[++i]);
+        else if (arg[0] == '-') { Usage(); return 2; }
+        else fixtures.push_back(arg);
+    }
+    if (opt.make) return MakeFixtures(opt.fixtures, opt.refdir) ? 0 : 2;
+    std::vector<Golden> goldens;
+    const bool has_golden = LoadGoldens(opt.golden, goldens);
+    if (!opt.update && !has_golden) {
+        std::printf("cannot read golden file %s, run with -u first\n", opt.golden);
+        return 2;
+    }
+    // 未指定时使用金标准中的全部文件
+    if (fixtures.empty()) {
+        for (const auto& g : goldens) {
+            bool found = false;
+            for (const auto& f : fixtures) found = found || f == g.path;
+            if (!found) fixtures.push_back(g.path);
+        }
+    }
+    if (fixtures.empty()) fixtures.push_back("audiofiledemo/Hymn_of_ussr_instrumental.ogg");
+    int failed = 0;
+    std::vector<Golden> now;
+    for (const auto& f : fixtures) failed += RunFixture(opt, f, goldens, now);
+    if (opt.update) {
+        const auto file = std::fopen(opt.golden, "w");
+        if (!file) { std::printf("cannot write %s\n", opt.golden); return 2; }
+        std::fprintf(file, "# pattern hash bytes fixture, written by regress -u\n"
+            "# float codecs may round differently per compiler/cpu, rebase with -u and check snr with -r\n");
+        for (const auto& g : now)
+            std::fprintf(file, "%s %016llx %llu %s\n", PATTERN_NAME[g.pattern],
+                (unsigned long long)g.hash, (unsigned long long)g.bytes, g.path.c_str());
+        std::fclose(file);
+        std::printf("%u goldens written to %s\n", unsigned(now.size()), opt.golden);
+    }
+    std::printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
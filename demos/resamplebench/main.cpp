@@ -0,0 +1,218 @@
+﻿// resampler benchmark: quality (snr, alias rejection) and throughput of each mode over common rate pairs
+#include "../../inc/au_dsp.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "playau.lib")
+#endif
+
+namespace {
+    using namespace PlayAU;
+    // clock
+    using Clock = std::chrono::steady_clock;
+    // constant
+    enum : uint32_t {
+        // output frames per process call, 10ms at 48k
+        BLOCK_FRAMES = 480,
+        // frames skipped at both ends when measuring
+        EDGE_FRAMES = 64,
+    };
+    // pi
+    const double PI = 3.14159265358979323846;
+    // options
+    struct Options {
+        // audio seconds per throughput run
+        double      seconds = 10.0;
+        // channels of throughput run
+        uint32_t    channels = 2;
+        // json output, nullptr for none
+        const char* json = nullptr;
+    };
+    // rate pair
+    struct RatePair {
+        // input rate
+        uint32_t    in;
+        // output rate
+        uint32_t    out;
+    };
+    // result of one mode on one rate pair
+    struct Result {
+        // mode
+        ResampleMode    mode;
+        // pair
+        RatePair        pair;
+        // snr at 1kHz in dB
+        double          snr_low;
+        // snr at half nyquist of lower rate in dB
+        double          snr_high;
+        // alias level of tone above output nyquist in dB, 0 if upsampling
+        double          alias;
+        // output frames per second per channel, in million
+        double          mfps;
+        // same with ratio swept +-5% every block
+        double          mfps_doppler;
+    };
+    // mode name
+    const char* ModeName(ResampleMode mode) noexcept {
+        switch (mode)
+        {
+        case Resample_Linear: return "linear";
+        case Resample_Cubic: return "cubic";
+        default: return "sinc";
+        }
+    }
+    // resample whole mono signal in blocks, constant ratio
+    void ResampleAll(ResampleMode mode, double ratio, const std::vector<float>& in, std::vector<float>& out) {
+        CAUResampler rs;
+        rs.Reset(mode, 1, ratio);
+        out.assign(size_t(double(in.size()) / ratio), 0.f);
+        uint32_t src = 0, dst = 0;
+        const auto in_len = uint32_t(in.size()), out_len = uint32_t(out.size());
+        while (dst < out_len) {
+            uint32_t n = out_len - dst, consumed = 0;
+            if (n > BLOCK_FRAMES) n = BLOCK_FRAMES;
+            const auto done = rs.Process(in.data() + src, in_len - src, consumed, out.data() + dst, n, ratio);
+            src += consumed;
+            dst += done;
+            if (done != n) break;
+        }
+        out.resize(dst);
+    }
+    // make sine
+    void MakeSine(std::vector<float>& buf, uint32_t len, double freq, double rate) {
+        buf.resize(len);
+        for (uint32_t i = 0; i != len; ++i)
+            buf[i] = float(0.5 * std::sin(2.0 * PI * freq * double(i) / rate));
+    }
+    // snr of resampled sine against ideal one
+    double MeasureSnr(ResampleMode mode, const RatePair& pair, double freq) {
+        std::vector<float> in, out;
+        MakeSine(in, pair.in, freq, double(pair.in));
+        const double ratio = double(pair.in) / double(pair.out);
+        ResampleAll(mode, ratio, in, out);
+        double sig = 0.0, err = 0.0;
+        for (size_t j = EDGE_FRAMES; j + EDGE_FRAMES < out.size(); ++j) {
+            // 输出帧j对应输入位置j*ratio
+            const double ideal = 0.5 * std::sin(2.0 * PI * freq * double(j) * ratio / double(pair.in));
+            sig += ideal * ideal;
+            err += (double(out[j]) - ideal) * (double(out[j]) - ideal);
+        }
+        if (err <= 0.0) return 200.0;
+        return 10.0 * std::log10(sig / err);
+    }
+    // level of tone between output and input nyquist, should be filtered out
+    double MeasureAlias(ResampleMode mode, const RatePair& pair) {
+        if (pair.out >= pair.in) return 0.0;
+        std::vector<float> in, out;
+        const double freq = 0.5 * (double(pair.out) * 0.5 + double(pair.in) * 0.5 * 0.9);
+        MakeSine(in, pair.in, freq, double(pair.in));
+        ResampleAll(mode, double(pair.in) / double(pair.out), in, out);
+        double level = 0.0;
+        size_t count = 0;
+        for (size_t j = EDGE_FRAMES; j + EDGE_FRAMES < out.size(); ++j, ++count)
+            level += double(out[j]) * double(out[j]);
+        if (!count || level <= 0.0) return -200.0;
+        // 相对输入正弦功率
+        return 10.0 * std::log10(level / double(count) / 0.125);
+    }
+    // throughput in output mframes per second per channel
+    double MeasureSpeed(ResampleMode mode, const RatePair& pair, const Options& opt, bool doppler) {
+        const uint32_t ch = opt.channels;
+        const double ratio = double(pair.in) / double(pair.out);
+        const auto out_total = uint32_t(opt.seconds * double(pair.out));
+        // 输入为一段循环使用的噪声
+        std::vector<float> in(size_t(BLOCK_FRAMES) * RESAMPLE_MAX_RATIO * 2 * ch);
+        uint32_t seed = 12345;
+        for (auto& x : in) { seed = seed * 1664525u + 1013904223u; x = float(int32_t(seed) >> 8) / float(1 << 23); }
+        std::vector<float> out(size_t(BLOCK_FRAMES) * ch);
+        const auto in_frames = uint32_t(in.size() / ch);
+        CAUResampler rs;
+        rs.Reset(mode, ch, ratio);
+        uint32_t done = 0, block = 0;
+        float sink = 0.f;
+        const auto begin = Clock::now();
+        while (done < out_total) {
+            double target = ratio;
+            if (doppler) target = ratio * (1.0 + 0.05 * std::sin(double(block) * 0.05));
+            uint32_t consumed = 0, offset = 0, written = 0;
+            while (written != BLOCK_FRAMES) {
+                if (offset + 1 >= in_frames) offset = 0;
+                written += rs.Process(in.data() + size_t(offset) * ch, in_frames - offset, consumed,
+                    out.data() + size_t(written) * ch, BLOCK_FRAMES - written, target);
+                offset += consumed;
+            }
+            sink += out[0];
+            done += BLOCK_FRAMES;
+            ++block;
+        }
+        const double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+        if (sink == 12345.f) std::printf(" ");
+        return double(done) / sec * 1e-6;
+    }
+    // usage
+    void Usage() noexcept {
+        std::printf("usage: resamplebench [-s seconds] [-c channels] [-j out.json]\n");
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has = i + 1 < argc;
+        if (!std::strcmp(arg, "-s") && has) opt.seconds = std::atof(argv[++i]);
+        else if (!std::strcmp(arg, "-c") && has) opt.channels = uint32_t(std::atoi(argv[++i]));
+        else if (!std::strcmp(arg, "-j") && has) opt.json = argv[++i];
+        else { Usage(); return 2; }
+    }
+    if (opt.seconds <= 0.0 || !opt.channels || opt.channels > DSP_MAX_CHANNELS) {
+        Usage();
+        return 2;
+    }
+    const RatePair pairs[] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 },
+        { 48000, 22050 }, { 96000, 48000 }, { 32000, 48000 },
+    };
+    const ResampleMode modes[] = { Resample_Linear, Resample_Cubic, Resample_Sinc };
+    std::vector<Result> results;
+    std::printf("%-7s %-13s %9s %9s %9s %10s %10s\n",
+        "mode", "rate", "snr1k", "snrhigh", "alias", "mfps", "doppler");
+    for (const auto& pair : pairs) {
+        for (const auto mode : modes) {
+            Result r{};
+            r.mode = mode;
+            r.pair = pair;
+            const uint32_t low = pair.in < pair.out ? pair.in : pair.out;
+            r.snr_low = MeasureSnr(mode, pair, 1000.0);
+            r.snr_high = MeasureSnr(mode, pair, double(low) * 0.25);
+            r.alias = MeasureAlias(mode, pair);
+            r.mfps = MeasureSpeed(mode, pair, opt, false);
+            r.mfps_doppler = MeasureSpeed(mode, pair, opt, true);
+            std::printf("%-7s %5u->%-6u %8.1fdB %8.1fdB %8.1fdB %9.2fM %9.2fM\n",
+                ModeName(mode), pair.in, pair.out, r.snr_low, r.snr_high, r.alias, r.mfps, r.mfps_doppler);
+            results.push_back(r);
+        }
+    }
+    if (opt.json) {
+        const auto file = std::fopen(opt.json, "w");
+        if (!file) { std::printf("cannot write %s\n", opt.json); return 1; }
+        std::fprintf(file, "{\n  \"channels\": %u,\n  \"seconds\": %.3f,\n  \"results\": [\n", opt.channels, opt.seconds);
+        for (size_t i = 0; i != results.size(); ++i) {
+            const auto& r = results[i];
+            std::fprintf(file, "    {\"mode\": \"%s\", \"in\": %u, \"out\": %u, \"snr_1k\": %.2f, "
+                "\"snr_high\": %.2f, \"alias\": %.2f, \"mfps\": %.3f, \"mfps_doppler\": %.3f}%s\n",
+                ModeName(r.mode), r.pair.in, r.pair.out, r.snr_low, r.snr_high, r.alias,
+                r.mfps, r.mfps_doppler, i + 1 == results.size() ? "" : ",");
+        }
+        std::fprintf(file, "  ]\n}\n");
+        std::fclose(file);
+    }
+    return 0;
+}
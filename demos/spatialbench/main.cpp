@@ -0,0 +1,209 @@
+﻿// spatializer check and benchmark: compare simd update with scalar reference, check known cases, then time emitters
+#include "../../inc/au_spatial.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "playau.lib")
+#endif
+
+namespace {
+    using namespace PlayAU;
+    // clock
+    using Clock = std::chrono::steady_clock;
+    // spatializer holder
+    using Spatial = std::unique_ptr<CAUSpatializer>;
+    // constant
+    enum : uint32_t {
+        // random emitters in check
+        CHECK_EMITTERS = 1001,
+        // every n-th emitter removed in check, leaves holes in the id range
+        CHECK_HOLE = 7,
+    };
+    // max error allowed between simd and reference
+    const float CHECK_TOLERANCE = 1e-5f;
+    // max error allowed in known cases
+    const float CASE_TOLERANCE = 1e-3f;
+    // options
+    struct Options {
+        // emitter count
+        uint32_t    emitters = SPATIAL_MAX_EMITTERS;
+        // updates per measure
+        uint32_t    rounds = 2000;
+    };
+    // random
+    struct Random {
+        // state
+        uint32_t    seed = 2463534242u;
+        // next in [-1, 1)
+        float Next() noexcept {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            return float(int32_t(seed) >> 8) / float(1 << 23);
+        }
+    };
+    // known case
+    struct Case {
+        // name
+        const char* name;
+        // emitter position
+        AudioVector position;
+        // emitter velocity
+        AudioVector velocity;
+        // cone front, zero for omni
+        AudioVector front;
+        // attenuation curve
+        AttenuationCurve curve;
+        // expected gain, left, right, doppler
+        float       gain, left, right, doppler;
+    };
+    // known cases, listener at origin facing +z
+    const Case CASES[] = {
+        { "left",     { -5, 0, 0 }, { 0, 0, 0 },     { 0, 0, 0 },  Attenuation_Inverse, 0.2f,  1.f,     0.f,     1.f },
+        { "right",    {  5, 0, 0 }, { 0, 0, 0 },     { 0, 0, 0 },  Attenuation_Inverse, 0.2f,  0.f,     1.f,     1.f },
+        { "front",    {  0, 0, 2 }, { 0, 0, 0 },     { 0, 0, 0 },  Attenuation_Inverse, 0.5f,  0.7071f, 0.7071f, 1.f },
+        { "approach", {  0, 0, 10 }, { 0, 0, -34.3f }, { 0, 0, 0 }, Attenuation_Inverse, 0.1f,  0.7071f, 0.7071f, 1.1111f },
+        { "recede",   {  0, 0, 10 }, { 0, 0, 34.3f }, { 0, 0, 0 },  Attenuation_Inverse, 0.1f,  0.7071f, 0.7071f, 0.9091f },
+        { "cone-away",{  0, 0, 10 }, { 0, 0, 0 },     { 0, 0, 1 },  Attenuation_Inverse, 0.025f, 0.7071f, 0.7071f, 1.f },
+        { "cone-to",  {  0, 0, 10 }, { 0, 0, 0 },     { 0, 0, -1 }, Attenuation_Inverse, 0.1f,  0.7071f, 0.7071f, 1.f },
+        { "linear",   {  0, 0, 10 }, { 0, 0, 0 },     { 0, 0, 0 },  Attenuation_Linear,  0.5f,  0.7071f, 0.7071f, 1.f },
+        { "none",     {  0, 0, 100 }, { 0, 0, 0 },    { 0, 0, 0 },  Attenuation_None,    1.f,   0.7071f, 0.7071f, 1.f },
+    };
+    // create spatializer
+    Spatial Create() {
+        Spatial spatial{ new(std::nothrow) CAUSpatializer };
+        if (!spatial) std::printf("out of memory\n");
+        return spatial;
+    }
+    // random emitter
+    AudioEmitter RandomEmitter(Random& rng, uint32_t i) noexcept {
+        AudioEmitter e;
+        e.position = { rng.Next() * 50.f, rng.Next() * 50.f, rng.Next() * 50.f };
+        e.velocity = { rng.Next() * 50.f, rng.Next() * 50.f, rng.Next() * 50.f };
+        e.front = { rng.Next(), rng.Next(), rng.Next() };
+        e.cone.inner_angle = 1.f;
+        e.cone.outer_angle = 3.f;
+        e.cone.outer_volume = 0.3f;
+        e.max_distance = 40.f;
+        e.curve = AttenuationCurve(i % 3);
+        return e;
+    }
+    // check simd update against scalar reference, return max error
+    float Check(CAUSpatializer& simd, CAUSpatializer& scalar) noexcept {
+        Random rng;
+        AudioListener listener;
+        listener.position = { 1.f, 2.f, 3.f };
+        listener.velocity = { 3.f, 0.f, -2.f };
+        listener.front = { 1.f, 0.f, 1.f };
+        simd.SetListener(listener);
+        scalar.SetListener(listener);
+        uint32_t ids[CHECK_EMITTERS];
+        for (uint32_t i = 0; i != CHECK_EMITTERS; ++i) {
+            const auto e = RandomEmitter(rng, i);
+            ids[i] = simd.AddEmitter(e, &simd);
+            scalar.AddEmitter(e, &scalar);
+        }
+        for (uint32_t i = 0; i < CHECK_EMITTERS; i += CHECK_HOLE) {
+            simd.RemoveEmitter(ids[i]);
+            scalar.RemoveEmitter(ids[i]);
+        }
+        simd.Update();
+        scalar.UpdateScalar();
+        float err = 0.f;
+        for (uint32_t id = 0; id != simd.GetEnd(); ++id) {
+            if (!simd.GetUser(id)) continue;
+            err = std::fmax(err, std::fabs(simd.GetGain(id) - scalar.GetGain(id)));
+            err = std::fmax(err, std::fabs(simd.GetLeft(id) - scalar.GetLeft(id)));
+            err = std::fmax(err, std::fabs(simd.GetRight(id) - scalar.GetRight(id)));
+            err = std::fmax(err, std::fabs(simd.GetDoppler(id) - scalar.GetDoppler(id)));
+        }
+        for (uint32_t i = 0; i != CHECK_EMITTERS; ++i)
+            if (i % CHECK_HOLE) simd.RemoveEmitter(ids[i]), scalar.RemoveEmitter(ids[i]);
+        return err;
+    }
+    // check known cases via simd update, return failed count
+    uint32_t CheckCases(CAUSpatializer& spatial) noexcept {
+        spatial.SetListener(AudioListener{});
+        uint32_t failed = 0;
+        for (const auto& c : CASES) {
+            AudioEmitter e;
+            e.position = c.position;
+            e.velocity = c.velocity;
+            e.curve = c.curve;
+            e.max_distance = 19.f;
+            if (c.front.x || c.front.y || c.front.z) {
+                e.front = c.front;
+                e.cone.inner_angle = 1.f;
+                e.cone.outer_angle = 2.f;
+                e.cone.outer_volume = 0.25f;
+            }
+            const auto id = spatial.AddEmitter(e, &spatial);
+            spatial.Update();
+            const float got[4] = {
+                spatial.GetGain(id), spatial.GetLeft(id),
+                spatial.GetRight(id), spatial.GetDoppler(id)
+            };
+            const float want[4] = { c.gain, c.left, c.right, c.doppler };
+            bool ok = true;
+            for (uint32_t i = 0; i != 4; ++i) ok = ok && std::fabs(got[i] - want[i]) <= CASE_TOLERANCE;
+            if (!ok) {
+                ++failed;
+                std::printf("case %-9s FAILED gain %.4f L %.4f R %.4f doppler %.4f\n",
+                    c.name, got[0], got[1], got[2], got[3]);
+            }
+            spatial.RemoveEmitter(id);
+        }
+        return failed;
+    }
+    // time update of emitters, return ns per emitter
+    double Bench(const Options& opt, CAUSpatializer& spatial, bool scalar) {
+        Random rng;
+        std::vector<uint32_t> ids(opt.emitters);
+        for (uint32_t i = 0; i != opt.emitters; ++i) ids[i] = spatial.AddEmitter(RandomEmitter(rng, i), &spatial);
+        const auto begin = Clock::now();
+        for (uint32_t r = 0; r != opt.rounds; ++r) {
+            if (scalar) spatial.UpdateScalar();
+            else spatial.Update();
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        for (const auto id : ids) spatial.RemoveEmitter(id);
+        return ns / (double(opt.rounds) * opt.emitters);
+    }
+    // usage
+    void Usage() noexcept {
+        std::printf("usage: spatialbench [-n emitters] [-r rounds]\n");
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has = i + 1 < argc;
+        if (!std::strcmp(arg, "-n") && has) opt.emitters = uint32_t(std::atoi(argv[++i]));
+        else if (!std::strcmp(arg, "-r") && has) opt.rounds = uint32_t(std::atoi(argv[++i]));
+        else { Usage(); return 2; }
+    }
+    if (!opt.emitters || opt.emitters > SPATIAL_MAX_EMITTERS || !opt.rounds) { Usage(); return 2; }
+    const auto simd = Create();
+    const auto scalar = Create();
+    if (!simd || !scalar) return 1;
+    const float err = Check(*simd, *scalar);
+    std::printf("check: max error %.3g %s\n", err, err <= CHECK_TOLERANCE ? "ok" : "FAILED");
+    const uint32_t failed = CheckCases(*simd);
+    std::printf("cases: %u failed\n", failed);
+    if (err > CHECK_TOLERANCE || failed) return 1;
+    const double t_simd = Bench(opt, *simd, false);
+    const double t_scalar = Bench(opt, *scalar, true);
+    std::printf("%u emitters, %u updates\n", opt.emitters, opt.rounds);
+    std::printf("%12s %12s %8s\n", "simd ns/e", "scalar ns/e", "speedup");
+    std::printf("%12.3f %12.3f %7.2fx\n", t_simd, t_scalar, t_scalar / t_simd);
+    return 0;
+}
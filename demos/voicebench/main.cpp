@@ -0,0 +1,355 @@
+﻿// many-voice benchmark: decode, resample and mix N streaming voices with the software mixer, report thread cpu per voice and thread scaling
+#include "../../inc/playau.h"
+#include "../../src/private/p_au_engine_interface.h"
+
+#include "../../inc/au_mixer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "playau.lib")
+#endif
+
+namespace PlayAU {
+    // create audio stream via registered codecs
+    bool CreateAudioStreamFromFileStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) noexcept;
+}
+
+namespace {
+    using namespace PlayAU;
+    // clock
+    using Clock = std::chrono::steady_clock;
+    // constant
+    enum : uint32_t {
+        // output sample rate
+        MIX_RATE = 48000,
+        // frames per mixer pass, 10ms
+        MIX_FRAMES = MIX_RATE / 100,
+        // passes not timed
+        WARMUP_PASSES = 10,
+        // max voice count searched
+        MAX_VOICES = 1 << 16,
+    };
+    // options
+    struct Options {
+        // voice count of fixed run
+        uint32_t    voices = 64;
+        // group count
+        uint32_t    groups = 4;
+        // max mixer threads
+        uint32_t    threads = 16;
+        // audio seconds per measure
+        double      seconds = 2.0;
+        // real-time budget, part of pass time
+        double      budget = 0.5;
+        // resample mode
+        ResampleMode mode = Resample_Linear;
+        // json output, nullptr for none
+        const char* json = nullptr;
+    };
+    // asset
+    struct Asset {
+        // name
+        std::string             name;
+        // file data
+        std::vector<uint8_t>    data;
+    };
+    // measure result
+    struct Measure {
+        // voices
+        uint32_t    voices;
+        // threads
+        uint32_t    threads;
+        // wall time / audio time
+        double      load;
+        // cpu time of mixer threads per voice per audio second, in us
+        double      voice_us;
+        // memory bytes per voice
+        double      voice_bytes;
+        // part of blocks later than deadline
+        double      late;
+        // tasks stolen per block
+        double      steals;
+    };
+    // timer
+    struct Timer {
+        // begin
+        Clock::time_point   begin = Clock::now();
+        // elapsed in sec
+        double Elapsed() const noexcept {
+            const std::chrono::duration<double> d = Clock::now() - begin;
+            return d.count();
+        }
+    };
+    /// <summary>
+    /// Creates the audio stream of asset.
+    /// </summary>
+    /// <param name="asset">The asset.</param>
+    /// <param name="index">The voice index.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool OpenAsset(const Asset& asset, uint32_t index, AudioStreamHolder& out) noexcept {
+        FileStreamHolder file;
+        const auto len = static_cast<uint32_t>(asset.data.size());
+        if (!PlayAU::CreateMemoryStream(file, asset.data.data(), len)) return false;
+        if (!PlayAU::CreateAudioStreamFromFileStream(file, out, Flag_None)) return false;
+        const auto& fmt = out->format;
+        const uint32_t align = fmt.channels * (fmt.bits_per_sample / 8);
+        if (!align || !out->length) return false;
+        // 错开起始位置, 避免所有声部同时在同一帧解码
+        const uint64_t start = uint64_t(index) * 7919 * align % out->length / align * align;
+        return out->Seek(int64_t(start), XAUStream::Move_Begin);
+    }
+    /// <summary>
+    /// Runs voices through the software mixer.
+    /// </summary>
+    /// <param name="opt">The option.</param>
+    /// <param name="assets">The assets.</param>
+    /// <param name="count">The voice count.</param>
+    /// <param name="threads">The threads.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool Run(const Options& opt, const std::vector<Asset>& assets, uint32_t count, uint32_t threads, Measure& out) {
+        MemoryStats mem0, mem1;
+        PlayAU::GetMemoryStats(mem0);
+        CAUSoftMixer mixer;
+        if (!mixer.Initialize(MIX_RATE, 2, threads, float(opt.budget))) return false;
+        for (uint32_t i = 0; i != count; ++i) {
+            AudioStreamHolder stream;
+            if (!OpenAsset(assets[i % assets.size()], i, stream)) return false;
+            const auto voice = mixer.CreateVoice(std::move(stream), i % opt.groups);
+            if (!voice) return false;
+            mixer.SetVolume(voice, 1.f / 16.f);
+            mixer.SetLoop(voice, true);
+            mixer.SetResampleMode(voice, opt.mode);
+            mixer.Play(voice);
+        }
+        PlayAU::GetMemoryStats(mem1);
+        std::vector<float> master(size_t(MIX_FRAMES) * 2);
+        const uint32_t passes = uint32_t(opt.seconds * 100.0);
+        for (uint32_t pass = 0; pass != WARMUP_PASSES; ++pass)
+            mixer.Render(master.data(), MIX_FRAMES);
+        SoftMixerStats s0, s1;
+        mixer.GetStats(s0);
+        Timer timer;
+        for (uint32_t pass = 0; pass != passes; ++pass)
+            mixer.Render(master.data(), MIX_FRAMES);
+        const double wall = timer.Elapsed();
+        mixer.GetStats(s1);
+        const double audio = double(passes) / 100.0;
+        out.voices = count;
+        out.threads = s1.threads;
+        out.load = wall / audio;
+        // 各线程实际占用的cpu时间, 而不是墙钟时间乘以线程数
+        out.voice_us = double(s1.cpu_ns - s0.cpu_ns) * 1e-3 / audio / double(count);
+        out.voice_bytes = double(mem1.total - mem0.total) / double(count);
+        const auto blocks = s1.blocks - s0.blocks;
+        out.late = blocks ? double(s1.late_blocks - s0.late_blocks) / double(blocks) : 0.0;
+        out.steals = blocks ? double(s1.steals - s0.steals) / double(blocks) : 0.0;
+        return true;
+    }
+    /// <summary>
+    /// Finds max voice count under budget.
+    /// </summary>
+    /// <param name="opt">The option.</param>
+    /// <param name="assets">The assets.</param>
+    /// <param name="threads">The threads.</param>
+    /// <param name="out">The measure at max count.</param>
+    /// <returns>0 if even one voice is over budget</returns>
+    uint32_t MaxVoices(const Options& opt, const std::vector<Asset>& assets, uint32_t threads, Measure& out) {
+        Measure m{};
+        uint32_t good = 0, bad = 0;
+        // 倍增找到上界, 再二分到5%精度
+        for (uint32_t n = 8; n <= MAX_VOICES; n *= 2) {
+            if (!Run(opt, assets, n, threads, m)) return 0;
+            if (m.load > opt.budget) { bad = n; break; }
+            good = n; out = m;
+        }
+        if (!bad) return good;
+        // 起点已经超出预算: 明确提示, 向下搜索
+        if (!good) std::printf("%-10s %u voices over budget at %u thread(s) (load %.3f), searching below\n",
+            "note", bad, threads, m.load);
+        while (bad - good > std::max<uint32_t>(1, good / 20)) {
+            const uint32_t mid = good + (bad - good) / 2;
+            if (!Run(opt, assets, mid, threads, m)) break;
+            if (m.load > opt.budget) bad = mid;
+            else { good = mid; out = m; }
+        }
+        return good;
+    }
+    /// <summary>
+    /// Makes the wave file in memory.
+    /// </summary>
+    /// <param name="rate">The rate.</param>
+    /// <param name="channels">The channels.</param>
+    /// <param name="sec">The length in sec.</param>
+    /// <returns></returns>
+    Asset MakeWave(uint32_t rate, uint16_t channels, double sec) {
+        Asset asset;
+        asset.name = "pcm" + std::to_string(rate) + "x" + std::to_string(channels);
+        const uint32_t frames = uint32_t(rate * sec);
+        const uint32_t data_len = frames * channels * 2;
+        auto& d = asset.data;
+        const auto put = [&d](uint32_t v, int n) { for (int i = 0; i != n; ++i) d.push_back(uint8_t(v >> (i * 8))); };
+        d.insert(d.end(), { 'R', 'I', 'F', 'F' }); put(36 + data_len, 4);
+        d.insert(d.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' }); put(16, 4);
+        put(1, 2); put(channels, 2); put(rate, 4); put(rate * channels * 2, 4); put(channels * 2, 2); put(16, 2);
+        d.insert(d.end(), { 'd', 'a', 't', 'a' }); put(data_len, 4);
+        // 每个声道不同频率的正弦
+        for (uint32_t i = 0; i != frames; ++i)
+            for (uint16_t c = 0; c != channels; ++c)
+                put(uint16_t(int16_t(std::sin(6.2831853 * (220.0 + 110.0 * c) * i / rate) * 12000.0)), 2);
+        return asset;
+    }
+    /// <summary>
+    /// Loads the asset from file.
+    /// </summary>
+    /// <param name="path">The path.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool LoadAsset(const char* path, Asset& out) {
+        const auto file = std::fopen(path, "rb");
+        if (!file) return false;
+        std::fseek(file, 0, SEEK_END);
+        const long len = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        out.name = path;
+        out.data.resize(len > 0 ? size_t(len) : 0);
+        const bool ok = std::fread(out.data.data(), 1, out.data.size(), file) == out.data.size();
+        std::fclose(file);
+        return ok;
+    }
+    // print measure
+    void Print(const char* title, const Measure& m) {
+        std::printf("%-10s voices %6u threads %2u load %6.3f cpu/voice %8.1f us/s (%.3f%%) mem/voice %8.0f B late %5.1f%% steals %5.2f\n",
+            title, m.voices, m.threads, m.load, m.voice_us, m.voice_us * 1e-4, m.voice_bytes, m.late * 100.0, m.steals);
+    }
+    // write json string
+    void JsonString(std::FILE* file, const std::string& str) {
+        std::fputc('"', file);
+        for (const char ch : str) {
+            if (ch == '"' || ch == '\\') std::fputc('\\', file);
+            std::fputc(ch, file);
+        }
+        std::fputc('"', file);
+    }
+    // print measure as json
+    void Json(std::FILE* file, const Measure& m) {
+        std::fprintf(file, "{\"voices\": %u, \"threads\": %u, \"load\": %.6f, \"voice_us\": %.3f, \"voice_bytes\": %.0f, "
+            "\"late\": %.4f, \"steals\": %.3f}",
+            m.voices, m.threads, m.load, m.voice_us, m.voice_bytes, m.late, m.steals);
+    }
+    // usage
+    void Usage() noexcept {
+        std::printf(
+            "usage: voicebench [-n voices] [-g groups] [-t threads] [-s sec] [-b budget] [-r mode] [-j out.json] [files...]\n"
+            "  -n N     voice count of fixed run, default 64\n"
+            "  -g N     group count, default 4\n"
+            "  -t N     max mixer threads of scaling curve, default 16\n"
+            "  -s SEC   audio seconds per measure, default 2\n"
+            "  -b LOAD  real-time budget as part of pass time, default 0.5\n"
+            "  -r MODE  resample mode: linear, cubic or sinc, default linear\n"
+            "  -j FILE  write results as json\n"
+            "  files: ogg/flac/wav assets, default the demo ogg and the regress flac fixture,\n"
+            "         generated pcm of several rates and channel counts is always added\n"
+        );
+    }
+}
+
+
+/// <summary>
+/// Mains the specified argc.
+/// </summary>
+/// <param name="argc">The argc.</param>
+/// <param name="argv">The argv.</param>
+/// <returns></returns>
+int main(int argc, char* argv[]) {
+    Options opt;
+    std::vector<Asset> assets;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has = i + 1 < argc;
+        if (!std::strcmp(arg, "-n") && has) opt.voices = uint32_t(std::atoi(argv[++i]));
+        else if (!std::strcmp(arg, "-g") && has) opt.groups = uint32_t(std::atoi(argv[++i]));
+        else if (!std::strcmp(arg, "-t") && has) opt.threads = uint32_t(std::atoi(argv[++i]));
+        else if (!std::strcmp(arg, "-s") && has) opt.seconds = std::atof(argv[++i]);
+        else if (!std::strcmp(arg, "-b") && has) opt.budget = std::atof(argv[++i]);
+        else if (!std::strcmp(arg, "-j") && has) opt.json = argv[++i];
+        else if (!std::strcmp(arg, "-r") && has) {
+            const char* mode = argv[++i];
+            if (!std::strcmp(mode, "linear")) opt.mode = Resample_Linear;
+            else if (!std::strcmp(mode, "cubic")) opt.mode = Resample_Cubic;
+            else if (!std::strcmp(mode, "sinc")) opt.mode = Resample_Sinc;
+            else { Usage(); return 2; }
+        }
+        else if (arg[0] == '-') { Usage(); return 2; }
+        else files.push_back(arg);
+    }
+    if (!opt.voices || !opt.groups || opt.groups > MAX_GROUP_COUNT || !opt.threads || opt.seconds <= 0.0 || opt.budget <= 0.0) {
+        Usage();
+        return 2;
+    }
+    if (files.empty()) {
+        files.push_back("audiofiledemo/Hymn_of_ussr_instrumental.ogg");
+        files.push_back("demos/regress/fixtures/fixed.flac");
+    }
+    for (const auto f : files) {
+        Asset asset;
+        if (!LoadAsset(f, asset)) { std::printf("cannot read %s\n", f); return 1; }
+        assets.push_back(std::move(asset));
+    }
+    assets.push_back(MakeWave(22050, 1, 3.0));
+    assets.push_back(MakeWave(44100, 2, 3.0));
+    assets.push_back(MakeWave(48000, 2, 3.0));
+    assets.push_back(MakeWave(32000, 6, 3.0));
+    std::printf("assets:");
+    for (const auto& a : assets) std::printf(" %s", a.name.c_str());
+    std::printf("\nmix %u Hz, %u groups, pass %u frames, budget %.0f%% of real time\n",
+        MIX_RATE, opt.groups, MIX_FRAMES, opt.budget * 100.0);
+    // 固定声部数
+    Measure fixed{};
+    if (!Run(opt, assets, opt.voices, 1, fixed)) { std::printf("failed to create voices\n"); return 1; }
+    Print("fixed", fixed);
+    // 线程扩展曲线
+    std::vector<Measure> curve;
+    for (uint32_t t = 1; t <= opt.threads; t *= 2) {
+        Measure m{};
+        if (MaxVoices(opt, assets, t, m)) Print("max", m);
+        else {
+            m.threads = t;
+            std::printf("%-10s voices %6u threads %2u over budget even with one voice\n", "max", 0u, t);
+        }
+        curve.push_back(m);
+    }
+    if (opt.json) {
+        const auto file = std::fopen(opt.json, "w");
+        if (!file) { std::printf("cannot write %s\n", opt.json); return 1; }
+        std::fprintf(file, "{\n  \"mix_rate\": %u,\n  \"groups\": %u,\n  \"budget\": %.3f,\n  \"seconds\": %.3f,\n",
+            MIX_RATE, opt.groups, opt.budget, opt.seconds);
+        std::fprintf(file, "  \"hardware_threads\": %u,\n  \"assets\": [", std::thread::hardware_concurrency());
+        for (size_t i = 0; i != assets.size(); ++i) {
+            if (i) std::fprintf(file, ", ");
+            JsonString(file, assets[i].name);
+        }
+        std::fprintf(file, "],\n  \"fixed\": ");
+        Json(file, fixed);
+        std::fprintf(file, ",\n  \"max_voices\": [\n");
+        for (size_t i = 0; i != curve.size(); ++i) {
+            std::fprintf(file, "    ");
+            Json(file, curve[i]);
+            std::fprintf(file, i + 1 != curve.size() ? ",\n" : "\n");
+        }
+        std::fprintf(file, "  ]\n}\n");
+        std::fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+﻿// vorbis decode benchmark: per-stage timing of ogg/vorbis decoding
+#include "../../3rdparty/libvorbis/include/vorbis/codec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "playau.lib")
+#endif
+
+// lapping kernel in window.c
+extern "C" void _vorbis_window_lap(float *pcm, const float *p, const float *w, long n);
+
+namespace {
+    // clock
+    using Clock = std::chrono::high_resolution_clock;
+    // stage
+    enum Stage : int {
+        // ogg page/packet extraction
+        Stage_Ogg = 0,
+        // packet unpack + floor + residue + inverse mdct
+        Stage_Synthesis,
+        // window + overlap-add
+        Stage_Blockin,
+        // pcmout + float->int16 interleave
+        Stage_PcmOut,
+        // COUNT
+        STAGE_COUNT
+    };
+    // stage name
+    const char* const STAGE_NAME[STAGE_COUNT] = {
+        "ogg", "synthesis", "blockin", "pcmout",
+    };
+    // timer
+    struct Timer {
+        // begin
+        Clock::time_point   begin = Clock::now();
+        // elapsed
+        double Elapsed() const noexcept {
+            const std::chrono::duration<double> d = Clock::now() - begin;
+            return d.count();
+        }
+    };
+    // convert to int16 interleaved
+    void Interleave(int16_t* out, float** pcm, int channels, int count) noexcept {
+        for (int c = 0; c != channels; ++c) {
+            const float* src = pcm[c];
+            int16_t* dst = out + c;
+            for (int i = 0; i != count; ++i) {
+                int v = static_cast<int>(std::floor(src[i] * 32768.f + .5f));
+                if (v > 32767) v = 32767;
+                else if (v < -32768) v = -32768;
+                *dst = static_cast<int16_t>(v);
+                dst += channels;
+            }
+        }
+    }
+    /// <summary>
+    /// Decodes the whole file once.
+    /// </summary>
+    /// <param name="data">The data.</param>
+    /// <param name="len">The length.</param>
+    /// <param name="time">The time of each stage.</param>
+    /// <returns>sample count</returns>
+    long long DecodeOnce(const char* data, size_t len, double time[STAGE_COUNT]) noexcept {
+        ogg_sync_state oy; ogg_stream_state os;
+        ogg_page og; ogg_packet op;
+        vorbis_info vi; vorbis_comment vc;
+        vorbis_dsp_state vd; vorbis_block vb;
+        ::ogg_sync_init(&oy);
+        ::vorbis_info_init(&vi);
+        ::vorbis_comment_init(&vc);
+        // 一次写入全部数据
+        const auto buf = ::ogg_sync_buffer(&oy, static_cast<long>(len));
+        std::memcpy(buf, data, len);
+        ::ogg_sync_wrote(&oy, static_cast<long>(len));
+        long long samples = 0;
+        int headers = 0;
+        bool stream = false, ready = false;
+        std::vector<int16_t> out;
+        while (true) {
+            Timer t0;
+            if (::ogg_sync_pageout(&oy, &og) != 1) break;
+            if (!stream) {
+                ::ogg_stream_init(&os, ::ogg_page_serialno(&og));
+                stream = true;
+            }
+            ::ogg_stream_pagein(&os, &og);
+            time[Stage_Ogg] += t0.Elapsed();
+            while (true) {
+                Timer t1;
+                const auto got = ::ogg_stream_packetout(&os, &op);
+                time[Stage_Ogg] += t1.Elapsed();
+                if (got <= 0) break;
+                // 头信息
+                if (headers < 3) {
+                    if (::vorbis_synthesis_headerin(&vi, &vc, &op) < 0) goto end;
+                    if (++headers == 3) {
+                        ::vorbis_synthesis_init(&vd, &vi);
+                        ::vorbis_block_init(&vd, &vb);
+                        ready = true;
+                    }
+                    continue;
+                }
+                Timer t2;
+                const auto code = ::vorbis_synthesis(&vb, &op);
+                time[Stage_Synthesis] += t2.Elapsed();
+                if (code) continue;
+                Timer t3;
+                ::vorbis_synthesis_blockin(&vd, &vb);
+                time[Stage_Blockin] += t3.Elapsed();
+                Timer t4;
+                float** pcm; int count;
+                while ((count = ::vorbis_synthesis_pcmout(&vd, &pcm)) > 0) {
+                    out.resize(size_t(count) * vi.channels);
+                    Interleave(out.data(), pcm, vi.channels, count);
+                    ::vorbis_synthesis_read(&vd, count);
+                    samples += count;
+                }
+                time[Stage_PcmOut] += t4.Elapsed();
+            }
+        }
+    end:
+        if (ready) {
+            ::vorbis_block_clear(&vb);
+            ::vorbis_dsp_clear(&vd);
+        }
+        if (stream) ::ogg_stream_clear(&os);
+        ::vorbis_comment_clear(&vc);
+        ::vorbis_info_clear(&vi);
+        ::ogg_sync_clear(&oy);
+        return samples;
+    }
+    /// <summary>
+    /// Benchmarks the lapping kernel against the scalar loop.
+    /// </summary>
+    void BenchLapping() noexcept {
+        constexpr long N = 1024;
+        constexpr int LOOP = 20000;
+        std::vector<float> w(N), p(N), a(N), b(N);
+        for (long i = 0; i != N; ++i) {
+            w[i] = std::sin(float(i) / N * 1.5707963f);
+            p[i] = float(std::rand()) / RAND_MAX - .5f;
+            a[i] = b[i] = float(std::rand()) / RAND_MAX - .5f;
+        }
+        Timer t0;
+        for (int k = 0; k != LOOP; ++k) {
+            float* pcm = a.data();
+            for (long i = 0; i != N; ++i)
+                pcm[i] = pcm[i] * w[N - i - 1] + p[i] * w[i];
+        }
+        const double scalar = t0.Elapsed();
+        Timer t1;
+        for (int k = 0; k != LOOP; ++k)
+            ::_vorbis_window_lap(b.data(), p.data(), w.data(), N);
+        const double simd = t1.Elapsed();
+        const bool same = !std::memcmp(a.data(), b.data(), N * sizeof(float));
+        std::printf(
+            "lapping(n=%ld): scalar %.3f ms, kernel %.3f ms, x%.2f, %s\n",
+            N, scalar * 1e3, simd * 1e3, scalar / simd,
+            same ? "bit-exact" : "MISMATCH"
+        );
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1
+        ? argv[1]
+        : "../../audiofiledemo/Hymn_of_ussr_instrumental.ogg"
+        ;
+    const int loop = argc > 2 ? std::atoi(argv[2]) : 10;
+    const auto file = std::fopen(path, "rb");
+    if (!file) {
+        std::printf("cannot open %s\n", path);
+        return 1;
+    }
+    std::vector<char> data;
+    char buf[4096]; size_t len;
+    while ((len = std::fread(buf, 1, sizeof(buf), file)) > 0)
+        data.insert(data.end(), buf, buf + len);
+    std::fclose(file);
+
+    double time[STAGE_COUNT] = { 0 };
+    long long samples = 0;
+    Timer all;
+    for (int i = 0; i != loop; ++i)
+        samples += DecodeOnce(data.data(), data.size(), time);
+    const double total = all.Elapsed();
+
+    std::printf("%s: %d loop(s), %lld samples, %.3f ms\n", path, loop, samples, total * 1e3);
+    for (int i = 0; i != STAGE_COUNT; ++i) {
+        std::printf(
+            "  %-10s %10.3f ms %6.2f%%\n",
+            STAGE_NAME[i], time[i] * 1e3, time[i] / total * 100.
+        );
+    }
+    BenchLapping();
+    return 0;
+}
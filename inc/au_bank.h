@@ -0,0 +1,148 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+
+#include "au_config.h"
+#include "au_base.h"
+#include "au_stream.h"
+#include <atomic>
+
+namespace PlayAU {
+    // sound bank constant
+    enum BankConstant : uint32_t {
+        // magic "PAUB"
+        BANK_MAGIC = 0x42554150,
+        // format version
+        BANK_VERSION = 1,
+        // index offset in bank, keeps entries cache line aligned
+        BANK_INDEX_OFFSET = 64,
+        // entry data alignment in byte
+        BANK_DATA_ALIGN = 16,
+        // fmt extra bytes kept in entry
+        BANK_EXTRA_LENGTH = 32,
+        // invalid entry id
+        BANK_INVALID_ID = 0xFFFFFFFF,
+    };
+    // sound bank file header, little endian
+    struct BankHeader {
+        // BANK_MAGIC
+        uint32_t    magic;
+        // BANK_VERSION
+        uint32_t    version;
+        // entry count, entries start at BANK_INDEX_OFFSET
+        uint32_t    count;
+        // offset of BankSeekIndex array parallel to entries, 0 if no seek table
+        uint32_t    seek_index;
+    };
+    // sound bank entry, sorted by hash, one cache line
+    struct BankEntry {
+        // name hash via BankHash
+        uint32_t    hash;
+        // data offset in bank, aligned to BANK_DATA_ALIGN
+        uint32_t    offset;
+        // data length in byte
+        uint32_t    length;
+        // samples per sec
+        uint32_t    sample_rate;
+        // sample frames, 0 if unknown
+        uint32_t    frames;
+        // wave format tag of raw data, 0 if encoded file probed via codecs
+        uint16_t    tag;
+        // channels
+        uint16_t    channels;
+        // block align
+        uint16_t    block_align;
+        // bits per sample
+        uint16_t    bits_per_sample;
+        // fmt extra bytes length
+        uint16_t    extra_size;
+        // integrated loudness in 0.01 LUFS, 0 if unknown
+        int16_t     loudness;
+        // fmt extra bytes, e.g. adpcm coefficients
+        uint8_t     extra[BANK_EXTRA_LENGTH];
+    };
+    // seek table of an entry
+    struct BankSeekIndex {
+        // offset of first BankSeekPoint in bank
+        uint32_t    offset;
+        // point count, 0 if none
+        uint32_t    count;
+    };
+    // seek point, e.g. ogg page, sorted by frame
+    struct BankSeekPoint {
+        // frames done at the end of the page, e.g. ogg granule position
+        uint32_t    frame;
+        // page start, byte offset relative to entry data
+        uint32_t    offset;
+    };
+    static_assert(sizeof(BankHeader) == 16, "file format");
+    static_assert(sizeof(BankEntry) == 64, "file format");
+    static_assert(sizeof(BankSeekIndex) == 8, "file format");
+    static_assert(sizeof(BankSeekPoint) == 8, "file format");
+    // name hash of bank entry: FNV-1a 32bit
+    inline auto BankHash(const char name[]) noexcept -> uint32_t {
+        uint32_t hash = 0x811C9DC5;
+        for (; *name; ++name) hash = (hash ^ uint8_t(*name)) * 0x01000193;
+        return hash;
+    }
+    /// <summary>
+    /// sound bank, many entries in one mapped file
+    /// </summary>
+    class PLAYAU_API CAUSoundBank {
+    public:
+        // obj
+        PLAYAU_OBJ;
+        // create from file, nullptr if failed
+        static auto Create(const char16_t file[]) noexcept->CAUSoundBank*;
+        // create from memory without copying, data must outlive the bank
+        static auto CreateFromMemory(const void* data, uint32_t len) noexcept->CAUSoundBank*;
+        // [nullsafe] destroy this, data stays alive until clips from this bank destroyed
+        void Destroy() noexcept;
+        // [nullsafe] entry count
+        auto GetCount() const noexcept->uint32_t;
+        // [nullsafe] find entry id by name, BANK_INVALID_ID if not found
+        auto Find(const char name[]) const noexcept->uint32_t;
+        // [nullsafe] find entry id by hash, BANK_INVALID_ID if not found
+        auto FindHash(uint32_t hash) const noexcept->uint32_t;
+        // [nullsafe] get entry, nullptr if out of range
+        auto GetEntry(uint32_t id) const noexcept->const BankEntry*;
+        // [nullsafe] get entry data, nullptr if out of range
+        auto GetData(uint32_t id) const noexcept->const void*;
+        // [nullsafe] get entry seek table, nullptr if none
+        auto GetSeekTable(uint32_t id, uint32_t& count) const noexcept->const BankSeekPoint*;
+        // add reference for clips sharing bank data
+        void AddRef() const noexcept;
+        // release reference, delete this if last one
+        void Release() const noexcept;
+    private:
+        // ctor
+        CAUSoundBank() noexcept = default;
+        // dtor
+        ~CAUSoundBank() noexcept;
+        // load from data
+        bool load(const void* data, uint32_t len) noexcept;
+    private:
+        // file stream, keeps mapped view
+        FileStreamHolder            m_file;
+        // bank data
+        const uint8_t*              m_pData = nullptr;
+        // owned data if failed to map
+        void*                       m_pOwned = nullptr;
+        // entries
+        const BankEntry*            m_pEntries = nullptr;
+        // seek tables parallel to entries, null if none
+        const BankSeekIndex*        m_pSeeks = nullptr;
+        // reference count: owner and streams of clips
+        mutable std::atomic<uint32_t> m_cRef{ 1 };
+        // entry count
+        uint32_t                    m_uCount = 0;
+        // data length
+        uint32_t                    m_uLength = 0;
+    private:
+        // no copy
+        CAUSoundBank(const CAUSoundBank&) noexcept = delete;
+        // no move
+        CAUSoundBank(CAUSoundBank&&) noexcept = delete;
+    };
+}
@@ -57,16 +57,24 @@ namespace PlayAU {
         MAX_GROUP_NAME_LENGTH = 16,
         // group length in byte
         GROUP_BUFLEN_BYTE = MAX_GROUP_NAME_LENGTH + 4 * sizeof(void*),
-        // audio stream header peek length
-        AUDIO_HEADER_PEEK_LENGTH = 16,
+        // audio stream header peek length, shared by all codec probes
+        AUDIO_HEADER_PEEK_LENGTH = 64,
+        // registered codec max count
+        MAX_CODEC_COUNT = 16,
         // audio api buffer length in pointer
         AUDIO_API_BUFLEN = 5,
         // audio context buffer length in pointer
         AUDIO_CTX_BUFLEN = 4,
-        // file stream buffer lenth in pointer
-        FILE_STREAM_BUFLEN = 4,
-        // audio stream buffer lenth in byte
-        AUDIO_STREAM_BUFLEN = (FILE_STREAM_BUFLEN + 6) * sizeof(void*) + 4 * 4,
+        // file stream inline storage length in byte, larger one goes to heap
+        FILE_STREAM_INLINE_LENGTH = 6 * sizeof(void*),
+        // audio stream inline storage length in byte, larger one goes to heap
+        AUDIO_STREAM_INLINE_LENGTH = 32 * sizeof(void*),
+        // ogg decoder pool: codec setup count
+        OGG_POOL_SETUP_COUNT = 16,
+        // ogg decoder pool: parked dsp state count per setup
+        OGG_POOL_DSP_COUNT = 4,
+        // ogg decoder pool: idle ogg file count
+        OGG_POOL_FILE_COUNT = 8,
     };
     // wave format
     enum FormatWave : uint8_t {
@@ -91,6 +99,8 @@ namespace PlayAU {
         Flag_AutoDestroyOnEnd = 1 << 1,
         // load all data
         //Flag_LoadAll = 1 << 2,
+        // fast open, do not scan whole file until first seek(ogg)
+        Flag_FastOpen = 1 << 3,
 
         // [private] live clip
         Flag_p_Live = 1 << 16,
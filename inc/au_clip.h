@@ -4,6 +4,9 @@
 
 #include "au_base.h"
 #include "au_config.h"
+#include "au_stream.h"
+#include "au_stats.h"
+#include "au_spatial.h"
 #include <cstdint>
 
 namespace PlayAU {
@@ -11,8 +14,6 @@ namespace PlayAU {
     class CAUEngine;
     // group
     class CAUAudioGroup;
-    // audio stream
-    struct XAUAudioStream;
     // private clip data
     class PLAYAU_API CAUAudioClip {
         // friend
@@ -23,7 +24,7 @@ namespace PlayAU {
         // private
         struct Private;
         // ctor
-        CAUAudioClip(CAUEngine&, ClipFlag, XAUAudioStream&&, CAUAudioGroup*) noexcept;
+        CAUAudioClip(CAUEngine&, ClipFlag, AudioStreamHolder&&, CAUAudioGroup*) noexcept;
         // [nullsafe] destroy this
         void Destroy() noexcept;
         // [nullsafe] play this
@@ -46,6 +47,18 @@ namespace PlayAU {
         auto GetVolume() const noexcept ->float;
         // [nullsafe] get frequency ratio
         auto GetFrequencyRatio() const noexcept ->float;
+        // [nullsafe] get channel count of clip
+        auto GetChannels() const noexcept ->uint32_t;
+        // [nullsafe] set output matrix [output * clip channels + clip channel], nullptr for standard down/up-mix
+        bool SetOutputMatrix(const float* matrix) noexcept;
+        // [nullsafe] set constant power pan in [-1, 1], replaces output matrix
+        bool SetPan(float pan) noexcept;
+        // [nullsafe] set 3d emitter, applied by CAUEngine::Update3D, nullptr back to 2d with standard matrix
+        bool SetEmitter(const AudioEmitter* emitter) noexcept;
+        // [nullsafe] get stats snapshot, lock free
+        void GetStats(ClipStats& stats) const noexcept;
+        // [nullsafe] get bytes held by this clip: object, buckets, stream and decoder state
+        auto GetMemory() const noexcept->int64_t;
     public:
         // [nullsafe] get live buffer left
         auto GetLiveBufferLeft() const noexcept->uint32_t;
@@ -63,6 +76,10 @@ namespace PlayAU {
         bool                        m_playing = false;
         // state: pausing
         bool                        m_pausing = false;
+        // 3d emitter id
+        uint32_t                    m_emitter = SPATIAL_NO_EMITTER;
+        // frequency ratio set by user, doppler applied over it
+        float                       m_ratio = 1.f;
     public:
         // group
         CAUAudioGroup*     const    group;
@@ -72,7 +89,11 @@ namespace PlayAU {
         // audio engine
         CAUEngine&                  m_engine;
         // audio stream
-        char                        m_asbuffer[AUDIO_STREAM_BUFLEN];
+        AudioStreamHolder           m_stream;
+        // stats counters
+        ClipCounters                m_stats;
+        // bytes held
+        std::atomic<int64_t>        m_memory{ 0 };
     private:
         // no copy
         CAUAudioClip(const CAUAudioClip&) noexcept = delete;
@@ -0,0 +1,37 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+
+#include "au_config.h"
+#include "au_base.h"
+#include "au_stream.h"
+
+namespace PlayAU {
+    // probe peeked header, len is less than AUDIO_HEADER_PEEK_LENGTH for short stream
+    using CodecProbe = bool(*)(const uint8_t head[], uint32_t len);
+    // create XAUAudioStream in out taking file stream at begin, leave file untouched if failed
+    using CodecFactory = bool(*)(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag);
+    // codec priority, higher one probes first
+    enum CodecPriority : int32_t {
+        // weak signature, e.g. frame sync
+        Priority_Fallback = -100,
+        // built-in codecs
+        Priority_Builtin = 0,
+        // override built-in codecs
+        Priority_Override = 100,
+    };
+    // audio codec
+    struct AudioCodec {
+        // name, same name replaces registered one
+        const char*     name;
+        // probe
+        CodecProbe      probe;
+        // factory
+        CodecFactory    create;
+        // priority
+        int32_t         priority;
+    };
+    // register codec, not thread safe, call before creating clips
+    PLAYAU_API auto RegisterCodec(const AudioCodec& codec) noexcept->Result;
+}
@@ -1,40 +1,36 @@
 ﻿#pragma once
 
 #define PLAYAU_FLAG_NULL_THISPTR_SAFE
+#define PLAYAU_FLAG_FLAC_SUPPORT
+//#define PLAYAU_FLAG_TRACE
 
 #define PLAYAU_API
 //#define PLAYAU_API __declspec(dllexport) 
 
 
-// PlayAU object
-
-#if 1
-
-#define PLAYAU_OBJ
-
-#else
-#include <new>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <new>
 
-static inline void* myalloc(size_t size) noexcept {
-    return std::malloc(size);
-}
-static inline void myfree(void* ptr) noexcept {
-    std::free(ptr);
+namespace PlayAU {
+    // allocate memory via the installed allocator
+    PLAYAU_API void* Alloc(size_t len) noexcept;
+    // reallocate memory via the installed allocator
+    PLAYAU_API void* Realloc(void* ptr, size_t len) noexcept;
+    // free memory via the installed allocator
+    PLAYAU_API void Free(void* ptr) noexcept;
 }
 
+// PlayAU object
 #define PLAYAU_OBJ \
 void* operator new(size_t size, const std::nothrow_t&) noexcept {\
-    return myalloc(size);\
+    return PlayAU::Alloc(size);\
 }\
 void operator delete(void* ptr) noexcept {\
-    myfree(ptr);\
+    PlayAU::Free(ptr);\
 }
 
-#endif
-
-#include <cstdint>
-
 namespace PlayAU {
     // constant
     enum Constant : uint32_t {
@@ -66,5 +62,11 @@ namespace PlayAU {
         virtual auto PickDevice(char16_t id[256]) noexcept -> const char16_t* = 0;
         // call context, maybe async
         virtual void CallContext(CAUEngine&, void* ctx1, void* ctx2) noexcept = 0;
+        // allocate memory for engine objects and codecs, thread safe
+        virtual void* Alloc(size_t len) noexcept { return std::malloc(len); }
+        // reallocate memory, thread safe
+        virtual void* Realloc(void* ptr, size_t len) noexcept { return std::realloc(ptr, len); }
+        // free memory, thread safe, also called for blocks outliving the engine
+        virtual void Free(void* ptr) noexcept { std::free(ptr); }
     };
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+#include "au_config.h"
+#include <cstdint>
+
+// software dsp path, portable building blocks for mixing without backend
+
+namespace PlayAU {
+    // dsp constant
+    enum DspConstant : uint32_t {
+        // max channel count of dsp path
+        DSP_MAX_CHANNELS = 8,
+        // sinc taps per phase when upsampling, widened up to 4x when downsampling
+        RESAMPLE_TAPS = 32,
+        // sinc phase count per input frame
+        RESAMPLE_PHASES = 128,
+        // resampler input staging length in frame
+        RESAMPLE_BUFFER = 512,
+        // max input/output ratio
+        RESAMPLE_MAX_RATIO = 16,
+        // max frames of a mix block
+        MIX_BLOCK_FRAMES = 256,
+        // mix bus alignment in byte
+        MIX_BUS_ALIGN = 64,
+    };
+    // resample mode
+    enum ResampleMode : uint8_t {
+        // linear interpolation, cheapest
+        Resample_Linear = 0,
+        // 4-point catmull-rom
+        Resample_Cubic,
+        // polyphase windowed-sinc
+        Resample_Sinc,
+    };
+    /// <summary>
+    /// streaming resampler, fixed storage, ratio can change every call
+    /// </summary>
+    class PLAYAU_API CAUResampler {
+    public:
+        // ctor
+        CAUResampler() noexcept;
+        // reset state, channels in [1, DSP_MAX_CHANNELS], ratio = input rate / output rate
+        bool Reset(ResampleMode mode, uint32_t channels, double ratio) noexcept;
+        // switch mode, keeps buffered input and position
+        void SetMode(ResampleMode mode) noexcept { m_mode = mode; }
+        // get mode
+        auto GetMode() const noexcept { return m_mode; }
+        // get channel count
+        auto GetChannels() const noexcept { return m_channels; }
+        // get ratio now
+        auto GetRatio() const noexcept { return m_ratio; }
+        // input frames needed to render out_frames, ramping ratio to target
+        auto InputNeeded(uint32_t out_frames, double ratio) const noexcept->uint32_t;
+        // process interleaved float, ratio ramps linearly to target over out_frames, return frames written
+        auto Process(const float* in, uint32_t in_frames, uint32_t& consumed,
+            float* out, uint32_t out_frames, double ratio) noexcept->uint32_t;
+    private:
+        // drop frames no longer needed
+        void shift() noexcept;
+        // render one frame at position
+        void render(float* out, double pos) noexcept;
+    private:
+        // sinc table for ratio now
+        const float*        m_pTable = nullptr;
+        // position in staging buffer, in frame
+        double              m_pos = 0.0;
+        // ratio now
+        double              m_ratio = 1.0;
+        // frames in staging buffer
+        uint32_t            m_filled = 0;
+        // channel count
+        uint32_t            m_channels = 0;
+        // table level
+        uint32_t            m_level = 0;
+        // mode
+        ResampleMode        m_mode = Resample_Linear;
+        // planar staging buffer
+        alignas(16) float   m_buffer[DSP_MAX_CHANNELS][RESAMPLE_BUFFER];
+    };
+    // gain ramp over a block, gain of frame i is begin + (end - begin) * i / frames
+    struct MixRamp {
+        // gain of first frame
+        float       begin;
+        // gain of first frame of next block
+        float       end;
+    };
+    // mix bus, planar block, one per group plus master like the backend submix voices
+    struct alignas(MIX_BUS_ALIGN) MixBus {
+        // planar samples
+        float       data[DSP_MAX_CHANNELS][MIX_BLOCK_FRAMES];
+        // channel count
+        uint32_t    channels;
+        // frame count of block
+        uint32_t    frames;
+        // clear for new block
+        PLAYAU_API void Clear(uint32_t channels, uint32_t frames) noexcept;
+    };
+    // mix mono into bus channel 0/1 with gain ramps
+    PLAYAU_API void MixPan(MixBus& bus, const float* mono, MixRamp left, MixRamp right) noexcept;
+    // mix planar input into bus, matrix[out * in_channels + in] ramps from begin to end, like backend output matrix
+    PLAYAU_API void MixMatrix(MixBus& bus, const float* const* in, uint32_t in_channels,
+        const float* begin, const float* end) noexcept;
+    // mix bus into another bus, channels beyond the smaller count are skipped
+    PLAYAU_API void MixBusInto(MixBus& dst, const MixBus& src, MixRamp gain) noexcept;
+    // apply gain ramp in place
+    PLAYAU_API void MixGain(float* buf, uint32_t frames, MixRamp gain) noexcept;
+    // standard down/up-mix matrix[out * in + in] between wave channel layouts, false if count not in [1, DSP_MAX_CHANNELS]
+    PLAYAU_API bool GetChannelMatrix(uint32_t in, uint32_t out, float* matrix) noexcept;
+    // constant power pan in [-1, 1] over standard matrix, mono goes to front left/right only
+    PLAYAU_API bool GetPanMatrix(uint32_t in, uint32_t out, float pan, float* matrix) noexcept;
+    // standard matrix with left/right side and center outputs scaled, mono goes to front left/right only
+    PLAYAU_API bool GetSideMatrix(uint32_t in, uint32_t out, float left, float right, float center, float* matrix) noexcept;
+    // scalar reference of MixPan
+    PLAYAU_API void MixPanScalar(MixBus& bus, const float* mono, MixRamp left, MixRamp right) noexcept;
+    // scalar reference of MixMatrix
+    PLAYAU_API void MixMatrixScalar(MixBus& bus, const float* const* in, uint32_t in_channels,
+        const float* begin, const float* end) noexcept;
+    // scalar reference of MixBusInto
+    PLAYAU_API void MixBusIntoScalar(MixBus& dst, const MixBus& src, MixRamp gain) noexcept;
+    // scalar reference of MixGain
+    PLAYAU_API void MixGainScalar(float* buf, uint32_t frames, MixRamp gain) noexcept;
+}
@@ -5,14 +5,24 @@
 
 #include "au_config.h"
 #include "au_base.h"
+#include "au_stream.h"
+#include "au_stats.h"
 
 namespace PlayAU {
     // clip
     class CAUAudioClip;
     // group
     class CAUAudioGroup;
-    // stream
-    struct XAUStream; struct XAUAudioStream;
+    // sound bank
+    class CAUSoundBank;
+    // async clip request
+    struct CAUClipRequest;
+    // async clip loader
+    struct CAUAsyncLoader;
+    // spatializer
+    class CAUSpatializer;
+    // 3d listener
+    struct AudioListener;
     // audio device
     struct AudioDeviceInfo {
         // name of device
@@ -39,6 +49,10 @@ namespace PlayAU {
         struct Private;
         // clip
         using Clip = CAUAudioClip * ;
+        // async clip future
+        using ClipFuture = CAUClipRequest * ;
+        // async clip callback, clip is nullptr if failed or canceled
+        using ClipCallback = void(*)(void* user, Clip clip);
         // ctor
         CAUEngine() noexcept;
         // dtor
@@ -60,23 +74,55 @@ namespace PlayAU {
         void Resume() noexcept;
         // call context
         void CallContext(void* ctx1, void* ctx2) noexcept;
+        // get stats snapshot, lock free
+        void GetStats(EngineStats& stats) const noexcept;
+        // get output channel count, clip output matrix has this many rows
+        auto GetOutputChannels() const noexcept->uint32_t;
     public:
         // create clip from file
         Clip CreateClipFromFile(ClipFlag, const char16_t file[], const char*group=nullptr) noexcept;
+        // create clip from memory without copying, data must outlive the clip
+        Clip CreateClipFromMemory(ClipFlag, const void* data, uint32_t len, const char*group = nullptr) noexcept;
+        // create clip from sound bank entry without copying, bank must outlive the clip
+        Clip CreateClipFromBank(ClipFlag, const CAUSoundBank&, uint32_t id, const char*group = nullptr) noexcept;
         // create clip from stream
-        Clip CreateClipFromStream(ClipFlag, XAUStream&, const char*group = nullptr) noexcept;
-        // create clip from audio
-        Clip CreateClipFromAudio(ClipFlag, XAUAudioStream&&, const char*group = nullptr) noexcept;
+        Clip CreateClipFromStream(ClipFlag, FileStreamHolder&&, const char*group = nullptr) noexcept;
+        // create clip from audio, bytes the stream allocated before the call are not charged to clip
+        Clip CreateClipFromAudio(ClipFlag, AudioStreamHolder&&, const char*group = nullptr) noexcept;
         // create live clip
         Clip CreateLiveClip(const WaveFormat&, const char*group = nullptr) noexcept;
+    public:
+        // create clip from file on worker thread, callback is called in PollAsync
+        bool CreateClipFromFileAsync(ClipFlag, const char16_t file[], ClipCallback call, void* user, const char*group = nullptr) noexcept;
+        // create clip from file on worker thread, poll the future with PollClip
+        auto CreateClipFromFileAsync(ClipFlag, const char16_t file[], const char*group = nullptr) noexcept->ClipFuture;
+        // poll future, return true and release the future if finished, clip is nullptr if failed
+        bool PollClip(ClipFuture future, Clip& clip) noexcept;
+        // cancel and release the future
+        void CancelClip(ClipFuture future) noexcept;
+        // create finished clips and call callbacks on this thread, return count completed
+        auto PollAsync() noexcept->uint32_t;
     public:
         // find group
         auto FindGroup(const char name[]) noexcept->CAUAudioGroup*;
         // create empty group
         auto CreateEmptyGroup(const char name[]) noexcept->CAUAudioGroup*;
+        // get bytes held by clips in group, nullptr for all clips
+        auto GetGroupMemory(const CAUAudioGroup* group) noexcept->int64_t;
+    public:
+        // set listener of 3d clips, applied by next Update3D
+        bool SetListener(const AudioListener&) noexcept;
+        // compute all 3d clips in batch, then apply output matrix and doppler, call once per frame
+        void Update3D() noexcept;
     private:
         // config
         IAUConfigure*       m_pConfig = nullptr;
+        // async loader, created on first async request
+        CAUAsyncLoader*     m_pLoader = nullptr;
+        // spatializer, created on first listener or emitter
+        CAUSpatializer*     m_pSpatial = nullptr;
+        // stats counters
+        EngineCounters      m_stats;
         // api level
         APILevel            m_level = APILevel::Level_Auto;
         // version number
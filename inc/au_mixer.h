@@ -0,0 +1,126 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+#include "au_config.h"
+#include "au_base.h"
+#include "au_stream.h"
+#include "au_dsp.h"
+#include "au_spatial.h"
+#include <cstdint>
+
+// software mixer: decode, resample and mix voices into group buses on worker threads, no backend
+
+namespace PlayAU {
+    // soft mixer constant
+    enum SoftMixerConstant : uint32_t {
+        // max threads, render thread included
+        SOFT_MAX_THREADS = 16,
+        // max voices alive
+        SOFT_MAX_VOICES = 4096,
+        // min voices per render task
+        SOFT_TASK_VOICES = 8,
+        // max render tasks per block, each owns a bus
+        SOFT_MAX_TASKS = 64,
+        // decoded frames staged per voice
+        SOFT_STAGING_FRAMES = 512,
+    };
+    // soft mixer stats snapshot
+    struct SoftMixerStats {
+        // blocks rendered
+        uint64_t    blocks;
+        // blocks rendered later than deadline
+        uint64_t    late_blocks;
+        // total render time in ns
+        uint64_t    render_ns;
+        // max render time of one block in ns
+        uint64_t    render_max_ns;
+        // total deadline time in ns
+        uint64_t    deadline_ns;
+        // tasks run by a worker other than the one queued to
+        uint64_t    steals;
+        // cpu time of render thread in blocks and workers in ns
+        uint64_t    cpu_ns;
+        // voices alive
+        uint32_t    voices;
+        // threads, render thread included
+        uint32_t    threads;
+    };
+    // soft voice
+    struct CAUSoftVoice;
+    // soft renderer
+    struct CAUSoftRenderer;
+    // software mixer
+    class PLAYAU_API CAUSoftMixer {
+    public:
+        // voice
+        using Voice = CAUSoftVoice * ;
+        // ctor
+        CAUSoftMixer() noexcept;
+        // dtor
+        ~CAUSoftMixer() noexcept;
+        // init, threads 0 for hardware concurrency, budget is deadline as part of block time
+        auto Initialize(uint32_t rate, uint32_t channels, uint32_t threads = 0, float budget = 1.f) noexcept->Result;
+        // uninit, destroys all voices
+        void Uninitialize() noexcept;
+        // get sample rate
+        auto GetSampleRate() const noexcept { return m_rate; }
+        // get channel count
+        auto GetChannels() const noexcept { return m_channels; }
+        // render interleaved float, one thread at a time
+        void Render(float* out, uint32_t frames) noexcept;
+        // get stats snapshot, lock free
+        void GetStats(SoftMixerStats& stats) const noexcept;
+    public:
+        // create voice, stopped, group in [0, MAX_GROUP_COUNT)
+        auto CreateVoice(AudioStreamHolder&&, uint32_t group = 0) noexcept->Voice;
+        // [nullsafe] destroy voice, freed by next render
+        void DestroyVoice(Voice) noexcept;
+        // [nullsafe] play voice
+        void Play(Voice) noexcept;
+        // [nullsafe] pause voice
+        void Pause(Voice) noexcept;
+        // [nullsafe] stop voice and rewind
+        void Stop(Voice) noexcept;
+        // [nullsafe] is voice playing
+        bool IsPlaying(Voice) const noexcept;
+        // [nullsafe] set loop
+        void SetLoop(Voice, bool) noexcept;
+        // [nullsafe] set volume, ramped over next block
+        void SetVolume(Voice, float) noexcept;
+        // [nullsafe] set frequency ratio, ramped over next block
+        void SetFrequencyRatio(Voice, float) noexcept;
+        // [nullsafe] set resample mode
+        void SetResampleMode(Voice, ResampleMode) noexcept;
+        // [nullsafe] set output matrix [mixer channels * voice channels], nullptr for standard, ramped over next block
+        bool SetOutputMatrix(Voice, const float* matrix) noexcept;
+        // [nullsafe] set constant power pan in [-1, 1], replaces output matrix, ramped over next block
+        bool SetPan(Voice, float pan) noexcept;
+    public:
+        // set listener of 3d voices, applied by next Update3D
+        bool SetListener(const AudioListener&) noexcept;
+        // [nullsafe] set 3d emitter, applied by Update3D, nullptr back to 2d with standard matrix
+        bool SetEmitter(Voice, const AudioEmitter*) noexcept;
+        // compute all 3d voices in batch, then feed output matrix and doppler, call once per frame
+        void Update3D() noexcept;
+    public:
+        // set group volume, ramped over next block
+        void SetGroupVolume(uint32_t group, float) noexcept;
+        // set resample mode of all voices in group, and voices created later
+        void SetGroupResampleMode(uint32_t group, ResampleMode) noexcept;
+    private:
+        // renderer
+        CAUSoftRenderer*    m_pRenderer = nullptr;
+        // spatializer, created on first listener or emitter
+        CAUSpatializer*     m_pSpatial = nullptr;
+        // sample rate
+        uint32_t            m_rate = 0;
+        // channel count
+        uint32_t            m_channels = 0;
+    private:
+        // no copy
+        CAUSoftMixer(const CAUSoftMixer&) noexcept = delete;
+        // no move
+        CAUSoftMixer(CAUSoftMixer&&) noexcept = delete;
+    };
+}
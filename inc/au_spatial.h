@@ -0,0 +1,174 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+#include "au_config.h"
+#include <cstdint>
+
+// 3d positional audio: listener and emitters computed in batch, fed into output matrix and frequency ratio
+
+namespace PlayAU {
+    // spatial constant
+    enum SpatialConstant : uint32_t {
+        // max emitters of a spatializer
+        SPATIAL_MAX_EMITTERS = 4096,
+        // no emitter
+        SPATIAL_NO_EMITTER = 0xffffffff,
+    };
+    // attenuation curve over distance, distance clamped to [min, max] first
+    enum AttenuationCurve : uint8_t {
+        // no attenuation
+        Attenuation_None = 0,
+        // min / (min + rolloff * (d - min))
+        Attenuation_Inverse,
+        // 1 - rolloff * (d - min) / (max - min)
+        Attenuation_Linear,
+    };
+    // 3d vector, left-handed: x right, y up, z front
+    struct AudioVector {
+        // x
+        float       x;
+        // y
+        float       y;
+        // z
+        float       z;
+    };
+    // listener
+    struct AudioListener {
+        // position
+        AudioVector position{ 0.f, 0.f, 0.f };
+        // velocity, unit per second
+        AudioVector velocity{ 0.f, 0.f, 0.f };
+        // front direction
+        AudioVector front{ 0.f, 0.f, 1.f };
+        // top direction
+        AudioVector top{ 0.f, 1.f, 0.f };
+        // speed of sound, unit per second
+        float       speed_of_sound = 343.f;
+    };
+    // emitter cone, full angle in radian, volume interpolated between inner and outer angle
+    struct AudioCone {
+        // inner angle
+        float       inner_angle = 6.2831853f;
+        // outer angle
+        float       outer_angle = 6.2831853f;
+        // volume inside inner angle
+        float       inner_volume = 1.f;
+        // volume outside outer angle
+        float       outer_volume = 1.f;
+    };
+    // emitter
+    struct AudioEmitter {
+        // position
+        AudioVector position{ 0.f, 0.f, 0.f };
+        // velocity, unit per second
+        AudioVector velocity{ 0.f, 0.f, 0.f };
+        // front direction of cone
+        AudioVector front{ 0.f, 0.f, 1.f };
+        // cone, omni by default
+        AudioCone   cone;
+        // distance with full volume
+        float       min_distance = 1.f;
+        // distance attenuation stops at
+        float       max_distance = 1000.f;
+        // rolloff factor
+        float       rolloff = 1.f;
+        // doppler factor, 0 for none
+        float       doppler_scale = 1.f;
+        // attenuation curve
+        AttenuationCurve curve = Attenuation_Inverse;
+    };
+    /// <summary>
+    /// spatializer, emitters stored as structure of arrays and updated in simd batch
+    /// </summary>
+    class PLAYAU_API CAUSpatializer {
+    public:
+        // obj
+        PLAYAU_OBJ;
+        // ctor
+        CAUSpatializer() noexcept;
+        // set listener
+        void SetListener(const AudioListener&) noexcept;
+        // get listener
+        auto&GetListener() const noexcept { return m_listener; }
+        // add emitter with non-null user data, SPATIAL_NO_EMITTER if full
+        auto AddEmitter(const AudioEmitter&, void* user) noexcept->uint32_t;
+        // set emitter
+        void SetEmitter(uint32_t id, const AudioEmitter&) noexcept;
+        // remove emitter, id can be reused
+        void RemoveEmitter(uint32_t id) noexcept;
+        // compute all emitters
+        void Update() noexcept;
+        // scalar reference of Update
+        void UpdateScalar() noexcept;
+        // emitter id in [0, end) may be alive
+        auto GetEnd() const noexcept { return m_end; }
+        // user data of emitter, nullptr if not alive
+        auto GetUser(uint32_t id) const noexcept { return m_user[id]; }
+        // gain of last update: attenuation and cone
+        auto GetGain(uint32_t id) const noexcept { return m_gain[id]; }
+        // constant power pan gain of left side
+        auto GetLeft(uint32_t id) const noexcept { return m_left[id]; }
+        // constant power pan gain of right side
+        auto GetRight(uint32_t id) const noexcept { return m_right[id]; }
+        // doppler frequency ratio of last update
+        auto GetDoppler(uint32_t id) const noexcept { return m_doppler[id]; }
+        // output matrix[out * in + in] of last update
+        bool GetMatrix(uint32_t id, uint32_t in, uint32_t out, float* matrix) const noexcept;
+    private:
+        // reset emitter to silent
+        void reset(uint32_t id) noexcept;
+        // update emitters with ops of scalar or simd vector
+        template<typename O> void update() noexcept;
+    private:
+        // listener
+        AudioListener       m_listener;
+        // emitter id in [0, end) may be alive
+        uint32_t            m_end = 0;
+        // user data, nullptr if free
+        void*               m_user[SPATIAL_MAX_EMITTERS];
+        // position
+        float               m_px[SPATIAL_MAX_EMITTERS], m_py[SPATIAL_MAX_EMITTERS], m_pz[SPATIAL_MAX_EMITTERS];
+        // velocity
+        float               m_vx[SPATIAL_MAX_EMITTERS], m_vy[SPATIAL_MAX_EMITTERS], m_vz[SPATIAL_MAX_EMITTERS];
+        // normalized cone front
+        float               m_fx[SPATIAL_MAX_EMITTERS], m_fy[SPATIAL_MAX_EMITTERS], m_fz[SPATIAL_MAX_EMITTERS];
+        // cosine of half outer angle
+        float               m_cone_outer[SPATIAL_MAX_EMITTERS];
+        // 1 / (cosine of half inner angle - cosine of half outer angle)
+        float               m_cone_scale[SPATIAL_MAX_EMITTERS];
+        // outer volume
+        float               m_cone_volume[SPATIAL_MAX_EMITTERS];
+        // inner volume - outer volume
+        float               m_cone_delta[SPATIAL_MAX_EMITTERS];
+        // min distance
+        float               m_min[SPATIAL_MAX_EMITTERS];
+        // max distance
+        float               m_max[SPATIAL_MAX_EMITTERS];
+        // rolloff
+        float               m_rolloff[SPATIAL_MAX_EMITTERS];
+        // rolloff / (max - min)
+        float               m_linear[SPATIAL_MAX_EMITTERS];
+        // curve weight: none, inverse, linear; one of them is 1
+        float               m_wnone[SPATIAL_MAX_EMITTERS], m_winv[SPATIAL_MAX_EMITTERS], m_wlin[SPATIAL_MAX_EMITTERS];
+        // doppler scale
+        float               m_dscale[SPATIAL_MAX_EMITTERS];
+        // result: gain
+        float               m_gain[SPATIAL_MAX_EMITTERS];
+        // result: left gain
+        float               m_left[SPATIAL_MAX_EMITTERS];
+        // result: right gain
+        float               m_right[SPATIAL_MAX_EMITTERS];
+        // result: doppler ratio
+        float               m_doppler[SPATIAL_MAX_EMITTERS];
+        // first free id
+        uint32_t            m_free = 0;
+        // next free id of free emitter
+        uint32_t            m_next[SPATIAL_MAX_EMITTERS];
+    private:
+        // no copy
+        CAUSpatializer(const CAUSpatializer&) noexcept = delete;
+        // no move
+        CAUSpatializer(CAUSpatializer&&) noexcept = delete;
+    };
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+#include "au_base.h"
+#include "au_config.h"
+#include <cstdint>
+#include <atomic>
+
+namespace PlayAU {
+    // stats constant
+    enum StatsConstant : uint32_t {
+        // mixer pass histogram bucket count, bucket i counts pass shorter than 2^i us, last one for longer
+        STATS_HISTOGRAM_COUNT = 16,
+    };
+    // memory kind, recorded per allocation
+    enum MemoryKind : uint32_t {
+        // not classified
+        Memory_Other = 0,
+        // clip objects
+        Memory_Clip,
+        // clip buckets
+        Memory_Bucket,
+        // file/memory stream buffers
+        Memory_Stream,
+        // sound bank buffers
+        Memory_Bank,
+        // adpcm decoder state
+        Memory_Adpcm,
+        // flac decoder state
+        Memory_Flac,
+        // vorbis decoder state and codebooks
+        Memory_Vorbis,
+        // mp3 decoder state
+        Memory_Mp3,
+        // software mixer voices and buses
+        Memory_Mixer,
+        // spatializer emitters
+        Memory_Spatial,
+        // COUNT
+        MEMORY_KIND_COUNT
+    };
+    // memory stats snapshot
+    struct MemoryStats {
+        // bytes held now
+        int64_t     total;
+        // max bytes held
+        int64_t     peak;
+        // allocations alive
+        int64_t     allocations;
+        // bytes held per kind
+        int64_t     kinds[MEMORY_KIND_COUNT];
+    };
+    // memory budget callback, called on the allocating thread (maybe audio thread) when total goes over budget
+    using MemoryBudgetCallback = void(*)(void* user, int64_t total, int64_t budget);
+    // get memory stats of all engines, lock free
+    PLAYAU_API void GetMemoryStats(MemoryStats& stats) noexcept;
+    // set memory budget, 0 to disable
+    PLAYAU_API void SetMemoryBudget(int64_t budget, MemoryBudgetCallback call, void* user) noexcept;
+    // clip stats snapshot
+    struct ClipStats {
+        // bytes decoded in SubmitNext
+        uint64_t    bytes_decoded;
+        // total decode time in SubmitNext in ns
+        uint64_t    decode_ns;
+        // max decode time of one SubmitNext in ns
+        uint64_t    decode_max_ns;
+        // buffers submitted to voice
+        uint32_t    buffers_submitted;
+        // processing passes the voice ran dry before end of stream
+        uint32_t    underruns;
+        // voice errors
+        uint32_t    errors;
+        // buffers queued in voice after last submit, engine sums clips alive
+        uint32_t    queued;
+    };
+    // engine stats snapshot, clip counters are summed over all clips ever created, queued over clips alive
+    struct EngineStats {
+        // all clips
+        ClipStats   clips;
+        // mixer processing passes
+        uint64_t    passes;
+        // total mixer pass time in ns
+        uint64_t    pass_ns;
+        // max mixer pass time in ns
+        uint64_t    pass_max_ns;
+        // voices alive now
+        uint32_t    voices;
+        // critical errors from audio api
+        uint32_t    critical_errors;
+        // mixer pass time histogram
+        uint32_t    pass_histogram[STATS_HISTOGRAM_COUNT];
+    };
+    // clip counters, written by audio threads, read without lock
+    struct ClipCounters {
+        // bytes decoded
+        std::atomic<uint64_t>   bytes_decoded{ 0 };
+        // decode time
+        std::atomic<uint64_t>   decode_ns{ 0 };
+        // max decode time
+        std::atomic<uint64_t>   decode_max_ns{ 0 };
+        // buffers submitted
+        std::atomic<uint32_t>   buffers_submitted{ 0 };
+        // underruns
+        std::atomic<uint32_t>   underruns{ 0 };
+        // errors
+        std::atomic<uint32_t>   errors{ 0 };
+        // queued buffers
+        std::atomic<uint32_t>   queued{ 0 };
+        // read snapshot
+        void Snapshot(ClipStats& stats) const noexcept;
+    };
+    // engine counters, written by audio threads, read without lock
+    struct EngineCounters {
+        // all clips
+        ClipCounters            clips;
+        // pass count
+        std::atomic<uint64_t>   passes{ 0 };
+        // pass time
+        std::atomic<uint64_t>   pass_ns{ 0 };
+        // max pass time
+        std::atomic<uint64_t>   pass_max_ns{ 0 };
+        // begin time of pass in progress
+        std::atomic<uint64_t>   pass_begin{ 0 };
+        // voices alive
+        std::atomic<uint32_t>   voices{ 0 };
+        // critical errors
+        std::atomic<uint32_t>   critical_errors{ 0 };
+        // pass histogram
+        std::atomic<uint32_t>   pass_histogram[STATS_HISTOGRAM_COUNT];
+        // ctor
+        EngineCounters() noexcept { for (auto& x : pass_histogram) x.store(0, std::memory_order_relaxed); }
+        // read snapshot
+        void Snapshot(EngineStats& stats) const noexcept;
+    };
+}
@@ -0,0 +1,143 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+#include "au_config.h"
+#include "au_base.h"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace PlayAU {
+    // stream
+    struct XAUStream; struct XAUAudioStream;
+    /// <summary>
+    /// stream holder, owns a stream object: small and nothrow movable one
+    /// stays inline, others live in a single heap allocation and never move
+    /// </summary>
+    template<typename I, size_t LEN>
+    class CAUStreamHolder {
+        // operation
+        enum Op : uint32_t { Op_Relocate, Op_Destroy };
+        // operation function
+        using OpFunc = I*(*)(Op op, void* dst, void* src);
+        // relocate inline object
+        template<typename T, bool INLINE> struct Relocator {
+            static I* Relocate(void* dst, void* src) noexcept {
+                const auto from = static_cast<T*>(src);
+                const auto obj = new(dst) T(std::move(*from));
+                from->~T();
+                return obj;
+            }
+        };
+        // heap object never moves
+        template<typename T> struct Relocator<T, false> {
+            static I* Relocate(void*, void* src) noexcept { return static_cast<T*>(src); }
+        };
+        // operation for T
+        template<typename T, bool INLINE> static I* Operate(Op op, void* dst, void* src) noexcept {
+            if (op == Op_Relocate) return Relocator<T, INLINE>::Relocate(dst, src);
+            const auto obj = static_cast<T*>(src);
+            obj->Dispose();
+            obj->~T();
+            return nullptr;
+        }
+    public:
+        // ctor
+        CAUStreamHolder() noexcept = default;
+        // move ctor
+        CAUStreamHolder(CAUStreamHolder&& x) noexcept { this->take(x); }
+        // move assign
+        auto operator=(CAUStreamHolder&& x) noexcept -> CAUStreamHolder& {
+            if (this != &x) { this->Reset(); this->take(x); }
+            return *this;
+        }
+        // dtor
+        ~CAUStreamHolder() noexcept { this->Reset(); }
+        // construct stream T, return nullptr if out of memory
+        template<typename T, typename... Args> T* Emplace(Args&&... args) noexcept {
+            constexpr bool fit = sizeof(T) <= LEN
+                && alignof(T) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible<T>::value;
+            this->Reset();
+            void* const mem = fit ? static_cast<void*>(m_buffer) : PlayAU::Alloc(sizeof(T));
+            if (!mem) return nullptr;
+            const auto obj = new(mem) T{ std::forward<Args>(args)... };
+            m_pObject = obj;
+            m_pStream = obj;
+            m_pfnOp = &Operate<T, fit>;
+            return obj;
+        }
+        // dispose and destroy stream
+        void Reset() noexcept {
+            if (!m_pfnOp) return;
+            m_pfnOp(Op_Destroy, nullptr, m_pObject);
+            if (!this->IsInline()) PlayAU::Free(m_pObject);
+            m_pObject = nullptr;
+            m_pStream = nullptr;
+            m_pfnOp = nullptr;
+        }
+        // stored inline
+        bool IsInline() const noexcept { return m_pObject == m_buffer; }
+        // get stream
+        auto Get() const noexcept -> I* { return m_pStream; }
+        // get stream
+        auto operator->() const noexcept -> I* { return m_pStream; }
+        // get stream
+        auto operator*() const noexcept -> I& { return *m_pStream; }
+        // not empty
+        explicit operator bool() const noexcept { return !!m_pStream; }
+    private:
+        // take stream from x
+        void take(CAUStreamHolder& x) noexcept {
+            if (!x.m_pfnOp) return;
+            m_pfnOp = x.m_pfnOp;
+            if (x.IsInline()) {
+                m_pStream = m_pfnOp(Op_Relocate, m_buffer, x.m_pObject);
+                m_pObject = m_buffer;
+            }
+            else {
+                m_pStream = x.m_pStream;
+                m_pObject = x.m_pObject;
+            }
+            x.m_pObject = nullptr;
+            x.m_pStream = nullptr;
+            x.m_pfnOp = nullptr;
+        }
+    private:
+        // operation
+        OpFunc                  m_pfnOp = nullptr;
+        // stream interface
+        I*                      m_pStream = nullptr;
+        // object address
+        void*                   m_pObject = nullptr;
+        // inline buffer
+        alignas(std::max_align_t) char m_buffer[LEN];
+    private:
+        // no copy
+        CAUStreamHolder(const CAUStreamHolder&) noexcept = delete;
+    };
+    // file stream holder
+    using FileStreamHolder = CAUStreamHolder<XAUStream, FILE_STREAM_INLINE_LENGTH>;
+    // audio stream holder
+    using AudioStreamHolder = CAUStreamHolder<XAUAudioStream, AUDIO_STREAM_INLINE_LENGTH>;
+    // user stream callback, called on the thread reading the stream
+    struct StreamCallback {
+        // user data
+        void*       user;
+        // total length in byte
+        uint64_t    length;
+        // read up to len bytes, return byte count read
+        uint32_t  (*read)(void* user, void* buf, uint32_t len);
+        // seek to absolute position in byte, return false if failed
+        bool      (*seek)(void* user, uint64_t pos);
+        // [optional] close, called once when stream disposed
+        void      (*close)(void* user);
+    };
+    // create stream viewing memory without copying, data must outlive the stream
+    PLAYAU_API bool CreateMemoryStream(FileStreamHolder& out, const void* data, uint32_t len) noexcept;
+    // create stream owning a copy of data
+    PLAYAU_API bool CreateBufferStream(FileStreamHolder& out, const void* data, uint32_t len) noexcept;
+    // create stream via user callback, close is not called if failed
+    PLAYAU_API bool CreateCallbackStream(FileStreamHolder& out, const StreamCallback& callback) noexcept;
+}
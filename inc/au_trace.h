@@ -0,0 +1,21 @@
+﻿#pragma once
+// License: MIT  http://opensource.org/licenses/MIT
+// Author: dustpg   mailto:dustpg@gmail.com
+
+#include "au_config.h"
+#include <cstdint>
+
+namespace PlayAU {
+    // trace constant
+    enum TraceConstant : uint32_t {
+        // events kept per thread, older ones are overwritten
+        TRACE_RING_LENGTH = 4096,
+    };
+    // trace output, called several times per export
+    using TraceWriter = void(*)(void* user, const char* data, uint32_t len);
+    // export recorded events as chrome trace json, empty trace if PLAYAU_FLAG_TRACE not defined,
+    // events are freed when engine uninitialized, export before that
+    PLAYAU_API void ExportTrace(TraceWriter writer, void* user) noexcept;
+    // drop recorded events
+    PLAYAU_API void ClearTrace() noexcept;
+}
@@ -6,3 +6,10 @@
 
 #include "au_config.h"
 #include "au_engine.h"
+#include "au_codec.h"
+#include "au_bank.h"
+#include "au_stats.h"
+#include "au_trace.h"
+#include "au_dsp.h"
+#include "au_mixer.h"
+#include "au_spatial.h"
@@ -0,0 +1,470 @@
+﻿#include "private/p_au_adpcm.h"
+
+#include <cstring>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PLAYAU_ADPCM_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLAYAU_ADPCM_SSE2
+#include <emmintrin.h>
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define PLAYAU_ADPCM_SSE41
+#include <smmintrin.h>
+#endif
+#endif
+
+
+namespace PlayAU {
+    // standard ms-adpcm coefficients
+    const AdpcmCoef ADPCM_MS_COEFS[ADPCM_MS_COEF_COUNT] = {
+        { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 },
+        { 240, 0 }, { 460, -208 }, { 392, -232 },
+    };
+    // ms-adpcm adaptation table
+    static const int32_t MS_ADAPT[16] = {
+        230, 230, 230, 230, 307, 409, 512, 614,
+        768, 614, 512, 409, 307, 230, 230, 230,
+    };
+    // ms-adpcm delta range, upper bound keeps adapt * delta in 32bit
+    enum : int32_t { MS_DELTA_MIN = 16, MS_DELTA_MAX = 0x7fffffff / 768 };
+    // ima-adpcm step table
+    static const int32_t IMA_STEP[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+        19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+        130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+        337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+        876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+        2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+        5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+    };
+    // ima-adpcm step index adjustment
+    static const int32_t IMA_INDEX[16] = {
+        -1, -1, -1, -1, 2, 4, 6, 8,
+        -1, -1, -1, -1, 2, 4, 6, 8,
+    };
+    // ima-adpcm max step index
+    enum : int32_t { IMA_INDEX_MAX = 88 };
+    // read little endian int16
+    static inline int32_t AdpcmRead16(const uint8_t* ptr) noexcept {
+        return static_cast<int16_t>(uint16_t(ptr[0] | (ptr[1] << 8)));
+    }
+    // clamp to int16
+    static inline int32_t AdpcmClamp16(int32_t x) noexcept {
+        return x < -32768 ? -32768 : (x > 32767 ? 32767 : x);
+    }
+    // one decode lane: a channel in a block
+    struct AdpcmLane {
+        // nibble data of block
+        const uint8_t*      data;
+        // output, stride is channel count
+        int16_t*            out;
+        // channel index
+        uint32_t            channel;
+        // ms: last sample / ima: predictor
+        int32_t             s1;
+        // ms: second last sample
+        int32_t             s2;
+        // ms: delta / ima: step index
+        int32_t             delta;
+        // ms: coefficient 1
+        int32_t             c1;
+        // ms: coefficient 2
+        int32_t             c2;
+    };
+    // ms-adpcm nibble of sample i (i >= 2), high nibble first
+    static inline uint32_t MsNibble(const AdpcmLane& lane, uint32_t i, uint32_t channels) noexcept {
+        const uint32_t k = (i - 2) * channels + lane.channel;
+        return (lane.data[k >> 1] >> ((~k & 1) << 2)) & 0xf;
+    }
+    // ima-adpcm nibble of sample i (i >= 1), 8 samples per 4 bytes, low nibble first
+    static inline uint32_t ImaNibble(const AdpcmLane& lane, uint32_t i, uint32_t channels) noexcept {
+        const uint32_t j = i - 1;
+        const uint32_t byte = (j >> 3) * 4 * channels + lane.channel * 4 + ((j & 7) >> 1);
+        return (lane.data[byte] >> ((j & 1) << 2)) & 0xf;
+    }
+    /// <summary>
+    /// Decodes ms-adpcm lane samples [2, samples) in scalar.
+    /// </summary>
+    /// <param name="lane">The lane.</param>
+    /// <param name="channels">The channels.</param>
+    /// <param name="samples">The samples.</param>
+    static void MsDecodeLane(AdpcmLane& lane, uint32_t channels, uint32_t samples) noexcept {
+        int32_t s1 = lane.s1, s2 = lane.s2, delta = lane.delta;
+        for (uint32_t i = 2; i < samples; ++i) {
+            const uint32_t code = PlayAU::MsNibble(lane, i, channels);
+            // 无符号运算, 溢出回绕与SIMD一致
+            const uint32_t sum = uint32_t(s1 * lane.c1) + uint32_t(s2 * lane.c2);
+            const int32_t pred = static_cast<int32_t>(sum) >> 8;
+            const int32_t cur = PlayAU::AdpcmClamp16(pred + (int32_t(code ^ 8) - 8) * delta);
+            delta = (MS_ADAPT[code] * delta) >> 8;
+            if (delta < MS_DELTA_MIN) delta = MS_DELTA_MIN;
+            if (delta > MS_DELTA_MAX) delta = MS_DELTA_MAX;
+            s2 = s1; s1 = cur;
+            lane.out[i * channels] = static_cast<int16_t>(cur);
+        }
+    }
+    /// <summary>
+    /// Decodes ima-adpcm lane samples [1, samples) in scalar.
+    /// </summary>
+    /// <param name="lane">The lane.</param>
+    /// <param name="channels">The channels.</param>
+    /// <param name="samples">The samples.</param>
+    static void ImaDecodeLane(AdpcmLane& lane, uint32_t channels, uint32_t samples) noexcept {
+        int32_t pred = lane.s1, index = lane.delta;
+        for (uint32_t i = 1; i < samples; ++i) {
+            const uint32_t code = PlayAU::ImaNibble(lane, i, channels);
+            const int32_t step = IMA_STEP[index];
+            int32_t diff = step >> 3;
+            if (code & 1) diff += step >> 2;
+            if (code & 2) diff += step >> 1;
+            if (code & 4) diff += step;
+            if (code & 8) diff = -diff;
+            pred = PlayAU::AdpcmClamp16(pred + diff);
+            index += IMA_INDEX[code];
+            if (index < 0) index = 0;
+            if (index > IMA_INDEX_MAX) index = IMA_INDEX_MAX;
+            lane.out[i * channels] = static_cast<int16_t>(pred);
+        }
+    }
+#if defined(PLAYAU_ADPCM_SSE2) || defined(PLAYAU_ADPCM_NEON)
+#ifdef PLAYAU_ADPCM_NEON
+    // 4 x int32
+    using AdpcmV4 = int32x4_t;
+    static inline AdpcmV4 AdpcmLoad(const int32_t* p) noexcept { return vld1q_s32(p); }
+    static inline void AdpcmStore(int32_t* p, AdpcmV4 a) noexcept { vst1q_s32(p, a); }
+    static inline AdpcmV4 AdpcmSet1(int32_t x) noexcept { return vdupq_n_s32(x); }
+    static inline AdpcmV4 AdpcmAddV(AdpcmV4 a, AdpcmV4 b) noexcept { return vaddq_s32(a, b); }
+    static inline AdpcmV4 AdpcmSubV(AdpcmV4 a, AdpcmV4 b) noexcept { return vsubq_s32(a, b); }
+    static inline AdpcmV4 AdpcmMulV(AdpcmV4 a, AdpcmV4 b) noexcept { return vmulq_s32(a, b); }
+    static inline AdpcmV4 AdpcmAndV(AdpcmV4 a, AdpcmV4 b) noexcept { return vandq_s32(a, b); }
+    static inline AdpcmV4 AdpcmXorV(AdpcmV4 a, AdpcmV4 b) noexcept { return veorq_s32(a, b); }
+    static inline AdpcmV4 AdpcmMinV(AdpcmV4 a, AdpcmV4 b) noexcept { return vminq_s32(a, b); }
+    static inline AdpcmV4 AdpcmMaxV(AdpcmV4 a, AdpcmV4 b) noexcept { return vmaxq_s32(a, b); }
+    template<int N> static inline AdpcmV4 AdpcmSar(AdpcmV4 a) noexcept { return vshrq_n_s32(a, N); }
+    // all ones if (a & bit) != 0
+    static inline AdpcmV4 AdpcmMask(AdpcmV4 a, int32_t bit) noexcept {
+        return vreinterpretq_s32_u32(vtstq_s32(a, vdupq_n_s32(bit)));
+    }
+    // saturate to int16 range
+    static inline AdpcmV4 AdpcmSat16(AdpcmV4 a) noexcept { return vmovl_s16(vqmovn_s32(a)); }
+    // s1 * c1 + s2 * c2
+    static inline AdpcmV4 AdpcmDot2(AdpcmV4 s1, AdpcmV4 s2, AdpcmV4 c1, AdpcmV4 c2) noexcept {
+        return vmlaq_s32(vmulq_s32(s1, c1), s2, c2);
+    }
+#else
+    // 4 x int32
+    using AdpcmV4 = __m128i;
+    static inline AdpcmV4 AdpcmLoad(const int32_t* p) noexcept {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    static inline void AdpcmStore(int32_t* p, AdpcmV4 a) noexcept {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a);
+    }
+    static inline AdpcmV4 AdpcmSet1(int32_t x) noexcept { return _mm_set1_epi32(x); }
+    static inline AdpcmV4 AdpcmAddV(AdpcmV4 a, AdpcmV4 b) noexcept { return _mm_add_epi32(a, b); }
+    static inline AdpcmV4 AdpcmSubV(AdpcmV4 a, AdpcmV4 b) noexcept { return _mm_sub_epi32(a, b); }
+    static inline AdpcmV4 AdpcmAndV(AdpcmV4 a, AdpcmV4 b) noexcept { return _mm_and_si128(a, b); }
+    static inline AdpcmV4 AdpcmXorV(AdpcmV4 a, AdpcmV4 b) noexcept { return _mm_xor_si128(a, b); }
+    template<int N> static inline AdpcmV4 AdpcmSar(AdpcmV4 a) noexcept { return _mm_srai_epi32(a, N); }
+#ifdef PLAYAU_ADPCM_SSE41
+    static inline AdpcmV4 AdpcmMulV(AdpcmV4 a, AdpcmV4 b) noexcept { return _mm_mullo_epi32(a, b); }
+    static inline AdpcmV4 AdpcmMinV(AdpcmV4 a, AdpcmV4 b) noexcept { return _mm_min_epi32(a, b); }
+    static inline AdpcmV4 AdpcmMaxV(AdpcmV4 a, AdpcmV4 b) noexcept { return _mm_max_epi32(a, b); }
+#else
+    // 32bit multiply low for sse2
+    static inline AdpcmV4 AdpcmMulV(AdpcmV4 a, AdpcmV4 b) noexcept {
+        const auto even = _mm_mul_epu32(a, b);
+        const auto odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(
+            _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))
+        );
+    }
+    static inline AdpcmV4 AdpcmMinV(AdpcmV4 a, AdpcmV4 b) noexcept {
+        const auto gt = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+    }
+    static inline AdpcmV4 AdpcmMaxV(AdpcmV4 a, AdpcmV4 b) noexcept {
+        const auto gt = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+    }
+#endif
+    // all ones if (a & bit) != 0
+    static inline AdpcmV4 AdpcmMask(AdpcmV4 a, int32_t bit) noexcept {
+        const auto b = _mm_set1_epi32(bit);
+        return _mm_cmpeq_epi32(_mm_and_si128(a, b), b);
+    }
+    // saturate to int16 range
+    static inline AdpcmV4 AdpcmSat16(AdpcmV4 a) noexcept {
+        const auto p = _mm_packs_epi32(a, a);
+        return _mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16);
+    }
+    // s1 * c1 + s2 * c2, all in int16 range
+    static inline AdpcmV4 AdpcmDot2(AdpcmV4 s1, AdpcmV4 s2, AdpcmV4 c1, AdpcmV4 c2) noexcept {
+        const auto s = _mm_or_si128(_mm_and_si128(s1, _mm_set1_epi32(0xffff)), _mm_slli_epi32(s2, 16));
+        const auto c = _mm_or_si128(_mm_and_si128(c1, _mm_set1_epi32(0xffff)), _mm_slli_epi32(c2, 16));
+        return _mm_madd_epi16(s, c);
+    }
+#endif
+    /// <summary>
+    /// Decodes 4 ms-adpcm lanes samples [2, samples) together.
+    /// </summary>
+    /// <param name="lanes">The 4 lanes.</param>
+    /// <param name="channels">The channels.</param>
+    /// <param name="samples">The samples.</param>
+    static void MsDecodeLane4(AdpcmLane lanes[4], uint32_t channels, uint32_t samples) noexcept {
+        alignas(16) int32_t tmp[4][4];
+        for (int l = 0; l != 4; ++l) {
+            tmp[0][l] = lanes[l].s1; tmp[1][l] = lanes[l].s2;
+            tmp[2][l] = lanes[l].c1; tmp[3][l] = lanes[l].c2;
+        }
+        auto s1 = PlayAU::AdpcmLoad(tmp[0]), s2 = PlayAU::AdpcmLoad(tmp[1]);
+        const auto c1 = PlayAU::AdpcmLoad(tmp[2]), c2 = PlayAU::AdpcmLoad(tmp[3]);
+        for (int l = 0; l != 4; ++l) tmp[0][l] = lanes[l].delta;
+        auto delta = PlayAU::AdpcmLoad(tmp[0]);
+        const auto dmin = PlayAU::AdpcmSet1(MS_DELTA_MIN);
+        const auto dmax = PlayAU::AdpcmSet1(MS_DELTA_MAX);
+        for (uint32_t i = 2; i < samples; ++i) {
+            // 码字与自适应系数只能逐个读取
+            for (int l = 0; l != 4; ++l) {
+                const uint32_t code = PlayAU::MsNibble(lanes[l], i, channels);
+                tmp[0][l] = int32_t(code ^ 8) - 8;
+                tmp[1][l] = MS_ADAPT[code];
+            }
+            const auto code = PlayAU::AdpcmLoad(tmp[0]);
+            const auto adapt = PlayAU::AdpcmLoad(tmp[1]);
+            const auto pred = PlayAU::AdpcmSar<8>(PlayAU::AdpcmDot2(s1, s2, c1, c2));
+            const auto cur = PlayAU::AdpcmSat16(PlayAU::AdpcmAddV(pred, PlayAU::AdpcmMulV(code, delta)));
+            delta = PlayAU::AdpcmSar<8>(PlayAU::AdpcmMulV(adapt, delta));
+            delta = PlayAU::AdpcmMinV(PlayAU::AdpcmMaxV(delta, dmin), dmax);
+            s2 = s1; s1 = cur;
+            PlayAU::AdpcmStore(tmp[2], cur);
+            for (int l = 0; l != 4; ++l)
+                lanes[l].out[i * channels] = static_cast<int16_t>(tmp[2][l]);
+        }
+    }
+    /// <summary>
+    /// Decodes 4 ima-adpcm lanes samples [1, samples) together.
+    /// </summary>
+    /// <param name="lanes">The 4 lanes.</param>
+    /// <param name="channels">The channels.</param>
+    /// <param name="samples">The samples.</param>
+    static void ImaDecodeLane4(AdpcmLane lanes[4], uint32_t channels, uint32_t samples) noexcept {
+        alignas(16) int32_t tmp[3][4];
+        for (int l = 0; l != 4; ++l) {
+            tmp[0][l] = lanes[l].s1;
+            tmp[1][l] = lanes[l].delta;
+        }
+        auto pred = PlayAU::AdpcmLoad(tmp[0]);
+        auto index = PlayAU::AdpcmLoad(tmp[1]);
+        const auto zero = PlayAU::AdpcmSet1(0);
+        const auto imax = PlayAU::AdpcmSet1(IMA_INDEX_MAX);
+        for (uint32_t i = 1; i < samples; ++i) {
+            // 码字与步长只能逐个读取
+            PlayAU::AdpcmStore(tmp[2], index);
+            for (int l = 0; l != 4; ++l) {
+                const uint32_t code = PlayAU::ImaNibble(lanes[l], i, channels);
+                tmp[0][l] = static_cast<int32_t>(code);
+                tmp[1][l] = IMA_STEP[tmp[2][l]];
+                tmp[2][l] = IMA_INDEX[code];
+            }
+            const auto code = PlayAU::AdpcmLoad(tmp[0]);
+            const auto step = PlayAU::AdpcmLoad(tmp[1]);
+            // diff = step/8 + step/4 * b0 + step/2 * b1 + step * b2
+            const auto b0 = PlayAU::AdpcmAndV(PlayAU::AdpcmMask(code, 1), PlayAU::AdpcmSar<2>(step));
+            const auto b1 = PlayAU::AdpcmAndV(PlayAU::AdpcmMask(code, 2), PlayAU::AdpcmSar<1>(step));
+            const auto b2 = PlayAU::AdpcmAndV(PlayAU::AdpcmMask(code, 4), step);
+            auto diff = PlayAU::AdpcmAddV(PlayAU::AdpcmSar<3>(step), b0);
+            diff = PlayAU::AdpcmAddV(diff, PlayAU::AdpcmAddV(b1, b2));
+            // 符号位: (diff ^ m) - m
+            const auto sign = PlayAU::AdpcmMask(code, 8);
+            diff = PlayAU::AdpcmSubV(PlayAU::AdpcmXorV(diff, sign), sign);
+            pred = PlayAU::AdpcmSat16(PlayAU::AdpcmAddV(pred, diff));
+            index = PlayAU::AdpcmAddV(index, PlayAU::AdpcmLoad(tmp[2]));
+            index = PlayAU::AdpcmMinV(PlayAU::AdpcmMaxV(index, zero), imax);
+            PlayAU::AdpcmStore(tmp[0], pred);
+            for (int l = 0; l != 4; ++l)
+                lanes[l].out[i * channels] = static_cast<int16_t>(tmp[0][l]);
+        }
+    }
+#endif
+}
+
+
+/// <summary>
+/// Gets samples per ms-adpcm block.
+/// </summary>
+/// <param name="block_align">The block align.</param>
+/// <param name="channels">The channels.</param>
+/// <returns></returns>
+auto PlayAU::MsAdpcmBlockSamples(uint32_t block_align, uint32_t channels) noexcept -> uint32_t {
+    const uint32_t header = ADPCM_MS_HEADER_LENGTH * channels;
+    if (!channels || block_align <= header) return 0;
+    return 2 + (block_align - header) * 2 / channels;
+}
+
+/// <summary>
+/// Gets samples per ima-adpcm block.
+/// </summary>
+/// <param name="block_align">The block align.</param>
+/// <param name="channels">The channels.</param>
+/// <returns></returns>
+auto PlayAU::ImaAdpcmBlockSamples(uint32_t block_align, uint32_t channels) noexcept -> uint32_t {
+    const uint32_t header = ADPCM_IMA_HEADER_LENGTH * channels;
+    if (!channels || block_align <= header) return 0;
+    // 数据以每声道4字节(8个样本)交错
+    return 1 + (block_align - header) / (4 * channels) * 8;
+}
+
+/// <summary>
+/// Decodes ms-adpcm blocks, lanes of (block, channel) run 4 at a time in SIMD.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="block_align">The block align.</param>
+/// <param name="count">The block count.</param>
+/// <param name="channels">The channels.</param>
+/// <param name="samples">The samples per block.</param>
+/// <param name="coefs">The coefficients.</param>
+/// <param name="coef_count">The coefficient count.</param>
+/// <param name="out">The output.</param>
+void PlayAU::DecodeMsAdpcmBlocks(
+    const uint8_t* data, uint32_t block_align, uint32_t count,
+    uint32_t channels, uint32_t samples,
+    const AdpcmCoef coefs[], uint32_t coef_count,
+    int16_t* out) noexcept {
+    AdpcmLane lanes[ADPCM_BLOCK_BATCH * ADPCM_MAX_CHANNELS];
+    constexpr uint32_t lane_cap = sizeof(lanes) / sizeof(lanes[0]);
+    while (count) {
+        // 每批最多填满车道
+        uint32_t batch = lane_cap / channels;
+        if (batch > count) batch = count;
+        uint32_t n = 0;
+        for (uint32_t b = 0; b != batch; ++b) {
+            const uint8_t* const block = data + b * block_align;
+            int16_t* const pcm = out + b * samples * channels;
+            for (uint32_t c = 0; c != channels; ++c) {
+                auto& lane = lanes[n++];
+                // 块头: 预测器索引, 初始步长, 样本1, 样本2
+                uint32_t pred = block[c];
+                if (pred >= coef_count) pred = 0;
+                lane.data = block + ADPCM_MS_HEADER_LENGTH * channels;
+                lane.out = pcm + c;
+                lane.channel = c;
+                lane.c1 = coefs[pred].c1;
+                lane.c2 = coefs[pred].c2;
+                lane.delta = PlayAU::AdpcmRead16(block + channels + c * 2);
+                lane.s1 = PlayAU::AdpcmRead16(block + channels * 3 + c * 2);
+                lane.s2 = PlayAU::AdpcmRead16(block + channels * 5 + c * 2);
+                // 样本2在前
+                if (samples > 0) pcm[c] = static_cast<int16_t>(lane.s2);
+                if (samples > 1) pcm[channels + c] = static_cast<int16_t>(lane.s1);
+            }
+        }
+        uint32_t l = 0;
+#if defined(PLAYAU_ADPCM_SSE2) || defined(PLAYAU_ADPCM_NEON)
+        for (; l + 4 <= n; l += 4) PlayAU::MsDecodeLane4(lanes + l, channels, samples);
+#endif
+        for (; l != n; ++l) PlayAU::MsDecodeLane(lanes[l], channels, samples);
+        data += batch * block_align;
+        out += batch * samples * channels;
+        count -= batch;
+    }
+}
+
+/// <summary>
+/// Decodes ima-adpcm blocks, lanes of (block, channel) run 4 at a time in SIMD.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="block_align">The block align.</param>
+/// <param name="count">The block count.</param>
+/// <param name="channels">The channels.</param>
+/// <param name="samples">The samples per block.</param>
+/// <param name="out">The output.</param>
+void PlayAU::DecodeImaAdpcmBlocks(
+    const uint8_t* data, uint32_t block_align, uint32_t count,
+    uint32_t channels, uint32_t samples,
+    int16_t* out) noexcept {
+    AdpcmLane lanes[ADPCM_BLOCK_BATCH * ADPCM_MAX_CHANNELS];
+    constexpr uint32_t lane_cap = sizeof(lanes) / sizeof(lanes[0]);
+    while (count) {
+        uint32_t batch = lane_cap / channels;
+        if (batch > count) batch = count;
+        uint32_t n = 0;
+        for (uint32_t b = 0; b != batch; ++b) {
+            const uint8_t* const block = data + b * block_align;
+            int16_t* const pcm = out + b * samples * channels;
+            for (uint32_t c = 0; c != channels; ++c) {
+                auto& lane = lanes[n++];
+                // 块头: 初始预测值, 步长索引, 保留
+                const uint8_t* const head = block + c * ADPCM_IMA_HEADER_LENGTH;
+                int32_t index = head[2];
+                if (index > IMA_INDEX_MAX) index = IMA_INDEX_MAX;
+                lane.data = block + ADPCM_IMA_HEADER_LENGTH * channels;
+                lane.out = pcm + c;
+                lane.channel = c;
+                lane.s1 = PlayAU::AdpcmRead16(head);
+                lane.delta = index;
+                if (samples > 0) pcm[c] = static_cast<int16_t>(lane.s1);
+            }
+        }
+        uint32_t l = 0;
+#if defined(PLAYAU_ADPCM_SSE2) || defined(PLAYAU_ADPCM_NEON)
+        for (; l + 4 <= n; l += 4) PlayAU::ImaDecodeLane4(lanes + l, channels, samples);
+#endif
+        for (; l != n; ++l) PlayAU::ImaDecodeLane(lanes[l], channels, samples);
+        data += batch * block_align;
+        out += batch * samples * channels;
+        count -= batch;
+    }
+}
+
+/// <summary>
+/// Encodes one ima-adpcm block, mirrors the decoder so no drift between blocks.
+/// </summary>
+/// <param name="block">The block.</param>
+/// <param name="block_align">The block align.</param>
+/// <param name="channels">The channels.</param>
+/// <param name="pcm">The interleaved pcm.</param>
+/// <param name="frames">The frames in pcm.</param>
+/// <param name="index">The step index of each channel.</param>
+void PlayAU::EncodeImaAdpcmBlock(
+    uint8_t* block, uint32_t block_align,
+    uint32_t channels, const int16_t* pcm, uint32_t frames,
+    int32_t index[]) noexcept {
+    const uint32_t samples = PlayAU::ImaAdpcmBlockSamples(block_align, channels);
+    std::memset(block, 0, block_align);
+    uint8_t* const data = block + ADPCM_IMA_HEADER_LENGTH * channels;
+    for (uint32_t c = 0; c != channels; ++c) {
+        int32_t pred = frames ? pcm[c] : 0;
+        int32_t idx = index[c];
+        // 块头: 初始预测值, 步长索引, 保留
+        uint8_t* const head = block + c * ADPCM_IMA_HEADER_LENGTH;
+        head[0] = static_cast<uint8_t>(pred);
+        head[1] = static_cast<uint8_t>(pred >> 8);
+        head[2] = static_cast<uint8_t>(idx);
+        int32_t last = pred;
+        for (uint32_t i = 1; i < samples; ++i) {
+            if (i < frames) last = pcm[i * channels + c];
+            const int32_t step = IMA_STEP[idx];
+            int32_t diff = last - pred;
+            uint32_t code = 0;
+            if (diff < 0) { code = 8; diff = -diff; }
+            // 与解码相同的量化差值
+            int32_t delta = step >> 3;
+            if (diff >= step) { code |= 4; diff -= step; delta += step; }
+            if (diff >= step >> 1) { code |= 2; diff -= step >> 1; delta += step >> 1; }
+            if (diff >= step >> 2) { code |= 1; delta += step >> 2; }
+            pred = PlayAU::AdpcmClamp16(code & 8 ? pred - delta : pred + delta);
+            idx += IMA_INDEX[code];
+            if (idx < 0) idx = 0;
+            if (idx > IMA_INDEX_MAX) idx = IMA_INDEX_MAX;
+            const uint32_t j = i - 1;
+            const uint32_t byte = (j >> 3) * 4 * channels + c * 4 + ((j & 7) >> 1);
+            data[byte] |= static_cast<uint8_t>(code << ((j & 1) << 2));
+        }
+        index[c] = idx;
+    }
+}
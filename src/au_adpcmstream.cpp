@@ -0,0 +1,324 @@
+﻿#include "../inc/au_config.h"
+#include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_trace.h"
+#include "private/p_au_wave.h"
+#include "private/p_au_adpcm.h"
+
+#include <cstring>
+#include <new>
+
+
+namespace PlayAU {
+    /// <summary>
+    /// adpcm decoder state
+    /// </summary>
+    struct AdpcmDecoder {
+        // ms-adpcm coefficients
+        AdpcmCoef           coefs[ADPCM_MS_COEF_COUNT];
+        // block buffer when file stream is not mapped
+        uint8_t*            blocks;
+        // decoded pcm of current batch
+        int16_t*            pcm;
+        // data chunk offset in file
+        uint64_t            data_offset;
+        // data chunk length in byte
+        uint64_t            data_size;
+        // block count, including partial last block
+        uint64_t            block_count;
+        // total sample frames
+        uint64_t            total_frames;
+        // first block of current batch
+        uint64_t            batch_block;
+        // block align
+        uint32_t            block_align;
+        // samples per full block
+        uint32_t            samples;
+        // channel count
+        uint32_t            channels;
+        // ms-adpcm coefficient count
+        uint32_t            coef_count;
+        // block count of current batch
+        uint32_t            batch_count;
+        // sample frames of current batch
+        uint32_t            batch_frames;
+        // read cursor in current batch
+        uint32_t            cursor;
+        // format tag
+        uint16_t            tag;
+    };
+    /// <summary>
+    /// ms-adpcm/ima-adpcm stream, decodes blocks to pcm16
+    /// </summary>
+    /// <seealso cref="XAUAudioStream" />
+    struct CAUAdpcmAudioStream final : XAUAudioStream {
+    public:
+        // ctor
+        CAUAdpcmAudioStream() noexcept;
+        // init
+        bool Init(const WaveHeader& header) noexcept;
+        // dispose
+        void Dispose() noexcept override;
+        // seek stream in byte, return current position
+        bool Seek(int64_t off, Move method = XAUStream::Move_Begin) noexcept override;
+        // read stream, return byte count read
+        auto ReadNext(uint32_t len, void* buf) noexcept->uint32_t override;
+    private:
+        // samples in block of length
+        auto block_samples(uint32_t bytes) const noexcept->uint32_t;
+        // decode batch from block
+        void decode_batch(uint64_t block) noexcept;
+        // release decoder
+        void release() noexcept;
+    private:
+        // adpcm decoder
+        AdpcmDecoder            m_decoder;
+    };
+    /// <summary>
+    /// Creates the adpcm audio stream.
+    /// </summary>
+    /// <param name="file">The file.</param>
+    /// <param name="out">The out.</param>
+    /// <param name="header">The header.</param>
+    /// <returns></returns>
+    bool CreateAdpcmAudioStream(FileStreamHolder& file, AudioStreamHolder& out, const WaveHeader& header) noexcept {
+        MemoryKindScope kind{ Memory_Adpcm };
+        return PlayAU::CreateAudioStream<CAUAdpcmAudioStream>(file, out, header);
+    }
+    // read little endian uint16
+    static inline uint32_t AdpcmRead16u(const uint8_t* ptr) noexcept {
+        return uint32_t(ptr[0]) | (uint32_t(ptr[1]) << 8);
+    }
+}
+
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUAdpcmAudioStream"/> struct.
+/// </summary>
+PlayAU::CAUAdpcmAudioStream::CAUAdpcmAudioStream() noexcept {
+    this->length = 0;
+    this->offset = 0;
+    std::memset(&m_decoder, 0, sizeof(m_decoder));
+}
+
+/// <summary>
+/// Initializes this instance.
+/// </summary>
+/// <param name="header">The header.</param>
+/// <returns></returns>
+bool PlayAU::CAUAdpcmAudioStream::Init(const WaveHeader& header) noexcept {
+    const uint32_t channels = header.channels;
+    const uint32_t block_align = header.block_align;
+    if (!channels || channels > ADPCM_MAX_CHANNELS) return false;
+    if (header.bits_per_sample != 4) return false;
+    const auto decoder = &m_decoder;
+    decoder->tag = header.tag;
+    decoder->channels = channels;
+    decoder->block_align = block_align;
+    decoder->data_offset = header.data_offset;
+    decoder->data_size = header.data_size;
+    uint32_t samples = this->block_samples(block_align);
+    if (samples < 2) return false;
+    // 额外数据: 每块样本数 [+ 系数个数 + 系数]
+    if (header.extra_size >= 2) {
+        const uint32_t per_block = PlayAU::AdpcmRead16u(header.extra);
+        if (per_block >= 2 && per_block < samples) samples = per_block;
+    }
+    decoder->samples = samples;
+    std::memcpy(decoder->coefs, ADPCM_MS_COEFS, sizeof(ADPCM_MS_COEFS));
+    decoder->coef_count = ADPCM_MS_COEF_COUNT;
+    if (header.tag == WAVE_TAG_MSADPCM && header.extra_size >= 4) {
+        uint32_t count = PlayAU::AdpcmRead16u(header.extra + 2);
+        const uint32_t kept = (header.extra_size - 4) / 4;
+        if (count > kept) count = kept;
+        if (count > ADPCM_MS_COEF_COUNT) count = ADPCM_MS_COEF_COUNT;
+        for (uint32_t i = 0; i != count; ++i) {
+            const auto ptr = header.extra + 4 + i * 4;
+            decoder->coefs[i].c1 = static_cast<int16_t>(PlayAU::AdpcmRead16u(ptr));
+            decoder->coefs[i].c2 = static_cast<int16_t>(PlayAU::AdpcmRead16u(ptr + 2));
+        }
+        if (count) decoder->coef_count = count;
+    }
+    // 样本总数: 完整块 + 最后的不完整块
+    const uint64_t full = decoder->data_size / block_align;
+    const uint32_t rest = this->block_samples(static_cast<uint32_t>(decoder->data_size % block_align));
+    const uint32_t last = rest ? (rest < samples ? rest : samples) : samples;
+    uint64_t frames = full * samples + (rest ? last : 0);
+    decoder->block_count = full + (rest ? 1 : 0);
+    // fact块只用于裁掉最后一块的填充, 部分编码器写入的值不可靠
+    const uint64_t fact = header.fact_samples;
+    if (fact < frames && fact + last > frames) frames = fact;
+    decoder->total_frames = frames;
+    // 批量解码缓存: PCM + 未映射时的块数据
+    const size_t pcm_len = size_t(ADPCM_BLOCK_BATCH) * samples * channels * sizeof(int16_t);
+    const size_t block_len = size_t(ADPCM_BLOCK_BATCH) * block_align;
+    const auto buffer = static_cast<uint8_t*>(PlayAU::Alloc(pcm_len + block_len));
+    if (!buffer) return false;
+    decoder->pcm = reinterpret_cast<int16_t*>(buffer);
+    decoder->blocks = buffer + pcm_len;
+    // 格式
+    this->format.channels = static_cast<uint8_t>(channels);
+    this->format.samples_per_sec = header.sample_rate;
+    this->format.bits_per_sample = 16;
+    this->format.fmt_tag = Wave_PCM;
+    this->length = decoder->total_frames * channels * sizeof(int16_t);
+    return true;
+}
+
+/// <summary>
+/// Gets samples in block of length.
+/// </summary>
+/// <param name="bytes">The bytes.</param>
+/// <returns></returns>
+auto PlayAU::CAUAdpcmAudioStream::block_samples(uint32_t bytes) const noexcept -> uint32_t {
+    const auto decoder = &m_decoder;
+    return decoder->tag == WAVE_TAG_MSADPCM
+        ? PlayAU::MsAdpcmBlockSamples(bytes, decoder->channels)
+        : PlayAU::ImaAdpcmBlockSamples(bytes, decoder->channels)
+        ;
+}
+
+/// <summary>
+/// Releases unmanaged and - optionally - managed resources.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUAdpcmAudioStream::Dispose() noexcept {
+    this->release();
+    this->DisposeFS();
+}
+
+/// <summary>
+/// Releases the decoder.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUAdpcmAudioStream::release() noexcept {
+    PlayAU::Free(m_decoder.pcm);
+    m_decoder.pcm = nullptr;
+    m_decoder.blocks = nullptr;
+}
+
+/// <summary>
+/// Decodes a batch of blocks beginning at block.
+/// </summary>
+/// <param name="block">The block.</param>
+/// <returns></returns>
+void PlayAU::CAUAdpcmAudioStream::decode_batch(uint64_t block) noexcept {
+    const auto decoder = &m_decoder;
+    decoder->batch_block = block;
+    decoder->batch_count = 0;
+    decoder->batch_frames = 0;
+    decoder->cursor = 0;
+    if (block >= decoder->block_count) return;
+    if (block * decoder->samples >= decoder->total_frames) return;
+    const uint64_t blocks = decoder->block_count - block;
+    const uint32_t count = blocks < ADPCM_BLOCK_BATCH ? static_cast<uint32_t>(blocks) : ADPCM_BLOCK_BATCH;
+    const uint32_t block_align = decoder->block_align;
+    const uint64_t begin = block * block_align;
+    const uint64_t left = decoder->data_size - begin;
+    const uint32_t want = count * block_align < left ? count * block_align : static_cast<uint32_t>(left);
+    // 顺序读取时文件已经在目标位置
+    const auto fs = this->FileStream();
+    const uint64_t pos = decoder->data_offset + begin;
+    if (fs->offset != pos && !fs->Seek(static_cast<int64_t>(pos), XAUStream::Move_Begin))
+        return;
+    // 映射的文件直接解码, 否则读入块缓存
+    uint32_t read = 0;
+    auto data = static_cast<const uint8_t*>(fs->ViewNext(want, read));
+    if (!data) {
+        read = fs->ReadNext(want, decoder->blocks);
+        data = decoder->blocks;
+    }
+    const uint32_t full = read / block_align;
+    const uint32_t rest = this->block_samples(read % block_align);
+    const uint32_t samples = decoder->samples;
+    const uint32_t channels = decoder->channels;
+    const auto partial = rest < samples ? rest : samples;
+    const auto tail = data + full * block_align;
+    const auto out = decoder->pcm + full * samples * channels;
+    if (decoder->tag == WAVE_TAG_MSADPCM) {
+        PlayAU::DecodeMsAdpcmBlocks(
+            data, block_align, full, channels, samples,
+            decoder->coefs, decoder->coef_count, decoder->pcm
+        );
+        if (partial) PlayAU::DecodeMsAdpcmBlocks(
+            tail, block_align, 1, channels, partial,
+            decoder->coefs, decoder->coef_count, out
+        );
+    }
+    else {
+        PlayAU::DecodeImaAdpcmBlocks(data, block_align, full, channels, samples, decoder->pcm);
+        if (partial) PlayAU::DecodeImaAdpcmBlocks(tail, block_align, 1, channels, partial, out);
+    }
+    decoder->batch_count = full + (partial ? 1 : 0);
+    // 最后一批受总样本数限制
+    const uint64_t first = block * samples;
+    uint32_t frames = full * samples + partial;
+    if (frames > decoder->total_frames - first) frames = static_cast<uint32_t>(decoder->total_frames - first);
+    decoder->batch_frames = frames;
+}
+
+/// <summary>
+/// Seeks the specified off, aligned to sample frame.
+/// </summary>
+/// <param name="off">The off.</param>
+/// <param name="method">The method.</param>
+/// <returns></returns>
+bool PlayAU::CAUAdpcmAudioStream::Seek(int64_t off, Move method) noexcept {
+    const auto decoder = &m_decoder;
+    const int64_t frame_len = static_cast<int64_t>(decoder->channels * sizeof(int16_t));
+    int64_t target = off / frame_len;
+    // 相对移动
+    switch (method)
+    {
+    case PlayAU::XAUStream::Move_Current:
+        target += static_cast<int64_t>(this->offset) / frame_len;
+        break;
+    case PlayAU::XAUStream::Move_End:
+        target += static_cast<int64_t>(this->length) / frame_len;
+        break;
+    }
+    if (target < 0) target = 0;
+    if (static_cast<uint64_t>(target) > decoder->total_frames) target = static_cast<int64_t>(decoder->total_frames);
+    const auto frame = static_cast<uint64_t>(target);
+    // 定位到所在块, 块内裁剪
+    const uint64_t block = frame / decoder->samples;
+    const bool hit = block >= decoder->batch_block
+        && block < decoder->batch_block + decoder->batch_count;
+    if (!hit) this->decode_batch(block);
+    const uint64_t first = decoder->batch_block * decoder->samples;
+    const uint64_t skip = frame - first;
+    const uint32_t cursor = skip < decoder->batch_frames ? static_cast<uint32_t>(skip) : decoder->batch_frames;
+    decoder->cursor = cursor;
+    this->offset = (first + cursor) * frame_len;
+    return true;
+}
+
+/// <summary>
+/// Reads the next.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <param name="buf">The buf.</param>
+/// <returns></returns>
+auto PlayAU::CAUAdpcmAudioStream::ReadNext(uint32_t len, void* buf) noexcept -> uint32_t {
+    PLAYAU_TRACE_SCOPE("adpcm.ReadNext");
+    const auto decoder = &m_decoder;
+    const uint32_t frame_len = decoder->channels * sizeof(int16_t);
+    auto write = reinterpret_cast<uint8_t*>(buf);
+    uint32_t want = len / frame_len;
+    while (want) {
+        // 当前批已读完
+        if (decoder->cursor == decoder->batch_frames) {
+            this->decode_batch(decoder->batch_block + decoder->batch_count);
+            if (!decoder->batch_frames) break;
+        }
+        uint32_t count = decoder->batch_frames - decoder->cursor;
+        if (count > want) count = want;
+        std::memcpy(write, decoder->pcm + decoder->cursor * decoder->channels, count * frame_len);
+        decoder->cursor += count;
+        write += count * frame_len;
+        want -= count;
+    }
+    const auto done = static_cast<uint32_t>(write - reinterpret_cast<uint8_t*>(buf));
+    this->offset += done;
+    return done;
+}
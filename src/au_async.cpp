@@ -0,0 +1,410 @@
+﻿#include "../inc/playau.h"
+#include "../inc/au_clip.h"
+#include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_trace.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <new>
+#include <system_error>
+
+
+namespace PlayAU {
+    // create file stream
+    bool CreateWinFileStream(FileStreamHolder& out, const char16_t file[]) noexcept;
+    // create audio stream from file stream
+    bool CreateAudioStreamFromFileStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) noexcept;
+    // create clip, charged: bytes allocated for the stream before
+    auto CreateClip(CAUEngine&, ClipFlag, AudioStreamHolder&&, const char* group, int64_t charged) noexcept->CAUAudioClip*;
+    /// <summary>
+    /// async clip request, strings are stored after the object
+    /// </summary>
+    struct CAUClipRequest {
+        // next request in list
+        CAUClipRequest*             next;
+        // callback, nullptr for future
+        CAUEngine::ClipCallback     call;
+        // user data for callback
+        void*                       user;
+        // group name, nullptr for default
+        const char*                 group;
+        // file path
+        const char16_t*             file;
+        // clip flag
+        ClipFlag                    flag;
+        // canceled while loading
+        bool                        canceled;
+        // audio stream, empty if failed
+        AudioStreamHolder           stream;
+        // bytes allocated for the stream, charged to clip
+        std::atomic<int64_t>        charged;
+        // create request
+        static auto Create(ClipFlag, const char16_t file[], const char* group) noexcept->CAUClipRequest*;
+        // destroy request
+        void Destroy() noexcept;
+    };
+    /// <summary>
+    /// async clip loader, one worker thread serves all requests in order
+    /// so that a batch shares one i/o queue instead of seeking concurrently
+    /// </summary>
+    struct CAUAsyncLoader {
+        // request list
+        struct List {
+            // head
+            CAUClipRequest*     head = nullptr;
+            // tail
+            CAUClipRequest*     tail = nullptr;
+            // push back
+            void Push(CAUClipRequest* req) noexcept;
+            // pop front, nullptr if empty
+            auto Pop() noexcept->CAUClipRequest*;
+            // remove request, return false if not found
+            bool Remove(CAUClipRequest* req) noexcept;
+        };
+        // ctor
+        CAUAsyncLoader() noexcept;
+        // dtor
+        ~CAUAsyncLoader() noexcept;
+        // start worker thread, false if failed
+        bool Start() noexcept;
+        // add request
+        void Add(CAUClipRequest* req) noexcept;
+        // worker thread
+        void Run() noexcept;
+        // mutex
+        std::mutex                  mutex;
+        // wake up worker
+        std::condition_variable     cv;
+        // requests waiting for worker
+        List                        pending;
+        // loaded requests with callback
+        List                        finished;
+        // loaded requests with future
+        List                        ready;
+        // request loading in worker
+        CAUClipRequest*             loading = nullptr;
+        // exit worker
+        bool                        exit = false;
+        // worker thread
+        std::thread                 worker;
+    };
+    /// <summary>
+    /// Starts the async loader on first request.
+    /// </summary>
+    /// <param name="loader">The loader.</param>
+    /// <returns></returns>
+    static bool StartAsyncLoader(CAUAsyncLoader*& loader) noexcept {
+        if (loader) return true;
+        const auto ptr = PlayAU::Alloc(sizeof(CAUAsyncLoader));
+        if (!ptr) return false;
+        loader = new(ptr) CAUAsyncLoader;
+        // 线程创建失败时本次请求失败, 下次请求重试
+        if (loader->Start()) return true;
+        loader->~CAUAsyncLoader();
+        PlayAU::Free(loader);
+        loader = nullptr;
+        return false;
+    }
+    /// <summary>
+    /// Creates the clip from loaded request.
+    /// </summary>
+    /// <param name="engine">The engine.</param>
+    /// <param name="req">The req.</param>
+    /// <returns></returns>
+    static auto CreateClipFromRequest(CAUEngine& engine, CAUClipRequest& req) noexcept -> CAUAudioClip* {
+        if (!req.stream) return nullptr;
+        // 去掉私有标志位, 加载时申请的内存记在片段上
+        const auto flag = static_cast<ClipFlag>(req.flag & Flag_Public);
+        const auto charged = req.charged.load(std::memory_order_relaxed);
+        return PlayAU::CreateClip(engine, flag, std::move(req.stream), req.group, charged);
+    }
+    /// <summary>
+    /// Stops worker and releases async requests.
+    /// </summary>
+    /// <param name="loader">The loader.</param>
+    /// <returns></returns>
+    void DisposeAsyncLoader(CAUAsyncLoader* loader) noexcept {
+        if (!loader) return;
+        loader->~CAUAsyncLoader();
+        PlayAU::Free(loader);
+    }
+}
+
+
+/// <summary>
+/// Creates the request.
+/// </summary>
+/// <param name="flag">The flag.</param>
+/// <param name="file">The file.</param>
+/// <param name="group">The group.</param>
+/// <returns></returns>
+auto PlayAU::CAUClipRequest::Create(
+    ClipFlag flag,
+    const char16_t file[],
+    const char* group) noexcept -> CAUClipRequest* {
+    // 路径与分组名复制到对象之后, 调用者的字符串不必存活
+    const size_t filelen = (std::char_traits<char16_t>::length(file) + 1) * sizeof(char16_t);
+    const size_t grouplen = group ? std::strlen(group) + 1 : 0;
+    const auto ptr = PlayAU::Alloc(sizeof(CAUClipRequest) + filelen + grouplen);
+    if (!ptr) return nullptr;
+    const auto req = new(ptr) CAUClipRequest;
+    const auto tail = reinterpret_cast<char*>(req + 1);
+    std::memcpy(tail, file, filelen);
+    if (group) std::memcpy(tail + filelen, group, grouplen);
+    req->next = nullptr;
+    req->call = nullptr;
+    req->user = nullptr;
+    req->group = group ? tail + filelen : nullptr;
+    req->file = reinterpret_cast<const char16_t*>(tail);
+    req->flag = flag;
+    req->canceled = false;
+    req->charged.store(0, std::memory_order_relaxed);
+    return req;
+}
+
+/// <summary>
+/// Destroys this instance.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUClipRequest::Destroy() noexcept {
+    this->~CAUClipRequest();
+    PlayAU::Free(this);
+}
+
+
+/// <summary>
+/// Pushes the request to back.
+/// </summary>
+/// <param name="req">The req.</param>
+/// <returns></returns>
+void PlayAU::CAUAsyncLoader::List::Push(CAUClipRequest* req) noexcept {
+    req->next = nullptr;
+    if (this->tail) this->tail->next = req;
+    else this->head = req;
+    this->tail = req;
+}
+
+/// <summary>
+/// Pops the request from front.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUAsyncLoader::List::Pop() noexcept -> CAUClipRequest* {
+    const auto req = this->head;
+    if (req) {
+        this->head = req->next;
+        if (!this->head) this->tail = nullptr;
+        req->next = nullptr;
+    }
+    return req;
+}
+
+/// <summary>
+/// Removes the request.
+/// </summary>
+/// <param name="req">The req.</param>
+/// <returns></returns>
+bool PlayAU::CAUAsyncLoader::List::Remove(CAUClipRequest* req) noexcept {
+    CAUClipRequest* prev = nullptr;
+    for (auto node = this->head; node; prev = node, node = node->next) {
+        if (node != req) continue;
+        if (prev) prev->next = node->next;
+        else this->head = node->next;
+        if (this->tail == node) this->tail = prev;
+        node->next = nullptr;
+        return true;
+    }
+    return false;
+}
+
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUAsyncLoader"/> struct.
+/// </summary>
+PlayAU::CAUAsyncLoader::CAUAsyncLoader() noexcept {
+}
+
+/// <summary>
+/// Starts the worker thread.
+/// </summary>
+/// <returns></returns>
+bool PlayAU::CAUAsyncLoader::Start() noexcept {
+    try {
+        this->worker = std::thread([this]() noexcept { this->Run(); });
+    }
+    catch (const std::system_error&) {
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Finalizes an instance of the <see cref="CAUAsyncLoader"/> struct.
+/// </summary>
+/// <returns></returns>
+PlayAU::CAUAsyncLoader::~CAUAsyncLoader() noexcept {
+    {
+        std::lock_guard<std::mutex> locker{ this->mutex };
+        this->exit = true;
+    }
+    this->cv.notify_one();
+    if (this->worker.joinable()) this->worker.join();
+    // 未完成的回调以空片段通知, 未取回的future直接释放
+    while (const auto req = this->pending.Pop()) {
+        if (req->call) req->call(req->user, nullptr);
+        req->Destroy();
+    }
+    while (const auto req = this->finished.Pop()) {
+        req->call(req->user, nullptr);
+        req->Destroy();
+    }
+    while (const auto req = this->ready.Pop()) req->Destroy();
+}
+
+/// <summary>
+/// Adds the request.
+/// </summary>
+/// <param name="req">The req.</param>
+/// <returns></returns>
+void PlayAU::CAUAsyncLoader::Add(CAUClipRequest* req) noexcept {
+    {
+        std::lock_guard<std::mutex> locker{ this->mutex };
+        this->pending.Push(req);
+    }
+    this->cv.notify_one();
+}
+
+/// <summary>
+/// Runs the worker thread.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUAsyncLoader::Run() noexcept {
+    std::unique_lock<std::mutex> locker{ this->mutex };
+    while (true) {
+        this->cv.wait(locker, [this]() noexcept { return this->exit || this->pending.head; });
+        if (this->exit) break;
+        const auto req = this->pending.Pop();
+        this->loading = req;
+        locker.unlock();
+        // 打开文件, 探测格式并解析头部, 片段在PollAsync/PollClip的线程创建
+        {
+            PLAYAU_TRACE_SCOPE("async.Load");
+            FileStreamHolder filestream;
+            if (PlayAU::CreateWinFileStream(filestream, req->file)) {
+                MemoryChargeScope charge{ &req->charged };
+                PlayAU::CreateAudioStreamFromFileStream(filestream, req->stream, req->flag);
+            }
+        }
+        locker.lock();
+        this->loading = nullptr;
+        if (req->canceled) req->Destroy();
+        else if (req->call) this->finished.Push(req);
+        else this->ready.Push(req);
+    }
+}
+
+
+/// <summary>
+/// Creates the clip from file asynchronously with callback.
+/// </summary>
+/// <param name="flag">The flag.</param>
+/// <param name="file">The file.</param>
+/// <param name="call">The call.</param>
+/// <param name="user">The user.</param>
+/// <param name="group">The group.</param>
+/// <returns></returns>
+bool PlayAU::CAUEngine::CreateClipFromFileAsync(
+    ClipFlag flag,
+    const char16_t file[],
+    ClipCallback call,
+    void* user,
+    const char* group) noexcept {
+    if (!call || !PlayAU::StartAsyncLoader(m_pLoader)) return false;
+    const auto req = CAUClipRequest::Create(flag, file, group);
+    if (!req) return false;
+    // 回调模式的请求由加载器持有, 不能作为future使用
+    req->call = call;
+    req->user = user;
+    m_pLoader->Add(req);
+    return true;
+}
+
+/// <summary>
+/// Creates the clip from file asynchronously with future.
+/// </summary>
+/// <param name="flag">The flag.</param>
+/// <param name="file">The file.</param>
+/// <param name="group">The group.</param>
+/// <returns></returns>
+auto PlayAU::CAUEngine::CreateClipFromFileAsync(
+    ClipFlag flag,
+    const char16_t file[],
+    const char* group) noexcept -> ClipFuture {
+    if (!PlayAU::StartAsyncLoader(m_pLoader)) return nullptr;
+    const auto req = CAUClipRequest::Create(flag, file, group);
+    if (req) m_pLoader->Add(req);
+    return req;
+}
+
+/// <summary>
+/// Polls the future.
+/// </summary>
+/// <param name="future">The future.</param>
+/// <param name="clip">The clip.</param>
+/// <returns></returns>
+bool PlayAU::CAUEngine::PollClip(ClipFuture future, Clip& clip) noexcept {
+    clip = nullptr;
+    if (!future || !m_pLoader) return false;
+    {
+        std::lock_guard<std::mutex> locker{ m_pLoader->mutex };
+        if (!m_pLoader->ready.Remove(future)) return false;
+    }
+    clip = PlayAU::CreateClipFromRequest(*this, *future);
+    future->Destroy();
+    return true;
+}
+
+/// <summary>
+/// Cancels the future.
+/// </summary>
+/// <param name="future">The future.</param>
+/// <returns></returns>
+void PlayAU::CAUEngine::CancelClip(ClipFuture future) noexcept {
+    if (!future || !m_pLoader) return;
+    {
+        std::lock_guard<std::mutex> locker{ m_pLoader->mutex };
+        // 正在加载的由工作线程释放
+        if (m_pLoader->loading == future) {
+            future->canceled = true;
+            return;
+        }
+        if (!m_pLoader->pending.Remove(future) && !m_pLoader->ready.Remove(future))
+            return;
+    }
+    future->Destroy();
+}
+
+/// <summary>
+/// Polls the async requests with callback.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUEngine::PollAsync() noexcept -> uint32_t {
+    if (!m_pLoader) return 0;
+    CAUAsyncLoader::List list;
+    {
+        // 一次取走全部完成的请求, 回调中可以提交新的请求
+        std::lock_guard<std::mutex> locker{ m_pLoader->mutex };
+        list = m_pLoader->finished;
+        m_pLoader->finished = CAUAsyncLoader::List{};
+    }
+    uint32_t count = 0;
+    while (const auto req = list.Pop()) {
+        const auto clip = PlayAU::CreateClipFromRequest(*this, *req);
+        req->call(req->user, clip);
+        req->Destroy();
+        ++count;
+    }
+    return count;
+}
@@ -0,0 +1,293 @@
+﻿#include "../inc/au_config.h"
+#include "../inc/au_bank.h"
+#include "../inc/au_engine.h"
+#include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_wave.h"
+
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#ifdef PLAYAU_FLAG_NULL_THISPTR_SAFE
+#define PLAYAU_NULL_RETURN(x) if (!this) return x;
+#else 
+#define PLAYAU_NULL_RETURN(x)
+#endif
+
+namespace PlayAU {
+    // create file stream
+    bool CreateWinFileStream(FileStreamHolder& out, const char16_t file[]) noexcept;
+    // create audio stream from file stream
+    bool CreateAudioStreamFromFileStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) noexcept;
+    // create clip, charged: bytes allocated for the stream before
+    auto CreateClip(CAUEngine&, ClipFlag, AudioStreamHolder&&, const char* group, int64_t charged) noexcept->CAUAudioClip*;
+}
+
+
+/// <summary>
+/// Creates the sound bank from file.
+/// </summary>
+/// <param name="file">The file.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::Create(const char16_t file[]) noexcept -> CAUSoundBank* {
+    MemoryKindScope kind{ Memory_Bank };
+    const auto obj = new(std::nothrow) CAUSoundBank;
+    if (!obj) return nullptr;
+    auto& fs = obj->m_file;
+    // 索引使用32位偏移
+    if (PlayAU::CreateWinFileStream(fs, file) && fs->length <= 0xFFFFFFFFu) {
+        const auto len = static_cast<uint32_t>(fs->length);
+        uint32_t read = 0;
+        // 映射的文件直接使用视图, 否则整个读入内存
+        auto data = fs->Map() ? fs->ViewNext(len, read) : nullptr;
+        if (!data && len) {
+            obj->m_pOwned = PlayAU::Alloc(len);
+            if (obj->m_pOwned && fs->Seek(0, XAUStream::Move_Begin))
+                read = fs->ReadNext(len, obj->m_pOwned);
+            data = obj->m_pOwned;
+            // 已经读入的文件不再需要
+            fs.Reset();
+        }
+        if (data && read == len && obj->load(data, len)) return obj;
+    }
+    obj->Destroy();
+    return nullptr;
+}
+
+/// <summary>
+/// Creates the sound bank from memory.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::CreateFromMemory(const void* data, uint32_t len) noexcept -> CAUSoundBank* {
+    MemoryKindScope kind{ Memory_Bank };
+    const auto obj = new(std::nothrow) CAUSoundBank;
+    if (!obj) return nullptr;
+    if (data && obj->load(data, len)) return obj;
+    obj->Destroy();
+    return nullptr;
+}
+
+/// <summary>
+/// Finalizes an instance of the <see cref="CAUSoundBank"/> class.
+/// </summary>
+/// <returns></returns>
+PlayAU::CAUSoundBank::~CAUSoundBank() noexcept {
+    PlayAU::Free(m_pOwned);
+}
+
+/// <summary>
+/// Destroys this instance, bank data is kept until clips from it destroyed.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoundBank::Destroy() noexcept {
+    PLAYAU_NULL_RETURN(void());
+    this->Release();
+}
+
+/// <summary>
+/// Adds the reference.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoundBank::AddRef() const noexcept {
+    m_cRef.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Releases the reference.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoundBank::Release() const noexcept {
+    const auto old = m_cRef.fetch_sub(1, std::memory_order_acq_rel);
+    assert(old && "bad release");
+    if (old == 1) delete this;
+}
+
+/// <summary>
+/// Loads the index from bank data.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+bool PlayAU::CAUSoundBank::load(const void* data, uint32_t len) noexcept {
+    const auto ptr = static_cast<const uint8_t*>(data);
+    // 索引直接指向数据, 需要对齐
+    if (reinterpret_cast<uintptr_t>(ptr) % alignof(BankEntry)) return false;
+    if (len < BANK_INDEX_OFFSET) return false;
+    const auto header = reinterpret_cast<const BankHeader*>(ptr);
+    if (header->magic != BANK_MAGIC || header->version != BANK_VERSION) return false;
+    const uint64_t index_end = BANK_INDEX_OFFSET + uint64_t(header->count) * sizeof(BankEntry);
+    if (index_end > len) return false;
+    const auto entries = reinterpret_cast<const BankEntry*>(ptr + BANK_INDEX_OFFSET);
+    // 定位表: 与索引平行, 0表示没有
+    const BankSeekIndex* seeks = nullptr;
+    if (header->seek_index) {
+        const auto seek_end = header->seek_index + uint64_t(header->count) * sizeof(BankSeekIndex);
+        if (header->seek_index % alignof(BankSeekIndex) || seek_end > len) return false;
+        seeks = reinterpret_cast<const BankSeekIndex*>(ptr + header->seek_index);
+    }
+    // 检查一次, 之后创建片段不再检查
+    for (uint32_t i = 0; i != header->count; ++i) {
+        const auto& e = entries[i];
+        if (i && entries[i - 1].hash >= e.hash) return false;
+        if (e.offset < index_end || uint64_t(e.offset) + e.length > len) return false;
+        if (e.extra_size > BANK_EXTRA_LENGTH) return false;
+        if (e.tag && (!e.channels || !e.block_align || !e.sample_rate)) return false;
+        if (!seeks || !seeks[i].count) continue;
+        const auto& s = seeks[i];
+        if (s.offset % alignof(BankSeekPoint)) return false;
+        if (s.offset + uint64_t(s.count) * sizeof(BankSeekPoint) > len) return false;
+        // 按帧有序且落在数据内
+        const auto points = reinterpret_cast<const BankSeekPoint*>(ptr + s.offset);
+        for (uint32_t j = 0; j != s.count; ++j) {
+            if (points[j].offset >= e.length) return false;
+            if (j && points[j - 1].frame > points[j].frame) return false;
+        }
+    }
+    m_pData = ptr;
+    m_uLength = len;
+    m_pEntries = entries;
+    m_pSeeks = seeks;
+    m_uCount = header->count;
+    return true;
+}
+
+/// <summary>
+/// Gets the entry count.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::GetCount() const noexcept -> uint32_t {
+    PLAYAU_NULL_RETURN(0);
+    return m_uCount;
+}
+
+/// <summary>
+/// Finds the entry by name.
+/// </summary>
+/// <param name="name">The name.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::Find(const char name[]) const noexcept -> uint32_t {
+    PLAYAU_NULL_RETURN(BANK_INVALID_ID);
+    return this->FindHash(PlayAU::BankHash(name));
+}
+
+/// <summary>
+/// Finds the entry by hash.
+/// </summary>
+/// <param name="hash">The hash.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::FindHash(uint32_t hash) const noexcept -> uint32_t {
+    PLAYAU_NULL_RETURN(BANK_INVALID_ID);
+    // 二分查找
+    uint32_t lo = 0, hi = m_uCount;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const uint32_t value = m_pEntries[mid].hash;
+        if (value == hash) return mid;
+        if (value < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    return BANK_INVALID_ID;
+}
+
+/// <summary>
+/// Gets the entry.
+/// </summary>
+/// <param name="id">The identifier.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::GetEntry(uint32_t id) const noexcept -> const BankEntry* {
+    PLAYAU_NULL_RETURN(nullptr);
+    return id < m_uCount ? m_pEntries + id : nullptr;
+}
+
+/// <summary>
+/// Gets the entry data.
+/// </summary>
+/// <param name="id">The identifier.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::GetData(uint32_t id) const noexcept -> const void* {
+    PLAYAU_NULL_RETURN(nullptr);
+    return id < m_uCount ? m_pData + m_pEntries[id].offset : nullptr;
+}
+
+/// <summary>
+/// Gets the entry seek table.
+/// </summary>
+/// <param name="id">The identifier.</param>
+/// <param name="count">The point count.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoundBank::GetSeekTable(uint32_t id, uint32_t& count) const noexcept -> const BankSeekPoint* {
+    count = 0;
+    PLAYAU_NULL_RETURN(nullptr);
+    if (id >= m_uCount || !m_pSeeks || !m_pSeeks[id].count) return nullptr;
+    count = m_pSeeks[id].count;
+    return reinterpret_cast<const BankSeekPoint*>(m_pData + m_pSeeks[id].offset);
+}
+
+
+/// <summary>
+/// Creates the clip from sound bank entry.
+/// </summary>
+/// <param name="flag">The flag.</param>
+/// <param name="bank">The bank.</param>
+/// <param name="id">The identifier.</param>
+/// <param name="group">The group.</param>
+/// <returns></returns>
+auto PlayAU::CAUEngine::CreateClipFromBank(
+    ClipFlag flag,
+    const CAUSoundBank& bank,
+    uint32_t id,
+    const char*group) noexcept -> Clip {
+    const auto entry = bank.GetEntry(id);
+    if (!entry) return nullptr;
+    FileStreamHolder memstream;
+    // 内存流持有库的引用, 片段释放前库数据一直有效
+    const auto release = [](void* owner) noexcept {
+        static_cast<const CAUSoundBank*>(owner)->Release();
+    };
+    const auto owner = const_cast<CAUSoundBank*>(&bank);
+    if (!PlayAU::CreateSharedMemoryStream(memstream, bank.GetData(id), entry->length, release, owner))
+        return nullptr;
+    bank.AddRef();
+    AudioStreamHolder audiostream;
+    // 解码器缓存等记在片段上
+    std::atomic<int64_t> charged{ 0 };
+    // 编码的文件交给解码器
+    if (!entry->tag) {
+        const auto audiook = [&]() noexcept {
+            MemoryChargeScope charge{ &charged };
+            return PlayAU::CreateAudioStreamFromFileStream(memstream, audiostream, flag);
+        }();
+        if (!audiook) return nullptr;
+        // 索引中的定位表省去解码器的二分查找
+        uint32_t count = 0;
+        const auto table = bank.GetSeekTable(id, count);
+        if (table) audiostream->SetSeekTable(table, count);
+        const auto f = static_cast<ClipFlag>(flag & Flag_Public);
+        return PlayAU::CreateClip(*this, f, std::move(audiostream), group, charged);
+    }
+    // 原始数据: 格式来自索引, 不再解析
+    WaveHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.data_size = entry->length;
+    header.sample_rate = entry->sample_rate;
+    header.fact_samples = entry->frames;
+    header.tag = entry->tag;
+    header.channels = entry->channels;
+    header.block_align = entry->block_align;
+    header.bits_per_sample = entry->bits_per_sample;
+    header.valid_bits = entry->bits_per_sample;
+    header.extra_size = entry->extra_size;
+    static_assert(uint32_t(BANK_EXTRA_LENGTH) <= uint32_t(WAVE_FMT_EXTRA_LENGTH), "overflow");
+    std::memcpy(header.extra, entry->extra, entry->extra_size);
+    const auto audiook = [&]() noexcept {
+        MemoryChargeScope charge{ &charged };
+        return PlayAU::CreateWaveAudioStream(memstream, audiostream, header);
+    }();
+    if (!audiook) return nullptr;
+    // 创建音频片段
+    const auto f = static_cast<ClipFlag>(flag & Flag_Public);
+    return PlayAU::CreateClip(*this, f, std::move(audiostream), group, charged);
+}
@@ -0,0 +1,163 @@
+﻿#include "../inc/au_dsp.h"
+
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+
+namespace PlayAU {
+    // speaker position, wave channel mask order
+    enum Speaker : uint8_t {
+        Speaker_FL = 0, Speaker_FR, Speaker_FC, Speaker_LFE,
+        Speaker_BL, Speaker_BR, Speaker_SL, Speaker_SR, Speaker_BC,
+        SPEAKER_COUNT
+    };
+    // speakers of each channel count, same as default channel mask of wave/flac
+    static const uint8_t CHANNEL_LAYOUT[DSP_MAX_CHANNELS][DSP_MAX_CHANNELS] = {
+        // mono
+        { Speaker_FC },
+        // stereo
+        { Speaker_FL, Speaker_FR },
+        // 3.0
+        { Speaker_FL, Speaker_FR, Speaker_FC },
+        // quad
+        { Speaker_FL, Speaker_FR, Speaker_BL, Speaker_BR },
+        // 5.0
+        { Speaker_FL, Speaker_FR, Speaker_FC, Speaker_BL, Speaker_BR },
+        // 5.1
+        { Speaker_FL, Speaker_FR, Speaker_FC, Speaker_LFE, Speaker_BL, Speaker_BR },
+        // 6.1
+        { Speaker_FL, Speaker_FR, Speaker_FC, Speaker_LFE, Speaker_BC, Speaker_SL, Speaker_SR },
+        // 7.1
+        { Speaker_FL, Speaker_FR, Speaker_FC, Speaker_LFE, Speaker_BL, Speaker_BR, Speaker_SL, Speaker_SR },
+    };
+    // -3dB
+    static const float CHANNEL_MINUS_3DB = 0.70710678f;
+    // standard matrices of all channel pairs, [out - 1][in - 1]
+    static float s_aChannelMatrix[DSP_MAX_CHANNELS][DSP_MAX_CHANNELS][DSP_MAX_CHANNELS * DSP_MAX_CHANNELS];
+    // table init flag
+    static std::once_flag s_oChannelOnce;
+    // route speaker into output layout, missing speaker folds to neighbours at -3dB (itu-r bs.775)
+    static void ChannelRoute(const int8_t* index, uint32_t speaker, float gain, float* gains) noexcept {
+        if (index[speaker] >= 0) { gains[index[speaker]] += gain; return; }
+        switch (speaker)
+        {
+        case Speaker_FC:
+            PlayAU::ChannelRoute(index, Speaker_FL, gain * CHANNEL_MINUS_3DB, gains);
+            PlayAU::ChannelRoute(index, Speaker_FR, gain * CHANNEL_MINUS_3DB, gains);
+            break;
+        case Speaker_FL: case Speaker_FR:
+            PlayAU::ChannelRoute(index, Speaker_FC, gain * CHANNEL_MINUS_3DB, gains);
+            break;
+        case Speaker_BL: case Speaker_SL:
+        {
+            // 后置与侧置互为替代, 都没有才折入前置
+            const uint32_t other = speaker == Speaker_BL ? Speaker_SL : Speaker_BL;
+            if (index[other] >= 0) gains[index[other]] += gain;
+            else PlayAU::ChannelRoute(index, Speaker_FL, gain * CHANNEL_MINUS_3DB, gains);
+            break;
+        }
+        case Speaker_BR: case Speaker_SR:
+        {
+            const uint32_t other = speaker == Speaker_BR ? Speaker_SR : Speaker_BR;
+            if (index[other] >= 0) gains[index[other]] += gain;
+            else PlayAU::ChannelRoute(index, Speaker_FR, gain * CHANNEL_MINUS_3DB, gains);
+            break;
+        }
+        case Speaker_BC:
+            PlayAU::ChannelRoute(index, Speaker_BL, gain * CHANNEL_MINUS_3DB, gains);
+            PlayAU::ChannelRoute(index, Speaker_BR, gain * CHANNEL_MINUS_3DB, gains);
+            break;
+        default:
+            // LFE不参与缩混
+            break;
+        }
+    }
+    // build all standard matrices
+    static void ChannelBuildTable() noexcept {
+        for (uint32_t out = 1; out <= DSP_MAX_CHANNELS; ++out) {
+            int8_t index[SPEAKER_COUNT];
+            std::memset(index, -1, sizeof(index));
+            for (uint32_t d = 0; d != out; ++d) index[CHANNEL_LAYOUT[out - 1][d]] = int8_t(d);
+            for (uint32_t in = 1; in <= DSP_MAX_CHANNELS; ++in) {
+                float* const matrix = s_aChannelMatrix[out - 1][in - 1];
+                for (uint32_t s = 0; s != in; ++s) {
+                    float gains[DSP_MAX_CHANNELS] = { 0.f };
+                    PlayAU::ChannelRoute(index, CHANNEL_LAYOUT[in - 1][s], 1.f, gains);
+                    for (uint32_t d = 0; d != out; ++d) matrix[d * in + s] = gains[d];
+                }
+            }
+        }
+    }
+    // side of output speaker, -1 left, 1 right, 0 center
+    static int ChannelSide(uint32_t out, uint32_t channel) noexcept {
+        switch (CHANNEL_LAYOUT[out - 1][channel])
+        {
+        case Speaker_FL: case Speaker_BL: case Speaker_SL: return -1;
+        case Speaker_FR: case Speaker_BR: case Speaker_SR: return 1;
+        default: return 0;
+        }
+    }
+}
+
+
+/// <summary>
+/// Gets the standard channel matrix.
+/// </summary>
+/// <param name="in">The input channel count.</param>
+/// <param name="out">The output channel count.</param>
+/// <param name="matrix">The matrix, out * in at least.</param>
+/// <returns></returns>
+bool PlayAU::GetChannelMatrix(uint32_t in, uint32_t out, float* matrix) noexcept {
+    if (!in || !out || in > DSP_MAX_CHANNELS || out > DSP_MAX_CHANNELS) return false;
+    std::call_once(s_oChannelOnce, PlayAU::ChannelBuildTable);
+    std::memcpy(matrix, s_aChannelMatrix[out - 1][in - 1], sizeof(float) * in * out);
+    return true;
+}
+
+/// <summary>
+/// Gets the pan matrix.
+/// </summary>
+/// <param name="in">The input channel count.</param>
+/// <param name="out">The output channel count.</param>
+/// <param name="pan">The pan, -1 for left, 1 for right.</param>
+/// <param name="matrix">The matrix, out * in at least.</param>
+/// <returns></returns>
+bool PlayAU::GetPanMatrix(uint32_t in, uint32_t out, float pan, float* matrix) noexcept {
+    pan = pan < -1.f ? -1.f : (pan > 1.f ? 1.f : pan);
+    const float theta = (pan + 1.f) * 0.78539816f;
+    return PlayAU::GetSideMatrix(in, out, std::cos(theta), std::sin(theta), 1.f, matrix);
+}
+
+/// <summary>
+/// Gets the side matrix.
+/// </summary>
+/// <param name="in">The input channel count.</param>
+/// <param name="out">The output channel count.</param>
+/// <param name="left">The left gain, 0.7071 at center.</param>
+/// <param name="right">The right gain, 0.7071 at center.</param>
+/// <param name="center">The center gain.</param>
+/// <param name="matrix">The matrix, out * in at least.</param>
+/// <returns></returns>
+bool PlayAU::GetSideMatrix(uint32_t in, uint32_t out, float left, float right, float center, float* matrix) noexcept {
+    if (!PlayAU::GetChannelMatrix(in, out, matrix)) return false;
+    if (out == 1) {
+        for (uint32_t s = 0; s != in; ++s) matrix[s] *= center;
+        return true;
+    }
+    // 单声道只送往前置左右, 正中时各-3dB
+    if (in == 1) {
+        std::memset(matrix, 0, sizeof(float) * out);
+        matrix[0] = left;
+        matrix[1] = right;
+        return true;
+    }
+    // 多声道按左右两侧整体平衡, 正中时不变, 偏向一侧时只衰减另一侧不增益
+    const float side_l = left * 1.41421356f, side_r = right * 1.41421356f;
+    const float gain[3] = { side_l < 1.f ? side_l : 1.f, center, side_r < 1.f ? side_r : 1.f };
+    for (uint32_t d = 0; d != out; ++d) {
+        const float g = gain[PlayAU::ChannelSide(out, d) + 1];
+        for (uint32_t s = 0; s != in; ++s) matrix[d * in + s] *= g;
+    }
+    return true;
+}
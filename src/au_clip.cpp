@@ -1,6 +1,8 @@
 ﻿#include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
 #include "../inc/au_clip.h"
 #include "../inc/au_engine.h"
+#include "../inc/au_dsp.h"
 #include <cassert>
 #include <cstring>
 #include <utility>
@@ -36,6 +38,10 @@ struct PlayAU::CAUEngine::Private {
         node.prev->next = node.next;
         node.next->prev = node.prev;
     }
+    // get spatializer
+    static auto&Spatial(CAUEngine& engine) noexcept {
+        return engine.m_pSpatial;
+    }
 };
 
 
@@ -49,11 +55,15 @@ struct PlayAU::CAUAudioClip::Private {
     }
     // get audio stream
     static auto AS(const CAUAudioClip& clip) noexcept {
-        return reinterpret_cast<const XAUAudioStream*>(clip.m_asbuffer);
+        return static_cast<const XAUAudioStream*>(clip.m_stream.Get());
     }
     // get audio stream
     static auto AS(CAUAudioClip& clip) noexcept {
-        return reinterpret_cast<XAUAudioStream*>(clip.m_asbuffer);
+        return clip.m_stream.Get();
+    }
+    // get memory counter
+    static auto&Memory(CAUAudioClip& clip) noexcept {
+        return clip.m_memory;
     }
     // from node
     static auto FromNode(Node& node) noexcept {
@@ -74,15 +84,13 @@ struct PlayAU::CAUAudioClip::Private {
 PlayAU::CAUAudioClip::CAUAudioClip(
     CAUEngine& engine, 
     ClipFlag flag,
-    XAUAudioStream&& stream,
+    AudioStreamHolder&& stream,
     CAUAudioGroup* group0
-) noexcept : m_engine(engine), m_flags(flag), group(group0) {
+) noexcept : m_flags(flag), group(group0), m_engine(engine), m_stream(std::move(stream)) {
     constexpr size_t offset_ctx = offsetof(CAUAudioClip, m_context);
     static_assert(offset_ctx == 0, "must be 0");
     // 添加
     CAUEngine::Private::AddClip(engine, m_node);
-    // 移动数据
-    if (&stream) stream.MoveTo(m_asbuffer);
 }
 
 /// <summary>
@@ -92,28 +100,44 @@ PlayAU::CAUAudioClip::CAUAudioClip(
 PlayAU::CAUAudioClip::~CAUAudioClip() noexcept {
     // 释放节点
     CAUEngine::Private::RemoveClip(m_engine, m_node);
+    // 释放发声体
+    if (m_emitter != SPATIAL_NO_EMITTER)
+        CAUEngine::Private::Spatial(m_engine)->RemoveEmitter(m_emitter);
     // 释放上下文环境
     const auto api = CAUEngine::Private::API(m_engine);
     api->DisposeClipCtx(m_context);
-    // 释放音频流
-    if (!(m_flags & Flag_p_Live))
-        Private::AS(*this)->Dispose();
+    // 音频流由m_stream释放
 }
 
 namespace PlayAU {
+    /// <summary>
+    /// live audio stream, only carries format, buffers are submitted by user
+    /// </summary>
+    /// <seealso cref="XAUAudioStream" />
+    struct CAULiveAudioStream final : XAUAudioStream {
+        // ctor
+        CAULiveAudioStream(const WaveFormat& fmt) noexcept {
+            this->length = 0; this->offset = 0; this->format = fmt; }
+        // dispose
+        void Dispose() noexcept override { }
+        // seek stream in byte, return current position
+        bool Seek(int64_t, Move) noexcept override { return false; }
+        // read stream, return byte count read
+        auto ReadNext(uint32_t, void*) noexcept->uint32_t override { return 0; }
+    };
     // create file stream
-    bool CreateWinFileStream(void* buf, const char16_t file[]) noexcept;
-    // create ogg audio stream
-    bool CreateOggAudioStream(XAUStream& file, void*buf) noexcept;
-    // create flac audio stream
-    bool CreateFlacAudioStream(XAUStream& file, void*buf) noexcept;
-    // create clip
+    bool CreateWinFileStream(FileStreamHolder& out, const char16_t file[]) noexcept;
+    // create audio stream via registered codecs
+    bool CreateAudioStreamFromFileStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) noexcept;
+    // create spatializer if not created
+    bool StartSpatializer(CAUSpatializer*& spatial) noexcept;
+    // create clip, charged: bytes allocated for the stream before
     auto CreateClip(
         CAUEngine&, 
         ClipFlag, 
-        XAUAudioStream&&, 
-        const WaveFormat* fmt,
-        const char* group
+        AudioStreamHolder&&, 
+        const char* group,
+        int64_t charged
     ) noexcept->CAUAudioClip*;
     /// <summary>
     /// Disposes the clip via.
@@ -131,13 +155,15 @@ namespace PlayAU {
 /// <param name="engine">The engine.</param>
 /// <param name="flags">The flags.</param>
 /// <param name="stream">The stream.</param>
+/// <param name="group">The group.</param>
+/// <param name="charged">The charged.</param>
 /// <returns></returns>
 auto PlayAU::CreateClip(
     CAUEngine& engine, 
     ClipFlag flags, 
-    XAUAudioStream&& stream,
-    const WaveFormat* fmt,
-    const char* group
+    AudioStreamHolder&& stream,
+    const char* group,
+    int64_t charged
 ) noexcept -> CAUAudioClip* {
     // 获取分组
     const auto group_obj = [&engine, group]() noexcept {
@@ -146,20 +172,26 @@ auto PlayAU::CreateClip(
         return engine.CreateEmptyGroup(group);
     }();
     // 创建对象
-    const auto obj = new(std::nothrow) CAUAudioClip{ 
-        engine, 
-        flags, 
-        std::move(stream),
-        group_obj
-    };
+    std::atomic<int64_t> objlen{ 0 };
+    const auto obj = [&]() noexcept {
+        MemoryKindScope kind{ Memory_Clip };
+        MemoryChargeScope charge{ &objlen };
+        return new(std::nothrow) CAUAudioClip{
+            engine,
+            flags,
+            std::move(stream),
+            group_obj
+        };
+    }();
     //alignas(CAUAudioClip) static char buf[sizeof(CAUAudioClip)];
     if (!obj) return nullptr;
-
-    // 提供了格式
-    if (fmt) CAUAudioClip::Private::AS(*obj)->format = *fmt;
+    CAUAudioClip::Private::Memory(*obj).store(charged + objlen, std::memory_order_relaxed);
     // 创建上下文环境
     const auto api = CAUEngine::Private::API(engine);
-    const auto ctxok = api->MakeClipCtx(CAUAudioClip::Private::Ctx(*obj));
+    const auto ctxok = [obj, api]() noexcept {
+        MemoryChargeScope charge{ &CAUAudioClip::Private::Memory(*obj) };
+        return api->MakeClipCtx(CAUAudioClip::Private::Ctx(*obj));
+    }();
     if (ctxok) return obj;
 #ifndef NDEBUG
     std::printf("Make clip context: failed\n");
@@ -169,44 +201,6 @@ auto PlayAU::CreateClip(
 }
 
 
-namespace PlayAU {
-    /// <summary>
-    /// Creates the audio stream from file stream.
-    /// </summary>
-    /// <param name="file">The file.</param>
-    /// <param name="buf">The buf.</param>
-    bool CreateAudioStreamFromFileStream(XAUStream& file, void* asbuf) {
-        alignas(uint32_t) char buf[AUDIO_HEADER_PEEK_LENGTH]; std::memset(buf, 0, sizeof(buf));
-        // 先读取一定字节
-        file.ReadNext(AUDIO_HEADER_PEEK_LENGTH, buf);
-        file.Seek(0, XAUStream::Move_Begin);
-        // 最开始4字节
-        const auto bufh = reinterpret_cast<uint32_t*>(buf)[0];
-        // OGG
-        const auto ogg_header = []() noexcept ->uint32_t {
-            union { char buf[4]; uint32_t u32; } tmp;
-            tmp.buf[0] = 'O'; tmp.buf[1] = 'g'; tmp.buf[2] = 'g'; tmp.buf[3] = 'S';
-            return tmp.u32;
-        }();
-        // OGG
-        const auto flac_header = []() noexcept ->uint32_t {
-            union { char buf[4]; uint32_t u32; } tmp;
-            tmp.buf[0] = 'f'; tmp.buf[1] = 'L'; tmp.buf[2] = 'a'; tmp.buf[3] = 'C';
-            return tmp.u32;
-        }();
-        // 分类讨论
-        if (bufh == ogg_header) {
-            return PlayAU::CreateOggAudioStream(file, asbuf);
-        }
-#ifdef PLAYAU_FLAG_FLAC_SUPPORT
-        else if (bufh == flac_header) {
-            return PlayAU::CreateFlacAudioStream(file, asbuf);
-        }
-#endif
-        return false;
-    }
-}
-
 /// <summary>
 /// Creates the clip from file.
 /// </summary>
@@ -218,20 +212,34 @@ auto PlayAU::CAUEngine::CreateClipFromFile(
     ClipFlag flag, 
     const char16_t file[], 
     const char*group) noexcept -> Clip {
-    alignas(void*) char asbuf[AUDIO_STREAM_BUFLEN];
-    const auto fsbuf = reinterpret_cast<XAUAudioStream*>(asbuf)->fsbuffer;
+    FileStreamHolder filestream;
     // 创建文件流
-    const auto fileok = PlayAU::CreateWinFileStream(fsbuf, file);
+    const auto fileok = PlayAU::CreateWinFileStream(filestream, file);
     // 文件? 不存在
     if (!fileok) return nullptr;
-    XAUStream& filestream = *(reinterpret_cast<XAUStream*>(fsbuf));
-    // 利用文件流创建音频流
-    const auto audiook = PlayAU::CreateAudioStreamFromFileStream(filestream, asbuf);
-    // 音频? 不存在
-    if (!audiook) return nullptr;
-    XAUAudioStream& audiostream = *(reinterpret_cast<XAUAudioStream*>(asbuf));
     // 创建音频片段
-    return this->CreateClipFromAudio(flag, std::move(audiostream), group);
+    return this->CreateClipFromStream(flag, std::move(filestream), group);
+}
+
+
+/// <summary>
+/// Creates the clip from memory.
+/// </summary>
+/// <param name="flag">The flag.</param>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <param name="group">The group.</param>
+/// <returns></returns>
+auto PlayAU::CAUEngine::CreateClipFromMemory(
+    ClipFlag flag,
+    const void* data,
+    uint32_t len,
+    const char*group) noexcept -> Clip {
+    FileStreamHolder memstream;
+    // 创建内存流
+    if (!PlayAU::CreateMemoryStream(memstream, data, len)) return nullptr;
+    // 创建音频片段
+    return this->CreateClipFromStream(flag, std::move(memstream), group);
 }
 
 
@@ -244,20 +252,23 @@ auto PlayAU::CAUEngine::CreateClipFromFile(
 /// <returns></returns>
 auto PlayAU::CAUEngine::CreateClipFromStream(
     ClipFlag flag, 
-    XAUStream& stream, 
+    FileStreamHolder&& stream, 
     const char*group) noexcept -> Clip {
-    alignas(void*) char asbuf[AUDIO_STREAM_BUFLEN];
-    const auto fsbuf = reinterpret_cast<XAUAudioStream*>(asbuf)->fsbuffer;
-    // 移动文件流
-    stream.MoveTo(fsbuf);
-    XAUStream& filestream = *(reinterpret_cast<XAUStream*>(fsbuf));
-    // 利用文件流创建音频流
-    const auto audiook = PlayAU::CreateAudioStreamFromFileStream(filestream, asbuf);
+    // 失败时文件流随局部对象释放
+    FileStreamHolder filestream{ std::move(stream) };
+    if (!filestream) return nullptr;
+    AudioStreamHolder audiostream;
+    // 利用文件流创建音频流, 期间申请的内存(解码器状态等)记在片段上
+    std::atomic<int64_t> charged{ 0 };
+    const auto audiook = [&]() noexcept {
+        MemoryChargeScope charge{ &charged };
+        return PlayAU::CreateAudioStreamFromFileStream(filestream, audiostream, flag);
+    }();
     // 音频? 不存在
     if (!audiook) return nullptr;
-    XAUAudioStream& audiostream = *(reinterpret_cast<XAUAudioStream*>(asbuf));
     // 创建音频片段
-    return this->CreateClipFromAudio(flag, std::move(audiostream), group);
+    const auto f = static_cast<ClipFlag>(flag & Flag_Public);
+    return CreateClip(*this, f, std::move(audiostream), group, charged);
 }
 
 /// <summary>
@@ -269,11 +280,12 @@ auto PlayAU::CAUEngine::CreateClipFromStream(
 /// <returns></returns>
 auto PlayAU::CAUEngine::CreateClipFromAudio(
     ClipFlag flag, 
-    XAUAudioStream&& stream, 
+    AudioStreamHolder&& stream, 
     const char*group) noexcept -> Clip {
+    if (!stream) return nullptr;
     // 去掉私有标志位
     const auto f = static_cast<ClipFlag>(flag & Flag_Public);
-    return CreateClip(*this, f, std::move(stream), nullptr, group);
+    return CreateClip(*this, f, std::move(stream), group, 0);
 }
 
 /// <summary>
@@ -285,8 +297,26 @@ auto PlayAU::CAUEngine::CreateClipFromAudio(
 auto PlayAU::CAUEngine::CreateLiveClip(
     const WaveFormat& fmt, 
     const char* group) noexcept ->Clip {
-    XAUAudioStream* stream = nullptr;
-    return CreateClip(*this, Flag_p_Live, std::move(*stream), &fmt, group);
+    AudioStreamHolder stream;
+    if (!stream.Emplace<CAULiveAudioStream>(fmt)) return nullptr;
+    return CreateClip(*this, Flag_p_Live, std::move(stream), group, 0);
+}
+
+
+/// <summary>
+/// Gets the bytes held by clips in group.
+/// </summary>
+/// <param name="group">The group.</param>
+/// <returns></returns>
+auto PlayAU::CAUEngine::GetGroupMemory(const CAUAudioGroup* group) noexcept -> int64_t {
+    int64_t sum = 0;
+    // 遍历片段链表, 与创建/销毁片段在同一线程调用
+    for (auto node = m_head.next; node != &m_tail; node = node->next) {
+        const auto clip = CAUAudioClip::Private::FromNode(*node);
+        if (group && clip->group != group) continue;
+        sum += clip->GetMemory();
+    }
+    return sum;
 }
 
 
@@ -355,7 +385,7 @@ void PlayAU::CAUAudioClip::Seek(double pos) noexcept {
     const auto stream = Private::AS(*this);
     const double spsec = stream->format.samples_per_sec;
     const auto pos_in_sample 
-        = static_cast<uint32_t>(pos * spsec)
+        = static_cast<uint64_t>(pos * spsec)
         * (stream->format.bits_per_sample >> 3)
         * stream->format.channels
         ;
@@ -402,6 +432,10 @@ void PlayAU::CAUAudioClip::SetVolume(float v) noexcept {
 void PlayAU::CAUAudioClip::SetFrequencyRatio(float f) noexcept {
     PLAYAU_NULL_RETURN((void)0);
     const auto api = CAUEngine::Private::API(m_engine);
+    m_ratio = f;
+    // 3d片段保留上次更新的多普勒
+    if (m_emitter != SPATIAL_NO_EMITTER)
+        f = PlayAU::ClipClampRatio(f * CAUEngine::Private::Spatial(m_engine)->GetDoppler(m_emitter));
     api->RatioClip(m_context, &f);
 }
 
@@ -427,6 +461,85 @@ auto PlayAU::CAUAudioClip::GetFrequencyRatio() const noexcept ->float {
     return api->RatioClip(ctx, nullptr);
 }
 
+/// <summary>
+/// Gets the channel count.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUAudioClip::GetChannels() const noexcept -> uint32_t {
+    PLAYAU_NULL_RETURN(0);
+    return Private::AS(*this)->format.channels;
+}
+
+/// <summary>
+/// Sets the output matrix.
+/// </summary>
+/// <param name="matrix">The matrix, nullptr for standard one.</param>
+/// <returns></returns>
+bool PlayAU::CAUAudioClip::SetOutputMatrix(const float* matrix) noexcept {
+    PLAYAU_NULL_RETURN(false);
+    const auto api = CAUEngine::Private::API(m_engine);
+    return api->MatrixClip(m_context, matrix);
+}
+
+/// <summary>
+/// Sets the pan.
+/// </summary>
+/// <param name="pan">The pan, -1 for left, 1 for right.</param>
+/// <returns></returns>
+bool PlayAU::CAUAudioClip::SetPan(float pan) noexcept {
+    PLAYAU_NULL_RETURN(false);
+    const auto api = CAUEngine::Private::API(m_engine);
+    float matrix[DSP_MAX_CHANNELS * DSP_MAX_CHANNELS];
+    const uint32_t in = Private::AS(*this)->format.channels;
+    if (!PlayAU::GetPanMatrix(in, api->OutputChannels(), pan, matrix)) return false;
+    return api->MatrixClip(m_context, matrix);
+}
+
+/// <summary>
+/// Sets the 3d emitter.
+/// </summary>
+/// <param name="emitter">The emitter, nullptr for 2d.</param>
+/// <returns></returns>
+bool PlayAU::CAUAudioClip::SetEmitter(const AudioEmitter* emitter) noexcept {
+    PLAYAU_NULL_RETURN(false);
+    auto& spatial = CAUEngine::Private::Spatial(m_engine);
+    // 回到2d: 标准矩阵与用户的频率比
+    if (!emitter) {
+        if (m_emitter == SPATIAL_NO_EMITTER) return true;
+        spatial->RemoveEmitter(m_emitter);
+        m_emitter = SPATIAL_NO_EMITTER;
+        this->SetFrequencyRatio(m_ratio);
+        return this->SetOutputMatrix(nullptr);
+    }
+    if (m_emitter != SPATIAL_NO_EMITTER) {
+        spatial->SetEmitter(m_emitter, *emitter);
+        return true;
+    }
+    if (!PlayAU::StartSpatializer(spatial)) return false;
+    m_emitter = spatial->AddEmitter(*emitter, this);
+    return m_emitter != SPATIAL_NO_EMITTER;
+}
+
+/// <summary>
+/// Gets the stats snapshot.
+/// </summary>
+/// <param name="stats">The stats.</param>
+/// <returns></returns>
+void PlayAU::CAUAudioClip::GetStats(ClipStats& stats) const noexcept {
+    std::memset(&stats, 0, sizeof(stats));
+    PLAYAU_NULL_RETURN((void)0);
+    m_stats.Snapshot(stats);
+}
+
+/// <summary>
+/// Gets the bytes held by this clip.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUAudioClip::GetMemory() const noexcept -> int64_t {
+    PLAYAU_NULL_RETURN(0);
+    return m_memory.load(std::memory_order_relaxed);
+}
+
 
 /// <summary>
 /// Gets the live buffer left.
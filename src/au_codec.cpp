@@ -0,0 +1,102 @@
+﻿#include "../inc/au_config.h"
+#include "../inc/au_codec.h"
+#include "private/p_au_engine_interface.h"
+
+#include <cstring>
+
+
+namespace PlayAU {
+    // create ogg audio stream
+    bool CreateOggAudioStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag) noexcept;
+    // create flac audio stream
+    bool CreateFlacAudioStream(FileStreamHolder& file, AudioStreamHolder& out) noexcept;
+    // create wave audio stream
+    bool CreateWaveAudioStream(FileStreamHolder& file, AudioStreamHolder& out) noexcept;
+    // ogg: "OggS"
+    static bool ProbeOgg(const uint8_t head[], uint32_t len) {
+        return len >= 4 && !std::memcmp(head, "OggS", 4);
+    }
+    // ogg
+    static bool CreateOgg(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) {
+        return PlayAU::CreateOggAudioStream(file, out, flag);
+    }
+#ifdef PLAYAU_FLAG_FLAC_SUPPORT
+    // flac: "fLaC" + STREAMINFO block header
+    static bool ProbeFlac(const uint8_t head[], uint32_t len) {
+        return len >= 5 && !std::memcmp(head, "fLaC", 4) && (head[4] & 0x7f) == 0;
+    }
+    // flac
+    static bool CreateFlac(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag) {
+        return PlayAU::CreateFlacAudioStream(file, out);
+    }
+#endif
+    // wave: "RIFF"/"RF64" + length + "WAVE"
+    static bool ProbeWave(const uint8_t head[], uint32_t len) {
+        if (len < 12 || std::memcmp(head + 8, "WAVE", 4)) return false;
+        return !std::memcmp(head, "RIFF", 4) || !std::memcmp(head, "RF64", 4);
+    }
+    // wave
+    static bool CreateWave(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag) {
+        return PlayAU::CreateWaveAudioStream(file, out);
+    }
+    // registered codecs, sorted by priority, null-terminated
+    static AudioCodec s_codecs[MAX_CODEC_COUNT] = {
+        { "ogg", PlayAU::ProbeOgg, PlayAU::CreateOgg, Priority_Builtin },
+#ifdef PLAYAU_FLAG_FLAC_SUPPORT
+        { "flac", PlayAU::ProbeFlac, PlayAU::CreateFlac, Priority_Builtin },
+#endif
+        { "wave", PlayAU::ProbeWave, PlayAU::CreateWave, Priority_Builtin },
+    };
+    /// <summary>
+    /// Creates the audio stream from file stream via registered codecs.
+    /// </summary>
+    /// <param name="file">The file.</param>
+    /// <param name="out">The out.</param>
+    /// <param name="flag">The flag.</param>
+    /// <returns></returns>
+    bool CreateAudioStreamFromFileStream(FileStreamHolder& file, AudioStreamHolder& out, ClipFlag flag) noexcept {
+        // 所有探测共享一次读取: 映射的文件直接查看
+        alignas(void*) uint8_t buf[AUDIO_HEADER_PEEK_LENGTH];
+        uint32_t len = 0;
+        auto head = static_cast<const uint8_t*>(file->ViewNext(AUDIO_HEADER_PEEK_LENGTH, len));
+        if (!head) {
+            len = file->ReadNext(AUDIO_HEADER_PEEK_LENGTH, buf);
+            head = buf;
+        }
+        if (!file->Seek(0, XAUStream::Move_Begin)) return false;
+        for (const auto& codec : s_codecs) {
+            if (!codec.probe) break;
+            if (!codec.probe(head, len)) continue;
+            if (codec.create(file, out, flag)) return true;
+            // 创建失败则尝试下一个匹配的解码器
+            if (!file || !file->Seek(0, XAUStream::Move_Begin)) break;
+        }
+        return false;
+    }
+}
+
+
+/// <summary>
+/// Registers the codec.
+/// </summary>
+/// <param name="codec">The codec.</param>
+/// <returns></returns>
+auto PlayAU::RegisterCodec(const AudioCodec& codec) noexcept -> Result {
+    if (!codec.name || !codec.probe || !codec.create) return { Result::RE_INVALIDARG };
+    uint32_t count = 0;
+    while (count != MAX_CODEC_COUNT && s_codecs[count].probe) ++count;
+    // 同名的解码器替换掉
+    for (uint32_t i = 0; i != count; ++i) {
+        if (std::strcmp(s_codecs[i].name, codec.name)) continue;
+        std::memmove(s_codecs + i, s_codecs + i + 1, (count - i - 1) * sizeof(AudioCodec));
+        s_codecs[--count] = AudioCodec{};
+        break;
+    }
+    if (count == MAX_CODEC_COUNT) return { Result::RE_OUTOFMEMORY };
+    // 同优先级的按注册顺序
+    uint32_t pos = 0;
+    while (pos != count && s_codecs[pos].priority >= codec.priority) ++pos;
+    std::memmove(s_codecs + pos + 1, s_codecs + pos, (count - pos) * sizeof(AudioCodec));
+    s_codecs[pos] = codec;
+    return { Result::RS_OK };
+}
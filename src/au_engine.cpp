@@ -2,19 +2,30 @@
 #include "../inc/au_clip.h"
 #include "../inc/au_group.h"
 #include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_trace.h"
 
 #include <cwchar>
 #include <cstring>
+#include <atomic>
 
 namespace PlayAU {
     // dispose groups
     void DisposeGroups(CAUEngine&) noexcept;
     // dispose clip via node
     void DisposeClipVia(Node&) noexcept;
+    // clear idle objects in ogg decoder pool
+    void ClearOggDecoderPool() noexcept;
+    // stop worker and release async requests
+    void DisposeAsyncLoader(CAUAsyncLoader*) noexcept;
+    // create spatializer if not created
+    bool StartSpatializer(CAUSpatializer*& spatial) noexcept;
     // XAudio 2.7
     auto InitInterfaceXAudio2_7(void* buf, IAUConfigure& config) noexcept->Result;
     // XAudio 2.8
     auto InitInterfaceXAudio2_8(void* buf, IAUConfigure& config) noexcept->Result;
+    // installed allocator for new blocks, nullptr for c runtime heap
+    static std::atomic<IAUConfigure*> s_pAllocator{ nullptr };
     // default config
     struct CAUDefConfig final : IAUConfigure {
         // pick the device
@@ -84,6 +95,8 @@ struct PlayAU::CAUEngine::Private {
 auto PlayAU::CAUEngine::Initialize(
     IAUConfigure* config, 
     APILevel level) noexcept -> Result {
+    // 默认配置随引擎销毁, 不作为全局分配器
+    const bool custom = config != nullptr;
     // 采用默认配置
     if (!config) {
         config = new(m_defcfg) CAUDefConfig;
@@ -93,6 +106,11 @@ auto PlayAU::CAUEngine::Initialize(
     m_level = level;
     // 获取
     Result hr = Private::InitAPI(*this, m_level);
+    // 第一个引擎的自定义配置作为全局分配器, 已有的内存块仍由各自的分配器释放
+    if (hr && custom) {
+        IAUConfigure* none = nullptr;
+        s_pAllocator.compare_exchange_strong(none, config, std::memory_order_acq_rel);
+    }
     // 尝试利用
     return hr;
 }
@@ -102,11 +120,24 @@ auto PlayAU::CAUEngine::Initialize(
 /// </summary>
 /// <returns></returns>
 void PlayAU::CAUEngine::Uninitialize() noexcept {
+    // 停止异步加载, 未完成的请求被取消
+    PlayAU::DisposeAsyncLoader(m_pLoader);
+    m_pLoader = nullptr;
     // 释放未释放片段
     while (m_head.next != &m_tail)
         PlayAU::DisposeClipVia(*m_head.next);
+    // 片段释放时会移除发声体
+    delete m_pSpatial;
+    m_pSpatial = nullptr;
     // 释放所有分组
     PlayAU::DisposeGroups(*this);
+    // 释放解码器池中的空闲对象
+    PlayAU::ClearOggDecoderPool();
+    // 释放跟踪事件, 应在此之前导出
+    PlayAU::ReleaseTrace();
+    // 卸载分配器, 之后的新内存块来自运行库堆
+    auto config = m_pConfig;
+    s_pAllocator.compare_exchange_strong(config, nullptr, std::memory_order_acq_rel);
 }
 
 /// <summary>
@@ -140,6 +171,62 @@ void PlayAU::CAUEngine::CallContext(void* ctx1, void* ctx2) noexcept {
 }
 
 
+/// <summary>
+/// Gets the stats snapshot.
+/// </summary>
+/// <param name="stats">The stats.</param>
+/// <returns></returns>
+void PlayAU::CAUEngine::GetStats(EngineStats& stats) const noexcept {
+    m_stats.Snapshot(stats);
+}
+
+/// <summary>
+/// Gets the output channel count.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUEngine::GetOutputChannels() const noexcept -> uint32_t {
+    const auto buffer = const_cast<uintptr_t*>(m_buffer);
+    const auto api = reinterpret_cast<IAUAudioAPI*>(buffer);
+    return api->OutputChannels();
+}
+
+/// <summary>
+/// Sets the listener.
+/// </summary>
+/// <param name="listener">The listener.</param>
+/// <returns></returns>
+bool PlayAU::CAUEngine::SetListener(const AudioListener& listener) noexcept {
+    if (!PlayAU::StartSpatializer(m_pSpatial)) return false;
+    m_pSpatial->SetListener(listener);
+    return true;
+}
+
+/// <summary>
+/// Updates 3d clips.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUEngine::Update3D() noexcept {
+    const auto spatial = m_pSpatial;
+    if (!spatial) return;
+    PLAYAU_TRACE_SCOPE("Update3D");
+    // 批量计算全部发声体, 再逐个写入后端
+    spatial->Update();
+    const auto api = reinterpret_cast<IAUAudioAPI*>(m_buffer);
+    const uint32_t out = api->OutputChannels();
+    float matrix[DSP_MAX_CHANNELS * DSP_MAX_CHANNELS];
+    const uint32_t end = spatial->GetEnd();
+    for (uint32_t id = 0; id != end; ++id) {
+        const auto clip = static_cast<CAUAudioClip*>(spatial->GetUser(id));
+        if (!clip) continue;
+        const uint32_t in = clip->GetChannels();
+        if (spatial->GetMatrix(id, in, out, matrix)) api->MatrixClip(clip->m_context, matrix);
+        // 多普勒叠加后可能超出声部的最大频率比
+        float ratio = PlayAU::ClipClampRatio(clip->m_ratio * spatial->GetDoppler(id));
+        api->RatioClip(clip->m_context, &ratio);
+    }
+}
+
+
 /// <summary>
 /// Initializes a new instance of the <see cref="CAUEngine"/> class.
 /// </summary>
@@ -160,3 +247,70 @@ PlayAU::CAUEngine::~CAUEngine() noexcept {
 
 }
 
+
+/// <summary>
+/// Allocates memory via the installed allocator.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+void* PlayAU::Alloc(size_t len) noexcept {
+    if (len > SIZE_MAX - MEMORY_HEADER_LENGTH) return nullptr;
+    const auto allocator = s_pAllocator.load(std::memory_order_acquire);
+    const auto all = len + MEMORY_HEADER_LENGTH;
+    // 头部记录长度/种类用于统计, 记录分配器用于释放
+    const auto base = allocator ? allocator->Alloc(all) : std::malloc(all);
+    return PlayAU::MemoryAttach(base, len, allocator);
+}
+
+/// <summary>
+/// Reallocates memory via the allocator owning it.
+/// </summary>
+/// <param name="ptr">The PTR.</param>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+void* PlayAU::Realloc(void* ptr, size_t len) noexcept {
+    if (!ptr) return PlayAU::Alloc(len);
+    if (len > SIZE_MAX - MEMORY_HEADER_LENGTH) return nullptr;
+    const auto allocator = PlayAU::MemoryOwner(ptr);
+    const auto all = len + MEMORY_HEADER_LENGTH;
+    // 头部随数据一起被复制, 失败时原内存保持不变
+    const auto base = PlayAU::MemoryBase(ptr);
+    const auto now = allocator ? allocator->Realloc(base, all) : std::realloc(base, all);
+    return now ? PlayAU::MemoryResize(now, len) : nullptr;
+}
+
+/// <summary>
+/// Frees memory via the allocator owning it.
+/// </summary>
+/// <param name="ptr">The PTR.</param>
+/// <returns></returns>
+void PlayAU::Free(void* ptr) noexcept {
+    if (!ptr) return;
+    const auto allocator = PlayAU::MemoryOwner(ptr);
+    const auto base = PlayAU::MemoryDetach(ptr);
+    if (allocator) allocator->Free(base);
+    else std::free(base);
+}
+
+// codec allocator, see os_types.h
+extern "C" {
+    // malloc
+    void* playau_codec_malloc(size_t len) noexcept {
+        return PlayAU::Alloc(len);
+    }
+    // calloc
+    void* playau_codec_calloc(size_t count, size_t len) noexcept {
+        if (len && count > SIZE_MAX / len) return nullptr;
+        const auto ptr = PlayAU::Alloc(count * len);
+        if (ptr) std::memset(ptr, 0, count * len);
+        return ptr;
+    }
+    // realloc
+    void* playau_codec_realloc(void* ptr, size_t len) noexcept {
+        return PlayAU::Realloc(ptr, len);
+    }
+    // free
+    void playau_codec_free(void* ptr) noexcept {
+        PlayAU::Free(ptr);
+    }
+}
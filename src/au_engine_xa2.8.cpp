@@ -4,6 +4,9 @@
 #include <Windows.h>
 #include "private/p_XAudio2_8.h"
 #include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_stats.h"
+#include "private/p_au_trace.h"
 
 #include <cassert>
 #include <cstring>
@@ -54,12 +57,14 @@ namespace PlayAU {
         void Resume() noexcept override;
         // call context
         void CallContext(void* ctx1, void* ctx2) noexcept override;
+        // output channel count
+        auto OutputChannels() noexcept -> uint32_t override;
         // make clip context
         bool MakeClipCtx(void*) noexcept override;
         // dispose clip context
         void DisposeClipCtx(void*) noexcept override;
         // tell clip context
-        auto TellClip(const void*) noexcept ->uint32_t override;
+        auto TellClip(const void*) noexcept ->uint64_t override;
         // play clip
         void PlayClip(void*) noexcept override;
         // pause clip context
@@ -67,11 +72,13 @@ namespace PlayAU {
         // stop clip
         void StopClip(void*) noexcept override;
         // seek clip in byte
-        void SeekClip(void*, uint32_t) noexcept override;
+        void SeekClip(void*, uint64_t) noexcept override;
         // ratio clip context
         auto RatioClip(void*, float*) noexcept -> float override;
         // volume clip context
         auto VolumeClip(void*, float*) noexcept -> float override;
+        // output matrix clip context
+        bool MatrixClip(void*, const float*) noexcept override;
         // live: buffer left
         auto LiveClipBuffer(void*) noexcept->uint32_t override;
         // live: buffer submit
@@ -9,7 +9,7 @@ namespace PlayAU {
             return clip.m_engine; }
         // get audio stream
         static auto AudioStream(CAUAudioClip& clip) noexcept {
-            return reinterpret_cast<XAUAudioStream*>(clip.m_asbuffer); }
+            return clip.m_stream.Get(); }
         // get playing
         static bool&Playing(CAUAudioClip& clip) noexcept {
             return clip.m_playing; }
@@ -19,15 +19,49 @@ namespace PlayAU {
         // get flag
         static auto Flag(const CAUAudioClip& clip) noexcept {
             return clip.m_flags; }
+        // get stats
+        static auto&Stats(CAUAudioClip& clip) noexcept {
+            return clip.m_stats; }
+        // get memory counter
+        static auto&Memory(CAUAudioClip& clip) noexcept {
+            return clip.m_memory; }
     };
 }
 
+/// <summary>
+/// private intercace for CAUEngine
+/// </summary>
+struct PlayAU::CAUEngine::Private {
+    // get api
+    static auto API(CAUEngine& engine) noexcept {
+        return reinterpret_cast<IAUAudioAPI*>(engine.m_buffer);
+    }
+    // get engine from api
+    static auto FromAPI(IAUAudioAPI& api) noexcept {
+        const auto addr = reinterpret_cast<char*>(&api);
+        const size_t offset = offsetof(CAUEngine, m_buffer);
+        const auto obj = reinterpret_cast<CAUEngine*>(addr - offset);
+        assert(API(*obj) == &api);
+        return obj;
+    }
+    // get cfg
+    static auto Config(CAUEngine& engine) noexcept {
+        return engine.m_pConfig;
+    }
+    // get stats
+    static auto&Stats(CAUEngine& engine) noexcept {
+        return engine.m_stats;
+    }
+};
+
 /// <summary>
 /// Called when [processing pass start].
 /// </summary>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::OnProcessingPassStart() noexcept {
-
+    const auto engine = CAUEngine::Private::FromAPI(*this);
+    auto& stats = CAUEngine::Private::Stats(*engine);
+    stats.pass_begin.store(PlayAU::StatsNow(), std::memory_order_relaxed);
 }
 
 /// <summary>
@@ -35,6 +69,13 @@ void PlayAU::CAUXAudio2_8::OnProcessingPassStart() noexcept {
 /// </summary>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::OnProcessingPassEnd() noexcept {
+    const auto engine = CAUEngine::Private::FromAPI(*this);
+    auto& stats = CAUEngine::Private::Stats(*engine);
+    const auto begin = stats.pass_begin.load(std::memory_order_relaxed);
+    if (!begin) return;
+    const auto end = PlayAU::StatsNow();
+    PlayAU::StatsPassEnd(stats, end - begin);
+    PLAYAU_TRACE_EVENT("mix", begin, end);
 }
 
 /// <summary>
@@ -43,6 +84,9 @@ void PlayAU::CAUXAudio2_8::OnProcessingPassEnd() noexcept {
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::OnCriticalError(HRESULT code) noexcept {
     // TODO: 分别处理
+    const auto engine = CAUEngine::Private::FromAPI(*this);
+    auto& stats = CAUEngine::Private::Stats(*engine);
+    PlayAU::StatsAdd<uint32_t>(stats.critical_errors, 1);
 }
 
 /// <summary>
@@ -75,29 +119,6 @@ void PlayAU::CAUXAudio2_8::Resume() noexcept {
 }
 
 
-/// <summary>
-/// private intercace for CAUEngine
-/// </summary>
-struct PlayAU::CAUEngine::Private {
-    // get api
-    static auto API(CAUEngine& engine) noexcept {
-        return reinterpret_cast<IAUAudioAPI*>(engine.m_buffer);
-    }
-    // get engine from api
-    static auto FromAPI(IAUAudioAPI& api) noexcept {
-        const auto addr = reinterpret_cast<char*>(&api);
-        const size_t offset = offsetof(CAUEngine, m_buffer);
-        const auto obj = reinterpret_cast<CAUEngine*>(addr - offset);
-        assert(API(*obj) == &api);
-        return obj;
-    }
-    // get cfg
-    static auto Config(CAUEngine& engine) noexcept {
-        return engine.m_pConfig;
-    }
-};
-
-
 /// <summary>
 /// context for XAudio2_8
 /// </summary>
@@ -148,6 +169,16 @@ public:
         auto& clip = *reinterpret_cast<CAUAudioClip*>(this);
         return CAUAudioClip::Private::Pausing(clip);
     }
+    // stats
+    auto&Stats() noexcept {
+        auto& clip = *reinterpret_cast<CAUAudioClip*>(this);
+        return CAUAudioClip::Private::Stats(clip);
+    }
+    // memory counter
+    auto&Memory() noexcept {
+        auto& clip = *reinterpret_cast<CAUAudioClip*>(this);
+        return CAUAudioClip::Private::Memory(clip);
+    }
     // audio stream
     auto AudioStream() noexcept {
         auto& clip = *reinterpret_cast<CAUAudioClip*>(this);
@@ -162,6 +193,8 @@ public:
 public:
     // post submit
     void PostSubmit() {
+        // 与CallContext之间的间隔即分发延迟
+        PLAYAU_TRACE_INSTANT("PostSubmit");
         auto& engine = this->Engine();
         const auto config = CAUEngine::Private::Config(engine);
         config->CallContext(engine, this, nullptr);
@@ -187,6 +220,11 @@ void PlayAU::CAUXAudio2_8::Ctx::Dispose() noexcept {
     if (this->source) {
         this->source->DestroyVoice();
         this->source = nullptr;
+        auto& stats = CAUEngine::Private::Stats(this->Engine());
+        stats.voices.fetch_sub(1, std::memory_order_relaxed);
+        // 引擎队列深度只计入存活的片段
+        const auto queued = this->Stats().queued.exchange(0, std::memory_order_relaxed);
+        stats.clips.queued.fetch_sub(queued, std::memory_order_relaxed);
     }
     // 释放缓存
     if (this->Flag() & Flag_p_Live) {
@@ -205,10 +243,21 @@ void PlayAU::CAUXAudio2_8::Ctx::Dispose() noexcept {
 /// <param name="ctx2">The CTX2.</param>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::CallContext(void* ctx1, void* ctx2) noexcept {
+    PLAYAU_TRACE_SCOPE("CallContext");
     const auto ctx = reinterpret_cast<Ctx*>(ctx1);
     ctx->SubmitNext();
 }
 
+/// <summary>
+/// Outputs the channel count.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUXAudio2_8::OutputChannels() noexcept -> uint32_t {
+    XAUDIO2_VOICE_DETAILS details;
+    m_pMastering->GetVoiceDetails(&details);
+    return details.InputChannels;
+}
+
 
 
 /// <summary>
@@ -227,7 +276,7 @@ void PlayAU::CAUXAudio2_8::DisposeClipCtx(void* buf) noexcept {
 /// </summary>
 /// <param name="ctx">The CTX.</param>
 /// <returns></returns>
-auto PlayAU::CAUXAudio2_8::TellClip(const void* ctx) noexcept -> uint32_t {
+auto PlayAU::CAUXAudio2_8::TellClip(const void* ctx) noexcept -> uint64_t {
     const auto obj = reinterpret_cast<CAUXAudio2_8::Ctx*>(
         const_cast<void*>(ctx)
         );
@@ -240,7 +289,7 @@ auto PlayAU::CAUXAudio2_8::TellClip(const void* ctx) noexcept -> uint32_t {
     src->GetState(&state, XAudio2::XAUDIO2_VOICE_NOSAMPLESPLAYED);
 #endif
     const auto data = reinterpret_cast<uintptr_t>(state.pCurrentBufferContext);
-    return static_cast<uint32_t>(data);
+    return static_cast<uint64_t>(data);
 }
 
 /// <summary>
@@ -306,6 +355,7 @@ void PlayAU::CAUXAudio2_8::StopClip(void* ctx) noexcept {
     const auto src = obj->source;
     assert(src && "bad action");
     src->FlushSourceBuffers();
+    MemoryChargeScope charge{ &obj->Memory() };
     obj->AudioStream()->Seek(0, XAUStream::Move_Begin);
 }
 
@@ -345,6 +395,29 @@ auto PlayAU::CAUXAudio2_8::VolumeClip(void* ctx, float* set) noexcept -> float {
     }
 }
 
+/// <summary>
+/// Sets the output matrix of the clip.
+/// </summary>
+/// <param name="ctx">The CTX.</param>
+/// <param name="matrix">The matrix, nullptr for standard one.</param>
+/// <returns></returns>
+bool PlayAU::CAUXAudio2_8::MatrixClip(void* ctx, const float* matrix) noexcept {
+    const auto obj = reinterpret_cast<CAUXAudio2_8::Ctx*>(ctx);
+    const auto src = obj->source;
+    assert(src && "bad action");
+    const uint32_t in = obj->AudioStream()->format.channels;
+    const uint32_t out = this->OutputChannels();
+    float standard[DSP_MAX_CHANNELS * DSP_MAX_CHANNELS];
+    if (!matrix) {
+        // 超出标准布局的保持后端默认
+        if (!PlayAU::GetChannelMatrix(in, out, standard)) return false;
+        matrix = standard;
+    }
+    // 分组的Submix与Mastering声道数一致, 唯一输出可以省略目标
+    const auto hr = src->SetOutputMatrix(nullptr, in, out, matrix);
+    return SUCCEEDED(hr);
+}
+
 /// <summary>
 /// Ratioes the clip.
 /// </summary>
@@ -373,9 +446,10 @@ auto PlayAU::CAUXAudio2_8::RatioClip(void* ctx, float* set) noexcept -> float {
 /// <param name="ctx">The CTX.</param>
 /// <param name="pos">The position.</param>
 /// <returns></returns>
-void PlayAU::CAUXAudio2_8::SeekClip(void* ctx, uint32_t pos) noexcept {
+void PlayAU::CAUXAudio2_8::SeekClip(void* ctx, uint64_t pos) noexcept {
     const auto obj = reinterpret_cast<CAUXAudio2_8::Ctx*>(ctx);
-    obj->AudioStream()->Seek(pos, XAUStream::Move_Begin);
+    MemoryChargeScope charge{ &obj->Memory() };
+    obj->AudioStream()->Seek(static_cast<int64_t>(pos), XAUStream::Move_Begin);
 }
 
 
@@ -506,14 +580,28 @@ auto PlayAU::CAUXAudio2_8::VolumeGroup(CAUAudioGroup& group, float* set) noexcep
 /// </summary>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::Ctx::SubmitNext() noexcept {
-    uint8_t* const base = this->buffer->data;
-    const auto ptr = base + this->bucket * BUCKET_LENGTH;
+    PLAYAU_TRACE_SCOPE("SubmitNext");
+    // 解码中申请/释放的内存记在片段上
+    MemoryChargeScope charge{ &this->Memory() };
     const auto stream = this->AudioStream();
-    const auto len = stream->ReadNext(BUCKET_LENGTH, ptr);
+    const uint8_t* ptr; uint32_t len = 0;
+    const auto begin = PlayAU::StatsNow();
+    // 没有桶: 直接提交映射的数据
+    if (!this->buffer) {
+        ptr = static_cast<const uint8_t*>(stream->ViewNext(BUCKET_LENGTH, len));
+    }
+    else {
+        const auto data = this->buffer->data + this->bucket * BUCKET_LENGTH;
+        len = stream->ReadNext(BUCKET_LENGTH, data);
+        ptr = data;
+        ++this->bucket;
+        this->bucket = this->bucket % PlayAU::BUCKET_COUNT;
+    }
     const auto pos = stream->offset;
     const auto all = stream->length;
-    ++this->bucket;
-    this->bucket = this->bucket % PlayAU::BUCKET_COUNT;
+    // 解码统计
+    auto& stats = CAUEngine::Private::Stats(this->Engine());
+    PlayAU::StatsSubmit(this->Stats(), stats.clips, len, PlayAU::StatsNow() - begin);
     // 数据有效
     if (!len) return;
     // 提交数据
@@ -521,10 +609,20 @@ void PlayAU::CAUXAudio2_8::Ctx::SubmitNext() noexcept {
     if (pos >= all) buffer.Flags = XAudio2::XAUDIO2_END_OF_STREAM;
     buffer.AudioBytes = len;
     buffer.pAudioData = ptr;
-    buffer.pContext = reinterpret_cast<void*>(pos-len/2);
+    buffer.pContext = reinterpret_cast<void*>(static_cast<uintptr_t>(pos - len / 2));
     const auto hr = this->source->SubmitSourceBuffer(&buffer, nullptr);
     // TODO: 错误处理
     assert(SUCCEEDED(hr));
+    // 队列深度
+    XAudio2::XAUDIO2_VOICE_STATE state = { 0 };
+#ifdef Ver2_8
+    this->source->GetState(&state);
+#else
+    this->source->GetState(&state, XAudio2::XAUDIO2_VOICE_NOSAMPLESPLAYED);
+#endif
+    // 引擎队列深度为各片段之和, 加上本片段的变化量
+    const auto old = this->Stats().queued.exchange(state.BuffersQueued, std::memory_order_relaxed);
+    stats.clips.queued.fetch_add(state.BuffersQueued - old, std::memory_order_relaxed);
 }
 
 
@@ -536,6 +634,13 @@ void PlayAU::CAUXAudio2_8::Ctx::SubmitNext() noexcept {
 /// <param name="SamplesRequired">The samples required.</param>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::Ctx::OnVoiceProcessingPassStart(UINT32 SamplesRequired) noexcept {
+    // 播放中需要数据但是流没有结束: 饥饿
+    if (!SamplesRequired || !this->Playing()) return;
+    const auto stream = this->AudioStream();
+    if (stream->offset >= stream->length) return;
+    auto& stats = CAUEngine::Private::Stats(this->Engine());
+    PlayAU::StatsAdd<uint32_t>(this->Stats().underruns, 1);
+    PlayAU::StatsAdd<uint32_t>(stats.clips.underruns, 1);
 }
 
 /// <summary>
@@ -559,6 +664,7 @@ void PlayAU::CAUXAudio2_8::Ctx::OnStreamEnd() noexcept {
     const auto flag = this->Flag();
     // 无限循环
     if (flag & Flag_LoopInfinite) {
+        MemoryChargeScope charge{ &this->Memory() };
         this->AudioStream()->Seek(0, XAUStream::Move_Begin);
         this->SubmitCount();
         const auto hr = this->source->Start(0);
@@ -584,6 +690,7 @@ void PlayAU::CAUXAudio2_8::Ctx::OnStreamEnd() noexcept {
 /// <param name="pBufferContext">The p buffer context.</param>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::Ctx::OnBufferStart(void * pBufferContext) noexcept {
+    PLAYAU_TRACE_SCOPE("OnBufferStart");
     // this->Playing()
     this->PostSubmit();
 }
@@ -595,7 +702,7 @@ void PlayAU::CAUXAudio2_8::Ctx::OnBufferStart(void * pBufferContext) noexcept {
 /// <param name="pBufferContext">The p buffer context.</param>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::Ctx::OnBufferEnd(void* pBufferContext) noexcept {
-
+    PLAYAU_TRACE_INSTANT("OnBufferEnd");
 }
 
 /// <summary>
@@ -605,7 +712,11 @@ void PlayAU::CAUXAudio2_8::Ctx::OnBufferEnd(void* pBufferContext) noexcept {
 /// <param name="Error">The error.</param>
 /// <returns></returns>
 void PlayAU::CAUXAudio2_8::Ctx::OnVoiceError(void* pBufferContext, HRESULT Error) noexcept {
-    assert(!"TODO: ERROR HANDLE");
+    // 只计数, 出错的片段由调用者通过统计发现
+    PLAYAU_TRACE_INSTANT("OnVoiceError");
+    auto& stats = CAUEngine::Private::Stats(this->Engine());
+    PlayAU::StatsAdd<uint32_t>(this->Stats().errors, 1);
+    PlayAU::StatsAdd<uint32_t>(stats.clips.errors, 1);
 }
 
 
@@ -664,6 +775,13 @@ bool PlayAU::CAUXAudio2_8::MakeClipCtx(void* buf) noexcept {
             hr = ctx->source->SetOutputVoices(&sends);
         }
     }
+    // 标准声道矩阵, 多声道缩混与单声道居中
+    if (SUCCEEDED(hr)) this->MatrixClip(ctx, nullptr);
+    // 声部计数, 与Dispose中释放Source对应
+    if (ctx->source) {
+        auto& stats = CAUEngine::Private::Stats(CAUAudioClip::Private::Engine(clip));
+        stats.voices.fetch_add(1, std::memory_order_relaxed);
+    }
     // 申请N个桶
     if (SUCCEEDED(hr)) {
         // live就直接开始
@@ -671,10 +789,14 @@ bool PlayAU::CAUXAudio2_8::MakeClipCtx(void* buf) noexcept {
             hr = ctx->source->Start(0);
         }
         else {
-            if (const auto obj = new(std::nothrow) Bucket) {
-                ctx->buffer = obj;
+            uint32_t len = 0;
+            // 可以直接映射的流(如PCM)不需要桶
+            if (stream->ViewNext(0, len)) ctx->buffer = nullptr;
+            else {
+                MemoryKindScope kind{ Memory_Bucket };
+                ctx->buffer = new(std::nothrow) Bucket;
+                if (!ctx->buffer) hr = E_OUTOFMEMORY;
             }
-            else hr = E_OUTOFMEMORY;
         }
     }
     return SUCCEEDED(hr);
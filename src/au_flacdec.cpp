@@ -0,0 +1,649 @@
+﻿#include "private/p_au_flac.h"
+
+#include <cstring>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PLAYAU_FLAC_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLAYAU_FLAC_SSE2
+#include <emmintrin.h>
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define PLAYAU_FLAC_SSE41
+#include <smmintrin.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace PlayAU {
+    // crc tables
+    struct FlacCrcTable {
+        // crc-8, poly 0x07
+        uint8_t     crc8[256];
+        // crc-16, poly 0x8005
+        uint16_t    crc16[256];
+        // ctor
+        FlacCrcTable() noexcept {
+            for (uint32_t i = 0; i != 256; ++i) {
+                uint32_t c8 = i, c16 = i << 8;
+                for (int j = 0; j != 8; ++j) {
+                    c8 = (c8 << 1) ^ (c8 & 0x80 ? 0x07 : 0);
+                    c16 = (c16 << 1) ^ (c16 & 0x8000 ? 0x8005 : 0);
+                }
+                crc8[i] = static_cast<uint8_t>(c8);
+                crc16[i] = static_cast<uint16_t>(c16);
+            }
+        }
+    };
+    // crc tables
+    static const FlacCrcTable s_crc;
+    // crc-8
+    static uint32_t FlacCrc8(const uint8_t* data, uint32_t len) noexcept {
+        uint32_t crc = 0;
+        for (uint32_t i = 0; i != len; ++i) crc = s_crc.crc8[crc ^ data[i]];
+        return crc;
+    }
+    // crc-16
+    static uint32_t FlacCrc16(const uint8_t* data, uint32_t len) noexcept {
+        uint32_t crc = 0;
+        for (uint32_t i = 0; i != len; ++i)
+            crc = ((crc << 8) & 0xffff) ^ s_crc.crc16[(crc >> 8) ^ data[i]];
+        return crc;
+    }
+    // count leading zero, x != 0
+    static inline uint32_t FlacClz64(uint64_t x) noexcept {
+#ifdef _MSC_VER
+#ifdef _WIN64
+        unsigned long index; ::_BitScanReverse64(&index, x);
+        return 63 - index;
+#else
+        unsigned long index;
+        const auto hi = static_cast<uint32_t>(x >> 32);
+        if (hi) { ::_BitScanReverse(&index, hi); return 31 - index; }
+        ::_BitScanReverse(&index, static_cast<uint32_t>(x));
+        return 63 - index;
+#endif
+#else
+        return static_cast<uint32_t>(__builtin_clzll(x));
+#endif
+    }
+    // load 64bit big endian
+    static inline uint64_t FlacLoadBE64(const uint8_t* p) noexcept {
+        uint64_t v; std::memcpy(&v, p, sizeof(v));
+#ifdef _MSC_VER
+        return ::_byteswap_uint64(v);
+#else
+        return __builtin_bswap64(v);
+#endif
+    }
+    // wrapping add, corrupted data must not overflow
+    static inline int32_t FlacAdd(int32_t a, uint32_t b) noexcept {
+        return static_cast<int32_t>(static_cast<uint32_t>(a) + b);
+    }
+    /// <summary>
+    /// msb-first bit reader over memory with 64bit cache
+    /// </summary>
+    struct FlacBitReader {
+        // begin
+        const uint8_t*      begin;
+        // current
+        const uint8_t*      ptr;
+        // end
+        const uint8_t*      end;
+        // cache, msb aligned
+        uint64_t            cache;
+        // valid bits in cache
+        uint32_t            bits;
+        // zero bytes padded after end
+        uint32_t            pad;
+        // ctor
+        FlacBitReader(const uint8_t* data, uint32_t len) noexcept
+            : begin(data), ptr(data), end(data + len), cache(0), bits(0), pad(0) {}
+        // bits consumed
+        auto Consumed() const noexcept -> uint64_t {
+            return uint64_t(ptr - begin + pad) * 8 - bits; }
+        // read beyond end
+        bool Overrun() const noexcept { return Consumed() > uint64_t(end - begin) * 8; }
+        // refill cache to at least 57 bits
+        void Refill() noexcept {
+            // 快速路径: 一次读取8字节
+            if (end - ptr >= 8) {
+                cache |= FlacLoadBE64(ptr) >> bits;
+                ptr += (63 - bits) >> 3;
+                bits |= 56;
+                return;
+            }
+            // 结尾处逐字节, 超出部分补零
+            while (bits <= 56) {
+                uint64_t byte = 0;
+                if (ptr != end) byte = *ptr++;
+                else ++pad;
+                cache |= byte << (56 - bits);
+                bits += 8;
+            }
+        }
+        // read n(<=32) bits
+        auto Read(uint32_t n) noexcept -> uint32_t {
+            if (!n) return 0;
+            if (bits < n) this->Refill();
+            const auto v = static_cast<uint32_t>(cache >> (64 - n));
+            cache <<= n;
+            bits -= n;
+            return v;
+        }
+        // read n(<=32) bits signed
+        auto ReadSigned(uint32_t n) noexcept -> int32_t {
+            if (!n) return 0;
+            if (bits < n) this->Refill();
+            const auto v = static_cast<int32_t>(static_cast<int64_t>(cache) >> (64 - n));
+            cache <<= n;
+            bits -= n;
+            return v;
+        }
+        // read unary coded number(count of zero before one)
+        auto ReadUnary() noexcept -> uint32_t {
+            uint32_t count = 0;
+            while (true) {
+                if (cache) {
+                    const auto zero = FlacClz64(cache);
+                    if (zero < bits) {
+                        cache <<= zero + 1;
+                        bits -= zero + 1;
+                        return count + zero;
+                    }
+                }
+                // 缓存内全为0
+                count += bits;
+                cache = 0; bits = 0;
+                if (ptr == end) { pad += 8; return count; }
+                this->Refill();
+            }
+        }
+        // align to byte boundary
+        void AlignByte() noexcept {
+            const auto skip = static_cast<uint32_t>(this->Consumed() & 7);
+            if (skip) this->Read(8 - skip);
+        }
+    };
+    // block size of code
+    static uint32_t FlacBlockSize(uint32_t code) noexcept {
+        if (code == 1) return 192;
+        if (code >= 2 && code <= 5) return 576u << (code - 2);
+        if (code >= 8) return 256u << (code - 8);
+        return 0;
+    }
+#if defined(PLAYAU_FLAC_SSE2) && !defined(PLAYAU_FLAC_SSE41)
+    // 32bit multiply low for sse2
+    static inline __m128i FlacMullo32(__m128i a, __m128i b) noexcept {
+        const auto even = _mm_mul_epu32(a, b);
+        const auto odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(
+            _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))
+        );
+    }
+#elif defined(PLAYAU_FLAC_SSE41)
+    // 32bit multiply low
+    static inline __m128i FlacMullo32(__m128i a, __m128i b) noexcept {
+        return _mm_mullo_epi32(a, b);
+    }
+#endif
+    /// <summary>
+    /// Restores lpc signal with 32bit accumulator.
+    /// </summary>
+    /// <param name="data">The data with warmup and residual.</param>
+    /// <param name="n">The sample count.</param>
+    /// <param name="coefs">The reversed coefficients, zero padded to multiple of 4.</param>
+    /// <param name="order">The order.</param>
+    /// <param name="shift">The shift.</param>
+    static void FlacRestoreLpc32(int32_t* data, uint32_t n, const int32_t* coefs, uint32_t order, int shift) noexcept {
+#if defined(PLAYAU_FLAC_SSE2) || defined(PLAYAU_FLAC_NEON)
+        // 高阶预测使用SIMD计算点积, 系数补零读取当前样本之后的数据
+        if (order >= 8) {
+            const uint32_t padded = (order + 3) & ~3u;
+            for (uint32_t i = order; i != n; ++i) {
+                const int32_t* const window = data + i - order;
+#ifdef PLAYAU_FLAC_NEON
+                int32x4_t sum = vdupq_n_s32(0);
+                for (uint32_t k = 0; k != padded; k += 4)
+                    sum = vmlaq_s32(sum, vld1q_s32(window + k), vld1q_s32(coefs + k));
+                const int32_t dot = vaddvq_s32(sum);
+#else
+                __m128i sum = _mm_setzero_si128();
+                for (uint32_t k = 0; k != padded; k += 4) {
+                    const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(window + k));
+                    const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefs + k));
+                    sum = _mm_add_epi32(sum, FlacMullo32(d, c));
+                }
+                sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+                sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+                const int32_t dot = _mm_cvtsi128_si32(sum);
+#endif
+                data[i] = PlayAU::FlacAdd(data[i], uint32_t(dot >> shift));
+            }
+            return;
+        }
+#endif
+        for (uint32_t i = order; i != n; ++i) {
+            const int32_t* const window = data + i - order;
+            uint32_t sum = 0;
+            // 无符号运算, 溢出回绕与SIMD一致
+            for (uint32_t k = 0; k != order; ++k)
+                sum += static_cast<uint32_t>(window[k]) * static_cast<uint32_t>(coefs[k]);
+            data[i] = PlayAU::FlacAdd(data[i], uint32_t(static_cast<int32_t>(sum) >> shift));
+        }
+    }
+    /// <summary>
+    /// Restores lpc signal with 64bit accumulator.
+    /// </summary>
+    /// <param name="data">The data with warmup and residual.</param>
+    /// <param name="n">The sample count.</param>
+    /// <param name="coefs">The reversed coefficients, zero padded to multiple of 4.</param>
+    /// <param name="order">The order.</param>
+    /// <param name="shift">The shift.</param>
+    static void FlacRestoreLpc64(int32_t* data, uint32_t n, const int32_t* coefs, uint32_t order, int shift) noexcept {
+#if defined(PLAYAU_FLAC_NEON) || defined(PLAYAU_FLAC_SSE41)
+        if (order >= 8) {
+            const uint32_t padded = (order + 3) & ~3u;
+            for (uint32_t i = order; i != n; ++i) {
+                const int32_t* const window = data + i - order;
+#ifdef PLAYAU_FLAC_NEON
+                int64x2_t sum = vdupq_n_s64(0);
+                for (uint32_t k = 0; k != padded; k += 4) {
+                    const auto d = vld1q_s32(window + k);
+                    const auto c = vld1q_s32(coefs + k);
+                    sum = vmlal_s32(sum, vget_low_s32(d), vget_low_s32(c));
+                    sum = vmlal_high_s32(sum, d, c);
+                }
+                const int64_t dot = vaddvq_s64(sum);
+#else
+                __m128i sum = _mm_setzero_si128();
+                for (uint32_t k = 0; k != padded; k += 4) {
+                    const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(window + k));
+                    const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefs + k));
+                    sum = _mm_add_epi64(sum, _mm_mul_epi32(d, c));
+                    sum = _mm_add_epi64(sum, _mm_mul_epi32(_mm_srli_epi64(d, 32), _mm_srli_epi64(c, 32)));
+                }
+                sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+                int64_t dot; _mm_storel_epi64(reinterpret_cast<__m128i*>(&dot), sum);
+#endif
+                data[i] = PlayAU::FlacAdd(data[i], uint32_t(dot >> shift));
+            }
+            return;
+        }
+#endif
+        for (uint32_t i = order; i != n; ++i) {
+            const int32_t* const window = data + i - order;
+            int64_t sum = 0;
+            for (uint32_t k = 0; k != order; ++k)
+                sum += int64_t(window[k]) * coefs[k];
+            data[i] = PlayAU::FlacAdd(data[i], uint32_t(sum >> shift));
+        }
+    }
+    /// <summary>
+    /// Restores fixed predictor signal.
+    /// </summary>
+    /// <param name="data">The data.</param>
+    /// <param name="n">The n.</param>
+    /// <param name="order">The order.</param>
+    static void FlacRestoreFixed(int32_t* data, uint32_t n, uint32_t order) noexcept {
+        // 无符号运算, 损坏的数据也不会有未定义行为
+        const auto d = reinterpret_cast<uint32_t*>(data);
+        switch (order)
+        {
+        case 1:
+            for (uint32_t i = 1; i < n; ++i)
+                d[i] += d[i - 1];
+            break;
+        case 2:
+            for (uint32_t i = 2; i < n; ++i)
+                d[i] += 2 * d[i - 1] - d[i - 2];
+            break;
+        case 3:
+            for (uint32_t i = 3; i < n; ++i)
+                d[i] += 3 * (d[i - 1] - d[i - 2]) + d[i - 3];
+            break;
+        case 4:
+            for (uint32_t i = 4; i < n; ++i)
+                d[i] += 4 * (d[i - 1] + d[i - 3]) - 6 * d[i - 2] - d[i - 4];
+            break;
+        }
+    }
+    /// <summary>
+    /// Decodes the partitioned rice residual.
+    /// </summary>
+    /// <param name="br">The bit reader.</param>
+    /// <param name="data">The data.</param>
+    /// <param name="n">The block size.</param>
+    /// <param name="order">The predictor order.</param>
+    /// <returns></returns>
+    static bool FlacDecodeResidual(FlacBitReader& br, int32_t* data, uint32_t n, uint32_t order) noexcept {
+        const auto method = br.Read(2);
+        if (method > 1) return false;
+        const uint32_t param_bits = method ? 5 : 4;
+        const uint32_t escape = method ? 31 : 15;
+        const auto porder = br.Read(4);
+        const uint32_t psize = n >> porder;
+        if ((psize << porder) != n || psize < order) return false;
+        int32_t* out = data + order;
+        for (uint32_t p = 0; p != (1u << porder); ++p) {
+            const uint32_t count = p ? psize : psize - order;
+            const auto k = br.Read(param_bits);
+            int32_t* const out_end = out + count;
+            // 转义: 原始数据
+            if (k == escape) {
+                const auto raw = br.Read(5);
+                for (; out != out_end; ++out) *out = br.ReadSigned(raw);
+            }
+            else {
+                for (; out != out_end; ++out) {
+                    const auto q = br.ReadUnary();
+                    const auto u = (q << k) | br.Read(k);
+                    *out = static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1);
+                }
+            }
+            if (br.Overrun()) return false;
+        }
+        return true;
+    }
+    /// <summary>
+    /// Decodes the subframe.
+    /// </summary>
+    /// <param name="br">The bit reader.</param>
+    /// <param name="data">The data.</param>
+    /// <param name="n">The block size.</param>
+    /// <param name="bps">The bits per sample.</param>
+    /// <returns></returns>
+    static bool FlacDecodeSubframe(FlacBitReader& br, int32_t* data, uint32_t n, uint32_t bps) noexcept {
+        const auto head = br.Read(8);
+        if (head & 0x80) return false;
+        const uint32_t type = (head >> 1) & 0x3f;
+        uint32_t wasted = 0;
+        if (head & 1) {
+            wasted = br.ReadUnary() + 1;
+            if (wasted >= bps) return false;
+            bps -= wasted;
+        }
+        // CONSTANT
+        if (type == 0) {
+            const auto v = br.ReadSigned(bps);
+            for (uint32_t i = 0; i != n; ++i) data[i] = v;
+        }
+        // VERBATIM
+        else if (type == 1) {
+            for (uint32_t i = 0; i != n; ++i) data[i] = br.ReadSigned(bps);
+        }
+        // FIXED
+        else if (type >= 8 && type <= 12) {
+            const uint32_t order = type - 8;
+            if (order > n) return false;
+            for (uint32_t i = 0; i != order; ++i) data[i] = br.ReadSigned(bps);
+            if (!PlayAU::FlacDecodeResidual(br, data, n, order)) return false;
+            PlayAU::FlacRestoreFixed(data, n, order);
+        }
+        // LPC
+        else if (type >= 32) {
+            const uint32_t order = (type & 31) + 1;
+            if (order > n) return false;
+            for (uint32_t i = 0; i != order; ++i) data[i] = br.ReadSigned(bps);
+            const auto precision = br.Read(4) + 1;
+            if (precision == 16) return false;
+            const auto shift = br.ReadSigned(5);
+            if (shift < 0) return false;
+            // 逆序系数, 补零到4的倍数
+            alignas(16) int32_t coefs[FLAC_MAX_LPC_ORDER + 4] = { 0 };
+            for (uint32_t i = 0; i != order; ++i)
+                coefs[order - 1 - i] = br.ReadSigned(precision);
+            if (!PlayAU::FlacDecodeResidual(br, data, n, order)) return false;
+            // 累加范围: bps + 系数精度 + log2(阶数)
+            uint32_t log2_order = 0;
+            while ((1u << (log2_order + 1)) <= order) ++log2_order;
+            if (bps + precision + log2_order <= 32)
+                PlayAU::FlacRestoreLpc32(data, n, coefs, order, shift);
+            else
+                PlayAU::FlacRestoreLpc64(data, n, coefs, order, shift);
+        }
+        else return false;
+        if (br.Overrun()) return false;
+        if (wasted) {
+            for (uint32_t i = 0; i != n; ++i)
+                data[i] = static_cast<int32_t>(static_cast<uint32_t>(data[i]) << wasted);
+        }
+        return true;
+    }
+}
+
+
+/// <summary>
+/// Parses the streaminfo block data.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="info">The information.</param>
+/// <returns></returns>
+bool PlayAU::ParseFlacStreamInfo(const uint8_t* data, FlacStreamInfo& info) noexcept {
+    FlacBitReader br{ data, FLAC_STREAMINFO_LENGTH };
+    info.min_blocksize = br.Read(16);
+    info.max_blocksize = br.Read(16);
+    info.min_framesize = br.Read(24);
+    info.max_framesize = br.Read(24);
+    info.sample_rate = br.Read(20);
+    info.channels = br.Read(3) + 1;
+    info.bits_per_sample = br.Read(5) + 1;
+    info.total_samples = uint64_t(br.Read(4)) << 32;
+    info.total_samples |= br.Read(32);
+    // 不支持的格式
+    if (info.max_blocksize < 16 || info.min_blocksize > info.max_blocksize) return false;
+    if (info.bits_per_sample < 4) return false;
+    if (info.bits_per_sample > FLAC_MAX_BITS_PER_SAMPLE) return false;
+    if (!info.sample_rate) return false;
+    return true;
+}
+
+/// <summary>
+/// Parses the frame header.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <param name="info">The information.</param>
+/// <param name="header">The header.</param>
+/// <returns></returns>
+auto PlayAU::ParseFlacFrameHeader(
+    const uint8_t* data, uint32_t len,
+    const FlacStreamInfo& info,
+    FlacFrameHeader& header) noexcept -> FlacStatus {
+    if (len < 6) return Flac_NeedMore;
+    // 同步码
+    if (data[0] != 0xff || (data[1] & 0xfe) != 0xf8) return Flac_Error;
+    const bool variable = data[1] & 1;
+    const uint32_t bs_code = data[2] >> 4;
+    const uint32_t sr_code = data[2] & 0xf;
+    const uint32_t assignment = data[3] >> 4;
+    const uint32_t ss_code = (data[3] >> 1) & 7;
+    if (!bs_code || sr_code == 15 || (data[3] & 1)) return Flac_Error;
+    if (assignment > 10) return Flac_Error;
+    // 声道数与位深必须与流信息一致
+    const uint32_t channels = assignment < 8 ? assignment + 1 : 2;
+    if (channels != info.channels) return Flac_Error;
+    static const uint8_t SAMPLE_SIZE[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+    if (ss_code == 3) return Flac_Error;
+    if (ss_code && SAMPLE_SIZE[ss_code] != info.bits_per_sample) return Flac_Error;
+    // UTF-8 编码的帧号/样本号
+    uint32_t pos = 4;
+    uint64_t number = data[pos++];
+    uint32_t extra = 0;
+    if (number & 0x80) {
+        if (!(number & 0x40)) return Flac_Error;
+        while (number & (0x40 >> extra)) ++extra;
+        if (extra > 6) return Flac_Error;
+        number &= 0x3f >> extra;
+    }
+    if (len < pos + extra + 4) return Flac_NeedMore;
+    for (uint32_t i = 0; i != extra; ++i) {
+        const auto byte = data[pos++];
+        if ((byte & 0xc0) != 0x80) return Flac_Error;
+        number = (number << 6) | (byte & 0x3f);
+    }
+    // 块大小
+    uint32_t blocksize = PlayAU::FlacBlockSize(bs_code);
+    if (bs_code == 6) blocksize = data[pos++] + 1u;
+    else if (bs_code == 7) {
+        blocksize = ((uint32_t(data[pos]) << 8) | data[pos + 1]) + 1;
+        pos += 2;
+    }
+    // 采样率
+    if (sr_code == 12) pos += 1;
+    else if (sr_code == 13 || sr_code == 14) pos += 2;
+    if (len < pos + 1) return Flac_NeedMore;
+    if (PlayAU::FlacCrc8(data, pos) != data[pos]) return Flac_Error;
+    if (blocksize > info.max_blocksize) return Flac_Error;
+    // 固定块大小时为帧号
+    const uint32_t fixed = info.min_blocksize == info.max_blocksize ? info.max_blocksize : blocksize;
+    header.sample = variable ? number : number * fixed;
+    header.blocksize = blocksize;
+    header.assignment = assignment;
+    header.length = pos + 1;
+    return Flac_OK;
+}
+
+/// <summary>
+/// Decodes a whole frame into channel buffers.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <param name="info">The information.</param>
+/// <param name="header">The header.</param>
+/// <param name="channels">The channel buffers.</param>
+/// <param name="used">The used length in byte.</param>
+/// <returns></returns>
+auto PlayAU::DecodeFlacFrame(
+    const uint8_t* data, uint32_t len,
+    const FlacStreamInfo& info,
+    FlacFrameHeader& header,
+    int32_t* const channels[],
+    uint32_t& used) noexcept -> FlacStatus {
+    const auto status = PlayAU::ParseFlacFrameHeader(data, len, info, header);
+    if (status != Flac_OK) return status;
+    FlacBitReader br{ data, len };
+    br.ptr += header.length;
+    const uint32_t n = header.blocksize;
+    const uint32_t bps = info.bits_per_sample;
+    const uint32_t count = header.assignment < 8 ? header.assignment + 1 : 2;
+    // 子帧
+    for (uint32_t ch = 0; ch != count; ++ch) {
+        // 差分声道多一位
+        uint32_t sub_bps = bps;
+        if ((header.assignment == 8 || header.assignment == 10) && ch == 1) ++sub_bps;
+        if (header.assignment == 9 && ch == 0) ++sub_bps;
+        if (!PlayAU::FlacDecodeSubframe(br, channels[ch], n, sub_bps))
+            return br.Overrun() ? Flac_NeedMore : Flac_Error;
+    }
+    // 帧尾: 对齐 + CRC-16
+    br.AlignByte();
+    const auto crc = br.Read(16);
+    if (br.Overrun()) return Flac_NeedMore;
+    const auto length = static_cast<uint32_t>(br.Consumed() >> 3);
+    if (PlayAU::FlacCrc16(data, length - 2) != crc) return Flac_Error;
+    // 声道去相关
+    const auto ch0 = channels[0];
+    const auto ch1 = channels[1];
+    switch (header.assignment)
+    {
+    case 8:
+        // left-side
+        for (uint32_t i = 0; i != n; ++i) ch1[i] = ch0[i] - ch1[i];
+        break;
+    case 9:
+        // side-right
+        for (uint32_t i = 0; i != n; ++i) ch0[i] += ch1[i];
+        break;
+    case 10:
+        // mid-side
+        for (uint32_t i = 0; i != n; ++i) {
+            const int32_t side = ch1[i];
+            const int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(ch0[i]) << 1) | (side & 1);
+            ch0[i] = (mid + side) >> 1;
+            ch1[i] = (mid - side) >> 1;
+        }
+        break;
+    }
+    used = length;
+    return Flac_OK;
+}
+
+/// <summary>
+/// Interleaves decoded samples to pcm.
+/// </summary>
+/// <param name="dst">The DST.</param>
+/// <param name="channels">The channel buffers.</param>
+/// <param name="channel_count">The channel count.</param>
+/// <param name="offset">The offset in samples.</param>
+/// <param name="count">The count in samples.</param>
+/// <param name="bytes">The bytes per sample.</param>
+/// <param name="shift">The left shift.</param>
+/// <returns></returns>
+void PlayAU::InterleaveFlacSamples(
+    void* dst,
+    const int32_t* const channels[],
+    uint32_t channel_count,
+    uint32_t offset, uint32_t count,
+    uint32_t bytes, uint32_t shift) noexcept {
+    // 常见格式: 16位立体声
+    if (bytes == 2 && channel_count == 2 && !shift) {
+        const int32_t* const l = channels[0] + offset;
+        const int32_t* const r = channels[1] + offset;
+        const auto out = reinterpret_cast<int16_t*>(dst);
+        uint32_t i = 0;
+#if defined(PLAYAU_FLAC_SSE2)
+        for (; i + 4 <= count; i += 4) {
+            const auto vl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i));
+            const auto vr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+            const auto lr = _mm_packs_epi32(_mm_unpacklo_epi32(vl, vr), _mm_unpackhi_epi32(vl, vr));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), lr);
+        }
+#elif defined(PLAYAU_FLAC_NEON)
+        for (; i + 4 <= count; i += 4) {
+            int16x4x2_t lr;
+            lr.val[0] = vmovn_s32(vld1q_s32(l + i));
+            lr.val[1] = vmovn_s32(vld1q_s32(r + i));
+            vst2_s16(out + i * 2, lr);
+        }
+#endif
+        for (; i != count; ++i) {
+            out[i * 2 + 0] = static_cast<int16_t>(l[i]);
+            out[i * 2 + 1] = static_cast<int16_t>(r[i]);
+        }
+        return;
+    }
+    const auto out = reinterpret_cast<uint8_t*>(dst);
+    const uint32_t stride = bytes * channel_count;
+    for (uint32_t ch = 0; ch != channel_count; ++ch) {
+        const int32_t* const src = channels[ch] + offset;
+        uint8_t* ptr = out + ch * bytes;
+        switch (bytes)
+        {
+        case 1:
+            // 8位PCM为无符号
+            for (uint32_t i = 0; i != count; ++i, ptr += stride)
+                *ptr = static_cast<uint8_t>((static_cast<uint32_t>(src[i]) << shift) + 128);
+            break;
+        case 2:
+            for (uint32_t i = 0; i != count; ++i, ptr += stride) {
+                const auto v = static_cast<int16_t>(static_cast<uint32_t>(src[i]) << shift);
+                std::memcpy(ptr, &v, sizeof(v));
+            }
+            break;
+        case 3:
+            for (uint32_t i = 0; i != count; ++i, ptr += stride) {
+                const auto v = static_cast<uint32_t>(src[i]) << shift;
+                ptr[0] = static_cast<uint8_t>(v);
+                ptr[1] = static_cast<uint8_t>(v >> 8);
+                ptr[2] = static_cast<uint8_t>(v >> 16);
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,194 @@
+﻿#include "../inc/au_stats.h"
+#include "private/p_au_memory.h"
+
+#include <cassert>
+
+
+namespace PlayAU {
+    // allocation header
+    struct MemoryHeader {
+        // user length
+        uint64_t        size;
+        // owning allocator, nullptr for c runtime heap
+        IAUConfigure*   allocator;
+        // memory kind
+        uint32_t        kind;
+        // magic to catch foreign pointer
+        uint32_t        magic;
+        // padding to header length
+        uint8_t         padding[MEMORY_HEADER_LENGTH - sizeof(uint64_t) - sizeof(void*) - sizeof(uint32_t) * 2];
+    };
+    static_assert(sizeof(MemoryHeader) == MEMORY_HEADER_LENGTH, "header length");
+    static_assert(MEMORY_HEADER_LENGTH % alignof(std::max_align_t) == 0, "header alignment");
+    // header magic
+    enum : uint32_t { MEMORY_MAGIC = 0x4D454D41 };
+    // memory counters
+    struct MemoryCounters {
+        // total
+        std::atomic<int64_t>    total{ 0 };
+        // peak
+        std::atomic<int64_t>    peak{ 0 };
+        // allocations
+        std::atomic<int64_t>    allocations{ 0 };
+        // per kind
+        std::atomic<int64_t>    kinds[MEMORY_KIND_COUNT]{};
+        // budget, 0 for none
+        std::atomic<int64_t>    budget{ 0 };
+        // budget callback
+        std::atomic<MemoryBudgetCallback> call{ nullptr };
+        // budget user data
+        std::atomic<void*>      user{ nullptr };
+        // ctor
+        constexpr MemoryCounters() noexcept {}
+    };
+    // global counters, constant initialized before any allocation
+    static MemoryCounters s_memory;
+    // kind of allocations on this thread
+    static thread_local MemoryKind t_memoryKind = Memory_Other;
+    // counter charged on this thread
+    static thread_local std::atomic<int64_t>* t_pMemoryCharge = nullptr;
+    /// <summary>
+    /// Accounts the size change.
+    /// </summary>
+    /// <param name="kind">The kind.</param>
+    /// <param name="delta">The delta.</param>
+    /// <returns></returns>
+    static void MemoryAccount(uint32_t kind, int64_t delta) noexcept {
+        constexpr auto order = std::memory_order_relaxed;
+        s_memory.kinds[kind].fetch_add(delta, order);
+        if (const auto charge = t_pMemoryCharge) charge->fetch_add(delta, order);
+        const auto old = s_memory.total.fetch_add(delta, order);
+        const auto now = old + delta;
+        if (delta <= 0) return;
+        // 峰值
+        auto peak = s_memory.peak.load(order);
+        while (peak < now && !s_memory.peak.compare_exchange_weak(peak, now, order));
+        // 超出预算时回调, 只在越过的那一次
+        const auto budget = s_memory.budget.load(order);
+        if (budget && old <= budget && now > budget) {
+            if (const auto call = s_memory.call.load(std::memory_order_acquire))
+                call(s_memory.user.load(order), now, budget);
+        }
+    }
+}
+
+
+/// <summary>
+/// Sets the kind of allocations on this thread.
+/// </summary>
+/// <param name="kind">The kind.</param>
+/// <returns></returns>
+auto PlayAU::MemorySwapKind(MemoryKind kind) noexcept -> MemoryKind {
+    const auto old = t_memoryKind;
+    t_memoryKind = kind;
+    return old;
+}
+
+/// <summary>
+/// Sets the counter charged on this thread.
+/// </summary>
+/// <param name="counter">The counter.</param>
+/// <returns></returns>
+auto PlayAU::MemorySwapCharge(std::atomic<int64_t>* counter) noexcept -> std::atomic<int64_t>* {
+    const auto old = t_pMemoryCharge;
+    t_pMemoryCharge = counter;
+    return old;
+}
+
+/// <summary>
+/// Writes the header and accounts the block.
+/// </summary>
+/// <param name="base">The base.</param>
+/// <param name="len">The length.</param>
+/// <param name="allocator">The owning allocator.</param>
+/// <returns></returns>
+void* PlayAU::MemoryAttach(void* base, size_t len, IAUConfigure* allocator) noexcept {
+    if (!base) return nullptr;
+    const auto header = static_cast<MemoryHeader*>(base);
+    header->size = len;
+    header->allocator = allocator;
+    header->kind = t_memoryKind;
+    header->magic = MEMORY_MAGIC;
+    s_memory.allocations.fetch_add(1, std::memory_order_relaxed);
+    PlayAU::MemoryAccount(header->kind, static_cast<int64_t>(len));
+    return header + 1;
+}
+
+/// <summary>
+/// Gets the raw block of the user pointer.
+/// </summary>
+/// <param name="ptr">The PTR.</param>
+/// <returns></returns>
+void* PlayAU::MemoryBase(void* ptr) noexcept {
+    const auto header = static_cast<MemoryHeader*>(ptr) - 1;
+    assert(header->magic == MEMORY_MAGIC && "not allocated by PlayAU::Alloc");
+    return header;
+}
+
+/// <summary>
+/// Gets the allocator owning the user pointer.
+/// </summary>
+/// <param name="ptr">The PTR.</param>
+/// <returns></returns>
+auto PlayAU::MemoryOwner(void* ptr) noexcept -> IAUConfigure* {
+    const auto header = static_cast<MemoryHeader*>(ptr) - 1;
+    assert(header->magic == MEMORY_MAGIC && "not allocated by PlayAU::Alloc");
+    return header->allocator;
+}
+
+/// <summary>
+/// Accounts the reallocated block to new length, kind is kept.
+/// </summary>
+/// <param name="base">The base.</param>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+void* PlayAU::MemoryResize(void* base, size_t len) noexcept {
+    const auto header = static_cast<MemoryHeader*>(base);
+    const auto delta = static_cast<int64_t>(len) - static_cast<int64_t>(header->size);
+    header->size = len;
+    PlayAU::MemoryAccount(header->kind, delta);
+    return header + 1;
+}
+
+/// <summary>
+/// Releases the accounting of the block.
+/// </summary>
+/// <param name="ptr">The PTR.</param>
+/// <returns></returns>
+void* PlayAU::MemoryDetach(void* ptr) noexcept {
+    const auto header = static_cast<MemoryHeader*>(ptr) - 1;
+    assert(header->magic == MEMORY_MAGIC && "not allocated by PlayAU::Alloc");
+    header->magic = 0;
+    s_memory.allocations.fetch_sub(1, std::memory_order_relaxed);
+    PlayAU::MemoryAccount(header->kind, -static_cast<int64_t>(header->size));
+    return header;
+}
+
+/// <summary>
+/// Gets the memory stats.
+/// </summary>
+/// <param name="stats">The stats.</param>
+/// <returns></returns>
+void PlayAU::GetMemoryStats(MemoryStats& stats) noexcept {
+    constexpr auto order = std::memory_order_relaxed;
+    stats.total = s_memory.total.load(order);
+    stats.peak = s_memory.peak.load(order);
+    stats.allocations = s_memory.allocations.load(order);
+    for (uint32_t i = 0; i != MEMORY_KIND_COUNT; ++i)
+        stats.kinds[i] = s_memory.kinds[i].load(order);
+}
+
+/// <summary>
+/// Sets the memory budget.
+/// </summary>
+/// <param name="budget">The budget.</param>
+/// <param name="call">The call.</param>
+/// <param name="user">The user.</param>
+/// <returns></returns>
+void PlayAU::SetMemoryBudget(int64_t budget, MemoryBudgetCallback call, void* user) noexcept {
+    // 先关闭预算再替换回调, 避免新回调拿到旧的用户数据
+    s_memory.budget.store(0, std::memory_order_relaxed);
+    s_memory.user.store(user, std::memory_order_relaxed);
+    s_memory.call.store(call, std::memory_order_release);
+    s_memory.budget.store(call ? budget : 0, std::memory_order_relaxed);
+}
@@ -0,0 +1,280 @@
+﻿#include "../inc/au_config.h"
+#include "../inc/au_stream.h"
+#include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_trace.h"
+
+#include <cassert>
+#include <cstring>
+
+
+namespace PlayAU {
+    // seek target in stream, return false if before begin
+    static bool StreamSeekTarget(const XAUStream& s, int64_t off, XAUStream::Move method, uint64_t& target) noexcept {
+        int64_t pos = off;
+        switch (method)
+        {
+        case PlayAU::XAUStream::Move_Current: pos += static_cast<int64_t>(s.offset); break;
+        case PlayAU::XAUStream::Move_End: pos += static_cast<int64_t>(s.length); break;
+        }
+        if (pos < 0) return false;
+        target = static_cast<uint64_t>(pos);
+        return true;
+    }
+    // release callback of memory owner
+    using MemoryRelease = void(*)(void* owner);
+    /// <summary>
+    /// memory stream, views borrowed or owned memory
+    /// </summary>
+    /// <seealso cref="XAUStream" />
+    struct CAUMemoryStream final : XAUStream {
+        // ctor
+        CAUMemoryStream(const void* data, uint32_t len, MemoryRelease release, void* owner) noexcept;
+        // move ctor
+        CAUMemoryStream(CAUMemoryStream&& x) noexcept;
+        // dispose
+        void Dispose() noexcept override;
+        // seek stream in byte, return current position
+        bool Seek(int64_t off, Move method = XAUStream::Move_Begin) noexcept override;
+        // read stream, return byte count read
+        auto ReadNext(uint32_t len, void* buf) noexcept->uint32_t override;
+        // view next bytes in memory
+        auto ViewNext(uint32_t len, uint32_t& read) noexcept->const void* override;
+        // memory is always viewable
+        bool Map() noexcept override { return true; }
+    private:
+        // data
+        const uint8_t*      m_pData;
+        // release owner when disposed, null if borrowed
+        MemoryRelease       m_pfnRelease;
+        // owner of data
+        void*               m_pOwner;
+    };
+    /// <summary>
+    /// callback stream, forwards to user callback
+    /// </summary>
+    /// <seealso cref="XAUStream" />
+    struct CAUCallbackStream final : XAUStream {
+        // ctor
+        CAUCallbackStream(const StreamCallback& callback) noexcept;
+        // move ctor
+        CAUCallbackStream(CAUCallbackStream&& x) noexcept;
+        // dispose
+        void Dispose() noexcept override;
+        // seek stream in byte, return current position
+        bool Seek(int64_t off, Move method = XAUStream::Move_Begin) noexcept override;
+        // read stream, return byte count read
+        auto ReadNext(uint32_t len, void* buf) noexcept->uint32_t override;
+    private:
+        // callback
+        StreamCallback      m_callback;
+    };
+}
+
+
+/// <summary>
+/// Creates the memory stream viewing borrowed memory.
+/// </summary>
+/// <param name="out">The out.</param>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+bool PlayAU::CreateMemoryStream(FileStreamHolder& out, const void* data, uint32_t len) noexcept {
+    out.Reset();
+    if (!data && len) return false;
+    return !!out.Emplace<CAUMemoryStream>(data, len, nullptr, nullptr);
+}
+
+/// <summary>
+/// Creates the memory stream viewing shared memory,
+/// release(owner) is called once the stream disposed.
+/// </summary>
+/// <param name="out">The out.</param>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <param name="release">The release callback.</param>
+/// <param name="owner">The owner.</param>
+/// <returns>false if failed, release is not called then</returns>
+bool PlayAU::CreateSharedMemoryStream(FileStreamHolder& out, const void* data, uint32_t len, void(*release)(void*), void* owner) noexcept {
+    out.Reset();
+    if (!data && len) return false;
+    return !!out.Emplace<CAUMemoryStream>(data, len, release, owner);
+}
+
+/// <summary>
+/// Creates the memory stream owning a copy of data.
+/// </summary>
+/// <param name="out">The out.</param>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+bool PlayAU::CreateBufferStream(FileStreamHolder& out, const void* data, uint32_t len) noexcept {
+    out.Reset();
+    if (!data && len) return false;
+    MemoryKindScope kind{ Memory_Stream };
+    const auto buf = PlayAU::Alloc(len ? len : 1);
+    if (!buf) return false;
+    if (len) std::memcpy(buf, data, len);
+    const MemoryRelease release = [](void* ptr) noexcept { PlayAU::Free(ptr); };
+    if (out.Emplace<CAUMemoryStream>(buf, len, release, buf)) return true;
+    PlayAU::Free(buf);
+    return false;
+}
+
+/// <summary>
+/// Creates the callback stream.
+/// </summary>
+/// <param name="out">The out.</param>
+/// <param name="callback">The callback.</param>
+/// <returns></returns>
+bool PlayAU::CreateCallbackStream(FileStreamHolder& out, const StreamCallback& callback) noexcept {
+    out.Reset();
+    if (!callback.read || !callback.seek) return false;
+    // 初始位置由回调决定, 这里统一回到起点
+    if (!callback.seek(callback.user, 0)) return false;
+    return !!out.Emplace<CAUCallbackStream>(callback);
+}
+
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUMemoryStream"/> struct.
+/// </summary>
+/// <param name="data">The data.</param>
+/// <param name="len">The length.</param>
+/// <param name="release">The release callback.</param>
+/// <param name="owner">The owner.</param>
+PlayAU::CAUMemoryStream::CAUMemoryStream(const void* data, uint32_t len, MemoryRelease release, void* owner) noexcept
+    : m_pData(static_cast<const uint8_t*>(data)), m_pfnRelease(release), m_pOwner(owner) {
+    this->length = len;
+    this->offset = 0;
+}
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUMemoryStream"/> struct.
+/// </summary>
+/// <param name="x">The x.</param>
+PlayAU::CAUMemoryStream::CAUMemoryStream(CAUMemoryStream&& x) noexcept
+    : m_pData(x.m_pData), m_pfnRelease(x.m_pfnRelease), m_pOwner(x.m_pOwner) {
+    this->length = x.length;
+    this->offset = x.offset;
+    x.m_pfnRelease = nullptr;
+}
+
+/// <summary>
+/// Releases unmanaged and - optionally - managed resources.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUMemoryStream::Dispose() noexcept {
+    if (m_pfnRelease) m_pfnRelease(m_pOwner);
+    m_pfnRelease = nullptr;
+    m_pOwner = nullptr;
+    m_pData = nullptr;
+    this->length = 0;
+    this->offset = 0;
+}
+
+/// <summary>
+/// Seeks the specified off.
+/// </summary>
+/// <param name="off">The off.</param>
+/// <param name="method">The method.</param>
+/// <returns></returns>
+bool PlayAU::CAUMemoryStream::Seek(int64_t off, Move method) noexcept {
+    uint64_t pos;
+    if (!PlayAU::StreamSeekTarget(*this, off, method, pos)) return false;
+    this->offset = pos;
+    return true;
+}
+
+/// <summary>
+/// Reads the next.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <param name="buf">The buf.</param>
+/// <returns></returns>
+auto PlayAU::CAUMemoryStream::ReadNext(uint32_t len, void* buf) noexcept -> uint32_t {
+    uint32_t read = 0;
+    const auto ptr = this->ViewNext(len, read);
+    if (read) std::memcpy(buf, ptr, read);
+    return read;
+}
+
+/// <summary>
+/// Views the next bytes in memory.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <param name="read">The read.</param>
+/// <returns></returns>
+auto PlayAU::CAUMemoryStream::ViewNext(uint32_t len, uint32_t& read) noexcept -> const void* {
+    const auto pos = this->offset < this->length ? this->offset : this->length;
+    const uint64_t left = this->length - pos;
+    read = len < left ? len : static_cast<uint32_t>(left);
+    this->offset = pos + read;
+    return m_pData + pos;
+}
+
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUCallbackStream"/> struct.
+/// </summary>
+/// <param name="callback">The callback.</param>
+PlayAU::CAUCallbackStream::CAUCallbackStream(const StreamCallback& callback) noexcept
+    : m_callback(callback) {
+    this->length = callback.length;
+    this->offset = 0;
+}
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUCallbackStream"/> struct.
+/// </summary>
+/// <param name="x">The x.</param>
+PlayAU::CAUCallbackStream::CAUCallbackStream(CAUCallbackStream&& x) noexcept
+    : m_callback(x.m_callback) {
+    this->length = x.length;
+    this->offset = x.offset;
+    x.m_callback.close = nullptr;
+}
+
+/// <summary>
+/// Releases unmanaged and - optionally - managed resources.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUCallbackStream::Dispose() noexcept {
+    if (m_callback.close) m_callback.close(m_callback.user);
+    m_callback.close = nullptr;
+    this->length = 0;
+    this->offset = 0;
+}
+
+/// <summary>
+/// Seeks the specified off.
+/// </summary>
+/// <param name="off">The off.</param>
+/// <param name="method">The method.</param>
+/// <returns></returns>
+bool PlayAU::CAUCallbackStream::Seek(int64_t off, Move method) noexcept {
+    uint64_t pos;
+    if (!PlayAU::StreamSeekTarget(*this, off, method, pos)) return false;
+    // 超出末尾的位置不交给回调
+    const uint64_t target = pos < this->length ? pos : this->length;
+    if (!m_callback.seek(m_callback.user, target)) return false;
+    this->offset = pos;
+    return true;
+}
+
+/// <summary>
+/// Reads the next.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <param name="buf">The buf.</param>
+/// <returns></returns>
+auto PlayAU::CAUCallbackStream::ReadNext(uint32_t len, void* buf) noexcept -> uint32_t {
+    PLAYAU_TRACE_SCOPE("callback.ReadNext");
+    const uint64_t left = this->offset < this->length ? this->length - this->offset : 0;
+    if (len > left) len = static_cast<uint32_t>(left);
+    if (!len) return 0;
+    uint32_t read = m_callback.read(m_callback.user, buf, len);
+    if (read > len) read = len;
+    this->offset += read;
+    return read;
+}
@@ -0,0 +1,333 @@
+﻿#include "../inc/au_dsp.h"
+
+#include <cstring>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PLAYAU_MIX_NEON
+#define PLAYAU_MIX_SIMD
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#define PLAYAU_MIX_AVX2
+#define PLAYAU_MIX_SIMD
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLAYAU_MIX_SSE2
+#define PLAYAU_MIX_SIMD
+#include <emmintrin.h>
+#endif
+
+
+namespace PlayAU {
+    static_assert(MIX_BLOCK_FRAMES % 16 == 0, "mix block must fill whole vectors");
+    static_assert(sizeof(float) * MIX_BLOCK_FRAMES % MIX_BUS_ALIGN == 0, "bus rows must stay aligned");
+#if defined(PLAYAU_MIX_AVX2)
+    // vector
+    using MixVec = __m256;
+    // lanes
+    enum : uint32_t { MIX_LANES = 8 };
+    // load unaligned
+    static inline MixVec MixLoadU(const float* p) noexcept { return _mm256_loadu_ps(p); }
+    // load aligned
+    static inline MixVec MixLoad(const float* p) noexcept { return _mm256_load_ps(p); }
+    // store aligned
+    static inline void MixStore(float* p, MixVec v) noexcept { _mm256_store_ps(p, v); }
+    // store unaligned
+    static inline void MixStoreU(float* p, MixVec v) noexcept { _mm256_storeu_ps(p, v); }
+    // splat
+    static inline MixVec MixSet1(float x) noexcept { return _mm256_set1_ps(x); }
+    // a * b + c, msvc /arch:AVX2 implies fma but does not define __FMA__
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+    static inline MixVec MixFma(MixVec a, MixVec b, MixVec c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static inline MixVec MixFma(MixVec a, MixVec b, MixVec c) noexcept { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+    // lane index
+    static inline MixVec MixLaneIndex() noexcept { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+    // a + b
+    static inline MixVec MixAdd(MixVec a, MixVec b) noexcept { return _mm256_add_ps(a, b); }
+    // a * b
+    static inline MixVec MixMul(MixVec a, MixVec b) noexcept { return _mm256_mul_ps(a, b); }
+#elif defined(PLAYAU_MIX_SSE2)
+    // vector
+    using MixVec = __m128;
+    // lanes
+    enum : uint32_t { MIX_LANES = 4 };
+    // load unaligned
+    static inline MixVec MixLoadU(const float* p) noexcept { return _mm_loadu_ps(p); }
+    // load aligned
+    static inline MixVec MixLoad(const float* p) noexcept { return _mm_load_ps(p); }
+    // store aligned
+    static inline void MixStore(float* p, MixVec v) noexcept { _mm_store_ps(p, v); }
+    // store unaligned
+    static inline void MixStoreU(float* p, MixVec v) noexcept { _mm_storeu_ps(p, v); }
+    // splat
+    static inline MixVec MixSet1(float x) noexcept { return _mm_set1_ps(x); }
+    // a * b + c, no fma in sse2
+    static inline MixVec MixFma(MixVec a, MixVec b, MixVec c) noexcept { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    // lane index
+    static inline MixVec MixLaneIndex() noexcept { return _mm_setr_ps(0, 1, 2, 3); }
+    // a + b
+    static inline MixVec MixAdd(MixVec a, MixVec b) noexcept { return _mm_add_ps(a, b); }
+    // a * b
+    static inline MixVec MixMul(MixVec a, MixVec b) noexcept { return _mm_mul_ps(a, b); }
+#elif defined(PLAYAU_MIX_NEON)
+    // vector
+    using MixVec = float32x4_t;
+    // lanes
+    enum : uint32_t { MIX_LANES = 4 };
+    // load unaligned
+    static inline MixVec MixLoadU(const float* p) noexcept { return vld1q_f32(p); }
+    // load aligned
+    static inline MixVec MixLoad(const float* p) noexcept { return vld1q_f32(p); }
+    // store aligned
+    static inline void MixStore(float* p, MixVec v) noexcept { vst1q_f32(p, v); }
+    // store unaligned
+    static inline void MixStoreU(float* p, MixVec v) noexcept { vst1q_f32(p, v); }
+    // splat
+    static inline MixVec MixSet1(float x) noexcept { return vdupq_n_f32(x); }
+    // a * b + c
+    static inline MixVec MixFma(MixVec a, MixVec b, MixVec c) noexcept { return vfmaq_f32(c, a, b); }
+    // lane index
+    static inline MixVec MixLaneIndex() noexcept { const float i[4] = { 0, 1, 2, 3 }; return vld1q_f32(i); }
+    // a + b
+    static inline MixVec MixAdd(MixVec a, MixVec b) noexcept { return vaddq_f32(a, b); }
+    // a * b
+    static inline MixVec MixMul(MixVec a, MixVec b) noexcept { return vmulq_f32(a, b); }
+#endif
+    // ramp step per frame
+    static inline float MixStep(float begin, float end, uint32_t frames) noexcept {
+        return frames ? (end - begin) / float(frames) : 0.f;
+    }
+    // frames done by vectors
+    static inline uint32_t MixVectorFrames(uint32_t frames) noexcept {
+#ifdef PLAYAU_MIX_SIMD
+        return frames / MIX_LANES * MIX_LANES;
+#else
+        return 0;
+#endif
+    }
+    // scalar tail of matrix/bus mix: dst[i] += (begin + step * i) * src[i]
+    static inline void MixTail(float* dst, const float* src, uint32_t from, uint32_t to, float begin, float step) noexcept {
+        for (uint32_t i = from; i < to; ++i) dst[i] += (begin + step * float(i)) * src[i];
+    }
+    // matrix entry used by mixing
+    struct MixEntry {
+        // input
+        const float*    src;
+        // gain of first frame
+        float           begin;
+        // gain step
+        float           step;
+    };
+}
+
+
+/// <summary>
+/// Clears the bus for new block.
+/// </summary>
+/// <param name="channels">The channels.</param>
+/// <param name="frames">The frames.</param>
+/// <returns></returns>
+void PlayAU::MixBus::Clear(uint32_t channels, uint32_t frames) noexcept {
+    if (channels > DSP_MAX_CHANNELS) channels = DSP_MAX_CHANNELS;
+    if (frames > MIX_BLOCK_FRAMES) frames = MIX_BLOCK_FRAMES;
+    this->channels = channels;
+    this->frames = frames;
+    for (uint32_t c = 0; c != channels; ++c)
+        std::memset(this->data[c], 0, sizeof(float) * frames);
+}
+
+/// <summary>
+/// Mixes mono into bus channel 0/1.
+/// </summary>
+/// <param name="bus">The bus.</param>
+/// <param name="mono">The mono input.</param>
+/// <param name="left">The left gain.</param>
+/// <param name="right">The right gain.</param>
+/// <returns></returns>
+void PlayAU::MixPan(MixBus& bus, const float* mono, MixRamp left, MixRamp right) noexcept {
+    if (bus.channels < 2) return PlayAU::MixPanScalar(bus, mono, left, right);
+    const uint32_t frames = bus.frames;
+    const float ls = MixStep(left.begin, left.end, frames);
+    const float rs = MixStep(right.begin, right.end, frames);
+    float* const l = bus.data[0];
+    float* const r = bus.data[1];
+    const uint32_t vec = MixVectorFrames(frames);
+#ifdef PLAYAU_MIX_SIMD
+    const MixVec lb = MixSet1(left.begin), lstep = MixSet1(ls);
+    const MixVec rb = MixSet1(right.begin), rstep = MixSet1(rs);
+    const MixVec lanes = MixSet1(float(MIX_LANES));
+    MixVec idx = MixLaneIndex();
+    for (uint32_t i = 0; i != vec; i += MIX_LANES) {
+        const MixVec x = MixLoadU(mono + i);
+        const MixVec gl = MixFma(lstep, idx, lb);
+        const MixVec gr = MixFma(rstep, idx, rb);
+        MixStore(l + i, MixFma(gl, x, MixLoad(l + i)));
+        MixStore(r + i, MixFma(gr, x, MixLoad(r + i)));
+        idx = MixAdd(idx, lanes);
+    }
+#endif
+    MixTail(l, mono, vec, frames, left.begin, ls);
+    MixTail(r, mono, vec, frames, right.begin, rs);
+}
+
+/// <summary>
+/// Mixes planar input into bus via matrix.
+/// </summary>
+/// <param name="bus">The bus.</param>
+/// <param name="in">The planar input.</param>
+/// <param name="in_channels">The input channels.</param>
+/// <param name="begin">The matrix of first frame.</param>
+/// <param name="end">The matrix of next block.</param>
+/// <returns></returns>
+void PlayAU::MixMatrix(MixBus& bus, const float* const* in, uint32_t in_channels,
+    const float* begin, const float* end) noexcept {
+    const uint32_t stride = in_channels;
+    if (in_channels > DSP_MAX_CHANNELS) in_channels = DSP_MAX_CHANNELS;
+    const uint32_t frames = bus.frames;
+    const uint32_t vec = MixVectorFrames(frames);
+    for (uint32_t d = 0; d != bus.channels; ++d) {
+        // 跳过全零系数, 降混矩阵大多稀疏
+        MixEntry entries[DSP_MAX_CHANNELS];
+        uint32_t count = 0;
+        for (uint32_t s = 0; s != in_channels; ++s) {
+            const float b = begin[d * stride + s];
+            const float e = end[d * stride + s];
+            if (b == 0.f && e == 0.f) continue;
+            entries[count++] = { in[s], b, MixStep(b, e, frames) };
+        }
+        if (!count) continue;
+        float* const dst = bus.data[d];
+#ifdef PLAYAU_MIX_SIMD
+        const MixVec lanes = MixSet1(float(MIX_LANES));
+        MixVec idx = MixLaneIndex();
+        for (uint32_t i = 0; i != vec; i += MIX_LANES) {
+            MixVec acc = MixLoad(dst + i);
+            for (uint32_t k = 0; k != count; ++k) {
+                const auto& e = entries[k];
+                const MixVec g = MixFma(MixSet1(e.step), idx, MixSet1(e.begin));
+                acc = MixFma(g, MixLoadU(e.src + i), acc);
+            }
+            MixStore(dst + i, acc);
+            idx = MixAdd(idx, lanes);
+        }
+#endif
+        for (uint32_t k = 0; k != count; ++k)
+            MixTail(dst, entries[k].src, vec, frames, entries[k].begin, entries[k].step);
+    }
+}
+
+/// <summary>
+/// Mixes bus into another bus.
+/// </summary>
+/// <param name="dst">The destination.</param>
+/// <param name="src">The source.</param>
+/// <param name="gain">The gain.</param>
+/// <returns></returns>
+void PlayAU::MixBusInto(MixBus& dst, const MixBus& src, MixRamp gain) noexcept {
+    const uint32_t channels = dst.channels < src.channels ? dst.channels : src.channels;
+    const uint32_t frames = dst.frames < src.frames ? dst.frames : src.frames;
+    const float step = MixStep(gain.begin, gain.end, frames);
+    const uint32_t vec = MixVectorFrames(frames);
+    for (uint32_t c = 0; c != channels; ++c) {
+        float* const d = dst.data[c];
+        const float* const s = src.data[c];
+#ifdef PLAYAU_MIX_SIMD
+        const MixVec gb = MixSet1(gain.begin), gs = MixSet1(step);
+        const MixVec lanes = MixSet1(float(MIX_LANES));
+        MixVec idx = MixLaneIndex();
+        for (uint32_t i = 0; i != vec; i += MIX_LANES) {
+            MixStore(d + i, MixFma(MixFma(gs, idx, gb), MixLoad(s + i), MixLoad(d + i)));
+            idx = MixAdd(idx, lanes);
+        }
+#endif
+        MixTail(d, s, vec, frames, gain.begin, step);
+    }
+}
+
+/// <summary>
+/// Applies gain ramp in place.
+/// </summary>
+/// <param name="buf">The buffer.</param>
+/// <param name="frames">The frames.</param>
+/// <param name="gain">The gain.</param>
+/// <returns></returns>
+void PlayAU::MixGain(float* buf, uint32_t frames, MixRamp gain) noexcept {
+    const float step = MixStep(gain.begin, gain.end, frames);
+    const uint32_t vec = MixVectorFrames(frames);
+#ifdef PLAYAU_MIX_SIMD
+    const MixVec gb = MixSet1(gain.begin), gs = MixSet1(step);
+    const MixVec lanes = MixSet1(float(MIX_LANES));
+    MixVec idx = MixLaneIndex();
+    // 缓冲不要求对齐
+    for (uint32_t i = 0; i != vec; i += MIX_LANES) {
+        MixStoreU(buf + i, MixMul(MixFma(gs, idx, gb), MixLoadU(buf + i)));
+        idx = MixAdd(idx, lanes);
+    }
+#endif
+    for (uint32_t i = vec; i < frames; ++i) buf[i] *= gain.begin + step * float(i);
+}
+
+/// <summary>
+/// Scalar reference of MixPan.
+/// </summary>
+/// <param name="bus">The bus.</param>
+/// <param name="mono">The mono input.</param>
+/// <param name="left">The left gain.</param>
+/// <param name="right">The right gain.</param>
+/// <returns></returns>
+void PlayAU::MixPanScalar(MixBus& bus, const float* mono, MixRamp left, MixRamp right) noexcept {
+    const uint32_t frames = bus.frames;
+    if (bus.channels > 0) MixTail(bus.data[0], mono, 0, frames, left.begin, MixStep(left.begin, left.end, frames));
+    if (bus.channels > 1) MixTail(bus.data[1], mono, 0, frames, right.begin, MixStep(right.begin, right.end, frames));
+}
+
+/// <summary>
+/// Scalar reference of MixMatrix.
+/// </summary>
+/// <param name="bus">The bus.</param>
+/// <param name="in">The planar input.</param>
+/// <param name="in_channels">The input channels.</param>
+/// <param name="begin">The matrix of first frame.</param>
+/// <param name="end">The matrix of next block.</param>
+/// <returns></returns>
+void PlayAU::MixMatrixScalar(MixBus& bus, const float* const* in, uint32_t in_channels,
+    const float* begin, const float* end) noexcept {
+    const uint32_t stride = in_channels;
+    if (in_channels > DSP_MAX_CHANNELS) in_channels = DSP_MAX_CHANNELS;
+    const uint32_t frames = bus.frames;
+    for (uint32_t d = 0; d != bus.channels; ++d) {
+        for (uint32_t s = 0; s != in_channels; ++s) {
+            const float b = begin[d * stride + s];
+            const float e = end[d * stride + s];
+            MixTail(bus.data[d], in[s], 0, frames, b, MixStep(b, e, frames));
+        }
+    }
+}
+
+/// <summary>
+/// Scalar reference of MixBusInto.
+/// </summary>
+/// <param name="dst">The destination.</param>
+/// <param name="src">The source.</param>
+/// <param name="gain">The gain.</param>
+/// <returns></returns>
+void PlayAU::MixBusIntoScalar(MixBus& dst, const MixBus& src, MixRamp gain) noexcept {
+    const uint32_t channels = dst.channels < src.channels ? dst.channels : src.channels;
+    const uint32_t frames = dst.frames < src.frames ? dst.frames : src.frames;
+    const float step = MixStep(gain.begin, gain.end, frames);
+    for (uint32_t c = 0; c != channels; ++c)
+        MixTail(dst.data[c], src.data[c], 0, frames, gain.begin, step);
+}
+
+/// <summary>
+/// Scalar reference of MixGain.
+/// </summary>
+/// <param name="buf">The buffer.</param>
+/// <param name="frames">The frames.</param>
+/// <param name="gain">The gain.</param>
+/// <returns></returns>
+void PlayAU::MixGainScalar(float* buf, uint32_t frames, MixRamp gain) noexcept {
+    const float step = MixStep(gain.begin, gain.end, frames);
+    for (uint32_t i = 0; i != frames; ++i) buf[i] *= gain.begin + step * float(i);
+}
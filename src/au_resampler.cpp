@@ -0,0 +1,310 @@
+﻿#include "../inc/au_dsp.h"
+
+#include <cstring>
+#include <cmath>
+#include <mutex>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PLAYAU_DSP_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLAYAU_DSP_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace PlayAU {
+    // resampler internal constant
+    enum : uint32_t {
+        // max taps, kernel widened 4x at most
+        RESAMPLE_MAX_TAPS = RESAMPLE_TAPS * 4,
+        // frames kept before and after position, same for all modes
+        RESAMPLE_HALF = RESAMPLE_MAX_TAPS / 2,
+        // cutoff levels, quarter octave per level up to max ratio
+        RESAMPLE_LEVELS = 17,
+        // sum of taps over levels, in RESAMPLE_TAPS / 4
+        RESAMPLE_TAPS_SUM = 4 + 5 + 6 + 7 + 8 + 10 + 12 + 14 + 16 * 9,
+        // all tables length
+        RESAMPLE_TABLE_LENGTH = (RESAMPLE_PHASES + 1) * RESAMPLE_TAPS / 4 * RESAMPLE_TAPS_SUM,
+    };
+    static_assert(RESAMPLE_TAPS % 32 == 0, "taps of each level must be multiple of 8");
+    static_assert(RESAMPLE_HALF * 3 < RESAMPLE_BUFFER, "staging buffer too short");
+    // taps of each level in RESAMPLE_TAPS / 4, not less than 2^(level/4) times base taps
+    static const uint8_t RESAMPLE_LEVEL_TAPS[RESAMPLE_LEVELS] = {
+        4, 5, 6, 7, 8, 10, 12, 14, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    };
+    // passband edge of level 0, relative to nyquist
+    static const double RESAMPLE_CUTOFF = 0.9;
+    // kaiser window beta, ~65dB stopband
+    static const double RESAMPLE_BETA = 6.5;
+    // min ratio
+    static const double RESAMPLE_MIN_RATIO = 1.0 / 1024.0;
+    // sinc tables, shared by all resamplers
+    alignas(16) static float s_aResampleTable[RESAMPLE_TABLE_LENGTH];
+    // table of each level
+    static const float* s_aResampleLevel[RESAMPLE_LEVELS];
+    // table init flags
+    static std::once_flag s_aResampleOnce[RESAMPLE_LEVELS];
+    // bessel I0 for kaiser window
+    static double ResampleBesselI0(double x) noexcept {
+        double sum = 1.0, term = 1.0;
+        const double q = x * x * 0.25;
+        for (uint32_t k = 1; k != 32; ++k) {
+            term *= q / double(k * k);
+            sum += term;
+            if (term < sum * 1e-12) break;
+        }
+        return sum;
+    }
+    // taps of level
+    static inline uint32_t ResampleTaps(uint32_t level) noexcept {
+        return RESAMPLE_LEVEL_TAPS[level] * (RESAMPLE_TAPS / 4);
+    }
+    // build table of level, cutoff scaled down a quarter octave per level
+    static void ResampleBuildTable(uint32_t level) noexcept {
+        const double pi = 3.14159265358979323846;
+        const double fc = RESAMPLE_CUTOFF * std::pow(2.0, -double(level) * 0.25);
+        const double i0beta = ResampleBesselI0(RESAMPLE_BETA);
+        const uint32_t taps = PlayAU::ResampleTaps(level), half = taps / 2;
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i != level; ++i) offset += PlayAU::ResampleTaps(i);
+        float* row = s_aResampleTable + offset * (RESAMPLE_PHASES + 1);
+        s_aResampleLevel[level] = row;
+        for (uint32_t p = 0; p <= RESAMPLE_PHASES; ++p, row += taps) {
+            const double frac = double(p) / double(RESAMPLE_PHASES);
+            double kernel[RESAMPLE_MAX_TAPS], sum = 0.0;
+            for (uint32_t k = 0; k != taps; ++k) {
+                // 抽头k对应输入帧 idx - half + 1 + k
+                const double d = double(k) - double(half - 1) - frac;
+                const double x = d / double(half);
+                double w = 0.0;
+                if (x > -1.0 && x < 1.0)
+                    w = ResampleBesselI0(RESAMPLE_BETA * std::sqrt(1.0 - x * x)) / i0beta;
+                const double t = pi * fc * d;
+                const double s = std::fabs(t) < 1e-9 ? 1.0 : std::sin(t) / t;
+                kernel[k] = fc * s * w;
+                sum += kernel[k];
+            }
+            // 直流增益归一
+            for (uint32_t k = 0; k != taps; ++k)
+                row[k] = static_cast<float>(kernel[k] / sum);
+        }
+    }
+    // get table of level
+    static const float* ResampleTable(uint32_t level) noexcept {
+        std::call_once(s_aResampleOnce[level], ResampleBuildTable, level);
+        return s_aResampleLevel[level];
+    }
+    // table level of ratio
+    static uint32_t ResampleLevel(double ratio) noexcept {
+        if (ratio <= 1.0) return 0;
+        const double lv = std::ceil(std::log2(ratio) * 4.0 - 1e-9);
+        return lv >= double(RESAMPLE_LEVELS - 1) ? RESAMPLE_LEVELS - 1 : uint32_t(lv);
+    }
+    // clamp ratio
+    static double ResampleClamp(double ratio) noexcept {
+        if (!(ratio >= RESAMPLE_MIN_RATIO)) return RESAMPLE_MIN_RATIO;
+        if (ratio > double(RESAMPLE_MAX_RATIO)) return double(RESAMPLE_MAX_RATIO);
+        return ratio;
+    }
+    // dot product, taps multiple of 8, kernel aligned
+    static inline float ResampleDot(const float* x, const float* kernel, uint32_t taps) noexcept {
+#if defined(PLAYAU_DSP_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.f), acc1 = vdupq_n_f32(0.f);
+        for (uint32_t k = 0; k != taps; k += 8) {
+            acc0 = vfmaq_f32(acc0, vld1q_f32(x + k), vld1q_f32(kernel + k));
+            acc1 = vfmaq_f32(acc1, vld1q_f32(x + k + 4), vld1q_f32(kernel + k + 4));
+        }
+        return vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(PLAYAU_DSP_SSE2)
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (uint32_t k = 0; k != taps; k += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + k), _mm_load_ps(kernel + k)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + k + 4), _mm_load_ps(kernel + k + 4)));
+        }
+        __m128 acc = _mm_add_ps(acc0, acc1);
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        return _mm_cvtss_f32(acc);
+#else
+        float sum = 0.f;
+        for (uint32_t k = 0; k != taps; ++k) sum += x[k] * kernel[k];
+        return sum;
+#endif
+    }
+    // interpolate kernel between two phases
+    static inline void ResampleKernel(float* kernel, const float* row, float frac, uint32_t taps) noexcept {
+        const float* next = row + taps;
+#if defined(PLAYAU_DSP_NEON)
+        const float32x4_t f = vdupq_n_f32(frac);
+        for (uint32_t k = 0; k != taps; k += 4) {
+            const float32x4_t a = vld1q_f32(row + k);
+            vst1q_f32(kernel + k, vfmaq_f32(a, vsubq_f32(vld1q_f32(next + k), a), f));
+        }
+#elif defined(PLAYAU_DSP_SSE2)
+        const __m128 f = _mm_set1_ps(frac);
+        for (uint32_t k = 0; k != taps; k += 4) {
+            const __m128 a = _mm_load_ps(row + k);
+            _mm_store_ps(kernel + k, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(next + k), a), f)));
+        }
+#else
+        for (uint32_t k = 0; k != taps; ++k)
+            kernel[k] = row[k] + (next[k] - row[k]) * frac;
+#endif
+    }
+}
+
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUResampler"/> class.
+/// </summary>
+PlayAU::CAUResampler::CAUResampler() noexcept {
+    this->Reset(Resample_Linear, 1, 1.0);
+}
+
+/// <summary>
+/// Resets the state.
+/// </summary>
+/// <param name="mode">The mode.</param>
+/// <param name="channels">The channels.</param>
+/// <param name="ratio">The ratio.</param>
+/// <returns></returns>
+bool PlayAU::CAUResampler::Reset(ResampleMode mode, uint32_t channels, double ratio) noexcept {
+    if (!channels || channels > DSP_MAX_CHANNELS) return false;
+    m_mode = mode;
+    m_channels = channels;
+    m_ratio = ResampleClamp(ratio);
+    m_level = ResampleLevel(m_ratio);
+    m_pTable = PlayAU::ResampleTable(m_level);
+    // 前置静音, 第一帧输出对齐第一帧输入
+    m_filled = RESAMPLE_HALF - 1;
+    m_pos = double(RESAMPLE_HALF - 1);
+    for (uint32_t c = 0; c != channels; ++c)
+        std::memset(m_buffer[c], 0, sizeof(float) * m_filled);
+    return true;
+}
+
+/// <summary>
+/// Input frames needed to render frames.
+/// </summary>
+/// <param name="out_frames">The out frames.</param>
+/// <param name="ratio">The target ratio.</param>
+/// <returns></returns>
+auto PlayAU::CAUResampler::InputNeeded(uint32_t out_frames, double ratio) const noexcept -> uint32_t {
+    if (!out_frames) return 0;
+    const double n = double(out_frames);
+    const double step = (ResampleClamp(ratio) - m_ratio) / n;
+    // 最后一帧的位置
+    const double last = m_pos + (n - 1.0) * m_ratio + step * (n - 1.0) * n * 0.5;
+    const double need = std::floor(last) + double(RESAMPLE_HALF + 1) - double(m_filled);
+    return need > 0.0 ? uint32_t(need) + 1 : 0;
+}
+
+/// <summary>
+/// Drops frames no longer needed.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUResampler::shift() noexcept {
+    const double keep = std::floor(m_pos) - double(RESAMPLE_HALF - 1);
+    if (keep <= 0.0) return;
+    const uint32_t drop = keep >= double(m_filled) ? m_filled : uint32_t(keep);
+    const uint32_t left = m_filled - drop;
+    for (uint32_t c = 0; c != m_channels; ++c)
+        std::memmove(m_buffer[c], m_buffer[c] + drop, sizeof(float) * left);
+    m_filled = left;
+    m_pos -= double(drop);
+}
+
+/// <summary>
+/// Renders one frame at position.
+/// </summary>
+/// <param name="out">The out.</param>
+/// <param name="pos">The position.</param>
+/// <returns></returns>
+void PlayAU::CAUResampler::render(float* out, double pos) noexcept {
+    const uint32_t idx = uint32_t(pos);
+    const float frac = float(pos - double(idx));
+    const uint32_t channels = m_channels;
+    switch (m_mode)
+    {
+    default:
+        for (uint32_t c = 0; c != channels; ++c) {
+            const float* x = m_buffer[c] + idx;
+            out[c] = x[0] + (x[1] - x[0]) * frac;
+        }
+        break;
+    case PlayAU::Resample_Cubic:
+        for (uint32_t c = 0; c != channels; ++c) {
+            const float* x = m_buffer[c] + idx;
+            const float a = x[-1], b = x[0], cc = x[1], d = x[2];
+            out[c] = b + 0.5f * frac * (cc - a + frac * (2.f * a - 5.f * b + 4.f * cc - d
+                + frac * (3.f * (b - cc) + d - a)));
+        }
+        break;
+    case PlayAU::Resample_Sinc:
+    {
+        // 相位间线性插值出本帧的核, 各声道共用
+        const float phase = frac * float(RESAMPLE_PHASES);
+        uint32_t pi = uint32_t(phase);
+        if (pi >= RESAMPLE_PHASES) pi = RESAMPLE_PHASES - 1;
+        const uint32_t taps = PlayAU::ResampleTaps(m_level);
+        alignas(16) float kernel[RESAMPLE_MAX_TAPS];
+        PlayAU::ResampleKernel(kernel, m_pTable + pi * taps, phase - float(pi), taps);
+        const uint32_t first = idx + 1 - taps / 2;
+        for (uint32_t c = 0; c != channels; ++c)
+            out[c] = PlayAU::ResampleDot(m_buffer[c] + first, kernel, taps);
+        break;
+    }
+    }
+}
+
+/// <summary>
+/// Processes interleaved float frames.
+/// </summary>
+/// <param name="in">The input.</param>
+/// <param name="in_frames">The input frames.</param>
+/// <param name="consumed">The input frames consumed.</param>
+/// <param name="out">The output.</param>
+/// <param name="out_frames">The output frames.</param>
+/// <param name="ratio">The target ratio.</param>
+/// <returns>frames written</returns>
+auto PlayAU::CAUResampler::Process(const float* in, uint32_t in_frames, uint32_t& consumed,
+    float* out, uint32_t out_frames, double ratio) noexcept -> uint32_t {
+    consumed = 0;
+    if (!out_frames) return 0;
+    ratio = ResampleClamp(ratio);
+    const double step = (ratio - m_ratio) / double(out_frames);
+    // 截止频率按区间内最大比率选取
+    const uint32_t level = ResampleLevel(ratio > m_ratio ? ratio : m_ratio);
+    if (level != m_level) {
+        m_level = level;
+        m_pTable = PlayAU::ResampleTable(level);
+    }
+    const uint32_t channels = m_channels;
+    uint32_t written = 0;
+    while (true) {
+        // 输出直到输入不足
+        while (written != out_frames) {
+            if (uint32_t(m_pos) + RESAMPLE_HALF >= m_filled) break;
+            this->render(out + written * channels, m_pos);
+            ++written;
+            m_ratio += step;
+            m_pos += m_ratio;
+        }
+        if (written == out_frames || consumed == in_frames) break;
+        // 拆分声道补充输入
+        this->shift();
+        uint32_t n = RESAMPLE_BUFFER - m_filled;
+        if (n > in_frames - consumed) n = in_frames - consumed;
+        const float* src = in + consumed * channels;
+        for (uint32_t c = 0; c != channels; ++c) {
+            float* dst = m_buffer[c] + m_filled;
+            for (uint32_t i = 0; i != n; ++i) dst[i] = src[i * channels + c];
+        }
+        m_filled += n;
+        consumed += n;
+    }
+    // 消除累计误差
+    if (written == out_frames) m_ratio = ratio;
+    return written;
+}
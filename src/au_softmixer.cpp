@@ -0,0 +1,951 @@
+﻿#include "../inc/au_mixer.h"
+#include "private/p_au_engine_interface.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_stats.h"
+#include "private/p_au_trace.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <new>
+#include <system_error>
+
+
+namespace PlayAU {
+    // soft mixer internal constant
+    enum : uint32_t {
+        // matrix length
+        SOFT_MATRIX_LENGTH = DSP_MAX_CHANNELS * DSP_MAX_CHANNELS,
+    };
+    /// <summary>
+    /// soft voice, touched by one render task at a time
+    /// </summary>
+    struct CAUSoftVoice {
+        // obj
+        PLAYAU_OBJ;
+        // ctor
+        CAUSoftVoice(AudioStreamHolder&& s) noexcept : stream(std::move(s)) {}
+        // dtor
+        ~CAUSoftVoice() noexcept { PlayAU::Free(this->buffer); }
+        // allocate buffers for channels and align
+        bool Init() noexcept;
+        // render block into bus
+        void Render(MixBus& bus) noexcept;
+        // fill staging, return false at end
+        bool Decode() noexcept;
+        // rewind stream and state
+        void Rewind() noexcept;
+        // next voice in pending list
+        CAUSoftVoice*               next = nullptr;
+        // audio stream
+        AudioStreamHolder           stream;
+        // volume
+        std::atomic<float>          volume{ 1.f };
+        // frequency ratio
+        std::atomic<float>          ratio{ 1.f };
+        // doppler ratio of 3d emitter
+        std::atomic<float>          doppler{ 1.f };
+        // resample mode
+        std::atomic<uint8_t>        mode{ Resample_Linear };
+        // playing
+        std::atomic<bool>           playing{ false };
+        // loop
+        std::atomic<bool>           loop{ false };
+        // stop requested, rewound by render thread
+        std::atomic<bool>           stop{ false };
+        // destroy requested
+        std::atomic<bool>           destroyed{ false };
+        // output matrix version requested
+        std::atomic<uint32_t>       version{ 0 };
+        // output matrix requested, out * channels + in
+        std::atomic<float>          target[SOFT_MATRIX_LENGTH];
+        // volume of last block
+        float                       gain = 0.f;
+        // group
+        uint32_t                    group = 0;
+        // group mode epoch applied
+        uint32_t                    epoch = 0;
+        // 3d emitter id, touched by api thread only
+        uint32_t                    emitter = SPATIAL_NO_EMITTER;
+        // output matrix version applied
+        uint32_t                    applied = 0;
+        // channel count
+        uint32_t                    channels = 0;
+        // bytes per frame
+        uint32_t                    align = 0;
+        // staged frames left
+        uint32_t                    staged = 0;
+        // staged frames read
+        uint32_t                    offset = 0;
+        // source rate / output rate
+        double                      base = 1.0;
+        // resampler
+        CAUResampler                resampler;
+        // output matrix, out * channels + in
+        float                       matrix[SOFT_MATRIX_LENGTH];
+        // planar block, MIX_BLOCK_FRAMES per channel
+        float*                      planar = nullptr;
+        // resampled interleaved block
+        float*                      resampled = nullptr;
+        // decoded interleaved float
+        float*                      staging = nullptr;
+        // raw bytes
+        uint8_t*                    raw = nullptr;
+        // buffer storage
+        void*                       buffer = nullptr;
+    };
+    // render task: voices of one group
+    struct SoftTask {
+        // first voice in order
+        uint32_t    first;
+        // voice count
+        uint32_t    count;
+        // group
+        uint32_t    group;
+    };
+    // task queue, owner pops back, others steal front
+    struct SoftQueue {
+        // lock
+        std::mutex  mutex;
+        // head
+        uint32_t    head = 0;
+        // tail
+        uint32_t    tail = 0;
+        // task index
+        uint16_t    tasks[SOFT_MAX_TASKS];
+        // push
+        void Push(uint32_t task) noexcept {
+            std::lock_guard<std::mutex> locker{ mutex };
+            tasks[tail++] = uint16_t(task);
+        }
+        // pop back, false if empty
+        bool Pop(uint32_t& task) noexcept {
+            std::lock_guard<std::mutex> locker{ mutex };
+            if (head == tail) return false;
+            task = tasks[--tail];
+            if (head == tail) head = tail = 0;
+            return true;
+        }
+        // steal front, false if empty
+        bool Steal(uint32_t& task) noexcept {
+            std::lock_guard<std::mutex> locker{ mutex };
+            if (head == tail) return false;
+            task = tasks[head++];
+            if (head == tail) head = tail = 0;
+            return true;
+        }
+    };
+    /// <summary>
+    /// soft renderer, render graph: group tasks on workers, then master reduce on render thread
+    /// </summary>
+    struct CAUSoftRenderer {
+        // obj
+        PLAYAU_OBJ;
+        // ctor
+        CAUSoftRenderer(uint32_t rate, uint32_t channels, uint32_t threads, float budget) noexcept;
+        // dtor
+        ~CAUSoftRenderer() noexcept;
+        // start workers
+        auto Start() noexcept->Result;
+        // stop and join started workers
+        void Shutdown() noexcept;
+        // render one block
+        void RenderBlock(float* out, uint32_t frames) noexcept;
+        // apply pending voices and destroy requests
+        void Sync() noexcept;
+        // run tasks until none left
+        void Work(uint32_t id) noexcept;
+        // run task
+        void RunTask(uint32_t task) noexcept;
+        // worker thread
+        void Loop(uint32_t id) noexcept;
+        // list lock
+        std::mutex                  mutex;
+        // pending voices
+        CAUSoftVoice*               pending = nullptr;
+        // resample mode of group
+        std::atomic<uint8_t>        group_mode[MAX_GROUP_COUNT];
+        // resample mode change count of group
+        std::atomic<uint32_t>       group_epoch[MAX_GROUP_COUNT];
+        // volume of group
+        std::atomic<float>          group_volume[MAX_GROUP_COUNT];
+        // volume of group in last block
+        float                       group_gain[MAX_GROUP_COUNT];
+        // voices alive count, including pending
+        std::atomic<uint32_t>       alive{ 0 };
+        // output rate
+        uint32_t        const       rate;
+        // output channels
+        uint32_t        const       channels;
+        // threads
+        uint32_t        const       threads;
+        // deadline as part of block time
+        float           const       budget;
+        // frames of block in progress
+        uint32_t                    frames = 0;
+        // voices in render
+        uint32_t                    count = 0;
+        // task count
+        uint32_t                    task_count = 0;
+        // voices in creation order
+        CAUSoftVoice*               voices[SOFT_MAX_VOICES];
+        // voices by group
+        CAUSoftVoice*               order[SOFT_MAX_VOICES];
+        // tasks
+        SoftTask                    tasks[SOFT_MAX_TASKS];
+        // task queues
+        SoftQueue                   queues[SOFT_MAX_THREADS];
+        // tasks left in block
+        std::atomic<uint32_t>       remaining{ 0 };
+        // worker lock
+        std::mutex                  work_mutex;
+        // start signal
+        std::condition_variable     start_cv;
+        // done signal
+        std::condition_variable     done_cv;
+        // block generation
+        uint64_t                    generation = 0;
+        // exit
+        bool                        exit = false;
+        // workers
+        std::thread                 workers[SOFT_MAX_THREADS];
+        // stats: blocks
+        std::atomic<uint64_t>       blocks{ 0 };
+        // stats: late blocks
+        std::atomic<uint64_t>       late_blocks{ 0 };
+        // stats: render time
+        std::atomic<uint64_t>       render_ns{ 0 };
+        // stats: max render time
+        std::atomic<uint64_t>       render_max_ns{ 0 };
+        // stats: deadline time
+        std::atomic<uint64_t>       deadline_ns{ 0 };
+        // stats: steals
+        std::atomic<uint64_t>       steals{ 0 };
+        // stats: render thread cpu time in blocks
+        std::atomic<uint64_t>       render_cpu_ns{ 0 };
+        // stats: worker thread cpu time, updated after each block
+        std::atomic<uint64_t>       worker_cpu_ns[SOFT_MAX_THREADS] = {};
+        // task buses
+        MixBus*                     buses = nullptr;
+        // master bus
+        MixBus*                     master = nullptr;
+        // bus storage
+        void*                       bus_storage = nullptr;
+    };
+    // read sample as float
+    static inline float SoftSample(const WaveFormat& fmt, const uint8_t* ptr) noexcept {
+        switch (fmt.bits_per_sample)
+        {
+        case 8:
+            return (float(ptr[0]) - 128.f) * (1.f / 128.f);
+        case 16:
+            return float(int16_t(uint16_t(ptr[0] | (ptr[1] << 8)))) * (1.f / 32768.f);
+        case 24:
+            return float(int32_t(uint32_t(ptr[0]) << 8 | uint32_t(ptr[1]) << 16 | uint32_t(ptr[2]) << 24) >> 8) * (1.f / 8388608.f);
+        case 32:
+            if (fmt.fmt_tag == Wave_IEEEFloat) { float f; std::memcpy(&f, ptr, 4); return f; }
+            { int32_t v; std::memcpy(&v, ptr, 4); return float(v) * (1.f / 2147483648.f); }
+        }
+        return 0.f;
+    }
+    // request output matrix, render thread ramps to it over next block
+    static void SoftRequestMatrix(CAUSoftVoice& voice, const float* matrix, uint32_t len) noexcept {
+        for (uint32_t i = 0; i != len; ++i) voice.target[i].store(matrix[i], std::memory_order_relaxed);
+        voice.version.fetch_add(1, std::memory_order_release);
+    }
+    // create spatializer if not created
+    bool StartSpatializer(CAUSpatializer*& spatial) noexcept;
+}
+
+
+/// <summary>
+/// Allocates the buffers sized by channels and align.
+/// </summary>
+/// <returns></returns>
+bool PlayAU::CAUSoftVoice::Init() noexcept {
+    const size_t block = size_t(MIX_BLOCK_FRAMES) * this->channels;
+    const size_t staging_len = size_t(SOFT_STAGING_FRAMES) * this->channels;
+    const size_t len = sizeof(float) * (block * 2 + staging_len)
+        + size_t(SOFT_STAGING_FRAMES) * this->align + MIX_BUS_ALIGN;
+    this->buffer = PlayAU::Alloc(len);
+    if (!this->buffer) return false;
+    // 平面块与总线一样对齐
+    auto addr = reinterpret_cast<uintptr_t>(this->buffer);
+    addr = (addr + MIX_BUS_ALIGN - 1) & ~uintptr_t(MIX_BUS_ALIGN - 1);
+    this->planar = reinterpret_cast<float*>(addr);
+    this->resampled = this->planar + block;
+    this->staging = this->resampled + block;
+    this->raw = reinterpret_cast<uint8_t*>(this->staging + staging_len);
+    return true;
+}
+
+/// <summary>
+/// Decodes next frames into staging.
+/// </summary>
+/// <returns>false at end of stream</returns>
+bool PlayAU::CAUSoftVoice::Decode() noexcept {
+    const auto& fmt = this->stream->format;
+    const uint32_t size = fmt.bits_per_sample / 8;
+    const uint32_t len = SOFT_STAGING_FRAMES * this->align;
+    uint32_t read = this->stream->ReadNext(len, this->raw);
+    // 循环播放
+    if (!read && this->loop.load(std::memory_order_relaxed)) {
+        this->stream->Seek(0, XAUStream::Move_Begin);
+        read = this->stream->ReadNext(len, this->raw);
+    }
+    const uint32_t frames = read / this->align;
+    const uint32_t samples = frames * this->channels;
+    const uint8_t* src = this->raw;
+    for (uint32_t i = 0; i != samples; ++i, src += size)
+        this->staging[i] = PlayAU::SoftSample(fmt, src);
+    this->staged = frames;
+    this->offset = 0;
+    return frames != 0;
+}
+
+/// <summary>
+/// Rewinds stream and state.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoftVoice::Rewind() noexcept {
+    this->stream->Seek(0, XAUStream::Move_Begin);
+    this->staged = this->offset = 0;
+    this->resampler.Reset(this->resampler.GetMode(), this->channels, this->resampler.GetRatio());
+    this->gain = 0.f;
+}
+
+/// <summary>
+/// Renders one block into bus.
+/// </summary>
+/// <param name="bus">The bus.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftVoice::Render(MixBus& bus) noexcept {
+    if (this->stop.exchange(false, std::memory_order_acquire)) this->Rewind();
+    if (!this->playing.load(std::memory_order_relaxed)) return;
+    const uint32_t frames = bus.frames;
+    const uint32_t ch = this->channels;
+    this->resampler.SetMode(ResampleMode(this->mode.load(std::memory_order_relaxed)));
+    const double target = this->base
+        * double(this->ratio.load(std::memory_order_relaxed))
+        * double(this->doppler.load(std::memory_order_relaxed));
+    // 解码+重采样直到填满本块
+    uint32_t done = 0;
+    while (done != frames) {
+        if (!this->staged && !this->Decode()) {
+            this->playing.store(false, std::memory_order_relaxed);
+            break;
+        }
+        uint32_t consumed = 0;
+        done += this->resampler.Process(this->staging + this->offset * ch, this->staged, consumed,
+            this->resampled + done * ch, frames - done, target);
+        this->offset += consumed;
+        this->staged -= consumed;
+    }
+    std::memset(this->resampled + done * ch, 0, sizeof(float) * (frames - done) * ch);
+    // 拆分声道后按矩阵混入
+    const float* planes[DSP_MAX_CHANNELS];
+    for (uint32_t c = 0; c != ch; ++c) {
+        float* const dst = this->planar + c * MIX_BLOCK_FRAMES;
+        const float* src = this->resampled + c;
+        for (uint32_t i = 0; i != frames; ++i, src += ch) dst[i] = *src;
+        planes[c] = dst;
+    }
+    const float volume = this->volume.load(std::memory_order_relaxed);
+    const uint32_t len = ch * bus.channels;
+    // 新矩阵与音量一起在本块内渐变
+    float next[SOFT_MATRIX_LENGTH];
+    const auto version = this->version.load(std::memory_order_acquire);
+    if (version != this->applied) {
+        for (uint32_t i = 0; i != len; ++i) next[i] = this->target[i].load(std::memory_order_relaxed);
+        this->applied = version;
+    }
+    else std::memcpy(next, this->matrix, sizeof(float) * len);
+    float begin[SOFT_MATRIX_LENGTH], end[SOFT_MATRIX_LENGTH];
+    for (uint32_t i = 0; i != len; ++i) {
+        begin[i] = this->matrix[i] * this->gain;
+        end[i] = next[i] * volume;
+    }
+    PlayAU::MixMatrix(bus, planes, ch, begin, end);
+    std::memcpy(this->matrix, next, sizeof(float) * len);
+    this->gain = volume;
+}
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUSoftRenderer"/> struct.
+/// </summary>
+/// <param name="rate">The rate.</param>
+/// <param name="channels">The channels.</param>
+/// <param name="threads">The threads.</param>
+/// <param name="budget">The budget.</param>
+PlayAU::CAUSoftRenderer::CAUSoftRenderer(uint32_t rate, uint32_t channels, uint32_t threads, float budget) noexcept
+    : rate(rate), channels(channels), threads(threads), budget(budget) {
+    for (uint32_t g = 0; g != MAX_GROUP_COUNT; ++g) {
+        group_mode[g].store(Resample_Linear, std::memory_order_relaxed);
+        group_epoch[g].store(0, std::memory_order_relaxed);
+        group_volume[g].store(1.f, std::memory_order_relaxed);
+        group_gain[g] = 1.f;
+    }
+}
+
+/// <summary>
+/// Starts the workers.
+/// </summary>
+/// <returns></returns>
+auto PlayAU::CAUSoftRenderer::Start() noexcept -> Result {
+    // 总线要求64字节对齐
+    const size_t len = sizeof(MixBus) * (SOFT_MAX_TASKS + 1) + MIX_BUS_ALIGN;
+    this->bus_storage = PlayAU::Alloc(len);
+    if (!this->bus_storage) return{ Result::RE_OUTOFMEMORY };
+    auto addr = reinterpret_cast<uintptr_t>(this->bus_storage);
+    addr = (addr + MIX_BUS_ALIGN - 1) & ~uintptr_t(MIX_BUS_ALIGN - 1);
+    this->buses = reinterpret_cast<MixBus*>(addr);
+    this->master = this->buses + SOFT_MAX_TASKS;
+    for (uint32_t i = 1; i < this->threads; ++i) {
+        try {
+            this->workers[i] = std::thread([this, i]() noexcept { this->Loop(i); });
+        }
+        catch (const std::system_error&) {
+            // 已启动的线程退出后失败
+            this->Shutdown();
+            return{ Result::RE_FAIL };
+        }
+    }
+    return{ Result::RS_OK };
+}
+
+/// <summary>
+/// Stops and joins the started workers.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoftRenderer::Shutdown() noexcept {
+    {
+        std::lock_guard<std::mutex> locker{ this->work_mutex };
+        this->exit = true;
+    }
+    this->start_cv.notify_all();
+    for (uint32_t i = 1; i < this->threads; ++i)
+        if (this->workers[i].joinable()) this->workers[i].join();
+}
+
+/// <summary>
+/// Finalizes an instance of the <see cref="CAUSoftRenderer"/> class.
+/// </summary>
+/// <returns></returns>
+PlayAU::CAUSoftRenderer::~CAUSoftRenderer() noexcept {
+    this->Shutdown();
+    // 释放全部声部
+    this->Sync();
+    for (uint32_t i = 0; i != this->count; ++i) delete this->voices[i];
+    PlayAU::Free(this->bus_storage);
+}
+
+/// <summary>
+/// Applies pending voices and destroy requests.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoftRenderer::Sync() noexcept {
+    CAUSoftVoice* list;
+    {
+        std::lock_guard<std::mutex> locker{ this->mutex };
+        list = this->pending;
+        this->pending = nullptr;
+    }
+    // 新声部按创建顺序追加
+    CAUSoftVoice* reversed = nullptr;
+    while (list) { const auto next = list->next; list->next = reversed; reversed = list; list = next; }
+    for (; reversed; reversed = reversed->next) this->voices[this->count++] = reversed;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i != this->count; ++i) {
+        const auto voice = this->voices[i];
+        if (voice->destroyed.load(std::memory_order_acquire)) {
+            delete voice;
+            this->alive.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else this->voices[kept++] = voice;
+    }
+    this->count = kept;
+}
+
+/// <summary>
+/// Runs tasks until none left.
+/// </summary>
+/// <param name="id">The worker id.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftRenderer::Work(uint32_t id) noexcept {
+    uint32_t task;
+    while (true) {
+        if (this->queues[id].Pop(task)) { this->RunTask(task); continue; }
+        // 自己的队列空了, 从其他线程队首窃取
+        bool stolen = false;
+        for (uint32_t i = 1; i != this->threads && !stolen; ++i) {
+            if (this->queues[(id + i) % this->threads].Steal(task)) {
+                PlayAU::StatsAdd<uint64_t>(this->steals, 1);
+                this->RunTask(task);
+                stolen = true;
+            }
+        }
+        if (!stolen) return;
+    }
+}
+
+/// <summary>
+/// Runs the task.
+/// </summary>
+/// <param name="index">The index.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftRenderer::RunTask(uint32_t index) noexcept {
+    PLAYAU_TRACE_SCOPE("soft.Task");
+    const auto& task = this->tasks[index];
+    MixBus& bus = this->buses[index];
+    bus.Clear(this->channels, this->frames);
+    for (uint32_t i = 0; i != task.count; ++i)
+        this->order[task.first + i]->Render(bus);
+    // 最后一个任务唤醒渲染线程
+    if (this->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> locker{ this->work_mutex };
+        this->done_cv.notify_one();
+    }
+}
+
+/// <summary>
+/// Worker loop.
+/// </summary>
+/// <param name="id">The worker id.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftRenderer::Loop(uint32_t id) noexcept {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> locker{ this->work_mutex };
+            this->start_cv.wait(locker, [&]() noexcept { return this->exit || this->generation != seen; });
+            if (this->exit) return;
+            seen = this->generation;
+        }
+        this->Work(id);
+        this->worker_cpu_ns[id].store(PlayAU::StatsThreadCpu(), std::memory_order_relaxed);
+    }
+}
+
+/// <summary>
+/// Renders one block.
+/// </summary>
+/// <param name="out">The out.</param>
+/// <param name="frames">The frames.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftRenderer::RenderBlock(float* out, uint32_t frames) noexcept {
+    PLAYAU_TRACE_SCOPE("soft.Render");
+    const auto begin = PlayAU::StatsNow();
+    const auto cpu = PlayAU::StatsThreadCpu();
+    this->Sync();
+    this->frames = frames;
+    // 按分组排序, 每组切分为任务, 任务总数受总线数限制
+    uint32_t per_group[MAX_GROUP_COUNT] = {}, start[MAX_GROUP_COUNT];
+    for (uint32_t i = 0; i != this->count; ++i) ++per_group[this->voices[i]->group];
+    uint32_t chunk = (this->count + SOFT_MAX_TASKS - MAX_GROUP_COUNT - 1) / (SOFT_MAX_TASKS - MAX_GROUP_COUNT);
+    if (chunk < SOFT_TASK_VOICES) chunk = SOFT_TASK_VOICES;
+    this->task_count = 0;
+    for (uint32_t g = 0, pos = 0; g != MAX_GROUP_COUNT; ++g) {
+        start[g] = pos;
+        for (uint32_t first = 0; first < per_group[g]; first += chunk) {
+            const uint32_t left = per_group[g] - first;
+            this->tasks[this->task_count++] = { pos + first, left < chunk ? left : chunk, g };
+        }
+        pos += per_group[g];
+    }
+    for (uint32_t i = 0; i != this->count; ++i) {
+        const auto voice = this->voices[i];
+        const uint32_t g = voice->group;
+        this->order[start[g]++] = voice;
+        // 分组重采样模式有变化
+        const uint32_t epoch = this->group_epoch[g].load(std::memory_order_acquire);
+        if (voice->epoch != epoch) {
+            voice->epoch = epoch;
+            voice->mode.store(this->group_mode[g].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+    // 任务轮流分配给各线程, 渲染线程作为0号线程参与
+    if (this->task_count) {
+        this->remaining.store(this->task_count, std::memory_order_relaxed);
+        for (uint32_t i = 0; i != this->task_count; ++i)
+            this->queues[i % this->threads].Push(i);
+        if (this->threads > 1) {
+            {
+                std::lock_guard<std::mutex> locker{ this->work_mutex };
+                ++this->generation;
+            }
+            this->start_cv.notify_all();
+        }
+        this->Work(0);
+        std::unique_lock<std::mutex> locker{ this->work_mutex };
+        this->done_cv.wait(locker, [this]() noexcept {
+            return !this->remaining.load(std::memory_order_acquire);
+        });
+    }
+    // 分组总线按任务顺序汇总到主总线, 结果与线程数无关
+    MixBus& master = *this->master;
+    master.Clear(this->channels, frames);
+    float volume[MAX_GROUP_COUNT];
+    for (uint32_t g = 0; g != MAX_GROUP_COUNT; ++g)
+        volume[g] = this->group_volume[g].load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i != this->task_count; ++i) {
+        const uint32_t g = this->tasks[i].group;
+        PlayAU::MixBusInto(master, this->buses[i], { this->group_gain[g], volume[g] });
+    }
+    for (uint32_t g = 0; g != MAX_GROUP_COUNT; ++g) this->group_gain[g] = volume[g];
+    for (uint32_t c = 0; c != this->channels; ++c) {
+        const float* src = master.data[c];
+        float* dst = out + c;
+        for (uint32_t i = 0; i != frames; ++i, dst += this->channels) *dst = src[i];
+    }
+    // 截止时间统计
+    const uint64_t ns = PlayAU::StatsNow() - begin;
+    const auto deadline = uint64_t(double(frames) * 1e9 / double(this->rate) * double(this->budget));
+    PlayAU::StatsAdd<uint64_t>(this->blocks, 1);
+    PlayAU::StatsAdd<uint64_t>(this->render_ns, ns);
+    PlayAU::StatsAdd<uint64_t>(this->render_cpu_ns, PlayAU::StatsThreadCpu() - cpu);
+    PlayAU::StatsAdd<uint64_t>(this->deadline_ns, deadline);
+    PlayAU::StatsMax<uint64_t>(this->render_max_ns, ns);
+    if (ns > deadline) PlayAU::StatsAdd<uint64_t>(this->late_blocks, 1);
+}
+
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUSoftMixer"/> class.
+/// </summary>
+PlayAU::CAUSoftMixer::CAUSoftMixer() noexcept {
+}
+
+/// <summary>
+/// Finalizes an instance of the <see cref="CAUSoftMixer"/> class.
+/// </summary>
+/// <returns></returns>
+PlayAU::CAUSoftMixer::~CAUSoftMixer() noexcept {
+    this->Uninitialize();
+}
+
+/// <summary>
+/// Initializes the mixer.
+/// </summary>
+/// <param name="rate">The rate.</param>
+/// <param name="channels">The channels.</param>
+/// <param name="threads">The threads.</param>
+/// <param name="budget">The budget.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoftMixer::Initialize(uint32_t rate, uint32_t channels, uint32_t threads, float budget) noexcept -> Result {
+    if (m_pRenderer) return{ Result::RE_UNEXPECTED };
+    if (!rate || !channels || channels > DSP_MAX_CHANNELS || !(budget > 0.f))
+        return{ Result::RE_INVALIDARG };
+    if (!threads) threads = std::thread::hardware_concurrency();
+    if (!threads) threads = 1;
+    if (threads > SOFT_MAX_THREADS) threads = SOFT_MAX_THREADS;
+    MemoryKindScope kind{ Memory_Mixer };
+    const auto renderer = new(std::nothrow) CAUSoftRenderer{ rate, channels, threads, budget };
+    if (!renderer) return{ Result::RE_OUTOFMEMORY };
+    const auto hr = renderer->Start();
+    if (!hr) {
+        delete renderer;
+        return hr;
+    }
+    m_pRenderer = renderer;
+    m_rate = rate;
+    m_channels = channels;
+    return{ Result::RS_OK };
+}
+
+/// <summary>
+/// Uninitializes the mixer.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::Uninitialize() noexcept {
+    delete m_pSpatial;
+    m_pSpatial = nullptr;
+    if (m_pRenderer) {
+        MemoryKindScope kind{ Memory_Mixer };
+        delete m_pRenderer;
+        m_pRenderer = nullptr;
+    }
+}
+
+/// <summary>
+/// Renders interleaved float.
+/// </summary>
+/// <param name="out">The out.</param>
+/// <param name="frames">The frames.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::Render(float* out, uint32_t frames) noexcept {
+    if (!m_pRenderer) return std::memset(out, 0, sizeof(float) * frames * m_channels), void();
+    while (frames) {
+        const uint32_t n = frames < MIX_BLOCK_FRAMES ? frames : MIX_BLOCK_FRAMES;
+        m_pRenderer->RenderBlock(out, n);
+        out += n * m_channels;
+        frames -= n;
+    }
+}
+
+/// <summary>
+/// Gets the stats.
+/// </summary>
+/// <param name="stats">The stats.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::GetStats(SoftMixerStats& stats) const noexcept {
+    std::memset(&stats, 0, sizeof(stats));
+    const auto r = m_pRenderer;
+    if (!r) return;
+    stats.blocks = r->blocks.load(std::memory_order_relaxed);
+    stats.late_blocks = r->late_blocks.load(std::memory_order_relaxed);
+    stats.render_ns = r->render_ns.load(std::memory_order_relaxed);
+    stats.render_max_ns = r->render_max_ns.load(std::memory_order_relaxed);
+    stats.deadline_ns = r->deadline_ns.load(std::memory_order_relaxed);
+    stats.steals = r->steals.load(std::memory_order_relaxed);
+    stats.cpu_ns = r->render_cpu_ns.load(std::memory_order_relaxed);
+    for (uint32_t i = 1; i < r->threads; ++i)
+        stats.cpu_ns += r->worker_cpu_ns[i].load(std::memory_order_relaxed);
+    stats.voices = r->alive.load(std::memory_order_relaxed);
+    stats.threads = r->threads;
+}
+
+/// <summary>
+/// Creates the voice.
+/// </summary>
+/// <param name="stream">The stream.</param>
+/// <param name="group">The group.</param>
+/// <returns></returns>
+auto PlayAU::CAUSoftMixer::CreateVoice(AudioStreamHolder&& stream, uint32_t group) noexcept -> Voice {
+    const auto r = m_pRenderer;
+    if (!r || !stream || group >= MAX_GROUP_COUNT) return nullptr;
+    const auto& fmt = stream->format;
+    const uint32_t size = fmt.bits_per_sample / 8;
+    if (!fmt.channels || fmt.channels > DSP_MAX_CHANNELS || !fmt.samples_per_sec) return nullptr;
+    if (size < 1 || size > 4 || (fmt.fmt_tag == Wave_IEEEFloat && size != 4)) return nullptr;
+    if (r->alive.fetch_add(1, std::memory_order_relaxed) >= SOFT_MAX_VOICES) {
+        r->alive.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    MemoryKindScope kind{ Memory_Mixer };
+    const auto voice = new(std::nothrow) CAUSoftVoice{ std::move(stream) };
+    if (voice) {
+        voice->channels = fmt.channels;
+        voice->align = size * fmt.channels;
+    }
+    if (!voice || !voice->Init()) {
+        delete voice;
+        r->alive.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    voice->group = group;
+    voice->base = double(fmt.samples_per_sec) / double(m_rate);
+    voice->epoch = r->group_epoch[group].load(std::memory_order_acquire);
+    const auto mode = ResampleMode(r->group_mode[group].load(std::memory_order_relaxed));
+    voice->mode.store(mode, std::memory_order_relaxed);
+    voice->resampler.Reset(mode, fmt.channels, voice->base);
+    PlayAU::GetChannelMatrix(fmt.channels, m_channels, voice->matrix);
+    PlayAU::SoftRequestMatrix(*voice, voice->matrix, fmt.channels * m_channels);
+    voice->applied = voice->version.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> locker{ r->mutex };
+    voice->next = r->pending;
+    r->pending = voice;
+    return voice;
+}
+
+/// <summary>
+/// Destroys the voice.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::DestroyVoice(Voice voice) noexcept {
+    if (!voice) return;
+    if (voice->emitter != SPATIAL_NO_EMITTER) m_pSpatial->RemoveEmitter(voice->emitter);
+    voice->destroyed.store(true, std::memory_order_release);
+}
+
+/// <summary>
+/// Plays the voice.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::Play(Voice voice) noexcept {
+    if (voice) voice->playing.store(true, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Pauses the voice.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::Pause(Voice voice) noexcept {
+    if (voice) voice->playing.store(false, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Stops the voice and rewinds.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::Stop(Voice voice) noexcept {
+    if (!voice) return;
+    voice->playing.store(false, std::memory_order_relaxed);
+    voice->stop.store(true, std::memory_order_release);
+}
+
+/// <summary>
+/// Determines whether the voice is playing.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <returns></returns>
+bool PlayAU::CAUSoftMixer::IsPlaying(Voice voice) const noexcept {
+    return voice ? voice->playing.load(std::memory_order_relaxed) : false;
+}
+
+/// <summary>
+/// Sets the loop.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <param name="loop">if set to <c>true</c> [loop].</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::SetLoop(Voice voice, bool loop) noexcept {
+    if (voice) voice->loop.store(loop, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Sets the volume.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <param name="volume">The volume.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::SetVolume(Voice voice, float volume) noexcept {
+    if (voice) voice->volume.store(volume, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Sets the frequency ratio.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <param name="ratio">The ratio.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::SetFrequencyRatio(Voice voice, float ratio) noexcept {
+    if (voice) voice->ratio.store(ratio, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Sets the resample mode.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <param name="mode">The mode.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::SetResampleMode(Voice voice, ResampleMode mode) noexcept {
+    if (voice) voice->mode.store(mode, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Sets the output matrix.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <param name="matrix">The matrix, nullptr for standard one.</param>
+/// <returns></returns>
+bool PlayAU::CAUSoftMixer::SetOutputMatrix(Voice voice, const float* matrix) noexcept {
+    if (!voice) return false;
+    float standard[SOFT_MATRIX_LENGTH];
+    if (!matrix) {
+        PlayAU::GetChannelMatrix(voice->channels, m_channels, standard);
+        matrix = standard;
+    }
+    PlayAU::SoftRequestMatrix(*voice, matrix, voice->channels * m_channels);
+    return true;
+}
+
+/// <summary>
+/// Sets the pan.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <param name="pan">The pan, -1 for left, 1 for right.</param>
+/// <returns></returns>
+bool PlayAU::CAUSoftMixer::SetPan(Voice voice, float pan) noexcept {
+    if (!voice) return false;
+    float matrix[SOFT_MATRIX_LENGTH];
+    PlayAU::GetPanMatrix(voice->channels, m_channels, pan, matrix);
+    PlayAU::SoftRequestMatrix(*voice, matrix, voice->channels * m_channels);
+    return true;
+}
+
+/// <summary>
+/// Sets the listener.
+/// </summary>
+/// <param name="listener">The listener.</param>
+/// <returns></returns>
+bool PlayAU::CAUSoftMixer::SetListener(const AudioListener& listener) noexcept {
+    if (!PlayAU::StartSpatializer(m_pSpatial)) return false;
+    m_pSpatial->SetListener(listener);
+    return true;
+}
+
+/// <summary>
+/// Sets the 3d emitter.
+/// </summary>
+/// <param name="voice">The voice.</param>
+/// <param name="emitter">The emitter, nullptr for 2d.</param>
+/// <returns></returns>
+bool PlayAU::CAUSoftMixer::SetEmitter(Voice voice, const AudioEmitter* emitter) noexcept {
+    if (!voice) return false;
+    // 回到2d: 标准矩阵, 去掉多普勒
+    if (!emitter) {
+        if (voice->emitter == SPATIAL_NO_EMITTER) return true;
+        m_pSpatial->RemoveEmitter(voice->emitter);
+        voice->emitter = SPATIAL_NO_EMITTER;
+        voice->doppler.store(1.f, std::memory_order_relaxed);
+        return this->SetOutputMatrix(voice, nullptr);
+    }
+    if (voice->emitter != SPATIAL_NO_EMITTER) {
+        m_pSpatial->SetEmitter(voice->emitter, *emitter);
+        return true;
+    }
+    if (!PlayAU::StartSpatializer(m_pSpatial)) return false;
+    voice->emitter = m_pSpatial->AddEmitter(*emitter, voice);
+    return voice->emitter != SPATIAL_NO_EMITTER;
+}
+
+/// <summary>
+/// Updates 3d voices.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::Update3D() noexcept {
+    const auto spatial = m_pSpatial;
+    if (!spatial) return;
+    PLAYAU_TRACE_SCOPE("soft.Update3D");
+    // 批量计算后写入各声部, 渲染线程在下一块渐变过去
+    spatial->Update();
+    float matrix[SOFT_MATRIX_LENGTH];
+    const uint32_t end = spatial->GetEnd();
+    for (uint32_t id = 0; id != end; ++id) {
+        const auto voice = static_cast<CAUSoftVoice*>(spatial->GetUser(id));
+        if (!voice) continue;
+        spatial->GetMatrix(id, voice->channels, m_channels, matrix);
+        PlayAU::SoftRequestMatrix(*voice, matrix, voice->channels * m_channels);
+        voice->doppler.store(spatial->GetDoppler(id), std::memory_order_relaxed);
+    }
+}
+
+/// <summary>
+/// Sets the group volume.
+/// </summary>
+/// <param name="group">The group.</param>
+/// <param name="volume">The volume.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::SetGroupVolume(uint32_t group, float volume) noexcept {
+    if (m_pRenderer && group < MAX_GROUP_COUNT)
+        m_pRenderer->group_volume[group].store(volume, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Sets the resample mode of group.
+/// </summary>
+/// <param name="group">The group.</param>
+/// <param name="mode">The mode.</param>
+/// <returns></returns>
+void PlayAU::CAUSoftMixer::SetGroupResampleMode(uint32_t group, ResampleMode mode) noexcept {
+    const auto r = m_pRenderer;
+    if (!r || group >= MAX_GROUP_COUNT) return;
+    // 渲染线程看到新的计数后给已有声部换模式
+    r->group_mode[group].store(mode, std::memory_order_relaxed);
+    r->group_epoch[group].fetch_add(1, std::memory_order_release);
+}
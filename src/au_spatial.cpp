@@ -0,0 +1,320 @@
+﻿#include "../inc/au_spatial.h"
+#include "../inc/au_dsp.h"
+#include "private/p_au_memory.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PLAYAU_SPATIAL_NEON
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#define PLAYAU_SPATIAL_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLAYAU_SPATIAL_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace PlayAU {
+    // min distance, avoid zero division
+    static const float SPATIAL_MIN_DISTANCE = 1e-3f;
+    // min doppler ratio
+    static const float SPATIAL_DOPPLER_MIN = 0.5f;
+    // max doppler ratio, same as default max frequency ratio of backend
+    static const float SPATIAL_DOPPLER_MAX = 2.f;
+    // scalar ops, also used by reference
+    struct SpatialScalar {
+        // lane type
+        using V = float;
+        static float Load(const float* p) noexcept { return *p; }
+        static void Store(float* p, float v) noexcept { *p = v; }
+        static float Set1(float x) noexcept { return x; }
+        static float Add(float a, float b) noexcept { return a + b; }
+        static float Sub(float a, float b) noexcept { return a - b; }
+        static float Mul(float a, float b) noexcept { return a * b; }
+        static float Div(float a, float b) noexcept { return a / b; }
+        static float Sqrt(float a) noexcept { return std::sqrt(a); }
+        static float Min(float a, float b) noexcept { return a < b ? a : b; }
+        static float Max(float a, float b) noexcept { return a > b ? a : b; }
+    };
+#if defined(PLAYAU_SPATIAL_AVX2)
+    // avx2 ops
+    struct SpatialVector {
+        // lane type
+        using V = __m256;
+        static __m256 Load(const float* p) noexcept { return _mm256_loadu_ps(p); }
+        static void Store(float* p, __m256 v) noexcept { _mm256_storeu_ps(p, v); }
+        static __m256 Set1(float x) noexcept { return _mm256_set1_ps(x); }
+        static __m256 Add(__m256 a, __m256 b) noexcept { return _mm256_add_ps(a, b); }
+        static __m256 Sub(__m256 a, __m256 b) noexcept { return _mm256_sub_ps(a, b); }
+        static __m256 Mul(__m256 a, __m256 b) noexcept { return _mm256_mul_ps(a, b); }
+        static __m256 Div(__m256 a, __m256 b) noexcept { return _mm256_div_ps(a, b); }
+        static __m256 Sqrt(__m256 a) noexcept { return _mm256_sqrt_ps(a); }
+        static __m256 Min(__m256 a, __m256 b) noexcept { return _mm256_min_ps(a, b); }
+        static __m256 Max(__m256 a, __m256 b) noexcept { return _mm256_max_ps(a, b); }
+    };
+#elif defined(PLAYAU_SPATIAL_SSE2)
+    // sse2 ops
+    struct SpatialVector {
+        // lane type
+        using V = __m128;
+        static __m128 Load(const float* p) noexcept { return _mm_loadu_ps(p); }
+        static void Store(float* p, __m128 v) noexcept { _mm_storeu_ps(p, v); }
+        static __m128 Set1(float x) noexcept { return _mm_set1_ps(x); }
+        static __m128 Add(__m128 a, __m128 b) noexcept { return _mm_add_ps(a, b); }
+        static __m128 Sub(__m128 a, __m128 b) noexcept { return _mm_sub_ps(a, b); }
+        static __m128 Mul(__m128 a, __m128 b) noexcept { return _mm_mul_ps(a, b); }
+        static __m128 Div(__m128 a, __m128 b) noexcept { return _mm_div_ps(a, b); }
+        static __m128 Sqrt(__m128 a) noexcept { return _mm_sqrt_ps(a); }
+        static __m128 Min(__m128 a, __m128 b) noexcept { return _mm_min_ps(a, b); }
+        static __m128 Max(__m128 a, __m128 b) noexcept { return _mm_max_ps(a, b); }
+    };
+#elif defined(PLAYAU_SPATIAL_NEON)
+    // neon ops
+    struct SpatialVector {
+        // lane type
+        using V = float32x4_t;
+        static float32x4_t Load(const float* p) noexcept { return vld1q_f32(p); }
+        static void Store(float* p, float32x4_t v) noexcept { vst1q_f32(p, v); }
+        static float32x4_t Set1(float x) noexcept { return vdupq_n_f32(x); }
+        static float32x4_t Add(float32x4_t a, float32x4_t b) noexcept { return vaddq_f32(a, b); }
+        static float32x4_t Sub(float32x4_t a, float32x4_t b) noexcept { return vsubq_f32(a, b); }
+        static float32x4_t Mul(float32x4_t a, float32x4_t b) noexcept { return vmulq_f32(a, b); }
+        static float32x4_t Div(float32x4_t a, float32x4_t b) noexcept { return vdivq_f32(a, b); }
+        static float32x4_t Sqrt(float32x4_t a) noexcept { return vsqrtq_f32(a); }
+        static float32x4_t Min(float32x4_t a, float32x4_t b) noexcept { return vminq_f32(a, b); }
+        static float32x4_t Max(float32x4_t a, float32x4_t b) noexcept { return vmaxq_f32(a, b); }
+    };
+#else
+    // no simd
+    using SpatialVector = SpatialScalar;
+#endif
+    static_assert(SPATIAL_MAX_EMITTERS % (sizeof(SpatialVector::V) / sizeof(float)) == 0, "emitters must fill whole vectors");
+    // length of vector
+    static inline float SpatialLength(const AudioVector& v) noexcept {
+        return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    }
+    // normalize vector, fallback if zero
+    static inline AudioVector SpatialNormalize(const AudioVector& v, const AudioVector& fallback) noexcept {
+        const float len = PlayAU::SpatialLength(v);
+        if (!(len > 1e-12f)) return fallback;
+        return { v.x / len, v.y / len, v.z / len };
+    }
+    /// <summary>
+    /// Creates spatializer if not created.
+    /// </summary>
+    /// <param name="spatial">The spatializer.</param>
+    /// <returns></returns>
+    bool StartSpatializer(CAUSpatializer*& spatial) noexcept {
+        if (spatial) return true;
+        MemoryKindScope kind{ Memory_Spatial };
+        spatial = new(std::nothrow) CAUSpatializer;
+        return spatial != nullptr;
+    }
+}
+
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUSpatializer"/> class.
+/// </summary>
+PlayAU::CAUSpatializer::CAUSpatializer() noexcept {
+    for (uint32_t i = 0; i != SPATIAL_MAX_EMITTERS; ++i) {
+        m_user[i] = nullptr;
+        m_next[i] = i + 1;
+        this->reset(i);
+    }
+}
+
+/// <summary>
+/// Resets the emitter to silent.
+/// </summary>
+/// <param name="id">The identifier.</param>
+/// <returns></returns>
+void PlayAU::CAUSpatializer::reset(uint32_t id) noexcept {
+    // 空闲位置也参与批量计算, 保持数值有限
+    m_px[id] = m_py[id] = m_pz[id] = 0.f;
+    m_vx[id] = m_vy[id] = m_vz[id] = 0.f;
+    m_fx[id] = m_fy[id] = 0.f; m_fz[id] = 1.f;
+    m_cone_outer[id] = -1.f; m_cone_scale[id] = 0.f;
+    m_cone_volume[id] = 0.f; m_cone_delta[id] = 0.f;
+    m_min[id] = m_max[id] = 1.f;
+    m_rolloff[id] = m_linear[id] = 0.f;
+    m_wnone[id] = m_winv[id] = m_wlin[id] = 0.f;
+    m_dscale[id] = 0.f;
+    m_gain[id] = m_left[id] = m_right[id] = 0.f;
+    m_doppler[id] = 1.f;
+}
+
+/// <summary>
+/// Sets the listener.
+/// </summary>
+/// <param name="listener">The listener.</param>
+/// <returns></returns>
+void PlayAU::CAUSpatializer::SetListener(const AudioListener& listener) noexcept {
+    m_listener = listener;
+    m_listener.front = PlayAU::SpatialNormalize(listener.front, { 0.f, 0.f, 1.f });
+    m_listener.top = PlayAU::SpatialNormalize(listener.top, { 0.f, 1.f, 0.f });
+    if (!(listener.speed_of_sound > 0.f)) m_listener.speed_of_sound = AudioListener{}.speed_of_sound;
+}
+
+/// <summary>
+/// Adds the emitter.
+/// </summary>
+/// <param name="emitter">The emitter.</param>
+/// <param name="user">The user data.</param>
+/// <returns></returns>
+auto PlayAU::CAUSpatializer::AddEmitter(const AudioEmitter& emitter, void* user) noexcept -> uint32_t {
+    const uint32_t id = m_free;
+    if (!user || id >= SPATIAL_MAX_EMITTERS) return SPATIAL_NO_EMITTER;
+    m_free = m_next[id];
+    m_user[id] = user;
+    if (id >= m_end) m_end = id + 1;
+    this->SetEmitter(id, emitter);
+    return id;
+}
+
+/// <summary>
+/// Sets the emitter.
+/// </summary>
+/// <param name="id">The identifier.</param>
+/// <param name="emitter">The emitter.</param>
+/// <returns></returns>
+void PlayAU::CAUSpatializer::SetEmitter(uint32_t id, const AudioEmitter& emitter) noexcept {
+    if (id >= SPATIAL_MAX_EMITTERS || !m_user[id]) return;
+    const float pi2 = 6.2831853f;
+    m_px[id] = emitter.position.x; m_py[id] = emitter.position.y; m_pz[id] = emitter.position.z;
+    m_vx[id] = emitter.velocity.x; m_vy[id] = emitter.velocity.y; m_vz[id] = emitter.velocity.z;
+    const auto front = PlayAU::SpatialNormalize(emitter.front, { 0.f, 0.f, 1.f });
+    m_fx[id] = front.x; m_fy[id] = front.y; m_fz[id] = front.z;
+    // 锥体: 按夹角余弦在内外角之间线性插值
+    auto inner = emitter.cone.inner_angle, outer = emitter.cone.outer_angle;
+    inner = inner < 0.f ? 0.f : (inner > pi2 ? pi2 : inner);
+    outer = outer < inner ? inner : (outer > pi2 ? pi2 : outer);
+    const float cos_inner = std::cos(inner * 0.5f), cos_outer = std::cos(outer * 0.5f);
+    const float diff = cos_inner - cos_outer;
+    m_cone_outer[id] = cos_outer;
+    m_cone_scale[id] = diff > 1e-6f ? 1.f / diff : 1e6f;
+    m_cone_volume[id] = emitter.cone.outer_volume;
+    m_cone_delta[id] = emitter.cone.inner_volume - emitter.cone.outer_volume;
+    // 距离衰减
+    const float min = emitter.min_distance > SPATIAL_MIN_DISTANCE ? emitter.min_distance : SPATIAL_MIN_DISTANCE;
+    const float max = emitter.max_distance > min ? emitter.max_distance : min;
+    const float rolloff = emitter.rolloff > 0.f ? emitter.rolloff : 0.f;
+    m_min[id] = min;
+    m_max[id] = max;
+    m_rolloff[id] = rolloff;
+    m_linear[id] = max > min ? rolloff / (max - min) : 0.f;
+    m_wnone[id] = emitter.curve == Attenuation_None ? 1.f : 0.f;
+    m_winv[id] = emitter.curve == Attenuation_Inverse ? 1.f : 0.f;
+    m_wlin[id] = emitter.curve == Attenuation_Linear ? 1.f : 0.f;
+    m_dscale[id] = emitter.doppler_scale > 0.f ? emitter.doppler_scale : 0.f;
+}
+
+/// <summary>
+/// Removes the emitter.
+/// </summary>
+/// <param name="id">The identifier.</param>
+/// <returns></returns>
+void PlayAU::CAUSpatializer::RemoveEmitter(uint32_t id) noexcept {
+    if (id >= SPATIAL_MAX_EMITTERS || !m_user[id]) return;
+    m_user[id] = nullptr;
+    this->reset(id);
+    m_next[id] = m_free;
+    m_free = id;
+    // 收缩批量计算的范围
+    while (m_end && !m_user[m_end - 1]) --m_end;
+}
+
+/// <summary>
+/// Updates emitters [0, end) in lanes.
+/// </summary>
+/// <returns></returns>
+template<typename O> void PlayAU::CAUSpatializer::update() noexcept {
+    using V = typename O::V;
+    constexpr uint32_t lanes = sizeof(V) / sizeof(float);
+    const auto& l = m_listener;
+    // 右方向 = 上方向 x 前方向 (左手系)
+    const AudioVector cross = {
+        l.top.y * l.front.z - l.top.z * l.front.y,
+        l.top.z * l.front.x - l.top.x * l.front.z,
+        l.top.x * l.front.y - l.top.y * l.front.x,
+    };
+    const auto right = PlayAU::SpatialNormalize(cross, { 1.f, 0.f, 0.f });
+    const V lx = O::Set1(l.position.x), ly = O::Set1(l.position.y), lz = O::Set1(l.position.z);
+    const V lvx = O::Set1(l.velocity.x), lvy = O::Set1(l.velocity.y), lvz = O::Set1(l.velocity.z);
+    const V rx = O::Set1(right.x), ry = O::Set1(right.y), rz = O::Set1(right.z);
+    const V speed = O::Set1(l.speed_of_sound);
+    const V speed_min = O::Set1(l.speed_of_sound * 1e-3f);
+    const V zero = O::Set1(0.f), one = O::Set1(1.f), half = O::Set1(0.5f), neg = O::Set1(-1.f);
+    const V eps = O::Set1(SPATIAL_MIN_DISTANCE * 1e-3f);
+    const V dmin = O::Set1(SPATIAL_DOPPLER_MIN), dmax = O::Set1(SPATIAL_DOPPLER_MAX);
+    const uint32_t end = (m_end + lanes - 1) / lanes * lanes;
+    for (uint32_t i = 0; i < end; i += lanes) {
+        // 听者指向发声体
+        const V dx = O::Sub(O::Load(m_px + i), lx);
+        const V dy = O::Sub(O::Load(m_py + i), ly);
+        const V dz = O::Sub(O::Load(m_pz + i), lz);
+        const V dist = O::Sqrt(O::Add(O::Add(O::Mul(dx, dx), O::Mul(dy, dy)), O::Mul(dz, dz)));
+        const V inv = O::Div(one, O::Max(dist, eps));
+        const V ux = O::Mul(dx, inv), uy = O::Mul(dy, inv), uz = O::Mul(dz, inv);
+        // 等功率声像: 投影到右方向
+        V pan = O::Add(O::Add(O::Mul(ux, rx), O::Mul(uy, ry)), O::Mul(uz, rz));
+        pan = O::Min(O::Max(pan, neg), one);
+        O::Store(m_left + i, O::Sqrt(O::Mul(O::Sub(one, pan), half)));
+        O::Store(m_right + i, O::Sqrt(O::Mul(O::Add(one, pan), half)));
+        // 锥体: 发声体前方与指向听者方向的夹角
+        const V front = O::Add(O::Add(
+            O::Mul(ux, O::Load(m_fx + i)), O::Mul(uy, O::Load(m_fy + i))), O::Mul(uz, O::Load(m_fz + i)));
+        V t = O::Mul(O::Sub(O::Sub(zero, front), O::Load(m_cone_outer + i)), O::Load(m_cone_scale + i));
+        t = O::Min(O::Max(t, zero), one);
+        const V cone = O::Add(O::Load(m_cone_volume + i), O::Mul(O::Load(m_cone_delta + i), t));
+        // 距离衰减, 各曲线都算再按权重选择
+        const V min = O::Load(m_min + i);
+        const V over = O::Sub(O::Min(O::Max(dist, min), O::Load(m_max + i)), min);
+        const V ginv = O::Div(min, O::Add(min, O::Mul(O::Load(m_rolloff + i), over)));
+        const V glin = O::Max(O::Sub(one, O::Mul(O::Load(m_linear + i), over)), zero);
+        const V att = O::Add(O::Add(O::Load(m_wnone + i),
+            O::Mul(O::Load(m_winv + i), ginv)), O::Mul(O::Load(m_wlin + i), glin));
+        O::Store(m_gain + i, O::Mul(att, cone));
+        // 多普勒: 速度投影到发声体指向听者的方向, 超音速部分截断
+        const V vls = O::Sub(zero, O::Add(O::Add(O::Mul(lvx, ux), O::Mul(lvy, uy)), O::Mul(lvz, uz)));
+        const V vss = O::Sub(zero, O::Add(O::Add(
+            O::Mul(O::Load(m_vx + i), ux), O::Mul(O::Load(m_vy + i), uy)), O::Mul(O::Load(m_vz + i), uz)));
+        const V scale = O::Load(m_dscale + i);
+        const V num = O::Max(O::Sub(speed, O::Mul(scale, vls)), speed_min);
+        const V den = O::Max(O::Sub(speed, O::Mul(scale, vss)), speed_min);
+        O::Store(m_doppler + i, O::Min(O::Max(O::Div(num, den), dmin), dmax));
+    }
+}
+
+/// <summary>
+/// Updates all emitters.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSpatializer::Update() noexcept {
+    this->update<SpatialVector>();
+}
+
+/// <summary>
+/// Updates all emitters, scalar reference.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUSpatializer::UpdateScalar() noexcept {
+    this->update<SpatialScalar>();
+}
+
+/// <summary>
+/// Gets the output matrix.
+/// </summary>
+/// <param name="id">The identifier.</param>
+/// <param name="in">The input channel count.</param>
+/// <param name="out">The output channel count.</param>
+/// <param name="matrix">The matrix, out * in at least.</param>
+/// <returns></returns>
+bool PlayAU::CAUSpatializer::GetMatrix(uint32_t id, uint32_t in, uint32_t out, float* matrix) const noexcept {
+    if (id >= SPATIAL_MAX_EMITTERS || !m_user[id]) return false;
+    const float gain = m_gain[id];
+    return PlayAU::GetSideMatrix(in, out, m_left[id] * gain, m_right[id] * gain, gain, matrix);
+}
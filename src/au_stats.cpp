@@ -0,0 +1,80 @@
+﻿#include "../inc/playau.h"
+#include "private/p_au_stats.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+
+/// <summary>
+/// Records the mixer pass end.
+/// </summary>
+/// <param name="engine">The engine.</param>
+/// <param name="ns">The ns.</param>
+/// <returns></returns>
+void PlayAU::StatsPassEnd(EngineCounters& engine, uint64_t ns) noexcept {
+    PlayAU::StatsAdd<uint64_t>(engine.passes, 1);
+    PlayAU::StatsAdd<uint64_t>(engine.pass_ns, ns);
+    PlayAU::StatsMax<uint64_t>(engine.pass_max_ns, ns);
+    // 按微秒的2的幂分桶
+    uint64_t us = ns / 1000;
+    uint32_t index = 0;
+    while (us && index != STATS_HISTOGRAM_COUNT - 1) { us >>= 1; ++index; }
+    PlayAU::StatsAdd<uint32_t>(engine.pass_histogram[index], 1);
+}
+
+/// <summary>
+/// Gets cpu time of the calling thread.
+/// </summary>
+/// <returns>ns, 0 if not supported</returns>
+uint64_t PlayAU::StatsThreadCpu() noexcept {
+#ifdef _WIN32
+    FILETIME create, exit, kernel, user;
+    if (!::GetThreadTimes(::GetCurrentThread(), &create, &exit, &kernel, &user)) return 0;
+    const auto ticks = [](const FILETIME& t) noexcept {
+        return uint64_t(t.dwHighDateTime) << 32 | t.dwLowDateTime;
+    };
+    // 以100ns为单位
+    return (ticks(kernel) + ticks(user)) * 100;
+#else
+    timespec ts;
+    if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) return 0;
+    return uint64_t(ts.tv_sec) * 1000000000u + uint64_t(ts.tv_nsec);
+#endif
+}
+
+/// <summary>
+/// Reads the snapshot of clip counters.
+/// </summary>
+/// <param name="stats">The stats.</param>
+/// <returns></returns>
+void PlayAU::ClipCounters::Snapshot(ClipStats& stats) const noexcept {
+    // 各计数器独立读取, 快照不保证彼此一致
+    constexpr auto order = std::memory_order_relaxed;
+    stats.bytes_decoded = this->bytes_decoded.load(order);
+    stats.decode_ns = this->decode_ns.load(order);
+    stats.decode_max_ns = this->decode_max_ns.load(order);
+    stats.buffers_submitted = this->buffers_submitted.load(order);
+    stats.underruns = this->underruns.load(order);
+    stats.errors = this->errors.load(order);
+    stats.queued = this->queued.load(order);
+}
+
+/// <summary>
+/// Reads the snapshot of engine counters.
+/// </summary>
+/// <param name="stats">The stats.</param>
+/// <returns></returns>
+void PlayAU::EngineCounters::Snapshot(EngineStats& stats) const noexcept {
+    constexpr auto order = std::memory_order_relaxed;
+    this->clips.Snapshot(stats.clips);
+    stats.passes = this->passes.load(order);
+    stats.pass_ns = this->pass_ns.load(order);
+    stats.pass_max_ns = this->pass_max_ns.load(order);
+    stats.voices = this->voices.load(order);
+    stats.critical_errors = this->critical_errors.load(order);
+    for (uint32_t i = 0; i != STATS_HISTOGRAM_COUNT; ++i)
+        stats.pass_histogram[i] = this->pass_histogram[i].load(order);
+}
@@ -0,0 +1,169 @@
+﻿#include "../inc/au_trace.h"
+#include "private/p_au_memory.h"
+#include "private/p_au_trace.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef PLAYAU_FLAG_TRACE
+#include <atomic>
+#include <new>
+
+namespace PlayAU {
+    // trace event
+    struct TraceRecord {
+        // name
+        const char*     name;
+        // begin time in ns
+        uint64_t        begin;
+        // duration in ns
+        uint64_t        duration;
+    };
+    /// <summary>
+    /// single writer ring for one thread, kept after the thread exits so
+    /// export can read its events, freed when engine uninitialized
+    /// </summary>
+    struct TraceRing {
+        // next ring in global list
+        TraceRing*              next;
+        // thread id in trace
+        uint32_t                tid;
+        // events written, slot = count % TRACE_RING_LENGTH
+        std::atomic<uint64_t>   count;
+        // events dropped by ClearTrace
+        std::atomic<uint64_t>   cleared;
+        // events
+        TraceRecord             records[TRACE_RING_LENGTH];
+    };
+    // ring list head
+    static std::atomic<TraceRing*> s_pTraceRings{ nullptr };
+    // thread id counter
+    static std::atomic<uint32_t> s_uTraceThread{ 0 };
+    // ring generation, bumped when rings released
+    static std::atomic<uint32_t> s_uTraceGeneration{ 0 };
+    // ring of this thread
+    static thread_local TraceRing* t_pTraceRing = nullptr;
+    // generation of ring of this thread
+    static thread_local uint32_t t_uTraceGeneration = 0;
+    /// <summary>
+    /// Gets the ring of this thread.
+    /// </summary>
+    /// <returns></returns>
+    static TraceRing* TraceThisRing() noexcept {
+        const auto generation = s_uTraceGeneration.load(std::memory_order_acquire);
+        // 释放过的环不再使用
+        if (t_pTraceRing && t_uTraceGeneration == generation) return t_pTraceRing;
+        // 环属于全局, 不记在正在创建的片段上
+        MemoryKindScope kind{ Memory_Other };
+        MemoryChargeScope charge{ nullptr };
+        const auto mem = PlayAU::Alloc(sizeof(TraceRing));
+        if (!mem) return nullptr;
+        const auto ring = new(mem) TraceRing{};
+        ring->tid = ++s_uTraceThread;
+        // 无锁压入全局链表
+        auto head = s_pTraceRings.load(std::memory_order_relaxed);
+        do { ring->next = head; }
+        while (!s_pTraceRings.compare_exchange_weak(head, ring, std::memory_order_release, std::memory_order_relaxed));
+        t_pTraceRing = ring;
+        t_uTraceGeneration = generation;
+        return ring;
+    }
+}
+
+/// <summary>
+/// Records the complete event.
+/// </summary>
+/// <param name="name">The name.</param>
+/// <param name="begin">The begin.</param>
+/// <param name="end">The end.</param>
+/// <returns></returns>
+void PlayAU::TraceEvent(const char* name, uint64_t begin, uint64_t end) noexcept {
+    const auto ring = TraceThisRing();
+    if (!ring) return;
+    const auto count = ring->count.load(std::memory_order_relaxed);
+    auto& record = ring->records[count % TRACE_RING_LENGTH];
+    record.name = name;
+    record.begin = begin;
+    record.duration = end - begin;
+    // 写完再发布, 导出时据此判断槽位是否被覆盖
+    ring->count.store(count + 1, std::memory_order_release);
+}
+#endif
+
+/// <summary>
+/// Exports recorded events as chrome trace json.
+/// </summary>
+/// <param name="writer">The writer.</param>
+/// <param name="user">The user.</param>
+/// <returns></returns>
+void PlayAU::ExportTrace(TraceWriter writer, void* user) noexcept {
+    const char head[] = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    writer(user, head, sizeof(head) - 1);
+#ifdef PLAYAU_FLAG_TRACE
+    char buf[256]; bool first = true;
+    auto ring = s_pTraceRings.load(std::memory_order_acquire);
+    for (; ring; ring = ring->next) {
+        const auto count = ring->count.load(std::memory_order_acquire);
+        const auto cleared = ring->cleared.load(std::memory_order_relaxed);
+        uint64_t index = count > TRACE_RING_LENGTH ? count - TRACE_RING_LENGTH : 0;
+        if (index < cleared) index = cleared;
+        for (; index < count; ++index) {
+            const TraceRecord record = ring->records[index % TRACE_RING_LENGTH];
+            // 读取期间被写入线程覆盖(或正在覆盖)的槽位丢弃
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const auto now = ring->count.load(std::memory_order_relaxed);
+            if (now - index >= TRACE_RING_LENGTH) continue;
+            // 时间单位为微秒, 保留纳秒精度
+            const auto len = std::snprintf(
+                buf, sizeof(buf),
+                "%s{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%llu.%03u%s}",
+                first ? "" : ",\n",
+                record.name,
+                record.duration ? "X" : "i",
+                ring->tid,
+                static_cast<unsigned long long>(record.begin / 1000),
+                static_cast<unsigned>(record.begin % 1000),
+                static_cast<unsigned long long>(record.duration / 1000),
+                static_cast<unsigned>(record.duration % 1000),
+                record.duration ? "" : ",\"s\":\"t\""
+            );
+            if (len <= 0) continue;
+            writer(user, buf, static_cast<uint32_t>(len));
+            first = false;
+        }
+    }
+#endif
+    const char tail[] = "]}\n";
+    writer(user, tail, sizeof(tail) - 1);
+}
+
+/// <summary>
+/// Frees rings of all threads, threads get new rings at next event.
+/// </summary>
+/// <returns></returns>
+void PlayAU::ReleaseTrace() noexcept {
+#ifdef PLAYAU_FLAG_TRACE
+    auto ring = s_pTraceRings.exchange(nullptr, std::memory_order_acq_rel);
+    s_uTraceGeneration.fetch_add(1, std::memory_order_release);
+    while (ring) {
+        const auto next = ring->next;
+        ring->~TraceRing();
+        PlayAU::Free(ring);
+        ring = next;
+    }
+#endif
+}
+
+/// <summary>
+/// Drops recorded events.
+/// </summary>
+/// <returns></returns>
+void PlayAU::ClearTrace() noexcept {
+#ifdef PLAYAU_FLAG_TRACE
+    auto ring = s_pTraceRings.load(std::memory_order_acquire);
+    for (; ring; ring = ring->next) {
+        const auto count = ring->count.load(std::memory_order_acquire);
+        ring->cleared.store(count, std::memory_order_relaxed);
+    }
+#endif
+}
@@ -0,0 +1,285 @@
+﻿#include "private/p_au_engine_interface.h"
+#include "private/p_au_trace.h"
+#include "private/p_au_wave.h"
+
+#include <cstring>
+#include <new>
+
+
+namespace PlayAU {
+    // read little endian
+    template<typename T> static inline T WaveRead(const uint8_t* ptr) noexcept {
+        T value = 0;
+        for (uint32_t i = 0; i != sizeof(T); ++i) value |= T(ptr[i]) << (i * 8);
+        return value;
+    }
+    // chunk id
+    static inline bool WaveChunkIs(const uint8_t* ptr, const char id[4]) noexcept {
+        return !std::memcmp(ptr, id, 4);
+    }
+    /// <summary>
+    /// wave stream, serves pcm/float straight from file stream
+    /// </summary>
+    /// <seealso cref="XAUAudioStream" />
+    struct CAUWaveAudioStream final : XAUAudioStream {
+    public:
+        // ctor
+        CAUWaveAudioStream() noexcept;
+        // init
+        bool Init(const WaveHeader& header) noexcept;
+        // dispose
+        void Dispose() noexcept override;
+        // seek stream in byte, return current position
+        bool Seek(int64_t off, Move method = XAUStream::Move_Begin) noexcept override;
+        // read stream, return byte count read
+        auto ReadNext(uint32_t len, void* buf) noexcept->uint32_t override;
+        // view next bytes in file stream
+        auto ViewNext(uint32_t len, uint32_t& read) noexcept->const void* override;
+    private:
+        // clamp length to data left in block
+        auto clamp(uint32_t len) const noexcept->uint32_t;
+    private:
+        // data chunk offset in file
+        uint64_t                m_uDataOffset = 0;
+        // block align
+        uint32_t                m_uBlockAlign = 1;
+    };
+    /// <summary>
+    /// Creates the wave audio stream.
+    /// </summary>
+    /// <param name="file">The file.</param>
+    /// <param name="out">The out.</param>
+    /// <returns></returns>
+    bool CreateWaveAudioStream(FileStreamHolder& file, AudioStreamHolder& out) noexcept {
+        WaveHeader header;
+        if (!PlayAU::ParseWaveHeader(*file, header)) return false;
+        return PlayAU::CreateWaveAudioStream(file, out, header);
+    }
+}
+
+
+/// <summary>
+/// Parses the RIFF/RF64 wave header.
+/// </summary>
+/// <param name="file">The file.</param>
+/// <param name="header">The header.</param>
+/// <returns></returns>
+bool PlayAU::ParseWaveHeader(XAUStream& file, WaveHeader& header) noexcept {
+    std::memset(&header, 0, sizeof(header));
+    uint8_t buf[WAVE_FMT_MAX_LENGTH];
+    // RIFF/RF64 + 长度 + WAVE
+    if (file.ReadNext(12, buf) != 12) return false;
+    const bool rf64 = WaveChunkIs(buf, "RF64");
+    if (!rf64 && !WaveChunkIs(buf, "RIFF")) return false;
+    if (!WaveChunkIs(buf + 8, "WAVE")) return false;
+    uint64_t data_size64 = 0;
+    bool has_fmt = false, has_data = false;
+    while (!(has_fmt && has_data)) {
+        if (file.ReadNext(WAVE_CHUNK_HEADER_LENGTH, buf) != WAVE_CHUNK_HEADER_LENGTH)
+            break;
+        uint64_t size = WaveRead<uint32_t>(buf + 4);
+        const uint64_t begin = file.offset;
+        // RF64: 64位长度
+        if (WaveChunkIs(buf, "ds64")) {
+            const uint32_t len = size < 24 ? 0 : 24;
+            if (!len || file.ReadNext(len, buf) != len) return false;
+            data_size64 = WaveRead<uint64_t>(buf + 8);
+        }
+        // 格式
+        else if (WaveChunkIs(buf, "fmt ")) {
+            if (size < 16) return false;
+            const uint32_t len = size < WAVE_FMT_MAX_LENGTH
+                ? static_cast<uint32_t>(size)
+                : WAVE_FMT_MAX_LENGTH
+                ;
+            if (file.ReadNext(len, buf) != len) return false;
+            header.tag = WaveRead<uint16_t>(buf + 0);
+            header.channels = WaveRead<uint16_t>(buf + 2);
+            header.sample_rate = WaveRead<uint32_t>(buf + 4);
+            header.block_align = WaveRead<uint16_t>(buf + 12);
+            header.bits_per_sample = WaveRead<uint16_t>(buf + 14);
+            header.valid_bits = header.bits_per_sample;
+            // 额外数据
+            if (len >= WAVE_FMT_BASE_LENGTH) {
+                uint32_t extra = WaveRead<uint16_t>(buf + 16);
+                const uint32_t kept = len - WAVE_FMT_BASE_LENGTH;
+                if (extra > kept) extra = kept;
+                header.extra_size = static_cast<uint16_t>(extra);
+                std::memcpy(header.extra, buf + WAVE_FMT_BASE_LENGTH, extra);
+            }
+            // WAVE_FORMAT_EXTENSIBLE: 子格式GUID的前两字节为格式标签
+            if (header.tag == WAVE_TAG_EXTENSIBLE) {
+                static const uint8_t SUBTYPE[14] = {
+                    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                    0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71,
+                };
+                if (header.extra_size < 22) return false;
+                if (std::memcmp(buf + 26, SUBTYPE, sizeof(SUBTYPE))) return false;
+                header.valid_bits = WaveRead<uint16_t>(buf + 18);
+                header.channel_mask = WaveRead<uint32_t>(buf + 20);
+                header.tag = WaveRead<uint16_t>(buf + 24);
+            }
+            has_fmt = true;
+        }
+        // 样本数
+        else if (WaveChunkIs(buf, "fact") && size >= 4) {
+            if (file.ReadNext(4, buf) != 4) return false;
+            header.fact_samples = WaveRead<uint32_t>(buf);
+        }
+        // 数据
+        else if (WaveChunkIs(buf, "data")) {
+            if (rf64 && size == 0xFFFFFFFF) size = data_size64;
+            header.data_offset = begin;
+            header.data_size = size;
+            has_data = true;
+            // 数据块在格式块之前的话继续查找
+            if (has_fmt) break;
+        }
+        // 跳过块, 长度补齐到偶数
+        const uint64_t next = begin + size + (size & 1);
+        if (next >= file.length) break;
+        if (!file.Seek(static_cast<int64_t>(next), XAUStream::Move_Begin)) return false;
+    }
+    if (!has_fmt || !has_data || !header.channels || !header.block_align) return false;
+    // 长度未知或者被截断的文件
+    const uint64_t left = header.data_offset < file.length
+        ? file.length - header.data_offset
+        : 0
+        ;
+    if (header.data_size > left) header.data_size = left;
+    return file.Seek(static_cast<int64_t>(header.data_offset), XAUStream::Move_Begin);
+}
+
+/// <summary>
+/// Creates the wave audio stream with parsed header.
+/// </summary>
+/// <param name="file">The file.</param>
+/// <param name="out">The out.</param>
+/// <param name="header">The header.</param>
+/// <returns></returns>
+bool PlayAU::CreateWaveAudioStream(FileStreamHolder& file, AudioStreamHolder& out, const WaveHeader& header) noexcept {
+    // ADPCM需要解码
+    if (header.tag == WAVE_TAG_MSADPCM || header.tag == WAVE_TAG_IMAADPCM)
+        return PlayAU::CreateAdpcmAudioStream(file, out, header);
+    return PlayAU::CreateAudioStream<CAUWaveAudioStream>(file, out, header);
+}
+
+/// <summary>
+/// Initializes a new instance of the <see cref="CAUWaveAudioStream"/> struct.
+/// </summary>
+PlayAU::CAUWaveAudioStream::CAUWaveAudioStream() noexcept {
+    this->length = 0;
+    this->offset = 0;
+}
+
+/// <summary>
+/// Initializes this instance.
+/// </summary>
+/// <param name="header">The header.</param>
+/// <returns></returns>
+bool PlayAU::CAUWaveAudioStream::Init(const WaveHeader& header) noexcept {
+    uint8_t tag;
+    switch (header.tag)
+    {
+    case WAVE_TAG_PCM:
+        switch (header.bits_per_sample)
+        {
+        case 8: case 16: case 24: case 32: break;
+        default: return false;
+        }
+        tag = Wave_PCM;
+        break;
+    case WAVE_TAG_IEEE_FLOAT:
+        if (header.bits_per_sample != 32) return false;
+        tag = Wave_IEEEFloat;
+        break;
+    default:
+        return false;
+    }
+    // 只支持紧凑排列的样本
+    const uint32_t block_align = header.channels * header.bits_per_sample / 8;
+    if (header.channels > 0xff || header.block_align != block_align) return false;
+    m_uBlockAlign = block_align;
+    m_uDataOffset = header.data_offset;
+    this->format.channels = static_cast<uint8_t>(header.channels);
+    this->format.samples_per_sec = header.sample_rate;
+    this->format.bits_per_sample = header.bits_per_sample;
+    this->format.fmt_tag = tag;
+    this->length = header.data_size - header.data_size % block_align;
+    // 样本直接来自文件: 映射后可以零拷贝提交, 失败则按块读取
+    this->FileStream()->Map();
+    return true;
+}
+
+/// <summary>
+/// Releases unmanaged and - optionally - managed resources.
+/// </summary>
+/// <returns></returns>
+void PlayAU::CAUWaveAudioStream::Dispose() noexcept {
+    this->DisposeFS();
+}
+
+/// <summary>
+/// Seeks the specified off.
+/// </summary>
+/// <param name="off">The off.</param>
+/// <param name="method">The method.</param>
+/// <returns></returns>
+bool PlayAU::CAUWaveAudioStream::Seek(int64_t off, Move method) noexcept {
+    int64_t target = off;
+    // 相对移动
+    switch (method)
+    {
+    case PlayAU::XAUStream::Move_Current:
+        target += static_cast<int64_t>(this->offset);
+        break;
+    case PlayAU::XAUStream::Move_End:
+        target += static_cast<int64_t>(this->length);
+        break;
+    }
+    if (target < 0) target = 0;
+    if (static_cast<uint64_t>(target) > this->length) target = static_cast<int64_t>(this->length);
+    // 对齐到块
+    const auto pos = static_cast<uint64_t>(target) / m_uBlockAlign * m_uBlockAlign;
+    const auto fs = this->FileStream();
+    if (!fs->Seek(static_cast<int64_t>(m_uDataOffset + pos), XAUStream::Move_Begin))
+        return false;
+    this->offset = pos;
+    return true;
+}
+
+/// <summary>
+/// Clamps the length to data left in block.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <returns></returns>
+auto PlayAU::CAUWaveAudioStream::clamp(uint32_t len) const noexcept -> uint32_t {
+    const uint64_t left = this->length - this->offset;
+    if (len > left) len = static_cast<uint32_t>(left);
+    return len / m_uBlockAlign * m_uBlockAlign;
+}
+
+/// <summary>
+/// Reads the next.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <param name="buf">The buf.</param>
+/// <returns></returns>
+auto PlayAU::CAUWaveAudioStream::ReadNext(uint32_t len, void* buf) noexcept -> uint32_t {
+    PLAYAU_TRACE_SCOPE("wave.ReadNext");
+    const auto read = this->FileStream()->ReadNext(this->clamp(len), buf);
+    this->offset += read;
+    return read;
+}
+
+/// <summary>
+/// Views the next bytes in file stream without copying.
+/// </summary>
+/// <param name="len">The length.</param>
+/// <param name="read">The read.</param>
+/// <returns></returns>
+auto PlayAU::CAUWaveAudioStream::ViewNext(uint32_t len, uint32_t& read) noexcept -> const void* {
+    const auto ptr = this->FileStream()->ViewNext(this->clamp(len), read);
+    this->offset += read;
+    return ptr;
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace PlayAU {
+    // adpcm constant
+    enum AdpcmConstant : uint32_t {
+        // ms-adpcm standard coefficient set count
+        ADPCM_MS_COEF_COUNT = 7,
+        // ms-adpcm block header length per channel
+        ADPCM_MS_HEADER_LENGTH = 7,
+        // ima-adpcm block header length per channel
+        ADPCM_IMA_HEADER_LENGTH = 4,
+        // max channel count
+        ADPCM_MAX_CHANNELS = 8,
+        // blocks decoded per batch
+        ADPCM_BLOCK_BATCH = 4,
+    };
+    // ms-adpcm predictor coefficient
+    struct AdpcmCoef {
+        // coefficient for last sample
+        int16_t     c1;
+        // coefficient for second last sample
+        int16_t     c2;
+    };
+    // standard ms-adpcm coefficients
+    extern const AdpcmCoef ADPCM_MS_COEFS[ADPCM_MS_COEF_COUNT];
+    // samples per ms-adpcm block, 0 if block align is invalid
+    auto MsAdpcmBlockSamples(uint32_t block_align, uint32_t channels) noexcept->uint32_t;
+    // samples per ima-adpcm block, 0 if block align is invalid
+    auto ImaAdpcmBlockSamples(uint32_t block_align, uint32_t channels) noexcept->uint32_t;
+    // decode ms-adpcm blocks to interleaved pcm16, block i goes to out + i * samples * channels
+    void DecodeMsAdpcmBlocks(
+        const uint8_t* data, uint32_t block_align, uint32_t count,
+        uint32_t channels, uint32_t samples,
+        const AdpcmCoef coefs[], uint32_t coef_count,
+        int16_t* out
+    ) noexcept;
+    // decode ima-adpcm blocks to interleaved pcm16, block i goes to out + i * samples * channels
+    void DecodeImaAdpcmBlocks(
+        const uint8_t* data, uint32_t block_align, uint32_t count,
+        uint32_t channels, uint32_t samples,
+        int16_t* out
+    ) noexcept;
+    // encode one ima-adpcm block from interleaved pcm16, frames less than block samples
+    // are padded with last sample, index[channels] carries step index between blocks
+    void EncodeImaAdpcmBlock(
+        uint8_t* block, uint32_t block_align,
+        uint32_t channels, const int16_t* pcm, uint32_t frames,
+        int32_t index[]
+    ) noexcept;
+}
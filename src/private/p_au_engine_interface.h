@@ -11,6 +11,7 @@
 
 #include <cstdint>
 #include "../../inc/au_base.h"
+#include "../../inc/au_stream.h"
 
 // readonly, write by self
 #define pconst
@@ -18,6 +19,16 @@
 namespace PlayAU {
     // group
     class CAUAudioGroup;
+    // seek point of bank entry
+    struct BankSeekPoint;
+    // max frequency ratio of clip voices, XAUDIO2_DEFAULT_FREQ_RATIO
+    constexpr float CLIP_MAX_RATIO = 2.f;
+    // min frequency ratio of clip voices, XAUDIO2_MIN_FREQ_RATIO
+    constexpr float CLIP_MIN_RATIO = 1.f / 1024.f;
+    // clamp frequency ratio into voice range
+    inline float ClipClampRatio(float ratio) noexcept {
+        return ratio > CLIP_MAX_RATIO ? CLIP_MAX_RATIO : (ratio < CLIP_MIN_RATIO ? CLIP_MIN_RATIO : ratio);
+    }
     // base interface
     struct PLAYAU_NOVTABLE IAUBase {
         // dispose
@@ -31,12 +42,14 @@ namespace PlayAU {
         virtual void Resume() noexcept = 0;
         // call context
         virtual void CallContext(void* ctx1, void* ctx2) noexcept = 0;
+        // output channel count
+        virtual auto OutputChannels() noexcept -> uint32_t = 0;
         // make clip context
         virtual bool MakeClipCtx(void*) noexcept = 0;
         // dispose clip context
         virtual void DisposeClipCtx(void*) noexcept = 0;
         // tell clip context
-        virtual auto TellClip(const void*) noexcept -> uint32_t = 0;
+        virtual auto TellClip(const void*) noexcept -> uint64_t = 0;
         // play clip context
         virtual void PlayClip(void*) noexcept = 0;
         // pause clip context
@@ -44,11 +57,13 @@ namespace PlayAU {
         // stop clip context
         virtual void StopClip(void*) noexcept = 0;
         // seek clip in byte
-        virtual void SeekClip(void*, uint32_t) noexcept = 0;
+        virtual void SeekClip(void*, uint64_t) noexcept = 0;
         // ratio clip context
         virtual auto RatioClip(void*, float*) noexcept -> float = 0;
         // volume clip context
         virtual auto VolumeClip(void*, float*) noexcept -> float = 0;
+        // output matrix clip context, [output * clip channels + clip channel], nullptr for standard
+        virtual bool MatrixClip(void*, const float*) noexcept = 0;
         // live: buffer left
         virtual auto LiveClipBuffer(void*) noexcept->uint32_t = 0;
         // live: buffer submit
@@ -60,30 +75,54 @@ namespace PlayAU {
         // volume group
         virtual auto VolumeGroup(CAUAudioGroup&, float*) noexcept -> float = 0;
     };
-    // Stream Interface for read less than 4GB stream
+    // Stream Interface
     struct PLAYAU_NOVTABLE XAUStream : IAUBase {
         // method to move
         enum Move : uint32_t { Move_Begin = 0, Move_Current, Move_End };
         // read stream, return byte count read
         virtual auto ReadNext(uint32_t len, void* buf) noexcept->uint32_t = 0;
         // seek stream in byte, if successful, return true
-        virtual bool Seek(int32_t off, Move method = XAUStream::Move_Begin) noexcept = 0;
-        // move this to new positon (&&)
-        virtual void MoveTo(void* target) noexcept = 0;
+        virtual bool Seek(int64_t off, Move method = XAUStream::Move_Begin) noexcept = 0;
+        // view next bytes in place and move on, valid until disposed, nullptr if not supported
+        virtual auto ViewNext(uint32_t /*len*/, uint32_t& read) noexcept->const void* { read = 0; return nullptr; }
+        // map whole stream for ViewNext, return true if viewable
+        virtual bool Map() noexcept { return false; }
         // total length
-        uint32_t     pconst length;
+        uint64_t     pconst length;
         // curret offset, EOF/EOS if greater or eql to @length
-        uint32_t     pconst offset;
+        uint64_t     pconst offset;
     };
     // interface for audio stream
     struct PLAYAU_NOVTABLE XAUAudioStream : XAUStream {
         // wave format
         WaveFormat   pconst format;
-        // file stream buffer
-        uintptr_t    pconst fsbuffer[FILE_STREAM_BUFLEN];
         // file stream
-        auto FileStream() noexcept { return reinterpret_cast<XAUStream*>(fsbuffer); }
+        FileStreamHolder    file;
+        // file stream
+        auto FileStream() noexcept { return file.Get(); }
         // dispose file stream
-        void DisposeFS() noexcept { FileStream()->Dispose(); }
+        void DisposeFS() noexcept { file.Reset(); }
+        // set frame to byte seek table of file stream, table must outlive the stream
+        virtual void SetSeekTable(const BankSeekPoint* /*table*/, uint32_t /*count*/) noexcept { }
     };
+    /// <summary>
+    /// Creates audio stream T owning the file stream,
+    /// the file stream is given back if init failed.
+    /// </summary>
+    /// <param name="file">The file.</param>
+    /// <param name="out">The out.</param>
+    /// <param name="args">The arguments for T::Init.</param>
+    /// <returns></returns>
+    template<typename T, typename... Args>
+    bool CreateAudioStream(FileStreamHolder& file, AudioStreamHolder& out, Args&&... args) noexcept {
+        const auto obj = out.template Emplace<T>();
+        if (!obj) return false;
+        obj->file = std::move(file);
+        if (obj->Init(std::forward<Args>(args)...)) return true;
+        file = std::move(obj->file);
+        out.Reset();
+        return false;
+    }
+    // create memory stream viewing shared data, release(owner) called once disposed
+    bool CreateSharedMemoryStream(FileStreamHolder& out, const void* data, uint32_t len, void(*release)(void*), void* owner) noexcept;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace PlayAU {
+    // flac constant
+    enum FlacConstant : uint32_t {
+        // max channel count
+        FLAC_MAX_CHANNELS = 8,
+        // max lpc order
+        FLAC_MAX_LPC_ORDER = 32,
+        // max bits per sample supported
+        FLAC_MAX_BITS_PER_SAMPLE = 24,
+        // max block size
+        FLAC_MAX_BLOCKSIZE = 65535,
+        // metadata block header length
+        FLAC_METADATA_HEADER_LENGTH = 4,
+        // streaminfo block length
+        FLAC_STREAMINFO_LENGTH = 34,
+        // seekpoint length in seektable block
+        FLAC_SEEKPOINT_LENGTH = 18,
+        // frame header max length
+        FLAC_FRAME_HEADER_MAX = 16,
+        // extra samples after channel buffer for simd prediction
+        FLAC_SAMPLE_PADDING = 4,
+    };
+    // flac decode status
+    enum FlacStatus : uint32_t {
+        // ok
+        Flac_OK = 0,
+        // need more data
+        Flac_NeedMore,
+        // bad data
+        Flac_Error,
+    };
+    // flac stream info
+    struct FlacStreamInfo {
+        // total samples in stream, 0 if unknown
+        uint64_t    total_samples;
+        // min block size in samples
+        uint32_t    min_blocksize;
+        // max block size in samples
+        uint32_t    max_blocksize;
+        // min frame size in bytes, 0 if unknown
+        uint32_t    min_framesize;
+        // max frame size in bytes, 0 if unknown
+        uint32_t    max_framesize;
+        // sample rate in Hz
+        uint32_t    sample_rate;
+        // channel count
+        uint32_t    channels;
+        // bits per sample
+        uint32_t    bits_per_sample;
+    };
+    // flac seek point
+    struct FlacSeekPoint {
+        // first sample number of target frame
+        uint64_t    sample;
+        // byte offset of target frame in file
+        uint64_t    offset;
+    };
+    // flac frame header
+    struct FlacFrameHeader {
+        // first sample number of this frame
+        uint64_t    sample;
+        // block size in samples
+        uint32_t    blocksize;
+        // channel assignment: 0-7 independent, 8 left-side, 9 right-side, 10 mid-side
+        uint32_t    assignment;
+        // header length in bytes
+        uint32_t    length;
+    };
+    // parse streaminfo block data
+    bool ParseFlacStreamInfo(const uint8_t* data, FlacStreamInfo& info) noexcept;
+    // parse frame header
+    auto ParseFlacFrameHeader(
+        const uint8_t* data, uint32_t len,
+        const FlacStreamInfo& info,
+        FlacFrameHeader& header
+    ) noexcept->FlacStatus;
+    // decode a whole frame into channel buffers (max_blocksize + FLAC_SAMPLE_PADDING)
+    auto DecodeFlacFrame(
+        const uint8_t* data, uint32_t len,
+        const FlacStreamInfo& info,
+        FlacFrameHeader& header,
+        int32_t* const channels[],
+        uint32_t& used
+    ) noexcept->FlacStatus;
+    // interleave decoded samples to pcm
+    void InterleaveFlacSamples(
+        void* dst,
+        const int32_t* const channels[],
+        uint32_t channel_count,
+        uint32_t offset, uint32_t count,
+        uint32_t bytes, uint32_t shift
+    ) noexcept;
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "../../inc/au_stats.h"
+
+namespace PlayAU {
+    // config interface
+    struct IAUConfigure;
+    // memory constant
+    enum MemoryConstant : size_t {
+        // header before each allocation, keeps max_align_t alignment
+        MEMORY_HEADER_LENGTH = 32,
+    };
+    // set kind of allocations on this thread, return old one
+    auto MemorySwapKind(MemoryKind kind) noexcept->MemoryKind;
+    // set counter charged by allocations on this thread, return old one
+    auto MemorySwapCharge(std::atomic<int64_t>* counter) noexcept->std::atomic<int64_t>*;
+    // write header to raw block of len + MEMORY_HEADER_LENGTH, return user pointer
+    void* MemoryAttach(void* base, size_t len, IAUConfigure* allocator) noexcept;
+    // raw block of the user pointer
+    void* MemoryBase(void* ptr) noexcept;
+    // allocator owning the user pointer, nullptr for c runtime heap
+    auto MemoryOwner(void* ptr) noexcept->IAUConfigure*;
+    // account reallocated raw block to new length, return user pointer
+    void* MemoryResize(void* base, size_t len) noexcept;
+    // release accounting of the user pointer, return raw block
+    void* MemoryDetach(void* ptr) noexcept;
+    // memory kind scope, nested scope overrides
+    struct MemoryKindScope {
+        // ctor
+        MemoryKindScope(MemoryKind kind) noexcept : old(PlayAU::MemorySwapKind(kind)) {}
+        // dtor
+        ~MemoryKindScope() noexcept { PlayAU::MemorySwapKind(old); }
+        // old kind
+        MemoryKind  const   old;
+    };
+    // memory charge scope, bytes allocated minus bytes freed inside are added to counter
+    struct MemoryChargeScope {
+        // ctor
+        MemoryChargeScope(std::atomic<int64_t>* counter) noexcept : old(PlayAU::MemorySwapCharge(counter)) {}
+        // dtor
+        ~MemoryChargeScope() noexcept { PlayAU::MemorySwapCharge(old); }
+        // old counter
+        std::atomic<int64_t>* const old;
+    };
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include "../../inc/au_stats.h"
+
+namespace PlayAU {
+    // now in ns, monotonic
+    inline uint64_t StatsNow() noexcept {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+    // add counter, relaxed: counters are independent
+    template<typename T> inline void StatsAdd(std::atomic<T>& x, T value) noexcept {
+        x.fetch_add(value, std::memory_order_relaxed);
+    }
+    // raise max counter
+    template<typename T> inline void StatsMax(std::atomic<T>& x, T value) noexcept {
+        T old = x.load(std::memory_order_relaxed);
+        while (old < value && !x.compare_exchange_weak(old, value, std::memory_order_relaxed));
+    }
+    // record one SubmitNext to clip and engine
+    inline void StatsSubmit(ClipCounters& clip, ClipCounters& all, uint32_t bytes, uint64_t ns) noexcept {
+        ClipCounters* const list[] = { &clip, &all };
+        for (const auto counters : list) {
+            PlayAU::StatsAdd<uint64_t>(counters->bytes_decoded, bytes);
+            PlayAU::StatsAdd<uint64_t>(counters->decode_ns, ns);
+            PlayAU::StatsMax<uint64_t>(counters->decode_max_ns, ns);
+            if (bytes) PlayAU::StatsAdd<uint32_t>(counters->buffers_submitted, 1);
+        }
+    }
+    // record mixer pass end
+    void StatsPassEnd(EngineCounters& engine, uint64_t ns) noexcept;
+    // cpu time of calling thread in ns, user and kernel
+    uint64_t StatsThreadCpu() noexcept;
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <cstdint>
+#include "../../inc/au_config.h"
+
+namespace PlayAU {
+    // free rings of all threads, no thread may be tracing
+    void ReleaseTrace() noexcept;
+}
+
+#ifdef PLAYAU_FLAG_TRACE
+#include "p_au_stats.h"
+
+namespace PlayAU {
+    // record complete event to ring of this thread, name must be static string
+    void TraceEvent(const char* name, uint64_t begin, uint64_t end) noexcept;
+    // scoped trace
+    struct TraceScope {
+        // ctor
+        TraceScope(const char* n) noexcept : name(n), begin(PlayAU::StatsNow()) {}
+        // dtor
+        ~TraceScope() noexcept { PlayAU::TraceEvent(name, begin, PlayAU::StatsNow()); }
+        // name
+        const char* const   name;
+        // begin time
+        uint64_t    const   begin;
+    };
+}
+#define PLAYAU_TRACE_JOIN2(a, b) a##b
+#define PLAYAU_TRACE_JOIN(a, b) PLAYAU_TRACE_JOIN2(a, b)
+// trace current scope
+#define PLAYAU_TRACE_SCOPE(name) PlayAU::TraceScope PLAYAU_TRACE_JOIN(playau_trace_, __LINE__){ name }
+// trace instant event
+#define PLAYAU_TRACE_INSTANT(name) { const auto playau_now = PlayAU::StatsNow(); PlayAU::TraceEvent(name, playau_now, playau_now); }
+// trace event with measured begin time
+#define PLAYAU_TRACE_EVENT(name, begin, end) PlayAU::TraceEvent(name, begin, end)
+#else
+#define PLAYAU_TRACE_SCOPE(name) (void)0
+#define PLAYAU_TRACE_INSTANT(name) (void)0
+#define PLAYAU_TRACE_EVENT(name, begin, end) (void)0
+#endif
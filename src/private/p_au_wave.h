@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <cstdint>
+#include "../../inc/au_stream.h"
+
+namespace PlayAU {
+    // wave constant
+    enum WaveConstant : uint32_t {
+        // riff chunk header length
+        WAVE_CHUNK_HEADER_LENGTH = 8,
+        // fmt chunk length before extra bytes
+        WAVE_FMT_BASE_LENGTH = 18,
+        // max fmt extra bytes kept, enough for ms-adpcm coefficients
+        WAVE_FMT_EXTRA_LENGTH = 32,
+        // max fmt chunk length to read
+        WAVE_FMT_MAX_LENGTH = WAVE_FMT_BASE_LENGTH + WAVE_FMT_EXTRA_LENGTH,
+        // WAVE_FORMAT_PCM
+        WAVE_TAG_PCM = 0x0001,
+        // WAVE_FORMAT_ADPCM
+        WAVE_TAG_MSADPCM = 0x0002,
+        // WAVE_FORMAT_IEEE_FLOAT
+        WAVE_TAG_IEEE_FLOAT = 0x0003,
+        // WAVE_FORMAT_DVI_ADPCM
+        WAVE_TAG_IMAADPCM = 0x0011,
+        // WAVE_FORMAT_EXTENSIBLE
+        WAVE_TAG_EXTENSIBLE = 0xFFFE,
+    };
+    // riff wave header
+    struct WaveHeader {
+        // data chunk offset in file
+        uint64_t    data_offset;
+        // data chunk length in byte
+        uint64_t    data_size;
+        // samples per sec
+        uint32_t    sample_rate;
+        // sample frames in fact chunk, 0 if not found
+        uint32_t    fact_samples;
+        // channel mask, 0 if not extensible
+        uint32_t    channel_mask;
+        // format tag, sub format if extensible
+        uint16_t    tag;
+        // channels
+        uint16_t    channels;
+        // block align
+        uint16_t    block_align;
+        // container bits per sample
+        uint16_t    bits_per_sample;
+        // valid bits per sample
+        uint16_t    valid_bits;
+        // fmt extra bytes length (cbSize), clamped to kept length
+        uint16_t    extra_size;
+        // fmt extra bytes
+        uint8_t     extra[WAVE_FMT_EXTRA_LENGTH];
+    };
+    // parse RIFF/RF64 wave header, file is left at data chunk
+    bool ParseWaveHeader(XAUStream& file, WaveHeader& header) noexcept;
+    // create wave audio stream with parsed header, file is at data
+    bool CreateWaveAudioStream(FileStreamHolder& file, AudioStreamHolder& out, const WaveHeader& header) noexcept;
+    // create adpcm audio stream with parsed header
+    bool CreateAdpcmAudioStream(FileStreamHolder& file, AudioStreamHolder& out, const WaveHeader& header) noexcept;
+}